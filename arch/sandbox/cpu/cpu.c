@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <cpu_work.h>
 #include <dm.h>
 #include <errno.h>
 #include <linux/libfdt.h>
@@ -238,6 +239,35 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
 {
 }
 
+#if CONFIG_IS_ENABLED(CPU_WORK)
+/* Secondary CPUs are host threads */
+static void *cpu_work_thread[CONFIG_CPU_WORK_CPUS + 1];
+static int cpu_work_cpus_override = -1;
+
+void sandbox_set_cpu_work_cpus(int cpus)
+{
+	cpu_work_cpus_override = cpus;
+}
+
+int arch_cpu_work_cpus(void)
+{
+	if (cpu_work_cpus_override >= 0)
+		return cpu_work_cpus_override;
+
+	return os_cpu_count() - 1;
+}
+
+int arch_cpu_work_start(int cpu, void (*func)(void *arg), void *arg)
+{
+	return os_thread_start(&cpu_work_thread[cpu], func, arg);
+}
+
+void arch_cpu_work_wait(int cpu)
+{
+	os_thread_join(cpu_work_thread[cpu]);
+}
+#endif
+
 int sandbox_read_fdt_from_file(void)
 {
 	struct sandbox_state *state = state_get_current();
@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -156,6 +157,76 @@ err:
 	return ret;
 }
 
+int os_map_file(int fd, void **bufp, size_t *sizep)
+{
+	struct stat st;
+	void *buf;
+
+	if (fstat(fd, &st) || !st.st_size)
+		return -EINVAL;
+
+	buf = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (buf == MAP_FAILED)
+		return -ENOMEM;
+	*bufp = buf;
+	*sizep = st.st_size;
+
+	return 0;
+}
+
+int os_unmap(void *buf, size_t size)
+{
+	return munmap(buf, size) ? -EINVAL : 0;
+}
+
+struct os_thread {
+	pthread_t thread;
+	void (*func)(void *arg);
+	void *arg;
+};
+
+static void *os_thread_entry(void *ptr)
+{
+	struct os_thread *thread = ptr;
+
+	thread->func(thread->arg);
+
+	return NULL;
+}
+
+int os_thread_start(void **threadp, void (*func)(void *arg), void *arg)
+{
+	struct os_thread *thread;
+
+	thread = os_malloc(sizeof(*thread));
+	if (!thread)
+		return -ENOMEM;
+	thread->func = func;
+	thread->arg = arg;
+	if (pthread_create(&thread->thread, NULL, os_thread_entry, thread)) {
+		os_free(thread);
+		return -EAGAIN;
+	}
+	*threadp = thread;
+
+	return 0;
+}
+
+void os_thread_join(void *ptr)
+{
+	struct os_thread *thread = ptr;
+
+	pthread_join(thread->thread, NULL);
+	os_free(thread);
+}
+
+int os_cpu_count(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return count > 0 ? count : 1;
+}
+
 /* Restore tty state when we exit */
 static struct termios orig_term;
 static bool term_setup;
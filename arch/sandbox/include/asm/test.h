@@ -67,6 +67,15 @@ void sandbox_i2c_eeprom_set_offset_len(struct udevice *dev, int offset_len);
  */
 void sandbox_timer_add_offset(unsigned long offset);
 
+/*
+ * sandbox_timer_add_offset_us()
+ *
+ * As sandbox_timer_add_offset(), but for emulated devices which need to
+ * account for short delays, such as bus transfer times
+ * offset: number of microseconds to advance the system time
+ */
+void sandbox_timer_add_offset_us(unsigned long offset);
+
 /**
  * sandbox_i2c_rtc_set_offset() - set the time offset from system/base time
  *
@@ -121,6 +130,71 @@ int sandbox_pwm_get_config(struct udevice *dev, uint channel, uint *period_nsp,
  */
 void sandbox_sf_set_block_protect(struct udevice *dev, int bp_mask);
 
+/**
+ * sandbox_sf_set_map() - Enable/disable the memory-mapped read window
+ *
+ * This allows tests to compare memory-mapped reads with normal SPI reads.
+ * The window is enabled by default.
+ *
+ * @dev: Device to update
+ * @enable: true to offer the window, false to force reads over SPI
+ */
+void sandbox_sf_set_map(struct udevice *dev, bool enable);
+
+/**
+ * sandbox_sf_set_dtr() - Enable/disable DTR reads
+ *
+ * With DTR disabled, DTR read commands return corrupted data, as they would
+ * on a board whose layout cannot cope with sampling on both clock edges. DTR
+ * is enabled by default.
+ *
+ * @dev: Device to update
+ * @enable: true to return correct data for DTR reads
+ */
+void sandbox_sf_set_dtr(struct udevice *dev, bool enable);
+
+/**
+ * sandbox_sf_set_sfdp() - Enable/disable the SFDP tables
+ *
+ * With SFDP disabled, the Read SFDP command fails, so the SPI NOR core sets
+ * up the flash from its flash_info entry alone. SFDP is enabled by default.
+ *
+ * @dev: Device to update
+ * @enable: true to answer the Read SFDP command
+ */
+void sandbox_sf_set_sfdp(struct udevice *dev, bool enable);
+
+/**
+ * sandbox_sf_get_erase_count() - Get the number of erase commands carried out
+ *
+ * This allows tests to check how a range is erased, e.g. that whole blocks
+ * are erased with one command.
+ *
+ * @dev: Device to check
+ * @return number of erase commands since the device was probed
+ */
+uint sandbox_sf_get_erase_count(struct udevice *dev);
+
+/**
+ * sandbox_mmc_set_host_caps() - Change the capabilities of a sandbox MMC host
+ *
+ * This allows tests to restrict the bus modes and widths that can be selected.
+ * The new capabilities are used the next time the card is initialised.
+ *
+ * @dev: MMC device to update
+ * @host_caps: New capabilities (MMC_MODE_...)
+ */
+void sandbox_mmc_set_host_caps(struct udevice *dev, uint host_caps);
+
+/**
+ * sandbox_mmc_get_cmd_count() - Get the number of commands an eMMC received
+ *
+ * @dev: MMC device to check (must be a "sandbox,emmc" device)
+ * @cmdidx: Command to check (MMC_CMD_...)
+ * @return number of times the command has been received since probe
+ */
+uint sandbox_mmc_get_cmd_count(struct udevice *dev, uint cmdidx);
+
 /**
  * sandbox_get_codec_params() - Read back codec parameters
  *
@@ -74,6 +74,16 @@ int pci_unmap_physmem(const void *addr, unsigned long len,
  */
 void sandbox_set_enable_pci_map(int enable);
 
+/**
+ * sandbox_set_cpu_work_cpus() - Set the number of secondary CPUs
+ *
+ * By default there is one secondary CPU for each extra CPU on the host.
+ * This allows tests to use threads even on a single-CPU host.
+ *
+ * @cpus: Number of secondary CPUs, or -1 for the default
+ */
+void sandbox_set_cpu_work_cpus(int cpus);
+
 /**
  * sandbox_read_fdt_from_file() - Read a device tree from a file
  *
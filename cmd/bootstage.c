@@ -4,6 +4,8 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -48,19 +50,58 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 	}
 
 	if (0 == strcmp(argv[0], "stash"))
-		ret = bootstage_stash((void *)base, size);
+		ret = bootstage_stash(map_sysmem(base, size), size);
 	else
-		ret = bootstage_unstash((void *)base, size);
+		ret = bootstage_unstash(map_sysmem(base, size), size);
 	if (ret)
 		return 1;
 
 	return 0;
 }
 
+static int do_bootstage_export(cmd_tbl_t *cmdtp, int flag, int argc,
+			       char * const argv[])
+{
+	ulong addr, size;
+	char *buf;
+	int needed;
+
+	/* With no address, print it out */
+	if (argc < 2) {
+		size = bootstage_export_json(NULL, 0);
+		buf = malloc(size);
+		if (!buf) {
+			printf("Out of memory (need %#lx bytes)\n", size);
+			return CMD_RET_FAILURE;
+		}
+		bootstage_export_json(buf, size);
+		puts(buf);
+		free(buf);
+
+		return 0;
+	}
+	if (argc < 3)
+		return CMD_RET_USAGE;
+	addr = simple_strtoul(argv[1], NULL, 16);
+	size = simple_strtoul(argv[2], NULL, 16);
+	buf = map_sysmem(addr, size);
+	needed = bootstage_export_json(buf, size);
+	unmap_sysmem(buf);
+	if (needed > size) {
+		printf("Buffer too small (need %#x bytes)\n", needed);
+		return CMD_RET_FAILURE;
+	}
+	/* Leave out the terminator, so the file can be saved directly */
+	env_set_hex("filesize", needed - 1);
+
+	return 0;
+}
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+	U_BOOT_CMD_MKENT(export, 3, 0, do_bootstage_export, "", ""),
 };
 
 /*
@@ -90,5 +131,7 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
-	"unstash [<start> [<size>]]  - Unstash data from memory"
+	"unstash [<start> [<size>]]  - Unstash data from memory\n"
+	"export [<start> <size>]     - Export Chrome trace JSON to memory\n"
+	"                              (setting filesize) or the console"
 );
@@ -13,6 +13,7 @@
 #include <mapmem.h>
 #include <errno.h>
 #include <asm/io.h>
+#include <dm/arena.h>
 #include <dm/root.h>
 #include <dm/util.h>
 
@@ -40,10 +41,21 @@ static int do_dm_dump_devres(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_dm_dump_arena(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	dm_dump_arena();
+
+	return 0;
+}
+
 static cmd_tbl_t test_commands[] = {
 	U_BOOT_CMD_MKENT(tree, 0, 1, do_dm_dump_all, "", ""),
 	U_BOOT_CMD_MKENT(uclass, 1, 1, do_dm_dump_uclass, "", ""),
 	U_BOOT_CMD_MKENT(devres, 1, 1, do_dm_dump_devres, "", ""),
+#if CONFIG_IS_ENABLED(DM_ARENA)
+	U_BOOT_CMD_MKENT(arena, 0, 1, do_dm_dump_arena, "", ""),
+#endif
 };
 
 static __maybe_unused void dm_reloc(void)
@@ -85,4 +97,7 @@ U_BOOT_CMD(
 	"tree          Dump driver model tree ('*' = activated)\n"
 	"dm uclass        Dump list of instances for each uclass\n"
 	"dm devres        Dump list of device resources for each device"
+#if CONFIG_IS_ENABLED(DM_ARENA)
+	"\ndm arena         Show arenas used for bind-time allocations"
+#endif
 );
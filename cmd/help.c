@@ -27,8 +27,13 @@ U_BOOT_CMD(
 	"	- print detailed usage of 'command'"
 );
 
-/* This does not use the U_BOOT_CMD macro as ? can't be used in symbol names */
-ll_entry_declare(cmd_tbl_t, question_mark, cmd) = {
+/*
+ * This does not use the U_BOOT_CMD macro as ? can't be used in symbol names.
+ * The linker sorts the command table by symbol name and find_cmd() relies on
+ * that matching the order of the command names, so use a name which sorts
+ * before the letters, as '?' does.
+ */
+ll_entry_declare(cmd_tbl_t, 0question_mark, cmd) = {
 	"?",	CONFIG_SYS_MAXARGS,	1,	do_help,
 	"alias for 'help'",
 #ifdef  CONFIG_SYS_LONGHELP
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show statistics about the malloc() heap
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <malloc.h>
+
+static const char *const malloc_op_name[MALLOC_OP_COUNT] = {
+	"malloc",
+	"calloc",
+	"realloc",
+	"memalign",
+	"free",
+};
+
+static ulong malloc_ticks_to_us(u64 ticks)
+{
+	return lldiv(ticks * 1000, max(get_tbclk() / 1000, 1UL));
+}
+
+/* Write a size in bytes, or in KiB if it is a whole number of them */
+static void malloc_size_str(char *buf, int len, const char *prefix, ulong size)
+{
+	if (size >= 1024 && !(size & 1023))
+		snprintf(buf, len, "%s%luK", prefix, size >> 10);
+	else
+		snprintf(buf, len, "%s%lu", prefix, size);
+}
+
+static int do_malloc_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	struct malloc_heap_stats st;
+	char size[20];
+	int i;
+
+	malloc_get_stats(&st);
+	printf("Heap:      %08lx-%08lx, %lu bytes from sbrk(), peak %lu\n",
+	       mem_malloc_start, mem_malloc_end, st.heap_size, st.heap_peak);
+	printf("Allocated: %lu bytes, peak %lu\n", st.in_use, st.peak);
+	printf("Free:      %lu bytes in %lu chunks, largest %lu, top %lu\n",
+	       st.free_bytes, st.free_chunks, st.largest_free, st.top_size);
+	printf("Failures:  %lu, fast-bin hits %lu\n", st.failures,
+	       st.fast_hits);
+
+	printf("\nFunction       Calls  Time (us)\n");
+	for (i = 0; i < MALLOC_OP_COUNT; i++) {
+		printf("%-10s %9lu %10lu\n", malloc_op_name[i], st.calls[i],
+		       malloc_ticks_to_us(st.ticks[i]));
+	}
+
+	printf("\nRequest size     Count\n");
+	for (i = 0; i < MALLOC_HIST_COUNT; i++) {
+		if (i < MALLOC_HIST_COUNT - 1)
+			malloc_size_str(size, sizeof(size), "<= ", 16UL << i);
+		else
+			malloc_size_str(size, sizeof(size), ">  ",
+					16UL << (i - 1));
+		printf("%-12s %9lu\n", size, st.hist[i]);
+	}
+
+	return 0;
+}
+
+static int do_malloc_reset(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	malloc_reset_stats();
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_malloc_sub[] = {
+	U_BOOT_CMD_MKENT(stats, 0, 1, do_malloc_stats, "", ""),
+	U_BOOT_CMD_MKENT(reset, 0, 1, do_malloc_reset, "", ""),
+};
+
+static int do_malloc(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char *const argv[])
+{
+	cmd_tbl_t *cp;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+	argc--;
+	argv++;
+
+	cp = find_cmd_tbl(argv[0], cmd_malloc_sub, ARRAY_SIZE(cmd_malloc_sub));
+	if (!cp || argc > cp->maxargs + 1)
+		return CMD_RET_USAGE;
+
+	return cp->cmd(cmdtp, flag, argc, argv);
+}
+
+U_BOOT_CMD(
+	malloc,	2,	1,	do_malloc,
+	"malloc() heap statistics",
+	"stats - show how the heap is used and the time spent in malloc()\n"
+	"malloc reset - reset the call counts and peak use"
+);
@@ -7,6 +7,7 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <mapmem.h>
 #include <mmc.h>
 #include <sparse_format.h>
 #include <image-sparse.h>
@@ -323,6 +324,14 @@ static lbaint_t mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t mmc_sparse_erase(struct sparse_storage *info,
+				 lbaint_t blk, lbaint_t blkcnt)
+{
+	struct blk_desc *dev_desc = info->priv;
+
+	return blk_derase(dev_desc, blk, blkcnt);
+}
+
 static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 			       int argc, char * const argv[])
 {
@@ -336,7 +345,7 @@ static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
-	addr = (void *)simple_strtoul(argv[1], NULL, 16);
+	addr = map_sysmem(simple_strtoul(argv[1], NULL, 16), 0);
 	blk = simple_strtoul(argv[2], NULL, 16);
 
 	if (!is_sparse_image(addr)) {
@@ -363,6 +372,11 @@ static int do_mmc_sparse_write(cmd_tbl_t *cmdtp, int flag,
 	sparse.size = dev_desc->lba - blk;
 	sparse.write = mmc_sparse_write;
 	sparse.reserve = mmc_sparse_reserve;
+	sparse.erase = NULL;
+	if (mmc->erase_zero) {
+		sparse.erase = mmc_sparse_erase;
+		sparse.erase_grp = mmc->erase_grp_size;
+	}
 	sparse.mssg = NULL;
 	sprintf(dest, "0x" LBAF, sparse.start * sparse.blksz);
 
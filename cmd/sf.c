@@ -14,6 +14,7 @@
 #include <spi_flash.h>
 #include <jffs2/jffs2.h>
 #include <linux/mtd/mtd.h>
+#include <u-boot/crc.h>
 
 #include <asm/io.h>
 #include <dm/device-internal.h>
@@ -152,24 +153,314 @@ static int do_spi_flash_probe(int argc, char * const argv[])
 	return 0;
 }
 
+#define SF_MANIFEST_MAGIC	0x4d554653	/* "SFUM" */
+#define SF_SUM_UNKNOWN		0xffffffff
+
 /**
- * Write a block of data to SPI flash, first checking if it is different from
- * what is already there.
+ * struct sf_manifest - checksums of the sectors written by 'sf update'
+ *
+ * This is stored in the flash at CONFIG_CMD_SF_UPDATE_MANIFEST_OFFSET so that
+ * 'sf update' can tell whether a sector already holds the new data without
+ * reading it. All values are little-endian.
  *
- * If the data being written is the same, then *skipped is incremented by len.
+ * @magic:		SF_MANIFEST_MAGIC
+ * @sector_size:	Size of the sectors described by @sum
+ * @count:		Number of entries in @sum, one per sector of the flash
+ * @crc:		crc32 of @sum
+ * @sum:		crc32 of the contents of each sector, or SF_SUM_UNKNOWN
+ */
+struct sf_manifest {
+	__le32 magic;
+	__le32 sector_size;
+	__le32 count;
+	__le32 crc;
+	__le32 sum[];
+};
+
+#ifdef CONFIG_CMD_SF_UPDATE_MANIFEST
+#define SF_MANIFEST_OFFSET	CONFIG_CMD_SF_UPDATE_MANIFEST_OFFSET
+#define SF_MANIFEST_SIZE	CONFIG_CMD_SF_UPDATE_MANIFEST_SIZE
+
+static ulong sf_manifest_size(struct spi_flash *flash)
+{
+	return sizeof(struct sf_manifest) +
+		flash->size / flash->sector_size * sizeof(__le32);
+}
+
+/* Check if a flash range is clear of the manifest area */
+static bool sf_manifest_outside(u32 offset, size_t len)
+{
+	return offset >= SF_MANIFEST_OFFSET + SF_MANIFEST_SIZE ||
+		offset + len <= SF_MANIFEST_OFFSET;
+}
+
+/* Check if this flash has room for a manifest */
+static bool sf_manifest_fits(struct spi_flash *flash)
+{
+	return SF_MANIFEST_OFFSET + SF_MANIFEST_SIZE <= flash->size &&
+		!(SF_MANIFEST_OFFSET % flash->sector_size) &&
+		sf_manifest_size(flash) <= SF_MANIFEST_SIZE;
+}
+
+/**
+ * Read the manifest for use by 'sf update'
  *
  * @param flash		flash context pointer
+ * @param offset	flash offset to be updated
+ * @param len		number of bytes to be updated
+ * @param erasep	Set to true if the manifest in the flash must be erased
+ *			before changing the flash
+ * @param newp		Set to true if a new manifest was started
+ * @return manifest, with every sector unknown if the flash does not hold a
+ * valid one, or NULL if it cannot be used for this update
+ */
+static struct sf_manifest *sf_manifest_load(struct spi_flash *flash,
+					    u32 offset, size_t len,
+					    bool *erasep, bool *newp)
+{
+	u32 count = flash->size / flash->sector_size;
+	struct sf_manifest *man;
+	u32 i;
+
+	*erasep = false;
+	*newp = false;
+	if (!sf_manifest_fits(flash) || !sf_manifest_outside(offset, len))
+		return NULL;
+	*erasep = true;
+	if (offset % flash->sector_size)
+		return NULL;
+	man = malloc(sf_manifest_size(flash));
+	if (!man)
+		return NULL;
+	if (!spi_flash_read(flash, SF_MANIFEST_OFFSET, sf_manifest_size(flash),
+			    man) &&
+	    le32_to_cpu(man->magic) == SF_MANIFEST_MAGIC &&
+	    le32_to_cpu(man->sector_size) == flash->sector_size &&
+	    le32_to_cpu(man->count) == count &&
+	    le32_to_cpu(man->crc) == crc32(0, (uchar *)man->sum,
+					   count * sizeof(__le32)))
+		return man;
+
+	debug("No valid manifest, starting a new one\n");
+	*newp = true;
+	man->magic = cpu_to_le32(SF_MANIFEST_MAGIC);
+	man->sector_size = cpu_to_le32(flash->sector_size);
+	man->count = cpu_to_le32(count);
+	for (i = 0; i < count; i++)
+		man->sum[i] = cpu_to_le32(SF_SUM_UNKNOWN);
+
+	return man;
+}
+
+static int sf_manifest_save(struct spi_flash *flash, struct sf_manifest *man)
+{
+	ulong size = sf_manifest_size(flash);
+
+	man->crc = cpu_to_le32(crc32(0, (uchar *)man->sum,
+				     size - sizeof(*man)));
+	if (spi_flash_erase(flash, SF_MANIFEST_OFFSET,
+			    ROUND(size, flash->sector_size)))
+		return -EIO;
+
+	return spi_flash_write(flash, SF_MANIFEST_OFFSET, size, man);
+}
+
+/* Erase the manifest header, if there is one */
+static int sf_manifest_erase(struct spi_flash *flash)
+{
+	struct sf_manifest hdr;
+
+	if (spi_flash_read(flash, SF_MANIFEST_OFFSET, sizeof(hdr), &hdr))
+		return -EIO;
+	if (le32_to_cpu(hdr.magic) != SF_MANIFEST_MAGIC)
+		return 0;
+	debug("Invalidating manifest\n");
+
+	return spi_flash_erase(flash, SF_MANIFEST_OFFSET, flash->sector_size);
+}
+
+/**
+ * Invalidate the manifest, before changing the flash contents
+ *
+ * This does nothing if the flash range includes the manifest area, since the
+ * caller is then writing the manifest area itself.
+ *
+ * @param flash		flash context pointer
+ * @param offset	flash offset about to be changed
+ * @param len		number of bytes about to be changed
+ * @return 0 if OK, -ve on error
+ */
+static int sf_manifest_invalidate(struct spi_flash *flash, u32 offset,
+				  size_t len)
+{
+	if (!sf_manifest_fits(flash) || !sf_manifest_outside(offset, len))
+		return 0;
+
+	return sf_manifest_erase(flash);
+}
+#else
+static struct sf_manifest *sf_manifest_load(struct spi_flash *flash,
+					    u32 offset, size_t len,
+					    bool *erasep, bool *newp)
+{
+	*erasep = false;
+	*newp = false;
+
+	return NULL;
+}
+
+static int sf_manifest_save(struct spi_flash *flash, struct sf_manifest *man)
+{
+	return 0;
+}
+
+static int sf_manifest_erase(struct spi_flash *flash)
+{
+	return 0;
+}
+
+static int sf_manifest_invalidate(struct spi_flash *flash, u32 offset,
+				  size_t len)
+{
+	return 0;
+}
+#endif /* CONFIG_CMD_SF_UPDATE_MANIFEST */
+
+/**
+ * struct sf_update - state of an 'sf update' in progress
+ *
+ * @flash:		flash context pointer
+ * @cmp_buf:		read buffer of one sector, used to compare data
+ * @man:		manifest, or NULL if not in use
+ * @man_erase:		true if the manifest in the flash must be erased before
+ *			changing the flash
+ * @man_changed:	true if @man must be written back at the end
+ * @run_offset:		flash offset of the run of sectors waiting to be written
+ * @run_buf:		buffer holding the data for the run
+ * @run_len:		length of the run in bytes, 0 if none
+ * @skipped:		count of skipped data
+ */
+struct sf_update {
+	struct spi_flash *flash;
+	char *cmp_buf;
+	struct sf_manifest *man;
+	bool man_erase;
+	bool man_changed;
+	u32 run_offset;
+	const char *run_buf;
+	size_t run_len;
+	size_t skipped;
+};
+
+/* Get ready to change the flash contents, by invalidating the manifest */
+static const char *spi_flash_update_start(struct sf_update *upd)
+{
+	if (upd->man_erase) {
+		if (sf_manifest_erase(upd->flash))
+			return "manifest";
+		upd->man_erase = false;
+	}
+
+	return NULL;
+}
+
+/**
+ * Erase and write the run of whole sectors collected so far
+ *
+ * The run is erased in one go, so that the flash driver can use its larger
+ * block erase where the run covers a whole block.
+ *
+ * @param upd		update state
+ * @return NULL if OK, else a string containing the stage which failed
+ */
+static const char *spi_flash_update_run(struct sf_update *upd)
+{
+	const char *err_oper;
+
+	if (!upd->run_len)
+		return NULL;
+	debug("Update region %x size %zx\n", upd->run_offset, upd->run_len);
+	err_oper = spi_flash_update_start(upd);
+	if (err_oper)
+		return err_oper;
+	if (spi_flash_erase(upd->flash, upd->run_offset, upd->run_len))
+		return "erase";
+	if (spi_flash_write(upd->flash, upd->run_offset, upd->run_len,
+			    upd->run_buf))
+		return "write";
+	upd->run_len = 0;
+
+	return NULL;
+}
+
+/* Record the new checksum of a sector in the manifest */
+static void spi_flash_update_sum(struct sf_update *upd, u32 offset, u32 sum)
+{
+	__le32 *entry;
+
+	if (!upd->man)
+		return;
+	entry = &upd->man->sum[offset / upd->flash->sector_size];
+	if (le32_to_cpu(*entry) != sum) {
+		*entry = cpu_to_le32(sum);
+		upd->man_changed = true;
+	}
+}
+
+/**
+ * Check whether a whole sector of SPI flash needs to change
+ *
+ * If the manifest has a checksum for the sector, that is used to decide.
+ * Otherwise the sector is read back and compared.
+ *
+ * @param upd		update state
+ * @param offset	flash offset of the sector
+ * @param buf		new data for the sector
+ * @param changedp	Set to true if the sector must be erased and written
+ * @return NULL if OK, else a string containing the stage which failed
+ */
+static const char *spi_flash_update_check(struct sf_update *upd, u32 offset,
+					  const char *buf, bool *changedp)
+{
+	struct spi_flash *flash = upd->flash;
+	u32 old, sum;
+
+	if (upd->man) {
+		sum = crc32(0, (const uchar *)buf, flash->sector_size);
+		old = le32_to_cpu(upd->man->sum[offset / flash->sector_size]);
+		spi_flash_update_sum(upd, offset, sum);
+		if (old != SF_SUM_UNKNOWN) {
+			*changedp = old != sum;
+			return NULL;
+		}
+	}
+
+	if (spi_flash_read(flash, offset, flash->sector_size, upd->cmp_buf))
+		return "read";
+	*changedp = memcmp(upd->cmp_buf, buf, flash->sector_size) != 0;
+
+	return NULL;
+}
+
+/**
+ * Write a partial sector of data to SPI flash, first checking if it is
+ * different from what is already there.
+ *
+ * If the data being written is the same, then upd->skipped is incremented by
+ * len.
+ *
+ * @param upd		update state
  * @param offset	flash offset to write
  * @param len		number of bytes to write
  * @param buf		buffer to write from
- * @param cmp_buf	read buffer to use to compare data
- * @param skipped	Count of skipped data (incremented by this function)
  * @return NULL if OK, else a string containing the stage which failed
  */
-static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
-		size_t len, const char *buf, char *cmp_buf, size_t *skipped)
+static const char *spi_flash_update_block(struct sf_update *upd, u32 offset,
+					  size_t len, const char *buf)
 {
-	char *ptr = (char *)buf;
+	struct spi_flash *flash = upd->flash;
+	char *cmp_buf = upd->cmp_buf;
+	const char *err_oper;
 
 	debug("offset=%#x, sector_size=%#x, len=%#zx\n",
 	      offset, flash->sector_size, len);
@@ -180,20 +471,22 @@ static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
 	if (memcmp(cmp_buf, buf, len) == 0) {
 		debug("Skip region %x size %zx: no change\n",
 		      offset, len);
-		*skipped += len;
-		return NULL;
-	}
-	/* Erase the entire sector */
-	if (spi_flash_erase(flash, offset, flash->sector_size))
-		return "erase";
-	/* If it's a partial sector, copy the data into the temp-buffer */
-	if (len != flash->sector_size) {
+		upd->skipped += len;
+	} else {
+		err_oper = spi_flash_update_start(upd);
+		if (err_oper)
+			return err_oper;
+		/* Erase the entire sector */
+		if (spi_flash_erase(flash, offset, flash->sector_size))
+			return "erase";
+		/* Copy the data into the temp-buffer and write it all */
 		memcpy(cmp_buf, buf, len);
-		ptr = cmp_buf;
+		if (spi_flash_write(flash, offset, flash->sector_size, cmp_buf))
+			return "write";
 	}
-	/* Write one complete sector */
-	if (spi_flash_write(flash, offset, flash->sector_size, ptr))
-		return "write";
+	if (upd->man)
+		spi_flash_update_sum(upd, offset, crc32(0, (uchar *)cmp_buf,
+							flash->sector_size));
 
 	return NULL;
 }
@@ -202,6 +495,10 @@ static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
  * Update an area of SPI flash by erasing and writing any blocks which need
  * to change. Existing blocks with the correct data are left unchanged.
  *
+ * Runs of adjacent sectors which need to change are erased and written
+ * together. With CONFIG_CMD_SF_UPDATE_MANIFEST, unchanged sectors are found
+ * using the manifest where possible, rather than by reading them.
+ *
  * @param flash		flash context pointer
  * @param offset	flash offset to write
  * @param len		number of bytes to write
@@ -212,21 +509,25 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 		size_t len, const char *buf)
 {
 	const char *err_oper = NULL;
-	char *cmp_buf;
 	const char *end = buf + len;
 	size_t todo;		/* number of bytes to do in this pass */
-	size_t skipped = 0;	/* statistics */
 	const ulong start_time = get_timer(0);
 	size_t scale = 1;
 	const char *start_buf = buf;
+	struct sf_update upd;
+	bool changed;
 	ulong delta;
 
+	memset(&upd, '\0', sizeof(upd));
+	upd.flash = flash;
 	if (end - buf >= 200)
 		scale = (end - buf) / 100;
-	cmp_buf = memalign(ARCH_DMA_MINALIGN, flash->sector_size);
-	if (cmp_buf) {
+	upd.cmp_buf = memalign(ARCH_DMA_MINALIGN, flash->sector_size);
+	if (upd.cmp_buf) {
 		ulong last_update = get_timer(0);
 
+		upd.man = sf_manifest_load(flash, offset, len, &upd.man_erase,
+					   &upd.man_changed);
 		for (; buf < end && !err_oper; buf += todo, offset += todo) {
 			todo = min_t(size_t, end - buf, flash->sector_size);
 			if (get_timer(last_update) > 100) {
@@ -236,13 +537,40 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 							 start_time));
 				last_update = get_timer(0);
 			}
-			err_oper = spi_flash_update_block(flash, offset, todo,
-					buf, cmp_buf, &skipped);
+			if (todo != flash->sector_size) {
+				err_oper = spi_flash_update_run(&upd);
+				if (!err_oper)
+					err_oper = spi_flash_update_block(&upd,
+							offset, todo, buf);
+				continue;
+			}
+			err_oper = spi_flash_update_check(&upd, offset, buf,
+							  &changed);
+			if (err_oper)
+				break;
+			if (!changed) {
+				debug("Skip region %x size %zx: no change\n",
+				      offset, todo);
+				upd.skipped += todo;
+				err_oper = spi_flash_update_run(&upd);
+			} else if (upd.run_len) {
+				upd.run_len += todo;
+			} else {
+				upd.run_offset = offset;
+				upd.run_buf = buf;
+				upd.run_len = todo;
+			}
 		}
+		if (!err_oper)
+			err_oper = spi_flash_update_run(&upd);
+		if (!err_oper && upd.man_changed &&
+		    sf_manifest_save(flash, upd.man))
+			err_oper = "manifest";
 	} else {
 		err_oper = "malloc";
 	}
-	free(cmp_buf);
+	free(upd.man);
+	free(upd.cmp_buf);
 	putc('\r');
 	if (err_oper) {
 		printf("SPI flash failed in %s step\n", err_oper);
@@ -250,8 +578,8 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 	}
 
 	delta = get_timer(start_time);
-	printf("%zu bytes written, %zu bytes skipped", len - skipped,
-	       skipped);
+	printf("%zu bytes written, %zu bytes skipped", len - upd.skipped,
+	       upd.skipped);
 	printf(" in %ld.%lds, speed %ld B/s\n",
 	       delta / 1000, delta % 1000, bytes_per_second(len, start_time));
 
@@ -298,10 +626,13 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 		int read;
 
 		read = strncmp(argv[0], "read", 4) == 0;
-		if (read)
+		if (read) {
 			ret = spi_flash_read(flash, offset, len, buf);
-		else
-			ret = spi_flash_write(flash, offset, len, buf);
+		} else {
+			ret = sf_manifest_invalidate(flash, offset, len);
+			if (!ret)
+				ret = spi_flash_write(flash, offset, len, buf);
+		}
 
 		printf("SF: %zu bytes @ %#x %s: ", (size_t)len, (u32)offset,
 		       read ? "Read" : "Written");
@@ -341,7 +672,9 @@ static int do_spi_flash_erase(int argc, char * const argv[])
 		return 1;
 	}
 
-	ret = spi_flash_erase(flash, offset, size);
+	ret = sf_manifest_invalidate(flash, offset, size);
+	if (!ret)
+		ret = spi_flash_erase(flash, offset, size);
 	printf("SF: %zu bytes @ %#x Erased: %s\n", (size_t)size, (u32)offset,
 	       ret ? "ERROR" : "OK");
 
@@ -52,6 +52,32 @@ static int create_func_list(int argc, char * const argv[])
 	return 0;
 }
 
+#ifdef CONFIG_TRACE_FUNC_TIMES
+static int create_time_list(int argc, char * const argv[])
+{
+	size_t buff_size, avail, buff_ptr, used;
+	unsigned int needed;
+	char *buff;
+	int err;
+
+	if (get_args(argc, argv, &buff, &buff_ptr, &buff_size))
+		return -1;
+
+	avail = buff_size - buff_ptr;
+	err = trace_list_times(buff + buff_ptr, avail, &needed);
+	if (err)
+		printf("Error: truncated (%#x bytes needed)\n", needed);
+	used = min(avail, (size_t)needed);
+	printf("Function times dumped to %08lx, size %#zx\n",
+	       (ulong)map_to_sysmem(buff + buff_ptr), used);
+	env_set_hex("profbase", map_to_sysmem(buff));
+	env_set_hex("profsize", buff_size);
+	env_set_hex("profoffset", buff_ptr + used);
+
+	return 0;
+}
+#endif
+
 static int create_call_list(int argc, char * const argv[])
 {
 	size_t buff_size, avail, buff_ptr, used;
@@ -101,6 +127,17 @@ int do_trace(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	case 's':
 		trace_print_stats();
 		break;
+#ifdef CONFIG_TRACE_FUNC_TIMES
+	case 't':
+		if (create_time_list(argc, argv))
+			return cmd_usage(cmdtp);
+		break;
+#endif
+	case 'w':
+		if (argc < 3)
+			return CMD_RET_USAGE;
+		trace_set_ring(!strcmp(argv[2], "on"));
+		break;
 	default:
 		return CMD_RET_USAGE;
 	}
@@ -116,5 +153,11 @@ U_BOOT_CMD(
 	"trace resume                       - resume tracing\n"
 	"trace funclist [<addr> <size>]     - dump function list into buffer\n"
 	"trace calls  [<addr> <size>]       "
-		"- dump function call trace into buffer"
+		"- dump function call trace into buffer\n"
+#ifdef CONFIG_TRACE_FUNC_TIMES
+	"trace times  [<addr> <size>]       "
+		"- dump time spent in each function into buffer\n"
+#endif
+	"trace wrap on|off                  "
+		"- overwrite oldest calls when buffer is full"
 );
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * zstd uncompress command, made from cmd/unlz4.c
+ */
+
+#include <common.h>
+#include <command.h>
+#include <mapmem.h>
+#include <u-boot/zstd.h>
+
+static int do_unzstd(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	unsigned long src, dst, src_len;
+	size_t dst_len;
+	int ret;
+
+	if (argc != 5)
+		return CMD_RET_USAGE;
+	src = simple_strtoul(argv[1], NULL, 16);
+	src_len = simple_strtoul(argv[2], NULL, 16);
+	dst = simple_strtoul(argv[3], NULL, 16);
+	dst_len = simple_strtoul(argv[4], NULL, 16);
+
+	ret = zstd_decompress(map_sysmem(src, src_len), src_len,
+			      map_sysmem(dst, dst_len), &dst_len);
+	if (ret) {
+		printf("Uncompress failed (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+	printf("Uncompressed size: %ld = 0x%lX\n", (ulong)dst_len,
+	       (ulong)dst_len);
+	env_set_hex("filesize", dst_len);
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	unzstd,    5,    1,    do_unzstd,
+	"zstd uncompress a memory region",
+	"srcaddr srcsize dstaddr dstsize"
+);
@@ -834,87 +834,87 @@ __weak int arch_cpu_init_dm(void)
 	return 0;
 }
 
-static const init_fnc_t init_sequence_f[] = {
-	setup_mon_len,
+static const struct initcall init_sequence_f[] = {
+	INITCALL(setup_mon_len),
 #ifdef CONFIG_OF_CONTROL
-	fdtdec_setup,
+	INITCALL(fdtdec_setup),
 #endif
 #ifdef CONFIG_TRACE
-	trace_early_init,
+	INITCALL(trace_early_init),
 #endif
-	initf_malloc,
-	log_init,
-	initf_bootstage,	/* uses its own timer, so does not need DM */
+	INITCALL(initf_malloc),
+	INITCALL(log_init),
+	INITCALL(initf_bootstage),	/* uses its own timer, so does not need DM */
 #ifdef CONFIG_BLOBLIST
-	bloblist_init,
+	INITCALL(bloblist_init),
 #endif
-	setup_spl_handoff,
-	initf_console_record,
+	INITCALL(setup_spl_handoff),
+	INITCALL(initf_console_record),
 #if defined(CONFIG_HAVE_FSP)
-	arch_fsp_init,
+	INITCALL(arch_fsp_init),
 #endif
-	arch_cpu_init,		/* basic arch cpu dependent setup */
-	mach_cpu_init,		/* SoC/machine dependent CPU setup */
-	initf_dm,
-	arch_cpu_init_dm,
+	INITCALL(arch_cpu_init),	/* basic arch cpu dependent setup */
+	INITCALL(mach_cpu_init),	/* SoC/machine dependent CPU setup */
+	INITCALL(initf_dm),
+	INITCALL(arch_cpu_init_dm),
 #if defined(CONFIG_BOARD_EARLY_INIT_F)
-	board_early_init_f,
+	INITCALL(board_early_init_f),
 #endif
 #if defined(CONFIG_PPC) || defined(CONFIG_SYS_FSL_CLK) || defined(CONFIG_M68K)
 	/* get CPU and bus clocks according to the environment variable */
-	get_clocks,		/* get CPU and bus clocks (etc.) */
+	INITCALL(get_clocks),		/* get CPU and bus clocks (etc.) */
 #endif
 #if !defined(CONFIG_M68K)
-	timer_init,		/* initialize timer */
+	INITCALL(timer_init),		/* initialize timer */
 #endif
 #if defined(CONFIG_BOARD_POSTCLK_INIT)
-	board_postclk_init,
-#endif
-	env_init,		/* initialize environment */
-	init_baud_rate,		/* initialze baudrate settings */
-	serial_init,		/* serial communications setup */
-	console_init_f,		/* stage 1 init of console */
-	display_options,	/* say that we are here */
-	display_text_info,	/* show debugging info if required */
+	INITCALL(board_postclk_init),
+#endif
+	INITCALL(env_init),		/* initialize environment */
+	INITCALL(init_baud_rate),	/* initialze baudrate settings */
+	INITCALL(serial_init),		/* serial communications setup */
+	INITCALL(console_init_f),	/* stage 1 init of console */
+	INITCALL(display_options),	/* say that we are here */
+	INITCALL(display_text_info),	/* show debugging info if required */
 #if defined(CONFIG_PPC) || defined(CONFIG_SH) || defined(CONFIG_X86)
-	checkcpu,
+	INITCALL(checkcpu),
 #endif
 #if defined(CONFIG_SYSRESET)
-	print_resetinfo,
+	INITCALL(print_resetinfo),
 #endif
 #if defined(CONFIG_DISPLAY_CPUINFO)
-	print_cpuinfo,		/* display cpu info (and speed) */
+	INITCALL(print_cpuinfo),	/* display cpu info (and speed) */
 #endif
 #if defined(CONFIG_DTB_RESELECT)
-	embedded_dtb_select,
+	INITCALL(embedded_dtb_select),
 #endif
 #if defined(CONFIG_DISPLAY_BOARDINFO)
-	show_board_info,
+	INITCALL(show_board_info),
 #endif
 	INIT_FUNC_WATCHDOG_INIT
 #if defined(CONFIG_MISC_INIT_F)
-	misc_init_f,
+	INITCALL(misc_init_f),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 #if defined(CONFIG_SYS_I2C)
-	init_func_i2c,
+	INITCALL(init_func_i2c),
 #endif
 #if defined(CONFIG_VID) && !defined(CONFIG_SPL)
-	init_func_vid,
+	INITCALL(init_func_vid),
 #endif
-	announce_dram_init,
-	dram_init,		/* configure available RAM banks */
+	INITCALL(announce_dram_init),
+	INITCALL(dram_init),		/* configure available RAM banks */
 #ifdef CONFIG_POST
-	post_init_f,
+	INITCALL(post_init_f),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 #if defined(CONFIG_SYS_DRAM_TEST)
-	testdram,
+	INITCALL(testdram),
 #endif /* CONFIG_SYS_DRAM_TEST */
 	INIT_FUNC_WATCHDOG_RESET
 
 #ifdef CONFIG_POST
-	init_post,
+	INITCALL(init_post),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 	/*
@@ -929,58 +929,58 @@ static const init_fnc_t init_sequence_f[] = {
 	 *  - monitor code
 	 *  - board info struct
 	 */
-	setup_dest_addr,
+	INITCALL(setup_dest_addr),
 #ifdef CONFIG_PRAM
-	reserve_pram,
+	INITCALL(reserve_pram),
 #endif
-	reserve_round_4k,
+	INITCALL(reserve_round_4k),
 #ifdef CONFIG_ARM
-	reserve_mmu,
-#endif
-	reserve_video,
-	reserve_trace,
-	reserve_uboot,
-	reserve_malloc,
-	reserve_board,
-	setup_machine,
-	reserve_global_data,
-	reserve_fdt,
-	reserve_bootstage,
-	reserve_bloblist,
-	reserve_arch,
-	reserve_stacks,
-	dram_init_banksize,
-	show_dram_config,
+	INITCALL(reserve_mmu),
+#endif
+	INITCALL(reserve_video),
+	INITCALL(reserve_trace),
+	INITCALL(reserve_uboot),
+	INITCALL(reserve_malloc),
+	INITCALL(reserve_board),
+	INITCALL(setup_machine),
+	INITCALL(reserve_global_data),
+	INITCALL(reserve_fdt),
+	INITCALL(reserve_bootstage),
+	INITCALL(reserve_bloblist),
+	INITCALL(reserve_arch),
+	INITCALL(reserve_stacks),
+	INITCALL(dram_init_banksize),
+	INITCALL(show_dram_config),
 #if defined(CONFIG_M68K) || defined(CONFIG_MIPS) || defined(CONFIG_PPC) || \
 	defined(CONFIG_SH)
-	setup_board_part1,
+	INITCALL(setup_board_part1),
 #endif
 #if defined(CONFIG_PPC) || defined(CONFIG_M68K)
 	INIT_FUNC_WATCHDOG_RESET
-	setup_board_part2,
+	INITCALL(setup_board_part2),
 #endif
-	display_new_sp,
+	INITCALL(display_new_sp),
 #ifdef CONFIG_OF_BOARD_FIXUP
-	fix_fdt,
+	INITCALL(fix_fdt),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
-	reloc_fdt,
-	reloc_bootstage,
-	reloc_bloblist,
-	setup_reloc,
+	INITCALL(reloc_fdt),
+	INITCALL(reloc_bootstage),
+	INITCALL(reloc_bloblist),
+	INITCALL(setup_reloc),
 #if defined(CONFIG_X86) || defined(CONFIG_ARC)
-	copy_uboot_to_ram,
-	do_elf_reloc_fixups,
-	clear_bss,
+	INITCALL(copy_uboot_to_ram),
+	INITCALL(do_elf_reloc_fixups),
+	INITCALL(clear_bss),
 #endif
 #if defined(CONFIG_XTENSA)
-	clear_bss,
+	INITCALL(clear_bss),
 #endif
 #if !defined(CONFIG_ARM) && !defined(CONFIG_SANDBOX) && \
 		!CONFIG_IS_ENABLED(X86_64)
-	jump_to_copy,
+	INITCALL(jump_to_copy),
 #endif
-	NULL,
+	INITCALL_END,
 };
 
 void board_init_f(ulong boot_flags)
@@ -1017,12 +1017,12 @@ void board_init_f(ulong boot_flags)
  * NOTE: At present only x86 uses this route, but it is intended that
  * all archs will move to this when generic relocation is implemented.
  */
-static const init_fnc_t init_sequence_f_r[] = {
+static const struct initcall init_sequence_f_r[] = {
 #if !CONFIG_IS_ENABLED(X86_64)
-	init_cache_f_r,
+	INITCALL(init_cache_f_r),
 #endif
 
-	NULL,
+	INITCALL_END,
 };
 
 void board_init_f_r(void)
@@ -623,8 +623,12 @@ static int initr_bedbug(void)
 }
 #endif
 
+/* Span covering board_init_r(), which ends when the command line starts */
+static int board_init_r_span = -1;
+
 static int run_main_loop(void)
 {
+	bootstage_span_end(board_init_r_span);
 #ifdef CONFIG_SANDBOX
 	sandbox_main_loop_init();
 #endif
@@ -643,12 +647,12 @@ static int run_main_loop(void)
  *
  * TODO: perhaps reset the watchdog in the initcall function after each call?
  */
-static init_fnc_t init_sequence_r[] = {
-	initr_trace,
-	initr_reloc,
+static struct initcall init_sequence_r[] = {
+	INITCALL(initr_trace),
+	INITCALL(initr_reloc),
 	/* TODO: could x86/PPC have this also perhaps? */
 #ifdef CONFIG_ARM
-	initr_caches,
+	INITCALL(initr_caches),
 	/* Note: For Freescale LS2 SoCs, new MMU table is created in DDR.
 	 *	 A temporary mapping of IFC high region is since removed,
 	 *	 so environmental variables in NOR flash is not available
@@ -656,28 +660,28 @@ static init_fnc_t init_sequence_r[] = {
 	 *	 region.
 	 */
 #endif
-	initr_reloc_global_data,
+	INITCALL(initr_reloc_global_data),
 #if defined(CONFIG_SYS_INIT_RAM_LOCK) && defined(CONFIG_E500)
-	initr_unlock_ram_in_cache,
+	INITCALL(initr_unlock_ram_in_cache),
 #endif
-	initr_barrier,
-	initr_malloc,
-	log_init,
-	initr_bootstage,	/* Needs malloc() but has its own timer */
-	initr_console_record,
+	INITCALL(initr_barrier),
+	INITCALL(initr_malloc),
+	INITCALL(log_init),
+	INITCALL(initr_bootstage),	/* Needs malloc() but has its own timer */
+	INITCALL(initr_console_record),
 #ifdef CONFIG_SYS_NONCACHED_MEMORY
-	initr_noncached,
+	INITCALL(initr_noncached),
 #endif
-	bootstage_relocate,
+	INITCALL(bootstage_relocate),
 #ifdef CONFIG_OF_LIVE
-	initr_of_live,
+	INITCALL(initr_of_live),
 #endif
 #ifdef CONFIG_DM
-	initr_dm,
+	INITCALL(initr_dm),
 #endif
 #if defined(CONFIG_ARM) || defined(CONFIG_NDS32) || defined(CONFIG_RISCV) || \
 	defined(CONFIG_SANDBOX)
-	board_init,	/* Setup chipselects */
+	INITCALL(board_init),		/* Setup chipselects */
 #endif
 	/*
 	 * TODO: printing of the clock inforamtion of the board is now
@@ -686,30 +690,30 @@ static init_fnc_t init_sequence_r[] = {
 	 * implement this.
 	 */
 #ifdef CONFIG_CLOCKS
-	set_cpu_clk_info, /* Setup clock information */
+	INITCALL(set_cpu_clk_info),	/* Setup clock information */
 #endif
 #ifdef CONFIG_EFI_LOADER
-	efi_memory_init,
+	INITCALL(efi_memory_init),
 #endif
-	stdio_init_tables,
-	initr_serial,
-	initr_announce,
+	INITCALL(stdio_init_tables),
+	INITCALL(initr_serial),
+	INITCALL(initr_announce),
 	INIT_FUNC_WATCHDOG_RESET
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
-	initr_manual_reloc_cmdtable,
+	INITCALL(initr_manual_reloc_cmdtable),
 #endif
 #if defined(CONFIG_PPC) || defined(CONFIG_M68K) || defined(CONFIG_MIPS)
-	initr_trap,
+	INITCALL(initr_trap),
 #endif
 #ifdef CONFIG_ADDR_MAP
-	initr_addr_map,
+	INITCALL(initr_addr_map),
 #endif
 #if defined(CONFIG_BOARD_EARLY_INIT_R)
-	board_early_init_r,
+	INITCALL(board_early_init_r),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 #ifdef CONFIG_POST
-	initr_post_backlog,
+	INITCALL(initr_post_backlog),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 #if defined(CONFIG_PCI) && defined(CONFIG_SYS_EARLY_PCI_INIT)
@@ -717,101 +721,101 @@ static init_fnc_t init_sequence_r[] = {
 	 * Do early PCI configuration _before_ the flash gets initialised,
 	 * because PCU resources are crucial for flash access on some boards.
 	 */
-	initr_pci,
+	INITCALL(initr_pci),
 #endif
 #ifdef CONFIG_ARCH_EARLY_INIT_R
-	arch_early_init_r,
+	INITCALL(arch_early_init_r),
 #endif
-	power_init_board,
+	INITCALL(power_init_board),
 #ifdef CONFIG_MTD_NOR_FLASH
-	initr_flash,
+	INITCALL(initr_flash),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 #if defined(CONFIG_PPC) || defined(CONFIG_M68K) || defined(CONFIG_X86)
 	/* initialize higher level parts of CPU like time base and timers */
-	cpu_init_r,
+	INITCALL(cpu_init_r),
 #endif
 #ifdef CONFIG_CMD_NAND
-	initr_nand,
+	INITCALL(initr_nand),
 #endif
 #ifdef CONFIG_CMD_ONENAND
-	initr_onenand,
+	INITCALL(initr_onenand),
 #endif
 #ifdef CONFIG_MMC
-	initr_mmc,
+	INITCALL(initr_mmc),
 #endif
-	initr_env,
+	INITCALL(initr_env),
 #ifdef CONFIG_SYS_BOOTPARAMS_LEN
-	initr_malloc_bootparams,
+	INITCALL(initr_malloc_bootparams),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
-	initr_secondary_cpu,
+	INITCALL(initr_secondary_cpu),
 #if defined(CONFIG_ID_EEPROM) || defined(CONFIG_SYS_I2C_MAC_OFFSET)
-	mac_read_from_eeprom,
+	INITCALL(mac_read_from_eeprom),
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 #if defined(CONFIG_PCI) && !defined(CONFIG_SYS_EARLY_PCI_INIT)
 	/*
 	 * Do pci configuration
 	 */
-	initr_pci,
+	INITCALL(initr_pci),
 #endif
-	stdio_add_devices,
-	initr_jumptable,
+	INITCALL(stdio_add_devices),
+	INITCALL(initr_jumptable),
 #ifdef CONFIG_API
-	initr_api,
+	INITCALL(initr_api),
 #endif
-	console_init_r,		/* fully init console as a device */
+	INITCALL(console_init_r),	/* fully init console as a device */
 #ifdef CONFIG_DISPLAY_BOARDINFO_LATE
-	console_announce_r,
-	show_board_info,
+	INITCALL(console_announce_r),
+	INITCALL(show_board_info),
 #endif
 #ifdef CONFIG_ARCH_MISC_INIT
-	arch_misc_init,		/* miscellaneous arch-dependent init */
+	INITCALL(arch_misc_init),	/* miscellaneous arch-dependent init */
 #endif
 #ifdef CONFIG_MISC_INIT_R
-	misc_init_r,		/* miscellaneous platform-dependent init */
+	INITCALL(misc_init_r),		/* miscellaneous platform-dependent init */
 #endif
 	INIT_FUNC_WATCHDOG_RESET
 #ifdef CONFIG_CMD_KGDB
-	initr_kgdb,
+	INITCALL(initr_kgdb),
 #endif
-	interrupt_init,
+	INITCALL(interrupt_init),
 #ifdef CONFIG_ARM
-	initr_enable_interrupts,
+	INITCALL(initr_enable_interrupts),
 #endif
 #if defined(CONFIG_MICROBLAZE) || defined(CONFIG_M68K)
-	timer_init,		/* initialize timer */
+	INITCALL(timer_init),		/* initialize timer */
 #endif
 #if defined(CONFIG_LED_STATUS)
-	initr_status_led,
+	INITCALL(initr_status_led),
 #endif
 	/* PPC has a udelay(20) here dating from 2002. Why? */
 #ifdef CONFIG_CMD_NET
-	initr_ethaddr,
+	INITCALL(initr_ethaddr),
 #endif
 #ifdef CONFIG_BOARD_LATE_INIT
-	board_late_init,
+	INITCALL(board_late_init),
 #endif
 #if defined(CONFIG_SCSI) && !defined(CONFIG_DM_SCSI)
 	INIT_FUNC_WATCHDOG_RESET
-	initr_scsi,
+	INITCALL(initr_scsi),
 #endif
 #ifdef CONFIG_BITBANGMII
-	initr_bbmii,
+	INITCALL(initr_bbmii),
 #endif
 #ifdef CONFIG_CMD_NET
 	INIT_FUNC_WATCHDOG_RESET
-	initr_net,
+	INITCALL(initr_net),
 #endif
 #ifdef CONFIG_POST
-	initr_post,
+	INITCALL(initr_post),
 #endif
 #if defined(CONFIG_CMD_PCMCIA) && !defined(CONFIG_IDE)
-	initr_pcmcia,
+	INITCALL(initr_pcmcia),
 #endif
 #if defined(CONFIG_IDE) && !defined(CONFIG_BLK)
-	initr_ide,
+	INITCALL(initr_ide),
 #endif
 #ifdef CONFIG_LAST_STAGE_INIT
 	INIT_FUNC_WATCHDOG_RESET
@@ -820,16 +824,16 @@ static init_fnc_t init_sequence_r[] = {
 	 * Interrupts) are up and running (i.e. the PC-style ISA
 	 * keyboard).
 	 */
-	last_stage_init,
+	INITCALL(last_stage_init),
 #endif
 #ifdef CONFIG_CMD_BEDBUG
 	INIT_FUNC_WATCHDOG_RESET
-	initr_bedbug,
+	INITCALL(initr_bedbug),
 #endif
 #if defined(CONFIG_PRAM)
-	initr_mem,
+	INITCALL(initr_mem),
 #endif
-	run_main_loop,
+	INITCALL(run_main_loop),
 };
 
 void board_init_r(gd_t *new_gd, ulong dest_addr)
@@ -854,10 +858,20 @@ void board_init_r(gd_t *new_gd, ulong dest_addr)
 	gd->flags &= ~GD_FLG_LOG_READY;
 
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
-	for (i = 0; i < ARRAY_SIZE(init_sequence_r); i++)
-		init_sequence_r[i] += gd->reloc_off;
+	for (i = 0; i < ARRAY_SIZE(init_sequence_r); i++) {
+		struct initcall *ic = &init_sequence_r[i];
+
+		if (ic->func)
+			ic->func += gd->reloc_off;
+		if (ic->complete)
+			ic->complete += gd->reloc_off;
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+		ic->name += gd->reloc_off;
+#endif
+	}
 #endif
 
+	board_init_r_span = bootstage_span_begin("board_init_r");
 	if (initcall_run_list(init_sequence_r))
 		hang();
 
@@ -8,6 +8,7 @@
 #include <common.h>
 #include <bootstage.h>
 #include <bzlib.h>
+#include <dma.h>
 #include <errno.h>
 #include <fdt_support.h>
 #include <lmb.h>
@@ -18,6 +19,7 @@
 #include <lzma/LzmaTypes.h>
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
+#include <u-boot/zstd.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
 #endif
@@ -55,9 +57,16 @@ static void boot_start_lmb(bootm_headers_t *images)
 {
 	ulong		mem_start;
 	phys_size_t	mem_size;
+	const char	*policy;
 
 	lmb_init(&images->lmb);
 
+	policy = env_get("bootm_alloc");
+	if (policy && !strcmp(policy, "first"))
+		images->lmb.policy = LMB_ALLOC_FIRST_FIT;
+	else if (policy && !strcmp(policy, "best"))
+		images->lmb.policy = LMB_ALLOC_BEST_FIT;
+
 	mem_start = env_get_bootm_low();
 	mem_size = env_get_bootm_size();
 
@@ -68,12 +77,15 @@ static void boot_start_lmb(bootm_headers_t *images)
 }
 #else
 #define lmb_reserve(lmb, base, size)
+#define lmb_release(lmb)
 static inline void boot_start_lmb(bootm_headers_t *images) { }
 #endif
 
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
+	/* Drop any regions left over from an earlier bootm */
+	lmb_release(&images.lmb);
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = env_get_yesno("verify");
 
@@ -428,6 +440,15 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
@@ -443,6 +464,80 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 }
 
 #ifndef USE_HOSTCC
+#if CONFIG_IS_ENABLED(DMA)
+/* Uncompressed OS images smaller than this are copied by the CPU */
+#define BOOTM_DMA_MIN_LEN	(1 << 20)
+
+/* Copy of the OS image started by bootm_load_os(), see bootm_wait_os() */
+static struct dma_copy bootm_os_copy;
+static bool bootm_os_copying;
+
+/*
+ * bootm_start_os_copy() - Start copying an uncompressed OS image using DMA
+ *
+ * This lets the ramdisk and device tree be relocated while the OS image is
+ * copied. It is only done when the image is large and does not overlap its
+ * load address.
+ *
+ * @return true if the copy was started, false to load the image as usual
+ */
+static bool bootm_start_os_copy(image_info_t *os, void *load_buf,
+				void *image_buf)
+{
+	ulong len = os->image_len;
+	int ret;
+
+	if (os->comp != IH_COMP_NONE || len < BOOTM_DMA_MIN_LEN ||
+	    len > CONFIG_SYS_BOOTM_LEN)
+		return false;
+	if (load_buf < image_buf + len && image_buf < load_buf + len)
+		return false;
+
+	print_decomp_msg(os->comp, os->type, false);
+	ret = dma_memcpy_start(&bootm_os_copy, load_buf, image_buf, len);
+	if (ret) {
+		printf("DMA error %d, copying ... ", ret);
+		memmove_wd(load_buf, image_buf, len, CHUNKSZ);
+	}
+	bootm_os_copying = true;
+	puts("OK\n");
+
+	return true;
+}
+#endif
+
+/*
+ * bootm_wait_os() - Wait for a copy started by bootm_start_os_copy()
+ *
+ * This must be called before anything uses the loaded OS image.
+ *
+ * @return 0 if OK (or there was no copy), -ve on error
+ */
+static int bootm_wait_os(void)
+{
+#if CONFIG_IS_ENABLED(DMA)
+	struct dma_copy *copy = &bootm_os_copy;
+	ulong start;
+	int ret;
+
+	if (!bootm_os_copying)
+		return 0;
+	bootm_os_copying = false;
+	ret = dma_memcpy_wait(copy);
+	if (ret) {
+		printf("Error %d copying OS image\n", ret);
+		bootstage_error(BOOTSTAGE_ID_DECOMP_IMAGE);
+		return ret;
+	}
+
+	start = ALIGN_DOWN(map_to_sysmem(copy->dst), ARCH_DMA_MINALIGN);
+	flush_cache(start, ALIGN(map_to_sysmem(copy->dst) + copy->len - start,
+				 ARCH_DMA_MINALIGN));
+#endif
+
+	return 0;
+}
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -460,19 +555,29 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
-	err = bootm_decomp_image(os.comp, load, os.image_start, os.type,
-				 load_buf, image_buf, image_len,
-				 CONFIG_SYS_BOOTM_LEN, &load_end);
-	if (err) {
-		bootstage_error(BOOTSTAGE_ID_DECOMP_IMAGE);
-		return err;
-	}
+#if CONFIG_IS_ENABLED(DMA)
+	if (load != image_start &&
+	    bootm_start_os_copy(&os, load_buf, image_buf)) {
+		/* bootm_wait_os() flushes the cache */
+		load_end = load + image_len;
+	} else
+#endif
+	{
+		err = bootm_decomp_image(os.comp, load, os.image_start,
+					 os.type, load_buf, image_buf,
+					 image_len, CONFIG_SYS_BOOTM_LEN,
+					 &load_end);
+		if (err) {
+			bootstage_error(BOOTSTAGE_ID_DECOMP_IMAGE);
+			return err;
+		}
 
-	flush_len = load_end - load;
-	if (flush_start < load)
-		flush_len += load - flush_start;
+		flush_len = load_end - load;
+		if (flush_start < load)
+			flush_len += load - flush_start;
 
-	flush_cache(flush_start, ALIGN(flush_len, ARCH_DMA_MINALIGN));
+		flush_cache(flush_start, ALIGN(flush_len, ARCH_DMA_MINALIGN));
+	}
 
 	debug("   kernel loaded at 0x%08lx, end = 0x%08lx\n", load, load_end);
 	bootstage_mark(BOOTSTAGE_ID_KERNEL_LOADED);
@@ -680,6 +785,12 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	}
 #endif
 
+	/* The OS image must be in place before the OS boot function runs */
+	if (bootm_wait_os() && !ret) {
+		ret = BOOTM_ERR_RESET;
+		goto err;
+	}
+
 	/* From now on, we need the OS boot function */
 	if (ret)
 		return ret;
@@ -735,6 +846,7 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 
 	/* Deal with any fallout */
 err:
+	bootm_wait_os();
 	if (iflag)
 		enable_interrupts();
 
@@ -18,24 +18,42 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+#ifdef CONFIG_SPL_BUILD
+	RECORD_MAX = RECORD_COUNT,
+#else
+	RECORD_MAX = CONFIG_BOOTSTAGE_RECORD_MAX,
+#endif
 };
 
 struct bootstage_record {
-	ulong time_us;
-	uint32_t start_us;
+	ulong time_us;		/* Mark time, accumulated time or span start */
+	uint32_t start_us;	/* Start of the current accumulation */
+	uint32_t duration_us;	/* Length of a span */
 	const char *name;
 	int flags;		/* see enum bootstage_flags */
+	int parent;		/* Record number of enclosing span, or -1 */
 	enum bootstage_id id;
 };
 
+/*
+ * The records are followed by a hash table of record numbers, indexed by id,
+ * so that finding a record does not need a search. There are no pointers, so
+ * the whole thing can be copied to a new place when U-Boot relocates.
+ */
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
-	struct bootstage_record record[RECORD_COUNT];
+	uint rec_max;		/* Number of records there is space for */
+	uint hash_mask;		/* Number of hash-table entries - 1 */
+	uint dropped;		/* Records not added due to lack of space */
+	int cur_span;		/* Innermost open span, or -1 if none */
+	bool in_heap;		/* true if allocated by grow_data() */
+	bool no_spans;		/* true to ignore bootstage_span_begin() */
+	struct bootstage_record record[];
 };
 
 enum {
-	BOOTSTAGE_VERSION	= 0,
+	BOOTSTAGE_VERSION	= 1,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
 };
@@ -63,32 +81,126 @@ int bootstage_relocate(void)
 	return 0;
 }
 
-struct bootstage_record *find_id(struct bootstage_data *data,
-				 enum bootstage_id id)
+/* Get the number of hash-table entries to use for a number of records */
+static uint hash_size(uint rec_max)
+{
+	uint size = 4;
+
+	while (size < rec_max * 2)
+		size <<= 1;
+
+	return size;
+}
+
+static uint32_t *get_hash(struct bootstage_data *data)
+{
+	return (uint32_t *)(data->record + data->rec_max);
+}
+
+static int data_size(uint rec_max)
+{
+	return sizeof(struct bootstage_data) +
+		rec_max * sizeof(struct bootstage_record) +
+		hash_size(rec_max) * sizeof(uint32_t);
+}
+
+/*
+ * Find the hash-table slot for an id. This holds the record number + 1 if
+ * there is a record for the id, else 0. The table is always less than half
+ * full, so there is always an empty slot.
+ */
+static uint32_t *hash_slot(struct bootstage_data *data, enum bootstage_id id)
+{
+	uint32_t *hash = get_hash(data);
+	uint pos;
+
+	for (pos = id * 2654435761U;; pos++) {
+		uint32_t *slot = &hash[pos & data->hash_mask];
+
+		if (!*slot || data->record[*slot - 1].id == id)
+			return slot;
+	}
+}
+
+static void rehash(struct bootstage_data *data)
 {
+	uint i;
+
+	memset(get_hash(data), '\0', (data->hash_mask + 1) * sizeof(uint32_t));
+	for (i = 0; i < data->rec_count; i++) {
+		uint32_t *slot = hash_slot(data, data->record[i].id);
+
+		/* Only the first record for each id can be found */
+		if (!*slot)
+			*slot = i + 1;
+	}
+}
+
+/*
+ * Move the data to a larger space in the heap. This is only possible after
+ * relocation; before that, records are dropped when the space is full.
+ */
+static int grow_data(void)
+{
+	struct bootstage_data *old = gd->bootstage, *data;
+	uint rec_max = min_t(uint, old->rec_max * 2, RECORD_MAX);
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) || rec_max <= old->rec_max)
+		return -ENOSPC;
+	data = malloc(data_size(rec_max));
+	if (!data)
+		return -ENOMEM;
+	memcpy(data, old, sizeof(*old) + old->rec_count * sizeof(*old->record));
+	data->rec_max = rec_max;
+	data->hash_mask = hash_size(rec_max) - 1;
+	data->in_heap = true;
+	rehash(data);
+	if (old->in_heap)
+		free(old);
+	gd->bootstage = data;
+
+	return 0;
+}
+
+static struct bootstage_record *find_id(struct bootstage_data *data,
+					enum bootstage_id id)
+{
+	uint32_t *slot = hash_slot(data, id);
+
+	return *slot ? &data->record[*slot - 1] : NULL;
+}
+
+/* Add a new record for an id, returning NULL if there is no space */
+static struct bootstage_record *add_id(enum bootstage_id id)
+{
+	struct bootstage_data *data = gd->bootstage;
 	struct bootstage_record *rec;
-	struct bootstage_record *end;
+	uint32_t *slot;
 
-	for (rec = data->record, end = rec + data->rec_count; rec < end;
-	     rec++) {
-		if (rec->id == id)
-			return rec;
+	if (data->rec_count == data->rec_max && grow_data()) {
+		data->dropped++;
+		return NULL;
 	}
+	data = gd->bootstage;
+	rec = &data->record[data->rec_count++];
+	memset(rec, '\0', sizeof(*rec));
+	rec->id = id;
+	rec->parent = -1;
+	slot = hash_slot(data, id);
+	if (!*slot)
+		*slot = data->rec_count;
 
-	return NULL;
+	return rec;
 }
 
-struct bootstage_record *ensure_id(struct bootstage_data *data,
-				   enum bootstage_id id)
+static struct bootstage_record *ensure_id(struct bootstage_data *data,
+					  enum bootstage_id id)
 {
 	struct bootstage_record *rec;
 
 	rec = find_id(data, id);
-	if (!rec && data->rec_count < RECORD_COUNT) {
-		rec = &data->record[data->rec_count++];
-		rec->id = id;
-		return rec;
-	}
+	if (!rec)
+		rec = add_id(id);
 
 	return rec;
 }
@@ -104,12 +216,13 @@ ulong bootstage_add_record(enum bootstage_id id, const char *name,
 
 	/* Only record the first event for each */
 	rec = find_id(data, id);
-	if (!rec && data->rec_count < RECORD_COUNT) {
-		rec = &data->record[data->rec_count++];
-		rec->time_us = mark;
-		rec->name = name;
-		rec->flags = flags;
-		rec->id = id;
+	if (!rec) {
+		rec = add_id(id);
+		if (rec) {
+			rec->time_us = mark;
+			rec->name = name;
+			rec->flags = flags;
+		}
 	}
 
 	/* Tell the board about this progress */
@@ -195,6 +308,66 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+int bootstage_span_begin(const char *name)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	ulong start_us;
+
+	/* Nowhere to put the record until bootstage_init() has run */
+	if (!data || data->no_spans)
+		return -1;
+	start_us = timer_get_boot_us();
+	rec = add_id(data->next_id++);
+	if (!rec)
+		return -1;
+	data = gd->bootstage;
+	rec->time_us = start_us;
+
+	/* Names such as device names may not last, so keep a copy */
+	rec->name = name;
+	if (gd->flags & GD_FLG_FULL_MALLOC_INIT) {
+		rec->name = strdup(name);
+		if (!rec->name)
+			rec->name = name;
+	}
+	rec->flags = BOOTSTAGEF_SPAN | BOOTSTAGEF_OPEN;
+	rec->parent = data->cur_span;
+	data->cur_span = rec - data->record;
+
+	return data->cur_span;
+}
+
+void bootstage_enable_spans(bool enable)
+{
+	struct bootstage_data *data = gd->bootstage;
+
+	if (data)
+		data->no_spans = !enable;
+}
+
+uint32_t bootstage_span_end(int span)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	uint32_t now;
+
+	if (!data || span < 0 || span >= data->rec_count ||
+	    !(data->record[span].flags & BOOTSTAGEF_OPEN))
+		return 0;
+
+	/* End any spans inside this one which are still open */
+	now = timer_get_boot_us();
+	do {
+		rec = &data->record[data->cur_span];
+		rec->duration_us = now - (uint32_t)rec->time_us;
+		rec->flags &= ~BOOTSTAGEF_OPEN;
+		data->cur_span = rec->parent;
+	} while (rec != &data->record[span] && data->cur_span >= 0);
+
+	return rec->duration_us;
+}
+
 /**
  * Get a record name as a printable string
  *
@@ -234,11 +407,33 @@ static uint32_t print_time_record(struct bootstage_record *rec, uint32_t prev)
 
 static int h_compare_record(const void *r1, const void *r2)
 {
-	const struct bootstage_record *rec1 = r1, *rec2 = r2;
+	const struct bootstage_record *rec1 = *(struct bootstage_record **)r1;
+	const struct bootstage_record *rec2 = *(struct bootstage_record **)r2;
 
 	return rec1->time_us > rec2->time_us ? 1 : -1;
 }
 
+/* Get the nesting depth of a span, 0 for a span with no parent */
+static int get_span_depth(struct bootstage_data *data,
+			  const struct bootstage_record *rec)
+{
+	int depth;
+
+	for (depth = 0; rec->parent >= 0; depth++)
+		rec = &data->record[rec->parent];
+
+	return depth;
+}
+
+/* Get the length of a span, or the time so far if it is still open */
+static uint32_t get_span_duration(const struct bootstage_record *rec)
+{
+	if (rec->flags & BOOTSTAGEF_OPEN)
+		return (uint32_t)timer_get_boot_us() - (uint32_t)rec->time_us;
+
+	return rec->duration_us;
+}
+
 #ifdef CONFIG_OF_LIBFDT
 /**
  * Add all bootstage timings to a device tree.
@@ -285,6 +480,21 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 				       get_record_name(buf, sizeof(buf), rec)))
 			return -EINVAL;
 
+		if (rec->flags & BOOTSTAGEF_SPAN) {
+			if (fdt_setprop_cell(blob, node, "start",
+					     rec->time_us) ||
+			    fdt_setprop_cell(blob, node, "duration",
+					     get_span_duration(rec)))
+				return -EINVAL;
+
+			/* Nodes are numbered in reverse order; see above */
+			if (rec->parent >= 0 &&
+			    fdt_setprop_cell(blob, node, "parent",
+					     data->rec_count - 1 - rec->parent))
+				return -EINVAL;
+			continue;
+		}
+
 		/* Check if this is a 'mark' or 'accum' record */
 		if (fdt_setprop_cell(blob, node,
 				rec->start_us ? "accum" : "mark",
@@ -307,7 +517,9 @@ int bootstage_fdt_add_report(void)
 void bootstage_report(void)
 {
 	struct bootstage_data *data = gd->bootstage;
-	struct bootstage_record *rec = data->record;
+	struct bootstage_record *rec, **list;
+	bool have_spans = false;
+	char buf[20];
 	uint32_t prev;
 	int i;
 
@@ -315,25 +527,132 @@ void bootstage_report(void)
 	       data->rec_count);
 	printf("%11s%11s  %s\n", "Mark", "Elapsed", "Stage");
 
-	prev = print_time_record(rec, 0);
-
-	/* Sort records by increasing time */
-	qsort(data->record, data->rec_count, sizeof(*rec), h_compare_record);
-
-	for (i = 1, rec++; i < data->rec_count; i++, rec++) {
-		if (rec->id && !rec->start_us)
+	/*
+	 * Sort records by increasing time. Sort a list of pointers, since the
+	 * record numbers are used to find records.
+	 */
+	list = malloc(data->rec_count * sizeof(*list));
+	if (!list) {
+		puts("bootstage: Out of memory\n");
+		return;
+	}
+	for (i = 0; i < data->rec_count; i++)
+		list[i] = &data->record[i];
+	prev = print_time_record(list[0], 0);
+	qsort(list, data->rec_count, sizeof(*list), h_compare_record);
+
+	for (i = 1; i < data->rec_count; i++) {
+		rec = list[i];
+		if (rec->flags & BOOTSTAGEF_SPAN)
+			have_spans = true;
+		else if (rec->id && !rec->start_us)
 			prev = print_time_record(rec, prev);
 	}
-	if (data->rec_count > RECORD_COUNT)
+	free(list);
+	if (data->dropped)
 		printf("Overflowed internal boot id table by %d entries\n"
 		       "Please increase CONFIG_(SPL_)BOOTSTAGE_RECORD_COUNT\n",
-		       data->rec_count - RECORD_COUNT);
+		       data->dropped);
 
 	puts("\nAccumulated time:\n");
 	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
 		if (rec->start_us)
 			prev = print_time_record(rec, -1);
 	}
+
+	if (!have_spans)
+		return;
+	puts("\nSpans:\n");
+	printf("%11s%11s  %s\n", "Start", "Duration", "Span");
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (!(rec->flags & BOOTSTAGEF_SPAN))
+			continue;
+		print_grouped_ull(rec->time_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(get_span_duration(rec), BOOTSTAGE_DIGITS);
+		printf("  %*s%s%s\n", get_span_depth(data, rec) * 2, "",
+		       get_record_name(buf, sizeof(buf), rec),
+		       rec->flags & BOOTSTAGEF_OPEN ? " (open)" : "");
+	}
+}
+
+/**
+ * Append text to a memory buffer
+ *
+ * Like append_data(), the buffer pointer is incremented whether or not there
+ * is space.
+ *
+ * @param ptrp	Pointer to buffer, updated by this function
+ * @param end	Pointer to end of buffer
+ * @param fmt	printf() format string
+ */
+static void append_text(char **ptrp, char *end, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	*ptrp += vsnprintf(*ptrp, *ptrp < end ? end - *ptrp : 0, fmt, args);
+	va_end(args);
+}
+
+/* Append a record name as a JSON string, escaping as needed */
+static void append_json_name(char **ptrp, char *end,
+			     const struct bootstage_record *rec)
+{
+	const char *name;
+	char buf[20];
+
+	name = get_record_name(buf, sizeof(buf), rec);
+	append_text(ptrp, end, "\"");
+	for (; *name; name++) {
+		if (*name == '"' || *name == '\\')
+			append_text(ptrp, end, "\\%c", *name);
+		else if (*name >= ' ')
+			append_text(ptrp, end, "%c", *name);
+	}
+	append_text(ptrp, end, "\"");
+}
+
+int bootstage_export_json(char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	const struct bootstage_record *rec;
+	char *ptr = buf, *end = buf + size;
+	const char *sep = "";
+	int i;
+
+	append_text(&ptr, end, "{\"traceEvents\":[");
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (rec->start_us)
+			continue;
+		append_text(&ptr, end, "%s\n{\"name\":", sep);
+		append_json_name(&ptr, end, rec);
+		if (rec->flags & BOOTSTAGEF_SPAN) {
+			append_text(&ptr, end, ",\"ph\":\"X\",\"ts\":%lu,\"dur\":%u",
+				    rec->time_us, get_span_duration(rec));
+		} else {
+			append_text(&ptr, end, ",\"ph\":\"i\",\"s\":\"g\",\"ts\":%lu",
+				    rec->time_us);
+		}
+		append_text(&ptr, end, ",\"pid\":0,\"tid\":0,\"args\":{\"id\":%d}}",
+			    rec->id);
+		sep = ",";
+	}
+
+	/* Accumulated times have no start time, so go in the metadata */
+	append_text(&ptr, end, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{");
+	sep = "";
+	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
+		if (!rec->start_us)
+			continue;
+		append_text(&ptr, end, "%s", sep);
+		append_json_name(&ptr, end, rec);
+		append_text(&ptr, end, ":%lu", rec->time_us);
+		sep = ",";
+	}
+	append_text(&ptr, end, "}}\n");
+
+	/* Allow for the nul terminator */
+	return ptr - buf + 1;
 }
 
 /**
@@ -453,11 +772,15 @@ int bootstage_unstash(const void *base, int size)
 		return -EINVAL;
 	}
 
-	if (data->rec_count + hdr->count > RECORD_COUNT) {
-		debug("%s: Bootstage has %d records, we have space for %d\n"
-			"Please increase CONFIG_(SPL_)BOOTSTAGE_RECORD_COUNT\n",
-		      __func__, hdr->count, RECORD_COUNT - data->rec_count);
-		return -ENOSPC;
+	while (data->rec_count + hdr->count > data->rec_max) {
+		if (grow_data()) {
+			debug("%s: Bootstage has %d records, we have space for %d\n"
+			      "Please increase CONFIG_(SPL_)BOOTSTAGE_RECORD_COUNT\n",
+			      __func__, hdr->count,
+			      data->rec_max - data->rec_count);
+			return -ENOSPC;
+		}
+		data = gd->bootstage;
 	}
 
 	ptr += sizeof(*hdr);
@@ -468,16 +791,24 @@ int bootstage_unstash(const void *base, int size)
 
 	/* Read the name strings */
 	ptr += rec_size;
-	for (rec = data->record + data->next_id, i = 0; i < hdr->count;
+	for (rec = data->record + data->rec_count, i = 0; i < hdr->count;
 	     i++, rec++) {
 		rec->name = ptr;
 
 		/* Assume no data corruption here */
 		ptr += strlen(ptr) + 1;
+
+		/* Spans which were open cannot be ended now */
+		rec->flags &= ~BOOTSTAGEF_OPEN;
+		if (rec->parent >= 0)
+			rec->parent += data->rec_count;
+		if (rec->id >= data->next_id)
+			data->next_id = rec->id + 1;
 	}
 
 	/* Mark the records as read */
 	data->rec_count += hdr->count;
+	rehash(data);
 	debug("Unstashed %d records\n", hdr->count);
 
 	return 0;
@@ -485,23 +816,25 @@ int bootstage_unstash(const void *base, int size)
 
 int bootstage_get_size(void)
 {
-	return sizeof(struct bootstage_data);
+	return data_size(RECORD_COUNT);
 }
 
 int bootstage_init(bool first)
 {
 	struct bootstage_data *data;
-	int size = sizeof(struct bootstage_data);
+	int size = data_size(RECORD_COUNT);
 
 	gd->bootstage = (struct bootstage_data *)malloc(size);
 	if (!gd->bootstage)
 		return -ENOMEM;
 	data = gd->bootstage;
 	memset(data, '\0', size);
-	if (first) {
-		data->next_id = BOOTSTAGE_ID_USER;
+	data->rec_max = RECORD_COUNT;
+	data->hash_mask = hash_size(RECORD_COUNT) - 1;
+	data->cur_span = -1;
+	data->next_id = BOOTSTAGE_ID_USER;
+	if (first)
 		bootstage_add_record(BOOTSTAGE_ID_AWAKE, "reset", 0, 0);
-	}
 
 	return 0;
 }
@@ -83,6 +83,7 @@
 #include <cli.h>
 #include <cli_hush.h>
 #include <command.h>        /* find_cmd */
+#include <u-boot/crc.h>
 #ifndef CONFIG_SYS_PROMPT_HUSH_PS2
 #define CONFIG_SYS_PROMPT_HUSH_PS2	"> "
 #endif
@@ -1540,6 +1541,7 @@ static int run_pipe_real(struct pipe *pi)
 	struct child_prog *child;
 	struct built_in_command *x;
 	char *p;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -1552,6 +1554,7 @@ static int run_pipe_real(struct pipe *pi)
 	int flag = do_repeat ? CMD_FLAG_REPEAT : 0;
 	struct child_prog *child;
 	char *p;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -1618,6 +1621,8 @@ static int run_pipe_real(struct pipe *pi)
 			}
 			return EXIT_SUCCESS;   /* don't worry about errors in set_local_var() yet */
 		}
+		/* don't update child->sp: the pipe may be run again (parse cache) */
+		sp = child->sp;
 		for (i = 0; is_assignment(child->argv[i]); i++) {
 			p = insert_var_value(child->argv[i]);
 #ifndef __U_BOOT__
@@ -1626,11 +1631,11 @@ static int run_pipe_real(struct pipe *pi)
 			set_local_var(p, 0);
 #endif
 			if (p != child->argv[i]) {
-				child->sp--;
+				sp--;
 				free(p);
 			}
 		}
-		if (child->sp) {
+		if (sp) {
 			char * str = NULL;
 
 			str = make_string(child->argv + i,
@@ -1763,6 +1768,7 @@ static int run_list_real(struct pipe *pi)
 	char *save_name = NULL;
 	char **list = NULL;
 	char **save_list = NULL;
+	struct pipe *save_pi = NULL;
 	struct pipe *rpipe;
 	int flag_rep = 0;
 #ifndef __U_BOOT__
@@ -1802,7 +1808,8 @@ static int run_list_real(struct pipe *pi)
 				/* check Ctrl-C */
 				ctrlc();
 				if ((had_ctrlc())) {
-					return 1;
+					rcode = 1;
+					break;
 				}
 #endif
 				flag_restore = 0;
@@ -1831,6 +1838,7 @@ static int run_list_real(struct pipe *pi)
 				list = make_list_in(pi->next->progs->argv,
 					pi->progs->argv[0]);
 				save_list = list;
+				save_pi = pi;
 				save_name = pi->progs->argv[0];
 				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
@@ -1902,7 +1910,8 @@ static int run_list_real(struct pipe *pi)
 #else
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
-			return -2;	/* exit */
+			rcode = -2;	/* exit */
+			break;
 		}
 		last_return_code=(rcode == 0) ? 0 : 1;
 #endif
@@ -1922,6 +1931,16 @@ static int run_list_real(struct pipe *pi)
 		checkjobs(NULL);
 #endif
 	}
+#ifdef __U_BOOT__
+	/* leaving a "for" loop early: put back the loop variable's name */
+	if (list) {
+		free(save_pi->progs->argv[0]);
+		while (*list)
+			free(*list++);
+		free(save_list);
+		save_pi->progs->argv[0] = save_name;
+	}
+#endif
 	return rcode;
 }
 
@@ -3179,43 +3198,70 @@ static void update_ifs_map(void)
 	mapset(ifs, 2);            /* also flow through if quoted */
 }
 
-/* most recursion does not come through here, the exeception is
- * from builtin_source() */
-static int parse_stream_outer(struct in_str *inp, int flag)
+/* Parse one list from the input, ready to run. On error, NULL is returned
+ * and the input is discarded. */
+static struct pipe *parse_stream_list(struct in_str *inp, int flag, int *rcodep)
 {
-
 	struct p_context ctx;
 	o_string temp=NULL_O_STRING;
 	int rcode;
+
+	ctx.type = flag;
+	initialize_context(&ctx);
+	update_ifs_map();
+	if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING)) mapset((uchar *)";$&|", 0);
+	inp->promptmode=1;
+	rcode = parse_stream(&temp, &ctx, inp,
+			     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+	*rcodep = rcode;
 #ifdef __U_BOOT__
-	int code = 1;
+	if (rcode == 1) flag_repeat = 0;
 #endif
-	do {
-		ctx.type = flag;
-		initialize_context(&ctx);
-		update_ifs_map();
-		if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING)) mapset((uchar *)";$&|", 0);
-		inp->promptmode=1;
-		rcode = parse_stream(&temp, &ctx, inp,
-				     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+	if (rcode != 1 && ctx.old_flag != 0) {
+		syntax();
 #ifdef __U_BOOT__
-		if (rcode == 1) flag_repeat = 0;
+		flag_repeat = 0;
 #endif
-		if (rcode != 1 && ctx.old_flag != 0) {
-			syntax();
+	}
+	if (rcode != 1 && ctx.old_flag == 0) {
+		done_word(&temp, &ctx);
+		done_pipe(&ctx,PIPE_SEQ);
+		b_free(&temp);
+		return ctx.list_head;
+	}
+	if (ctx.old_flag != 0) {
+		free(ctx.stack);
+		b_reset(&temp);
+	}
 #ifdef __U_BOOT__
-			flag_repeat = 0;
+	if (inp->__promptme == 0) printf("<INTERRUPT>\n");
+	inp->__promptme = 1;
+#endif
+	temp.nonnull = 0;
+	temp.quote = 0;
+	inp->p = NULL;
+	free_pipe_list(ctx.list_head,0);
+	b_free(&temp);
+	return NULL;
+}
+
+/* most recursion does not come through here, the exeception is
+ * from builtin_source() */
+static int parse_stream_outer(struct in_str *inp, int flag)
+{
+	struct pipe *list;
+	int rcode;
+#ifdef __U_BOOT__
+	int code = 1;
 #endif
-		}
-		if (rcode != 1 && ctx.old_flag == 0) {
-			done_word(&temp, &ctx);
-			done_pipe(&ctx,PIPE_SEQ);
+	do {
+		list = parse_stream_list(inp, flag, &rcode);
+		if (list) {
 #ifndef __U_BOOT__
-			run_list(ctx.list_head);
+			run_list(list);
 #else
-			code = run_list(ctx.list_head);
+			code = run_list(list);
 			if (code == -2) {	/* exit */
-				b_free(&temp);
 				code = 0;
 				/* XXX hackish way to not allow exit from main loop */
 				if (inp->peek == file_peek) {
@@ -3227,21 +3273,7 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 			if (code == -1)
 			    flag_repeat = 0;
 #endif
-		} else {
-			if (ctx.old_flag != 0) {
-				free(ctx.stack);
-				b_reset(&temp);
-			}
-#ifdef __U_BOOT__
-			if (inp->__promptme == 0) printf("<INTERRUPT>\n");
-			inp->__promptme = 1;
-#endif
-			temp.nonnull = 0;
-			temp.quote = 0;
-			inp->p = NULL;
-			free_pipe_list(ctx.list_head,0);
 		}
-		b_free(&temp);
 	/* loop on syntax errors, return on EOF */
 	} while (rcode != -1 && !(flag & FLAG_EXIT_FROM_LOOP) &&
 		(inp->peek != static_peek || b_peek(inp)));
@@ -3252,6 +3284,158 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #endif /* __U_BOOT__ */
 }
 
+#ifdef CONFIG_HUSH_PARSE_CACHE
+/*
+ * Cache of parsed scripts run from environment variables. Variables are only
+ * looked up when a list is run, so the parsed list depends only on the text
+ * and the parse flags. It can be run again whenever the same text comes back,
+ * which saves parsing long scripts like distro_bootcmd for every device.
+ */
+struct parse_cache_entry {
+	char *text;		/* script text, NULL if the entry is unused */
+	uint hash;		/* crc32 of the text */
+	int flag;		/* FLAG_... used to parse the text */
+	struct pipe *list;	/* parsed script */
+	ulong last_used;	/* parse_cache_clock when the entry was last run */
+	int busy;		/* number of runs of this entry in progress */
+};
+
+static struct parse_cache_entry parse_cache[CONFIG_HUSH_PARSE_CACHE_ENTRIES];
+static ulong parse_cache_clock;
+static uint parse_cache_hits;
+static uint parse_cache_misses;
+static bool parse_cache_disabled;
+
+static void parse_cache_drop(struct parse_cache_entry *ent)
+{
+	free_pipe_list(ent->list, 0);
+	free(ent->text);
+	ent->list = NULL;
+	ent->text = NULL;
+}
+
+void hush_parse_cache_enable(bool enable)
+{
+	struct parse_cache_entry *ent;
+
+	parse_cache_disabled = !enable;
+	if (enable)
+		return;
+	for (ent = parse_cache; ent < parse_cache + ARRAY_SIZE(parse_cache);
+	     ent++) {
+		if (ent->text && !ent->busy)
+			parse_cache_drop(ent);
+	}
+}
+
+void hush_parse_cache_stats(uint *hitsp, uint *missesp)
+{
+	*hitsp = parse_cache_hits;
+	*missesp = parse_cache_misses;
+}
+
+static struct parse_cache_entry *parse_cache_find(const char *s, uint hash,
+						  int flag)
+{
+	struct parse_cache_entry *ent;
+
+	for (ent = parse_cache; ent < parse_cache + ARRAY_SIZE(parse_cache);
+	     ent++) {
+		if (ent->text && ent->hash == hash && ent->flag == flag &&
+		    !strcmp(ent->text, s))
+			return ent;
+	}
+
+	return NULL;
+}
+
+/* Add a parsed script, replacing the least recently used one if needed */
+static struct parse_cache_entry *parse_cache_add(const char *s, uint hash,
+						 int flag, struct pipe *list)
+{
+	struct parse_cache_entry *ent, *victim = NULL;
+	char *text;
+
+	for (ent = parse_cache; ent < parse_cache + ARRAY_SIZE(parse_cache);
+	     ent++) {
+		if (ent->busy)
+			continue;
+		if (!ent->text) {
+			victim = ent;
+			break;
+		}
+		if (!victim || ent->last_used < victim->last_used)
+			victim = ent;
+	}
+	if (!victim)
+		return NULL;
+	text = strdup(s);
+	if (!text)
+		return NULL;
+	if (victim->text)
+		parse_cache_drop(victim);
+	victim->text = text;
+	victim->hash = hash;
+	victim->flag = flag;
+	victim->list = list;
+
+	return victim;
+}
+
+/*
+ * Run a script, parsing it only if it is not already in the cache. A script
+ * which is already running (i.e. runs itself) is parsed again, since running
+ * a "for" loop changes the list while it runs.
+ */
+static int parse_cache_run(const char *s, int flag)
+{
+	struct parse_cache_entry *ent;
+	struct in_str input;
+	struct pipe *list;
+	char *p;
+	uint hash;
+	int code, rcode;
+
+	hash = crc32(0, (const uchar *)s, strlen(s));
+	ent = parse_cache_find(s, hash, flag);
+	if (ent && !ent->busy) {
+		parse_cache_hits++;
+		list = ent->list;
+	} else {
+		parse_cache_misses++;
+		if (!(p = strchr(s, '\n')) || *++p) {
+			p = xmalloc(strlen(s) + 2);
+			strcpy(p, s);
+			strcat(p, "\n");
+			setup_string_in_str(&input, p);
+		} else {
+			p = NULL;
+			setup_string_in_str(&input, s);
+		}
+		list = parse_stream_list(&input, flag, &rcode);
+		free(p);
+		if (!list)
+			return 1;
+		ent = ent ? NULL : parse_cache_add(s, hash, flag, list);
+	}
+
+	if (ent) {
+		ent->last_used = ++parse_cache_clock;
+		ent->busy++;
+		code = run_list_real(list);
+		ent->busy--;
+	} else {
+		code = run_list(list);
+	}
+	if (code == -2)		/* exit */
+		code = 0;
+	else if (code == -1)
+		flag_repeat = 0;
+
+	return code != 0 ? 1 : 0;
+}
+#endif /* CONFIG_HUSH_PARSE_CACHE */
+
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
@@ -3266,6 +3450,12 @@ int parse_string_outer(const char *s, int flag)
 		return 1;
 	if (!*s)
 		return 0;
+#ifdef CONFIG_HUSH_PARSE_CACHE
+	/* the field separators affect parsing, so only cache with the default */
+	if ((flag & FLAG_CONT_ON_NEWLINE) && !parse_cache_disabled &&
+	    !env_get("IFS"))
+		return parse_cache_run(s, flag);
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
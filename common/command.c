@@ -116,10 +116,83 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+cmd_tbl_t *find_cmd_tbl_sorted(const char *cmd, cmd_tbl_t *table,
+				int table_len)
+{
+#ifdef CONFIG_CMDLINE
+	cmd_tbl_t *cmdtp;
+	const char *p;
+	int lo, hi, mid;
+	int len;
+
+	if (!cmd)
+		return NULL;
+	len = ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+
+	/* find the first command which is not before the abbreviation */
+	lo = 0;
+	hi = table_len;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (strncmp(table[mid].name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == table_len)
+		return NULL;
+
+	/*
+	 * All commands starting with the abbreviation are next to each other
+	 * and a full match comes first, since it is the shortest
+	 */
+	cmdtp = table + lo;
+	if (strncmp(cmdtp->name, cmd, len))
+		return NULL;
+	if (!cmdtp->name[len])
+		return cmdtp;		/* full match */
+	if (lo + 1 < table_len && !strncmp(cmdtp[1].name, cmd, len))
+		return NULL;		/* ambiguous */
+
+	return cmdtp;			/* exactly one match */
+#else
+	return NULL;
+#endif /* CONFIG_CMDLINE */
+}
+
+/*
+ * The linker scripts sort linker lists by section name, so the command table
+ * is in order of command name. Check this once, in case a linker script does
+ * not sort, so that find_cmd() can fall back to a linear search.
+ */
+static bool cmd_tbl_sorted(cmd_tbl_t *table, int table_len)
+{
+	static int sorted = -1;
+	const char *last = NULL;
+	cmd_tbl_t *cmdtp;
+
+	if (sorted == -1) {
+		sorted = 1;
+		for (cmdtp = table; cmdtp != table + table_len; cmdtp++) {
+			if (last && strcmp(last, cmdtp->name) >= 0) {
+				sorted = 0;
+				break;
+			}
+			last = cmdtp->name;
+		}
+	}
+
+	return sorted;
+}
+
 cmd_tbl_t *find_cmd(const char *cmd)
 {
 	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
 	const int len = ll_entry_count(cmd_tbl_t, cmd);
+
+	if (cmd_tbl_sorted(start, len))
+		return find_cmd_tbl_sorted(cmd, start, len);
+
 	return find_cmd_tbl(cmd, start, len);
 }
 
@@ -19,6 +19,32 @@ void malloc_stats();
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+/*
+  The public functions are wrappers (at the end of this file) which collect
+  statistics and call the allocator under these names. Calls within the
+  allocator, e.g. from calloc() to malloc(), are therefore not counted.
+*/
+#undef mALLOc
+#undef fREe
+#undef rEALLOc
+#undef mEMALIGn
+#undef cALLOc
+#define mALLOc		dl_malloc
+#define fREe		dl_free
+#define rEALLOc		dl_realloc
+#define mEMALIGn	dl_memalign
+#define cALLOc		dl_calloc
+
+static Void_t *mALLOc(size_t bytes);
+static void fREe(Void_t *mem);
+static Void_t *rEALLOc(Void_t *oldmem, size_t bytes);
+static Void_t *mEMALIGn(size_t alignment, size_t bytes);
+static Void_t *cALLOc(size_t n, size_t elem_size);
+
+static struct malloc_heap_stats heap_stats;
+#endif
+
 /*
   Emulation of sbrk for WIN32
   All code within the ifdef WIN32 is untested by me.
@@ -669,6 +695,58 @@ void mem_malloc_init(ulong start, ulong size)
 #define mark_binblock(ii)   (binblocks_w = (mbinptr)(binblocks_r | idx2binblock(ii)))
 #define clear_binblock(ii)  (binblocks_w = (mbinptr)(binblocks_r & ~(idx2binblock(ii))))
 
+static void free_chunk(mchunkptr p);
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+/*
+   Fast bins are singly-linked lists of recently freed small chunks, one
+   list for each chunk size. A chunk in a fast bin is still marked as in
+   use, so it is not merged with its neighbours and malloc() can take it
+   straight back. The fast bins are emptied into the normal bins by
+   malloc_consolidate() before the top chunk is extended.
+*/
+
+#define FASTBIN_MAX_REQUEST  (64 * SIZE_SZ / 4)
+#define FASTBIN_MAX_SIZE     request2size(FASTBIN_MAX_REQUEST)
+
+#define fastbin_index(sz) \
+  ((((unsigned long)(sz)) >> (SIZE_SZ == 8 ? 4 : 3)) - 2)
+
+#define NFASTBINS            (fastbin_index(FASTBIN_MAX_SIZE) + 1)
+
+static mchunkptr fastbins[NFASTBINS];
+static int have_fastchunks;
+static int fastbins_enabled = 1;
+
+/*
+  Free each chunk in the fast bins properly, merging it with any free
+  neighbours.
+*/
+
+static void malloc_consolidate(void)
+{
+  mchunkptr p;
+  int i;
+
+  have_fastchunks = 0;
+  for (i = 0; i < NFASTBINS; i++)
+  {
+    while ((p = fastbins[i]) != NULL)
+    {
+      fastbins[i] = p->fd;
+      free_chunk(p);
+    }
+  }
+}
+
+void malloc_fastbins_enable(bool enable)
+{
+  if (!enable && (gd->flags & GD_FLG_FULL_MALLOC_INIT))
+    malloc_consolidate();
+  fastbins_enabled = enable;
+}
+#endif
+
 
 
 
@@ -1269,6 +1347,23 @@ Void_t* mALLOc(bytes) size_t bytes;
 
   nb = request2size(bytes);  /* padded request size; */
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+  if (nb <= FASTBIN_MAX_SIZE)
+  {
+    mchunkptr *fb = &fastbins[fastbin_index(nb)];
+
+    if ((victim = *fb) != NULL)
+    {
+      *fb = victim->fd;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+      heap_stats.fast_hits++;
+#endif
+      check_malloced_chunk(victim, nb);
+      return chunk2mem(victim);
+    }
+  }
+#endif
+
   /* Check for exact match in a bin */
 
   if (is_small_request(nb))  /* Faster version for small requests */
@@ -1457,6 +1552,14 @@ Void_t* mALLOc(bytes) size_t bytes;
   /* Require that there be a remainder, ensuring top always exists  */
   if ( (remainder_size = chunksize(top) - nb) < (long)MINSIZE)
   {
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+    /* Merge the fast bins back in and try again before growing the heap */
+    if (have_fastchunks)
+    {
+      malloc_consolidate();
+      return mALLOc(bytes);
+    }
+#endif
 
 #if HAVE_MMAP
     /* If big and would otherwise need to extend, try to use mmap instead */
@@ -1512,15 +1615,6 @@ void fREe(mem) Void_t* mem;
 #endif
 {
   mchunkptr p;         /* chunk corresponding to mem */
-  INTERNAL_SIZE_T hd;  /* its head field */
-  INTERNAL_SIZE_T sz;  /* its size */
-  int       idx;       /* its bin index */
-  mchunkptr next;      /* next contiguous chunk */
-  INTERNAL_SIZE_T nextsz; /* its size */
-  INTERNAL_SIZE_T prevsz; /* size of previous contiguous chunk */
-  mchunkptr bck;       /* misc temp for linking */
-  mchunkptr fwd;       /* misc temp for linking */
-  int       islr;      /* track whether merging with last_remainder */
 
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
 	/* free() is a no-op - all the memory will be freed on relocation */
@@ -1532,10 +1626,9 @@ void fREe(mem) Void_t* mem;
     return;
 
   p = mem2chunk(mem);
-  hd = p->size;
 
 #if HAVE_MMAP
-  if (hd & IS_MMAPPED)                       /* release mmapped memory. */
+  if (chunk_is_mmapped(p))                   /* release mmapped memory. */
   {
     munmap_chunk(p);
     return;
@@ -1544,6 +1637,37 @@ void fREe(mem) Void_t* mem;
 
   check_inuse_chunk(p);
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+  /* Keep small chunks for reuse, unless they can go back into top */
+  if (fastbins_enabled && chunksize(p) <= FASTBIN_MAX_SIZE &&
+      next_chunk(p) != top)
+  {
+    mchunkptr *fb = &fastbins[fastbin_index(chunksize(p))];
+
+    p->fd = *fb;
+    *fb = p;
+    have_fastchunks = 1;
+    return;
+  }
+#endif
+
+  free_chunk(p);
+}
+
+/* Release an in-use chunk, merging it with any free neighbours */
+
+static void free_chunk(mchunkptr p)
+{
+  INTERNAL_SIZE_T hd = p->size; /* its head field */
+  INTERNAL_SIZE_T sz;  /* its size */
+  int       idx;       /* its bin index */
+  mchunkptr next;      /* next contiguous chunk */
+  INTERNAL_SIZE_T nextsz; /* its size */
+  INTERNAL_SIZE_T prevsz; /* size of previous contiguous chunk */
+  mchunkptr bck;       /* misc temp for linking */
+  mchunkptr fwd;       /* misc temp for linking */
+  int       islr;      /* track whether merging with last_remainder */
+
   sz = hd & ~PREV_INUSE;
   next = chunk_at_offset(p, sz);
   nextsz = chunksize(next);
@@ -2285,6 +2409,18 @@ static void malloc_update_mallinfo()
     }
   }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+  /* Chunks in the fast bins look as if they are in use, but are free */
+  for (i = 0; i < NFASTBINS; ++i)
+  {
+    for (p = fastbins[i]; p; p = p->fd)
+    {
+      avail += chunksize(p);
+      navail++;
+    }
+  }
+#endif
+
   current_mallinfo.ordblks = navail;
   current_mallinfo.uordblks = sbrked_mem - avail;
   current_mallinfo.fordblks = avail;
@@ -2394,6 +2530,154 @@ int initf_malloc(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+/* Read the timer, unless it still needs malloc() to set it up */
+static u64 malloc_stats_ticks(void)
+{
+#if CONFIG_IS_ENABLED(TIMER)
+	if (!gd->timer)
+		return 0;
+#endif
+	return get_ticks();
+}
+
+/* Check whether calls are using the main heap, set up by mem_malloc_init() */
+static bool malloc_stats_active(void)
+{
+	return (gd->flags & GD_FLG_FULL_MALLOC_INIT) && mem_malloc_end;
+}
+
+/* Get the size of the chunk holding @mem, or 0 if not in the main heap */
+static ulong malloc_stats_size(Void_t *mem)
+{
+	if (!mem || !malloc_stats_active())
+		return 0;
+
+	return chunksize(mem2chunk(mem));
+}
+
+/*
+ * Record a call which allocated @mem for a request of @bytes, replacing a
+ * chunk of @old_size bytes (if non-zero). This returns @mem.
+ */
+static Void_t *malloc_stats_add(enum malloc_op op, u64 start, size_t bytes,
+				Void_t *mem, ulong old_size)
+{
+	struct malloc_heap_stats *st = &heap_stats;
+	int i;
+
+	if (!malloc_stats_active())
+		return mem;
+	st->calls[op]++;
+	if (start)
+		st->ticks[op] += get_ticks() - start;
+	if (op == MALLOC_OP_FREE) {
+		st->in_use -= old_size;
+		return NULL;
+	}
+	if (!mem) {
+		st->failures++;
+		return NULL;
+	}
+	st->in_use += malloc_stats_size(mem) - old_size;
+	st->peak = max(st->peak, st->in_use);
+	for (i = 0; i < MALLOC_HIST_COUNT - 1 && bytes > (16UL << i); i++)
+		;
+	st->hist[i]++;
+
+	return mem;
+}
+
+void *malloc(size_t bytes)
+{
+	u64 start = malloc_stats_ticks();
+
+	return malloc_stats_add(MALLOC_OP_MALLOC, start, bytes,
+				dl_malloc(bytes), 0);
+}
+
+void free(void *mem)
+{
+	ulong size = malloc_stats_size(mem);
+	u64 start = malloc_stats_ticks();
+
+	dl_free(mem);
+	malloc_stats_add(MALLOC_OP_FREE, start, 0, NULL, size);
+}
+
+void *realloc(void *oldmem, size_t bytes)
+{
+	ulong old_size = malloc_stats_size(oldmem);
+	u64 start = malloc_stats_ticks();
+
+	return malloc_stats_add(MALLOC_OP_REALLOC, start, bytes,
+				dl_realloc(oldmem, bytes), old_size);
+}
+
+void *memalign(size_t alignment, size_t bytes)
+{
+	u64 start = malloc_stats_ticks();
+
+	return malloc_stats_add(MALLOC_OP_MEMALIGN, start, bytes,
+				dl_memalign(alignment, bytes), 0);
+}
+
+void *calloc(size_t n, size_t elem_size)
+{
+	u64 start = malloc_stats_ticks();
+
+	return malloc_stats_add(MALLOC_OP_CALLOC, start, n * elem_size,
+				dl_calloc(n, elem_size), 0);
+}
+
+/* Add a free chunk to the statistics */
+static void malloc_stats_free_chunk(struct malloc_heap_stats *stats,
+				    mchunkptr p)
+{
+	ulong size = chunksize(p);
+
+	stats->free_bytes += size;
+	stats->free_chunks++;
+	stats->largest_free = max(stats->largest_free, size);
+}
+
+void malloc_get_stats(struct malloc_heap_stats *stats)
+{
+	mbinptr b;
+	mchunkptr p;
+	int i;
+
+	*stats = heap_stats;
+	stats->heap_size = sbrked_mem;
+	stats->heap_peak = max_sbrked_mem;
+	if (!malloc_stats_active() || !sbrked_mem)
+		return;
+
+	stats->top_size = chunksize(top);
+	malloc_stats_free_chunk(stats, top);
+	for (i = 1; i < NAV; i++) {
+		b = bin_at(i);
+		for (p = last(b); p != b; p = p->bk)
+			malloc_stats_free_chunk(stats, p);
+	}
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+	for (i = 0; i < NFASTBINS; i++) {
+		for (p = fastbins[i]; p; p = p->fd)
+			malloc_stats_free_chunk(stats, p);
+	}
+#endif
+}
+
+void malloc_reset_stats(void)
+{
+	ulong in_use = heap_stats.in_use;
+
+	memset(&heap_stats, '\0', sizeof(heap_stats));
+	heap_stats.in_use = in_use;
+	heap_stats.peak = in_use;
+}
+#endif
+
 /*
 
 History:
@@ -43,9 +43,21 @@ static ulong spl_fit_read(struct spl_load_info *load, ulong file_offset,
 {
 	loff_t actread;
 	int ret;
-	char *filename = (char *)load->filename;
 
-	ret = fat_read_file(filename, buf, file_offset, size, &actread);
+	ret = fat_pread(load->priv, buf, file_offset, size, &actread);
+	if (ret)
+		return ret;
+
+	return actread;
+}
+
+/* Read from the start of a file, returning the number of bytes read */
+static int spl_fat_read(struct fs_file *file, void *buf, loff_t len)
+{
+	loff_t actread;
+	int ret;
+
+	ret = fat_pread(file, buf, 0, len, &actread);
 	if (ret)
 		return ret;
 
@@ -59,30 +71,38 @@ int spl_load_image_fat_buf(struct spl_image_info *spl_image,
 {
 	int err;
 	struct image_header *header;
+	struct fs_file *file;
 
 	err = spl_register_fat_device(block_dev, partition);
 	if (err)
 		goto end;
 
+	/* Look the file up once, rather than for each read */
+	err = file_fat_open(filename, &file);
+	if (err)
+		goto end;
+
 	/* Allow overwriting load address */
 	if (buffer)
 		header = buffer;
 	else
 		header = spl_get_load_buffer(-sizeof(*header), sizeof(*header));
 
-	err = file_fat_read(filename, header, sizeof(struct image_header));
+	err = spl_fat_read(file, header, sizeof(struct image_header));
 	if (err <= 0)
-		goto end;
+		goto out_close;
 
 	if (IS_ENABLED(CONFIG_SPL_LOAD_FIT_FULL) &&
 	    image_get_magic(header) == FDT_MAGIC) {
-		err = file_fat_read(filename, (void *)CONFIG_SYS_LOAD_ADDR, 0);
+		err = spl_fat_read(file, (void *)CONFIG_SYS_LOAD_ADDR, 0);
 		if (err <= 0)
-			goto end;
+			goto out_close;
 		err = spl_parse_image_header(spl_image,
 				(struct image_header *)CONFIG_SYS_LOAD_ADDR);
-		if (err == -EAGAIN)
+		if (err == -EAGAIN) {
+			fat_close_file(file);
 			return err;
+		}
 		if (err == 0)
 			err = 1;
 	} else if (IS_ENABLED(CONFIG_SPL_LOAD_FIT) &&
@@ -93,27 +113,31 @@ int spl_load_image_fat_buf(struct spl_image_info *spl_image,
 		load.read = spl_fit_read;
 		load.bl_len = 1;
 		load.filename = (void *)filename;
-		load.priv = NULL;
+		load.priv = file;
 
 		/* Force load address if dedicated buffer is provided */
 		if (buffer)
-			return spl_load_simple_fit_ex(spl_image, &load, 0,
-						      header, buffer);
+			err = spl_load_simple_fit_ex(spl_image, &load, 0,
+						     header, buffer);
 		else
-			return spl_load_simple_fit(spl_image, &load, 0, header);
+			err = spl_load_simple_fit(spl_image, &load, 0, header);
+		fat_close_file(file);
+		return err;
 	} else {
 		err = spl_parse_image_header(spl_image, header);
 		if (err)
-			goto end;
+			goto out_close;
 
 		/* Allow overwriting load address */
 		if (buffer)
 			spl_image->load_addr = (uintptr_t)buffer;
 
-		err = file_fat_read(filename,
-				    (u8 *)(uintptr_t)spl_image->load_addr, 0);
+		err = spl_fat_read(file, (u8 *)(uintptr_t)spl_image->load_addr,
+				   0);
 	}
 
+out_close:
+	fat_close_file(file);
 end:
 #ifdef CONFIG_SPL_LIBCOMMON_SUPPORT
 	if (err <= 0)
@@ -11,6 +11,7 @@
 #include <linux/libfdt.h>
 #include <malloc.h>
 #include <spl.h>
+#include <u-boot/zstd.h>
 
 #ifndef CONFIG_SYS_BOOTM_LEN
 #define CONFIG_SYS_BOOTM_LEN	(64 << 20)
@@ -207,15 +208,17 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	const void *data;
 	bool external_data = false;
 
-	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
-	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
+	bool decomp = IS_ENABLED(CONFIG_SPL_OS_BOOT) &&
+		(IS_ENABLED(CONFIG_SPL_GZIP) || IS_ENABLED(CONFIG_SPL_ZSTD));
+
+	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) || decomp) {
 		if (fit_image_get_type(fit, node, &type))
 			puts("Cannot get image type.\n");
 		else
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP)) {
+	if (decomp) {
 		if (fit_image_get_comp(fit, node, &image_comp))
 			puts("Cannot get image compression format.\n");
 		else
@@ -283,6 +286,14 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			return -EIO;
 		}
 		length = size;
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) && image_comp == IH_COMP_ZSTD) {
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		if (zstd_decompress(src, length, (void *)load_addr, &unc_len)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = unc_len;
 	} else {
 		memcpy((void *)load_addr, src, length);
 	}
@@ -457,6 +457,7 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_media_changed(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -470,9 +471,17 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_media_changed(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
+void blk_media_changed(struct blk_desc *desc)
+{
+	static uint media_gen;
+
+	desc->media_gen = ++media_gen;
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
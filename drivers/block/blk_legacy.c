@@ -246,6 +246,7 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 	ret = get_desc(drv, devnum, &desc);
 	if (ret)
 		return ret;
+	blk_media_changed(desc);
 	return desc->block_write(desc, start, blkcnt, buffer);
 }
 
@@ -262,3 +263,10 @@ int blk_select_hwpart_devnum(enum if_type if_type, int devnum, int hwpart)
 		return ret;
 	return drv->select_hwpart(desc, hwpart);
 }
+
+void blk_media_changed(struct blk_desc *desc)
+{
+	static uint media_gen;
+
+	desc->media_gen = ++media_gen;
+}
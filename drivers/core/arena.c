@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Arena allocator for bind-time driver model data
+ *
+ * Binding a device allocates the udevice and up to three blocks of platform
+ * data, and the first use of a uclass allocates the uclass and its private
+ * data. These are small and there are a lot of them, so while driver model
+ * is scanning for devices they come from a single block (the arena), sized
+ * from the device tree before the scan starts.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/arena.h>
+#include <dm/platdata.h>
+#include <dm/uclass-internal.h>
+#include <linux/libfdt.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Space taken by the arena header, keeping the data aligned */
+#define DM_ARENA_HDR	ALIGN(sizeof(struct dm_arena), DM_ARENA_ALIGN)
+
+static void *arena_data(struct dm_arena *arena)
+{
+	return (void *)arena + DM_ARENA_HDR;
+}
+
+/* Work out how much space a full scan is likely to need */
+static ulong dm_arena_estimate(void)
+{
+	struct uclass_driver *uc_drv =
+		ll_entry_start(struct uclass_driver, uclass);
+	const int n_uc = ll_entry_count(struct uclass_driver, uclass);
+	int nodes = ll_entry_count(struct driver_info, driver_info);
+	struct uclass_driver *entry;
+	ulong size = 0;
+
+	/* Any uclass may be used, and we know how big each one is */
+	for (entry = uc_drv; entry != uc_drv + n_uc; entry++) {
+		size += ALIGN(sizeof(struct uclass), DM_ARENA_ALIGN);
+		size += ALIGN(entry->priv_auto_alloc_size, DM_ARENA_ALIGN);
+	}
+
+	if (CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA) &&
+	    gd->fdt_blob) {
+		int offset;
+
+		for (offset = 0; offset >= 0;
+		     offset = fdt_next_node(gd->fdt_blob, offset, NULL))
+			nodes++;
+	}
+	size += nodes * ALIGN(sizeof(struct udevice) +
+			      CONFIG_DM_ARENA_NODE_EXTRA, DM_ARENA_ALIGN);
+
+	return size;
+}
+
+int dm_arena_open(void)
+{
+	struct dm_arena *arena;
+	ulong size;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return 0;
+	size = dm_arena_estimate();
+	arena = calloc(1, DM_ARENA_HDR + size);
+	if (!arena)
+		return -ENOMEM;
+	arena->size = size;
+	arena->open = true;
+	arena->next = gd->dm_arena;
+	gd->dm_arena = arena;
+	debug("%s: %lx bytes at %p\n", __func__, size, arena_data(arena));
+
+	return 0;
+}
+
+void dm_arena_close(void)
+{
+	struct dm_arena *arena = gd->dm_arena;
+
+	if (arena && arena->open) {
+		arena->open = false;
+		debug("%s: used %lx/%lx bytes, %u allocs, %u misses\n",
+		      __func__, arena->used, arena->size, arena->allocs,
+		      arena->misses);
+	}
+}
+
+void dm_arena_release(void)
+{
+	struct dm_arena *arena, *next;
+
+	for (arena = gd->dm_arena; arena; arena = next) {
+		next = arena->next;
+		free(arena);
+	}
+	gd->dm_arena = NULL;
+}
+
+void *dm_arena_calloc(size_t size)
+{
+	struct dm_arena *arena = gd->dm_arena;
+	ulong aligned = ALIGN(size, DM_ARENA_ALIGN);
+	void *ptr;
+
+	if (arena && arena->open) {
+		if (aligned <= arena->size - arena->used) {
+			/* The arena is zeroed and never reused */
+			ptr = arena_data(arena) + arena->used;
+			arena->used += aligned;
+			arena->allocs++;
+			return ptr;
+		}
+		arena->misses++;
+	}
+
+	return calloc(1, size);
+}
+
+bool dm_arena_contains(const void *ptr)
+{
+	struct dm_arena *arena;
+
+	for (arena = gd->dm_arena; arena; arena = arena->next) {
+		void *data = arena_data(arena);
+
+		if (ptr >= data && ptr < data + arena->size)
+			return true;
+	}
+
+	return false;
+}
+
+void dm_arena_free(void *ptr)
+{
+	if (ptr && !dm_arena_contains(ptr))
+		free(ptr);
+}
+
+void dm_dump_arena(void)
+{
+	struct dm_arena *arena;
+
+	printf("Arena                   Size     Used  Allocs  Misses\n");
+	for (arena = gd->dm_arena; arena; arena = arena->next) {
+		printf("%-18p  %8lx %8lx %7u %7u%s\n", arena_data(arena),
+		       arena->size, arena->used, arena->allocs, arena->misses,
+		       arena->open ? "  (open)" : "");
+	}
+}
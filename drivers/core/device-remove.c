@@ -11,6 +11,7 @@
 #include <common.h>
 #include <errno.h>
 #include <malloc.h>
+#include <dm/arena.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/uclass.h>
@@ -86,15 +87,15 @@ int device_unbind(struct udevice *dev)
 		return ret;
 
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
-		free(dev->platdata);
+		dm_arena_free(dev->platdata);
 		dev->platdata = NULL;
 	}
 	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA) {
-		free(dev->uclass_platdata);
+		dm_arena_free(dev->uclass_platdata);
 		dev->uclass_platdata = NULL;
 	}
 	if (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA) {
-		free(dev->parent_platdata);
+		dm_arena_free(dev->parent_platdata);
 		dev->parent_platdata = NULL;
 	}
 	ret = uclass_unbind_device(dev);
@@ -108,7 +109,7 @@ int device_unbind(struct udevice *dev)
 
 	if (dev->flags & DM_FLAG_NAME_ALLOCED)
 		free((char *)dev->name);
-	free(dev);
+	dm_arena_free(dev);
 
 	return 0;
 }
@@ -201,7 +202,7 @@ int device_remove(struct udevice *dev, uint flags)
 		device_free(dev);
 
 		dev->seq = -1;
-		dev->flags &= ~DM_FLAG_ACTIVATED;
+		dev->flags &= ~(DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING);
 	}
 
 	return ret;
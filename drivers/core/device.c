@@ -14,6 +14,7 @@
 #include <fdtdec.h>
 #include <fdt_support.h>
 #include <malloc.h>
+#include <dm/arena.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -50,7 +51,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		return ret;
 	}
 
-	dev = calloc(1, sizeof(struct udevice));
+	dev = dm_arena_calloc(sizeof(struct udevice));
 	if (!dev)
 		return -ENOMEM;
 
@@ -100,8 +101,8 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (alloc) {
 			dev->flags |= DM_FLAG_ALLOC_PDATA;
-			dev->platdata = calloc(1,
-					       drv->platdata_auto_alloc_size);
+			dev->platdata = dm_arena_calloc(
+					drv->platdata_auto_alloc_size);
 			if (!dev->platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc1;
@@ -116,7 +117,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	size = uc->uc_drv->per_device_platdata_auto_alloc_size;
 	if (size) {
 		dev->flags |= DM_FLAG_ALLOC_UCLASS_PDATA;
-		dev->uclass_platdata = calloc(1, size);
+		dev->uclass_platdata = dm_arena_calloc(size);
 		if (!dev->uclass_platdata) {
 			ret = -ENOMEM;
 			goto fail_alloc2;
@@ -131,7 +132,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (size) {
 			dev->flags |= DM_FLAG_ALLOC_PARENT_PDATA;
-			dev->parent_platdata = calloc(1, size);
+			dev->parent_platdata = dm_arena_calloc(size);
 			if (!dev->parent_platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc3;
@@ -194,24 +195,24 @@ fail_uclass_bind:
 	if (CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)) {
 		list_del(&dev->sibling_node);
 		if (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA) {
-			free(dev->parent_platdata);
+			dm_arena_free(dev->parent_platdata);
 			dev->parent_platdata = NULL;
 		}
 	}
 fail_alloc3:
 	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA) {
-		free(dev->uclass_platdata);
+		dm_arena_free(dev->uclass_platdata);
 		dev->uclass_platdata = NULL;
 	}
 fail_alloc2:
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
-		free(dev->platdata);
+		dm_arena_free(dev->platdata);
 		dev->platdata = NULL;
 	}
 fail_alloc1:
 	devres_release_all(dev);
 
-	free(dev);
+	dm_arena_free(dev);
 
 	return ret;
 }
@@ -305,19 +306,13 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+static int device_probe_dev(struct udevice *dev)
 {
 	const struct driver *drv;
 	int size = 0;
 	int ret;
 	int seq;
 
-	if (!dev)
-		return -EINVAL;
-
-	if (dev->flags & DM_FLAG_ACTIVATED)
-		return 0;
-
 	drv = dev->driver;
 	assert(drv);
 
@@ -445,6 +440,81 @@ fail:
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	int span = -1;
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev->flags & DM_FLAG_ACTIVATED)
+		return device_probe_complete(dev);
+
+	if (IS_ENABLED(CONFIG_BOOTSTAGE_DM_PROBE))
+		span = bootstage_span_begin(dev->name);
+	ret = device_probe_dev(dev);
+	bootstage_span_end(span);
+
+	return ret;
+}
+
+int device_probe_start(struct udevice *dev)
+{
+	const struct uclass_driver *uc_drv;
+	int ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev->flags & DM_FLAG_ACTIVATED)
+		return 0;
+
+	ret = device_probe(dev);
+	if (ret)
+		return ret;
+
+	uc_drv = dev->uclass->uc_drv;
+	if (!uc_drv->probe_start)
+		return 0;
+	ret = uc_drv->probe_start(dev);
+	if (ret)
+		goto fail;
+	if (uc_drv->probe_complete)
+		dev->flags |= DM_FLAG_PROBE_PENDING;
+
+	return 0;
+fail:
+	if (device_remove(dev, DM_REMOVE_NORMAL)) {
+		dm_warn("%s: Device '%s' failed to remove on error path\n",
+			__func__, dev->name);
+	}
+
+	return ret;
+}
+
+int device_probe_complete(struct udevice *dev)
+{
+	int ret;
+
+	if (!(dev->flags & DM_FLAG_PROBE_PENDING))
+		return 0;
+
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+	ret = dev->uclass->uc_drv->probe_complete(dev);
+	if (ret)
+		goto fail;
+
+	return 0;
+fail:
+	if (device_remove(dev, DM_REMOVE_NORMAL)) {
+		dm_warn("%s: Device '%s' failed to remove on error path\n",
+			__func__, dev->name);
+	}
+
+	return ret;
+}
+
 void *dev_get_platdata(const struct udevice *dev)
 {
 	if (!dev) {
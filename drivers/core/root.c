@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <linux/libfdt.h>
+#include <dm/arena.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -188,6 +189,11 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+	if (CONFIG_IS_ENABLED(DM_ARENA)) {
+		/* The uclasses may be in an arena, so drop them with it */
+		INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+		dm_arena_release();
+	}
 
 	return 0;
 }
@@ -386,7 +392,7 @@ __weak int dm_scan_other(bool pre_reloc_only)
 	return 0;
 }
 
-int dm_init_and_scan(bool pre_reloc_only)
+static int dm_do_init_and_scan(bool pre_reloc_only)
 {
 	int ret;
 
@@ -416,6 +422,20 @@ int dm_init_and_scan(bool pre_reloc_only)
 	return 0;
 }
 
+int dm_init_and_scan(bool pre_reloc_only)
+{
+	int ret;
+
+	/* Devices bound from here on are allocated from an arena if enabled */
+	ret = dm_arena_open();
+	if (ret)
+		debug("dm_arena_open() failed: %d\n", ret);
+	ret = dm_do_init_and_scan(pre_reloc_only);
+	dm_arena_close();
+
+	return ret;
+}
+
 /* This is the root driver - all drivers are children of this */
 U_BOOT_DRIVER(root_driver) = {
 	.name	= "root_driver",
@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <errno.h>
 #include <malloc.h>
+#include <dm/arena.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -65,11 +66,11 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 		 */
 		return -EPFNOSUPPORT;
 	}
-	uc = calloc(1, sizeof(*uc));
+	uc = dm_arena_calloc(sizeof(*uc));
 	if (!uc)
 		return -ENOMEM;
 	if (uc_drv->priv_auto_alloc_size) {
-		uc->priv = calloc(1, uc_drv->priv_auto_alloc_size);
+		uc->priv = dm_arena_calloc(uc_drv->priv_auto_alloc_size);
 		if (!uc->priv) {
 			ret = -ENOMEM;
 			goto fail_mem;
@@ -91,12 +92,12 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	return 0;
 fail:
 	if (uc_drv->priv_auto_alloc_size) {
-		free(uc->priv);
+		dm_arena_free(uc->priv);
 		uc->priv = NULL;
 	}
 	list_del(&uc->sibling_node);
 fail_mem:
-	free(uc);
+	dm_arena_free(uc);
 
 	return ret;
 }
@@ -129,8 +130,8 @@ int uclass_destroy(struct uclass *uc)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
-		free(uc->priv);
-	free(uc);
+		dm_arena_free(uc->priv);
+	dm_arena_free(uc);
 
 	return 0;
 }
@@ -15,6 +15,11 @@
 #include <dma-uclass.h>
 #include <dt-structs.h>
 #include <errno.h>
+#include <watchdog.h>
+#include <linux/sizes.h>
+
+/* Bytes copied by the CPU between watchdog resets, if no DMA can be used */
+#define DMA_CPU_CHUNK	SZ_64K
 
 #ifdef CONFIG_DMA_CHANNELS
 static inline struct dma_ops *dma_dev_ops(struct udevice *dev)
@@ -234,6 +239,105 @@ int dma_memcpy(void *dst, void *src, size_t len)
 	return ops->transfer(dev, DMA_MEM_TO_MEM, dst, src, len);
 }
 
+/* Find a memcpy device, preferring one which can queue transfers */
+static struct udevice *dma_find_copy_device(void)
+{
+	struct udevice *dev, *found = NULL;
+	int ret;
+
+	for (ret = uclass_first_device(UCLASS_DMA, &dev); dev && !ret;
+	     ret = uclass_next_device(&dev)) {
+		struct dma_dev_priv *uc_priv = dev_get_uclass_priv(dev);
+		const struct dma_ops *ops = device_get_ops(dev);
+
+		if (!(uc_priv->supported & DMA_SUPPORTS_MEM_TO_MEM))
+			continue;
+		if (ops->transfer_start && ops->transfer_wait)
+			return dev;
+		if (ops->transfer && !found)
+			found = dev;
+	}
+
+	return found;
+}
+
+int dma_memcpy_start(struct dma_copy *copy, void *dst, void *src, size_t len)
+{
+	const struct dma_ops *ops;
+	struct udevice *dev;
+	ulong start, end;
+	int ret;
+
+	copy->dev = NULL;
+	copy->dst = dst;
+	copy->len = len;
+	if (!len)
+		return 0;
+
+	dev = dma_find_copy_device();
+	if (!dev) {
+		/* Copy in chunks, as memmove_wd() does */
+		while (len) {
+			size_t chunk = min_t(size_t, len, DMA_CPU_CHUNK);
+
+			memcpy(dst, src, chunk);
+			WATCHDOG_RESET();
+			dst += chunk;
+			src += chunk;
+			len -= chunk;
+		}
+		return 0;
+	}
+
+	/* Write back the source, and drop any lines held for the destination */
+	start = ALIGN_DOWN((ulong)src, ARCH_DMA_MINALIGN);
+	end = ALIGN((ulong)src + len, ARCH_DMA_MINALIGN);
+	flush_dcache_range(start, end);
+	start = ALIGN_DOWN((ulong)dst, ARCH_DMA_MINALIGN);
+	end = ALIGN((ulong)dst + len, ARCH_DMA_MINALIGN);
+	/* Lines only partly covered may hold dirty data next to it */
+	if (start != (ulong)dst)
+		flush_dcache_range(start, start + ARCH_DMA_MINALIGN);
+	if (end != (ulong)dst + len)
+		flush_dcache_range(end - ARCH_DMA_MINALIGN, end);
+	invalidate_dcache_range(start, end);
+
+	ops = device_get_ops(dev);
+	if (!ops->transfer_start)
+		return ops->transfer(dev, DMA_MEM_TO_MEM, dst, src, len);
+
+	ret = ops->transfer_start(dev, DMA_MEM_TO_MEM, dst, src, len,
+				  &copy->cookie);
+	if (ret)
+		return ret;
+	copy->dev = dev;
+
+	return 0;
+}
+
+int dma_memcpy_wait(struct dma_copy *copy)
+{
+	const struct dma_ops *ops;
+	ulong start, end;
+	int ret;
+
+	if (!copy->dev)
+		return 0;
+
+	ops = device_get_ops(copy->dev);
+	ret = ops->transfer_wait(copy->dev, copy->cookie);
+	copy->dev = NULL;
+	if (ret)
+		return ret;
+
+	/* The CPU may have fetched lines of the destination meanwhile */
+	start = ALIGN_DOWN((ulong)copy->dst, ARCH_DMA_MINALIGN);
+	end = ALIGN((ulong)copy->dst + copy->len, ARCH_DMA_MINALIGN);
+	invalidate_dcache_range(start, end);
+
+	return 0;
+}
+
 UCLASS_DRIVER(dma) = {
 	.id		= UCLASS_DMA,
 	.name		= "dma",
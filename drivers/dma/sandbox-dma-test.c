@@ -16,6 +16,7 @@
 
 #define SANDBOX_DMA_CH_CNT 3
 #define SANDBOX_DMA_BUF_SIZE 1024
+#define SANDBOX_DMA_QUEUE_LEN 4
 
 struct sandbox_dma_chan {
 	struct sandbox_dma_dev *ud;
@@ -26,6 +27,13 @@ struct sandbox_dma_chan {
 	bool enabled;
 };
 
+/* A memcpy queued by transfer_start(), which happens in transfer_wait() */
+struct sandbox_dma_copy {
+	void *dst;
+	void *src;
+	size_t len;
+};
+
 struct sandbox_dma_dev {
 	struct device *dev;
 	u32 ch_count;
@@ -34,6 +42,9 @@ struct sandbox_dma_dev {
 	uchar	*buf_rx;
 	size_t	data_len;
 	u32	meta;
+	struct sandbox_dma_copy queue[SANDBOX_DMA_QUEUE_LEN];
+	ulong	started;	/* number of copies queued */
+	ulong	done;		/* number of those which are complete */
 };
 
 static int sandbox_dma_transfer(struct udevice *dev, int direction,
@@ -44,6 +55,53 @@ static int sandbox_dma_transfer(struct udevice *dev, int direction,
 	return 0;
 }
 
+/* Complete the oldest queued copy */
+static void sandbox_dma_complete(struct sandbox_dma_dev *ud)
+{
+	struct sandbox_dma_copy *copy;
+
+	copy = &ud->queue[ud->done % SANDBOX_DMA_QUEUE_LEN];
+	memcpy(copy->dst, copy->src, copy->len);
+	ud->done++;
+}
+
+static int sandbox_dma_transfer_start(struct udevice *dev, int direction,
+				      void *dst, void *src, size_t len,
+				      ulong *cookiep)
+{
+	struct sandbox_dma_dev *ud = dev_get_priv(dev);
+	struct sandbox_dma_copy *copy;
+
+	if (direction != DMA_MEM_TO_MEM)
+		return -EINVAL;
+
+	/* If the queue is full, wait for the oldest copy */
+	if (ud->started - ud->done == SANDBOX_DMA_QUEUE_LEN)
+		sandbox_dma_complete(ud);
+
+	copy = &ud->queue[ud->started % SANDBOX_DMA_QUEUE_LEN];
+	copy->dst = dst;
+	copy->src = src;
+	copy->len = len;
+	*cookiep = ud->started++;
+	debug("%s(cookie=%lu len=%zu)\n", __func__, *cookiep, len);
+
+	return 0;
+}
+
+static int sandbox_dma_transfer_wait(struct udevice *dev, ulong cookie)
+{
+	struct sandbox_dma_dev *ud = dev_get_priv(dev);
+
+	if (cookie >= ud->started)
+		return -EINVAL;
+
+	while (ud->done <= cookie)
+		sandbox_dma_complete(ud);
+
+	return 0;
+}
+
 static int sandbox_dma_of_xlate(struct dma *dma,
 				struct ofnode_phandle_args *args)
 {
@@ -227,6 +285,8 @@ static int sandbox_dma_prepare_rcv_buf(struct dma *dma, void *dst, size_t size)
 
 static const struct dma_ops sandbox_dma_ops = {
 	.transfer	= sandbox_dma_transfer,
+	.transfer_start	= sandbox_dma_transfer_start,
+	.transfer_wait	= sandbox_dma_transfer_wait,
 	.of_xlate	= sandbox_dma_of_xlate,
 	.request	= sandbox_dma_request,
 	.free		= sandbox_dma_free,
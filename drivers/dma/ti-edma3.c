@@ -37,6 +37,13 @@
 
 struct ti_edma3_priv {
 	u32 base;
+	/* copy started by ti_edma3_transfer_start(), if busy */
+	bool busy;
+	struct edma3_channel_config chan;
+	void *rem_dst;
+	void *rem_src;
+	size_t rem_len;
+	ulong started;
 };
 
 static u8 edma_fill_buffer[EDMA_FILL_BUFFER_SIZE] __aligned(ARCH_DMA_MINALIGN);
@@ -518,11 +525,99 @@ void edma3_fill(unsigned long edma3_base_addr, unsigned int edma_slot_num,
 
 #else
 
+/* Wait for the copy started by ti_edma3_transfer_start(), if any */
+static void ti_edma3_finish(struct ti_edma3_priv *priv)
+{
+	if (!priv->busy)
+		return;
+
+	while (edma3_check_for_transfer(priv->base, &priv->chan))
+		;
+	qedma3_stop(priv->base, &priv->chan);
+
+	/* the part which is not a whole number of blocks */
+	if (priv->rem_len)
+		__edma3_transfer(priv->base, 1, priv->rem_dst, priv->rem_src,
+				 priv->rem_len, priv->rem_len);
+
+	disable_edma3_clocks();
+	priv->busy = false;
+}
+
+static int ti_edma3_transfer_start(struct udevice *dev, int direction,
+				   void *dst, void *src, size_t len,
+				   ulong *cookiep)
+{
+	struct ti_edma3_priv *priv = dev_get_priv(dev);
+	struct edma3_slot_config slot;
+	unsigned int max_acnt = 0x7FFFU;
+	size_t acnt = len, bcnt = 1;
+
+	if (direction != DMA_MEM_TO_MEM)
+		return -EINVAL;
+
+	/* only one copy at a time, so wait for the last */
+	ti_edma3_finish(priv);
+
+	if (len > max_acnt) {
+		acnt = max_acnt;
+		bcnt = len / max_acnt;
+	}
+	priv->rem_len = len - acnt * bcnt;
+	priv->rem_dst = dst + acnt * bcnt;
+	priv->rem_src = src + acnt * bcnt;
+
+	enable_edma3_clocks();
+
+	slot.src	= (unsigned int)src;
+	slot.acnt	= acnt;
+	slot.bcnt	= bcnt;
+	slot.ccnt	= 1;
+	slot.src_bidx	= acnt;
+	slot.dst_bidx	= acnt;
+	slot.src_cidx	= 0;
+	slot.dst_cidx	= 0;
+	slot.link	= EDMA3_PARSET_NULL_LINK;
+	slot.bcntrld	= 0;
+	slot.opt	= EDMA3_SLOPT_TRANS_COMP_INT_ENB |
+			  EDMA3_SLOPT_COMP_CODE(0) |
+			  EDMA3_SLOPT_STATIC | EDMA3_SLOPT_AB_SYNC;
+	edma3_slot_configure(priv->base, 1, &slot);
+
+	priv->chan.slot = 1;
+	priv->chan.chnum = 0;
+	priv->chan.complete_code = 0;
+	/* set event trigger to dst update */
+	priv->chan.trigger_slot_word = EDMA3_TWORD(dst);
+	qedma3_start(priv->base, &priv->chan);
+	edma3_set_dest_addr(priv->base, priv->chan.slot, (unsigned int)dst);
+
+	priv->busy = true;
+	*cookiep = priv->started++;
+
+	return 0;
+}
+
+static int ti_edma3_transfer_wait(struct udevice *dev, ulong cookie)
+{
+	struct ti_edma3_priv *priv = dev_get_priv(dev);
+
+	if (cookie >= priv->started)
+		return -EINVAL;
+
+	/* earlier copies finished before the latest one was started */
+	ti_edma3_finish(priv);
+
+	return 0;
+}
+
 static int ti_edma3_transfer(struct udevice *dev, int direction, void *dst,
 			     void *src, size_t len)
 {
 	struct ti_edma3_priv *priv = dev_get_priv(dev);
 
+	ti_edma3_finish(priv);
+
 	/* enable edma3 clocks */
 	enable_edma3_clocks();
 
@@ -561,6 +656,8 @@ static int ti_edma3_probe(struct udevice *dev)
 
 static const struct dma_ops ti_edma3_ops = {
 	.transfer	= ti_edma3_transfer,
+	.transfer_start	= ti_edma3_transfer_start,
+	.transfer_wait	= ti_edma3_transfer_wait,
 };
 
 static const struct udevice_id ti_edma3_ids[] = {
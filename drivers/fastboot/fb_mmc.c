@@ -96,6 +96,19 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	if (fastboot_progress_callback)
+		fastboot_progress_callback("erasing");
+
+	return blk_derase(sparse->dev_desc, blk, blkcnt);
+}
+#endif
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -403,6 +416,7 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	if (is_sparse_image(download_buffer)) {
 		struct fb_mmc_sparse sparse_priv;
 		struct sparse_storage sparse;
+		struct mmc *mmc __maybe_unused;
 		int err;
 
 		sparse_priv.dev_desc = dev_desc;
@@ -412,8 +426,18 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.size = info.size;
 		sparse.write = fb_mmc_sparse_write;
 		sparse.reserve = fb_mmc_sparse_reserve;
+		sparse.erase = NULL;
 		sparse.mssg = fastboot_fail;
 
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+		/* Erase rather than write zeroes, if that gives zeroes */
+		mmc = find_mmc_device(CONFIG_FASTBOOT_FLASH_MMC_DEV);
+		if (mmc && mmc->erase_zero) {
+			sparse.erase = fb_mmc_sparse_erase;
+			sparse.erase_grp = mmc->erase_grp_size;
+		}
+#endif
+
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
@@ -9,6 +9,7 @@
 #include <dm.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <dm/uclass-internal.h>
 #include "mmc_private.h"
 
 int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
@@ -231,7 +232,8 @@ void mmc_do_preinit(void)
 #ifdef CONFIG_FSL_ESDHC_ADAPTER_IDENT
 		mmc_set_preinit(m, 1);
 #endif
-		if (m->preinit)
+		/* mmc_probe_start() may have started it already */
+		if (m->preinit && !m->init_in_progress)
 			mmc_start_init(m);
 	}
 }
@@ -243,16 +245,23 @@ void print_mmc_devices(char separator)
 	char *mmc_type;
 	bool first = true;
 
-	for (uclass_first_device(UCLASS_MMC, &dev);
+	/*
+	 * Don't probe the devices, since that would wait for any which
+	 * mmc_initialize() started to finish their init
+	 */
+	for (uclass_find_first_device(UCLASS_MMC, &dev);
 	     dev;
-	     uclass_next_device(&dev), first = false) {
+	     uclass_find_next_device(&dev)) {
 		struct mmc *m = mmc_get_mmc_dev(dev);
 
+		if (!m)
+			continue;
 		if (!first) {
 			printf("%c", separator);
 			if (separator != '\n')
 				puts(" ");
 		}
+		first = false;
 		if (m->has_init)
 			mmc_type = IS_SD(m) ? "SD" : "eMMC";
 		else
@@ -334,6 +343,9 @@ static int mmc_select_hwpart(struct udevice *bdev, int hwpart)
 	if (mmc->part_config == MMCPART_NOAVAILABLE)
 		return -EMEDIUMTYPE;
 
+	/* The cache does not know about partitions, so drop what it holds */
+	blkcache_invalidate(desc->if_type, desc->devnum);
+
 	return mmc_switch_part(mmc, hwpart);
 }
 
@@ -375,9 +387,45 @@ U_BOOT_DRIVER(mmc) = {
 	.id	= UCLASS_MMC,
 };
 
+/*
+ * A soldered-down eMMC can take hundreds of milliseconds to power up, so start
+ * it early (when probed with device_probe_start()) and let other devices be
+ * set up while it is busy. Removable cards are left alone, since the boot may
+ * well not use them.
+ */
+static int mmc_probe_start(struct udevice *dev)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	if (!mmc || mmc->has_init || mmc->init_in_progress)
+		return 0;
+	if (!mmc->preinit && !dev_read_bool(dev, "non-removable"))
+		return 0;
+	if (!mmc_getcd(mmc))
+		return 0;
+
+	/* Any error is reported again when the card is used */
+	mmc_start_init(mmc);
+
+	return 0;
+}
+
+static int mmc_probe_complete(struct udevice *dev)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	/* A missing or broken card does not stop the host from being used */
+	if (mmc && mmc->init_in_progress)
+		mmc_init(mmc);
+
+	return 0;
+}
+
 UCLASS_DRIVER(mmc) = {
 	.id		= UCLASS_MMC,
 	.name		= "mmc",
 	.flags		= DM_UC_FLAG_SEQ_ALIAS,
+	.probe_start	= mmc_probe_start,
+	.probe_complete	= mmc_probe_complete,
 	.per_device_auto_alloc_size = sizeof(struct mmc_uclass_priv),
 };
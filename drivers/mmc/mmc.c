@@ -11,6 +11,7 @@
 #include <command.h>
 #include <dm.h>
 #include <dm/device-internal.h>
+#include <dm/uclass-internal.h>
 #include <errno.h>
 #include <mmc.h>
 #include <part.h>
@@ -1282,6 +1283,9 @@ retry_scr:
 
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	mmc->erase_zero = !(mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE);
+#endif
 
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
@@ -2119,6 +2123,9 @@ static int mmc_startup_v4(struct mmc *mmc)
 		return -EINVAL;
 
 	mmc->version = mmc_versions[ext_csd[EXT_CSD_REV]];
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	mmc->erase_zero = !ext_csd[EXT_CSD_ERASED_MEM_CONT];
+#endif
 
 	if (mmc->version >= MMC_VERSION_4_2) {
 		/*
@@ -2837,15 +2844,22 @@ static int mmc_probe(bd_t *bis)
 	/*
 	 * Try to add them in sequence order. Really with driver model we
 	 * should allow holes, but the current MMC list does not allow that.
-	 * So if we request 0, 1, 3 we will get 0, 1, 2.
+	 * So if we request 0, 1, 3 we will get 0, 1, 2. Use
+	 * device_probe_start() here too, so that cards with an alias are
+	 * also started without waiting for them.
 	 */
 	for (i = 0; ; i++) {
-		ret = uclass_get_device_by_seq(UCLASS_MMC, i, &dev);
+		ret = uclass_find_device_by_seq(UCLASS_MMC, i, false, &dev);
+		if (ret == -ENODEV)
+			ret = uclass_find_device_by_seq(UCLASS_MMC, i, true,
+							&dev);
 		if (ret == -ENODEV)
 			break;
+		if (!ret)
+			device_probe_start(dev);
 	}
 	uclass_foreach_dev(dev, uc) {
-		ret = device_probe(dev);
+		ret = device_probe_start(dev);
 		if (ret)
 			pr_err("%s - probe failed: %d\n", dev->name, ret);
 	}
@@ -2862,13 +2876,14 @@ static int mmc_probe(bd_t *bis)
 }
 #endif
 
+static int mmc_initialized;
+
 int mmc_initialize(bd_t *bis)
 {
-	static int initialized = 0;
 	int ret;
-	if (initialized)	/* Avoid initializing mmc multiple times */
+	if (mmc_initialized)	/* Avoid initializing mmc multiple times */
 		return 0;
-	initialized = 1;
+	mmc_initialized = 1;
 
 #if !CONFIG_IS_ENABLED(BLK)
 #if !CONFIG_IS_ENABLED(MMC_TINY)
@@ -2887,6 +2902,13 @@ int mmc_initialize(bd_t *bis)
 	return 0;
 }
 
+#ifdef CONFIG_SANDBOX
+void mmc_reset_initialize(void)
+{
+	mmc_initialized = 0;
+}
+#endif
+
 #ifdef CONFIG_CMD_BKOPS_ENABLE
 int mmc_set_bkops_enable(struct mmc *mmc)
 {
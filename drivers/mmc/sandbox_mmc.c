@@ -9,13 +9,105 @@
 #include <errno.h>
 #include <fdtdec.h>
 #include <mmc.h>
+#include <os.h>
 #include <asm/test.h>
+#include <asm/unaligned.h>
+#include <linux/math64.h>
+
+enum {
+	SANDBOX_MMC_SD,		/* Fake SD card, see sandbox_mmc_send_cmd() */
+	SANDBOX_MMC_EMMC,	/* File-backed eMMC, see sandbox_emmc_send_cmd() */
+};
+
+/* Card states, as reported in the CURRENT_STATE field of the status */
+enum {
+	EMMC_STATE_IDLE,
+	EMMC_STATE_READY,
+	EMMC_STATE_IDENT,
+	EMMC_STATE_STBY,
+	EMMC_STATE_TRAN,
+	EMMC_STATE_DATA,
+	EMMC_STATE_RCV,
+	EMMC_STATE_PRG,
+};
+
+/* Hardware partitions, as selected by PARTITION_ACCESS in PART_CONF */
+enum {
+	EMMC_PART_USER,
+	EMMC_PART_BOOT1,
+	EMMC_PART_BOOT2,
+	EMMC_PART_RPMB,
+	EMMC_PART_COUNT,
+};
+
+/* 512KiB erase groups, in units of 512-byte blocks */
+#define EMMC_ERASE_GRP_BLKS	1024
 
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
 };
 
+/**
+ * struct sandbox_emmc - State of an emulated eMMC device
+ *
+ * The user area is stored at the start of the backing file, followed by the
+ * two boot partitions and then the RPMB partition.
+ *
+ * Each command advances the sandbox timer by the time it would take on a real
+ * bus, so that tests can measure throughput with timer_get_us(). Data
+ * transfers cost a fixed access latency plus the time to move the data, which
+ * is limited either by the bus (clock, width and DDR as set up by the host) or
+ * by the card's internal read/write rate, whichever is slower.
+ *
+ * @fd: File descriptor of the backing file
+ * @part_offset: Offset of each hardware partition in the file, in bytes
+ * @part_size: Size of each hardware partition in bytes
+ * @ext_csd: Extended CSD register
+ * @state: Current card state (EMMC_STATE_...)
+ * @status: Error bits to report in the next status response
+ * @rca: Relative card address
+ * @block_count: Block count from CMD23, or 0 if none
+ * @erase_start: First block to erase, from CMD35
+ * @erase_end: Last block to erase, from CMD36
+ * @tuned: true if tuning has completed since HS200 timing was selected
+ * @read_latency_us: Time before the first block of a read is sent
+ * @write_latency_us: Time to program the last block of a write
+ * @erase_us: Time to erase each erase group
+ * @switch_us: Time to process a CMD6 switch
+ * @power_up_us: Time the card stays busy after it first receives CMD1
+ * @powered: true once the card has received CMD1 since it was probed
+ * @power_on_us: Timer value when the card first received CMD1
+ * @read_rate: Internal read rate of the card in bytes per second
+ * @write_rate: Internal write rate of the card in bytes per second
+ * @pending_ns: Time not yet added to the sandbox timer, in nanoseconds
+ * @cmd_count: Number of times each command has been received
+ */
+struct sandbox_emmc {
+	int fd;
+	u64 part_offset[EMMC_PART_COUNT];
+	u64 part_size[EMMC_PART_COUNT];
+	u8 ext_csd[MMC_MAX_BLOCK_LEN];
+	int state;
+	u32 status;
+	u16 rca;
+	uint block_count;
+	lbaint_t erase_start;
+	lbaint_t erase_end;
+	bool tuned;
+	uint read_latency_us;
+	uint write_latency_us;
+	uint erase_us;
+	uint switch_us;
+	uint power_up_us;
+	bool powered;
+	ulong power_on_us;
+	uint read_rate;
+	uint write_rate;
+	u64 pending_ns;
+	uint cmd_count[64];
+};
+
 /**
  * sandbox_mmc_send_cmd() - Emulate SD commands
  *
@@ -85,6 +177,417 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	return 0;
 }
 
+static const u8 sandbox_emmc_tuning_4bit[] = {
+	0xff, 0x0f, 0xff, 0x00, 0xff, 0xcc, 0xc3, 0xcc,
+	0xc3, 0x3c, 0xcc, 0xff, 0xfe, 0xff, 0xfe, 0xef,
+	0xff, 0xdf, 0xff, 0xdd, 0xff, 0xfb, 0xff, 0xfb,
+	0xbf, 0xff, 0x7f, 0xff, 0x77, 0xf7, 0xbd, 0xef,
+	0xff, 0xf0, 0xff, 0xf0, 0x0f, 0xfc, 0xcc, 0x3c,
+	0xcc, 0x33, 0xcc, 0xcf, 0xff, 0xef, 0xff, 0xee,
+	0xff, 0xfd, 0xff, 0xfd, 0xdf, 0xff, 0xbf, 0xff,
+	0xbb, 0xff, 0xf7, 0xff, 0xf7, 0x7f, 0x7b, 0xde,
+};
+
+static const u8 sandbox_emmc_tuning_8bit[] = {
+	0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00,
+	0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc, 0xcc,
+	0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff, 0xff,
+	0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee, 0xff,
+	0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd, 0xdd,
+	0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff, 0xbb,
+	0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff, 0xff,
+	0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee, 0xff,
+	0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00,
+	0x00, 0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc,
+	0xcc, 0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff,
+	0xff, 0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee,
+	0xff, 0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd,
+	0xdd, 0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff,
+	0xbb, 0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff,
+	0xff, 0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee,
+};
+
+/* Add some bus or card activity to the sandbox timer */
+static void sandbox_emmc_charge(struct sandbox_emmc *card, u64 ns)
+{
+	u32 rem;
+
+	card->pending_ns += ns;
+	if (card->pending_ns >= 1000) {
+		sandbox_timer_add_offset_us(div_u64_rem(card->pending_ns, 1000,
+							&rem));
+		card->pending_ns = rem;
+	}
+}
+
+/* Time taken for a number of cycles of the bus clock, in nanoseconds */
+static u64 sandbox_emmc_clocks_ns(struct mmc *mmc, u64 clocks)
+{
+	uint clock = mmc->clock ? mmc->clock : mmc->cfg->f_min;
+
+	return div_u64(clocks * 1000000000ULL, clock);
+}
+
+/* Time taken to transfer a data payload, limited by the bus or the card */
+static u64 sandbox_emmc_data_ns(struct mmc *mmc, struct mmc_data *data,
+				uint rate)
+{
+	u64 bytes = (u64)data->blocks * data->blocksize;
+	u64 clocks, bus_ns, card_ns;
+
+	clocks = div_u64(bytes * 8, max(mmc->bus_width, 1U));
+	if (mmc->ddr_mode)
+		clocks /= 2;
+	/* Each block has a start bit, a 16-bit CRC and an end bit */
+	clocks += data->blocks * 18;
+	bus_ns = sandbox_emmc_clocks_ns(mmc, clocks);
+	card_ns = rate ? div_u64(bytes * 1000000000ULL, rate) : 0;
+
+	return max(bus_ns, card_ns);
+}
+
+/* Check that the host has set up the bus the way the card expects */
+static int sandbox_emmc_check_bus(struct sandbox_emmc *card, struct mmc *mmc,
+				  bool tuning)
+{
+	static const uint widths[] = { 1, 4, 8, 0 };
+	u8 bus_width = card->ext_csd[EXT_CSD_BUS_WIDTH];
+	uint max_clock;
+
+	if (mmc->bus_width != widths[bus_width & 3] ||
+	    !(bus_width & EXT_CSD_DDR_FLAG) != !mmc->ddr_mode)
+		return -EILSEQ;
+
+	switch (card->ext_csd[EXT_CSD_HS_TIMING]) {
+	case EXT_CSD_TIMING_LEGACY:
+		max_clock = 26000000;
+		break;
+	case EXT_CSD_TIMING_HS:
+		max_clock = 52000000;
+		break;
+	default:
+		/* Sampling is unreliable at HS200 until the host is tuned */
+		if (!tuning && !card->tuned)
+			return -EILSEQ;
+		max_clock = 200000000;
+		break;
+	}
+	if (mmc->clock > max_clock)
+		return -EILSEQ;
+
+	return 0;
+}
+
+/* Reset the card on CMD0, losing any volatile settings */
+static void sandbox_emmc_reset(struct sandbox_emmc *card)
+{
+	card->ext_csd[EXT_CSD_HS_TIMING] = EXT_CSD_TIMING_LEGACY;
+	card->ext_csd[EXT_CSD_BUS_WIDTH] = EXT_CSD_BUS_WIDTH_1;
+	card->ext_csd[EXT_CSD_ERASE_GROUP_DEF] = 0;
+	card->ext_csd[EXT_CSD_PART_CONF] &= ~PART_ACCESS_MASK;
+	card->state = EMMC_STATE_IDLE;
+	card->status = 0;
+	card->rca = 0;
+	card->block_count = 0;
+	card->tuned = false;
+}
+
+static int sandbox_emmc_switch(struct sandbox_emmc *card, u32 arg)
+{
+	uint mode = (arg >> 24) & 3;
+	uint index = (arg >> 16) & 0xff;
+	uint value = (arg >> 8) & 0xff;
+	bool ok;
+
+	if (card->state != EMMC_STATE_TRAN)
+		return -EIO;
+
+	switch (index) {
+	case EXT_CSD_HS_TIMING:
+		ok = value <= EXT_CSD_TIMING_HS200;
+		card->tuned = false;
+		break;
+	case EXT_CSD_BUS_WIDTH:
+		ok = (value & ~EXT_CSD_DDR_FLAG) <= EXT_CSD_BUS_WIDTH_8 &&
+			value != EXT_CSD_DDR_FLAG;
+		break;
+	case EXT_CSD_PART_CONF:
+		value &= PART_ACCESS_MASK;
+		ok = value < EMMC_PART_COUNT && card->part_size[value];
+		value |= card->ext_csd[index] & ~PART_ACCESS_MASK;
+		break;
+	case EXT_CSD_ERASE_GROUP_DEF:
+		ok = value <= 1;
+		break;
+	case EXT_CSD_BOOT_BUS_WIDTH:
+	case EXT_CSD_RST_N_FUNCTION:
+	case EXT_CSD_WR_REL_SET:
+		ok = true;
+		break;
+	default:
+		ok = false;
+		break;
+	}
+
+	if (mode == MMC_SWITCH_MODE_WRITE_BYTE && ok)
+		card->ext_csd[index] = value;
+	else
+		card->status |= MMC_STATUS_SWITCH_ERROR;
+
+	return 0;
+}
+
+/* Read or write blocks in the selected partition of the backing file */
+static int sandbox_emmc_access(struct sandbox_emmc *card, lbaint_t start,
+			       lbaint_t blocks, void *buf, bool write)
+{
+	uint part = card->ext_csd[EXT_CSD_PART_CONF] & PART_ACCESS_MASK;
+	u64 offset = (u64)start * MMC_MAX_BLOCK_LEN;
+	u64 size = (u64)blocks * MMC_MAX_BLOCK_LEN;
+	ssize_t ret;
+
+	/* RPMB is only accessible with authenticated frames */
+	if (part == EMMC_PART_RPMB)
+		return -EIO;
+	if (offset + size > card->part_size[part])
+		return -EIO;
+	if (os_lseek(card->fd, card->part_offset[part] + offset,
+		     OS_SEEK_SET) < 0)
+		return -EIO;
+	if (write)
+		ret = os_write(card->fd, buf, size);
+	else
+		ret = os_read(card->fd, buf, size);
+	if (ret != size)
+		return -EIO;
+
+	return 0;
+}
+
+static int sandbox_emmc_transfer(struct sandbox_emmc *card, struct mmc *mmc,
+				 struct mmc_cmd *cmd, struct mmc_data *data)
+{
+	bool write = data && (data->flags & MMC_DATA_WRITE);
+	bool multi = cmd->cmdidx == MMC_CMD_READ_MULTIPLE_BLOCK ||
+		cmd->cmdidx == MMC_CMD_WRITE_MULTIPLE_BLOCK;
+	uint count = card->block_count;
+	int ret;
+
+	card->block_count = 0;
+	if (card->state != EMMC_STATE_TRAN)
+		return -EIO;
+	if (!data || data->blocksize != MMC_MAX_BLOCK_LEN ||
+	    (!multi && data->blocks != 1) || (count && data->blocks != count))
+		return -EINVAL;
+
+	ret = sandbox_emmc_check_bus(card, mmc, false);
+	if (ret)
+		return ret;
+	ret = sandbox_emmc_access(card, cmd->cmdarg, data->blocks,
+				  write ? (void *)data->src : data->dest,
+				  write);
+	if (ret)
+		return ret;
+
+	if (write)
+		sandbox_emmc_charge(card, card->write_latency_us * 1000ULL +
+				    sandbox_emmc_data_ns(mmc, data,
+							 card->write_rate));
+	else
+		sandbox_emmc_charge(card, card->read_latency_us * 1000ULL +
+				    sandbox_emmc_data_ns(mmc, data,
+							 card->read_rate));
+
+	return 0;
+}
+
+/* Erase (or trim) the range set up by CMD35/CMD36, leaving zeroes behind */
+static int sandbox_emmc_erase(struct sandbox_emmc *card, u32 arg)
+{
+	uint part = card->ext_csd[EXT_CSD_PART_CONF] & PART_ACCESS_MASK;
+	lbaint_t part_blocks = card->part_size[part] / MMC_MAX_BLOCK_LEN;
+	lbaint_t start = card->erase_start;
+	lbaint_t end = card->erase_end + 1;
+	lbaint_t blk, count;
+	void *buf;
+	int ret = 0;
+
+	if (card->state != EMMC_STATE_TRAN || start >= end || end > part_blocks)
+		return -EIO;
+
+	/* Erase works on whole erase groups, trim and discard do not */
+	if (!(arg & MMC_TRIM_ARG)) {
+		start = rounddown(start, EMMC_ERASE_GRP_BLKS);
+		end = min(roundup(end, EMMC_ERASE_GRP_BLKS), part_blocks);
+	}
+
+	buf = calloc(EMMC_ERASE_GRP_BLKS, MMC_MAX_BLOCK_LEN);
+	if (!buf)
+		return -ENOMEM;
+	for (blk = start; !ret && blk < end; blk += count) {
+		count = min(end - blk, (lbaint_t)EMMC_ERASE_GRP_BLKS);
+		ret = sandbox_emmc_access(card, blk, count, buf, true);
+		sandbox_emmc_charge(card, card->erase_us * 1000ULL);
+	}
+	free(buf);
+
+	return ret;
+}
+
+/**
+ * sandbox_emmc_send_cmd() - Emulate eMMC commands
+ *
+ * This emulates an eMMC 5.1 device in sector-addressing mode, with the data
+ * stored in a file. Commands that the card would not respond to (such as the
+ * SD commands used to probe the card type) time out.
+ */
+static int sandbox_emmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+				 struct mmc_data *data)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+	struct sandbox_emmc *card = dev_get_priv(dev);
+	struct mmc *mmc = &plat->mmc;
+	const u8 *pattern;
+	uint size;
+	int ret = 0;
+
+	card->cmd_count[cmd->cmdidx % ARRAY_SIZE(card->cmd_count)]++;
+
+	/* The command and response tokens, with a few cycles in between */
+	sandbox_emmc_charge(card, sandbox_emmc_clocks_ns(mmc,
+		cmd->resp_type & MMC_RSP_136 ? 48 + 136 + 8 : 48 + 48 + 8));
+
+	switch (cmd->cmdidx) {
+	case MMC_CMD_GO_IDLE_STATE:
+		sandbox_emmc_reset(card);
+		break;
+	case MMC_CMD_SEND_OP_COND:
+		if (!card->powered) {
+			card->powered = true;
+			card->power_on_us = timer_get_us();
+		}
+		cmd->response[0] = OCR_HCS | 0x00ff8080;
+		/* OCR_BUSY is set when the card has finished powering up */
+		if (timer_get_us() - card->power_on_us >= card->power_up_us) {
+			cmd->response[0] |= OCR_BUSY;
+			card->state = EMMC_STATE_READY;
+		}
+		break;
+	case MMC_CMD_ALL_SEND_CID:
+		/* Manufacturer 0xfe, product name "SBEMC", revision 1.0 */
+		cmd->response[0] = 0xfe << 24 | 1 << 16 | 'S';
+		cmd->response[1] = 'B' << 24 | 'E' << 16 | 'M' << 8 | 'C';
+		cmd->response[2] = ' ' << 24 | 0x10 << 16 | 0x1234;
+		cmd->response[3] = 0x5678 << 16 | 0x11 << 8 | 1;
+		card->state = EMMC_STATE_IDENT;
+		break;
+	case MMC_CMD_SET_RELATIVE_ADDR:
+		card->rca = cmd->cmdarg >> 16;
+		card->state = EMMC_STATE_STBY;
+		break;
+	case MMC_CMD_SEND_CSD:
+		/* Version 4.x, 25MHz, 512-byte blocks, 512KiB erase groups */
+		cmd->response[0] = 3 << 30 | 4 << 26 | 0x27 << 16 | 1 << 8 |
+			0x32;
+		cmd->response[1] = 0x8f5 << 20 | 9 << 16 | 0x3ff;
+		cmd->response[2] = 3 << 30 | 7 << 15 | 31 << 10 | 31 << 5;
+		cmd->response[3] = 9 << 22;
+		break;
+	case MMC_CMD_SELECT_CARD:
+		card->state = cmd->cmdarg >> 16 == card->rca ?
+			EMMC_STATE_TRAN : EMMC_STATE_STBY;
+		break;
+	case MMC_CMD_SEND_EXT_CSD:
+		/* Without data this is the SD SEND_IF_COND command */
+		if (!data)
+			return -ETIMEDOUT;
+		if (card->state != EMMC_STATE_TRAN ||
+		    data->blocksize != MMC_MAX_BLOCK_LEN)
+			return -EIO;
+		ret = sandbox_emmc_check_bus(card, mmc, false);
+		if (ret)
+			return ret;
+		memcpy(data->dest, card->ext_csd, MMC_MAX_BLOCK_LEN);
+		sandbox_emmc_charge(card, card->read_latency_us * 1000ULL +
+				    sandbox_emmc_data_ns(mmc, data, 0));
+		break;
+	case MMC_CMD_APP_CMD:
+		return -ETIMEDOUT;
+	case MMC_CMD_SWITCH:
+		ret = sandbox_emmc_switch(card, cmd->cmdarg);
+		sandbox_emmc_charge(card, card->switch_us * 1000ULL);
+		break;
+	case MMC_CMD_SEND_STATUS:
+		cmd->response[0] = card->status | MMC_STATUS_RDY_FOR_DATA |
+			card->state << 9;
+		card->status = 0;
+		return 0;
+	case MMC_CMD_SET_BLOCKLEN:
+		if (cmd->cmdarg != MMC_MAX_BLOCK_LEN)
+			return -EIO;
+		break;
+	case MMC_CMD_SET_BLOCK_COUNT:
+		card->block_count = cmd->cmdarg & 0xffff;
+		break;
+	case MMC_CMD_READ_SINGLE_BLOCK:
+	case MMC_CMD_READ_MULTIPLE_BLOCK:
+	case MMC_CMD_WRITE_SINGLE_BLOCK:
+	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
+		ret = sandbox_emmc_transfer(card, mmc, cmd, data);
+		break;
+	case MMC_CMD_STOP_TRANSMISSION:
+		break;
+	case MMC_CMD_ERASE_GROUP_START:
+		card->erase_start = cmd->cmdarg;
+		break;
+	case MMC_CMD_ERASE_GROUP_END:
+		card->erase_end = cmd->cmdarg;
+		break;
+	case MMC_CMD_ERASE:
+		ret = sandbox_emmc_erase(card, cmd->cmdarg);
+		break;
+	case MMC_CMD_SEND_TUNING_BLOCK_HS200:
+		if (card->ext_csd[EXT_CSD_HS_TIMING] != EXT_CSD_TIMING_HS200)
+			return -EIO;
+		ret = sandbox_emmc_check_bus(card, mmc, true);
+		if (ret)
+			return ret;
+		if (mmc->bus_width == 8) {
+			pattern = sandbox_emmc_tuning_8bit;
+			size = sizeof(sandbox_emmc_tuning_8bit);
+		} else {
+			pattern = sandbox_emmc_tuning_4bit;
+			size = sizeof(sandbox_emmc_tuning_4bit);
+		}
+		if (!data || data->blocks != 1 || data->blocksize != size)
+			return -EINVAL;
+		memcpy(data->dest, pattern, size);
+		sandbox_emmc_charge(card, sandbox_emmc_data_ns(mmc, data, 0));
+		card->tuned = true;
+		break;
+	default:
+		debug("%s: Unknown command %d\n", __func__, cmd->cmdidx);
+		return -ETIMEDOUT;
+	}
+	if (ret)
+		return ret;
+
+	if (cmd->resp_type == MMC_RSP_R1 || cmd->resp_type == MMC_RSP_R1b)
+		cmd->response[0] = card->status | MMC_STATUS_RDY_FOR_DATA |
+			card->state << 9;
+
+	return 0;
+}
+
+static int sandbox_mmc_do_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
+				   struct mmc_data *data)
+{
+	if (dev_get_driver_data(dev) == SANDBOX_MMC_EMMC)
+		return sandbox_emmc_send_cmd(dev, cmd, data);
+
+	return sandbox_mmc_send_cmd(dev, cmd, data);
+}
+
 static int sandbox_mmc_set_ios(struct udevice *dev)
 {
 	return 0;
@@ -95,23 +598,141 @@ static int sandbox_mmc_get_cd(struct udevice *dev)
 	return 1;
 }
 
+#ifdef MMC_SUPPORTS_TUNING
+static int sandbox_mmc_execute_tuning(struct udevice *dev, uint opcode)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
+	return mmc_send_tuning(&plat->mmc, opcode, NULL);
+}
+#endif
+
 static const struct dm_mmc_ops sandbox_mmc_ops = {
-	.send_cmd = sandbox_mmc_send_cmd,
+	.send_cmd = sandbox_mmc_do_send_cmd,
 	.set_ios = sandbox_mmc_set_ios,
 	.get_cd = sandbox_mmc_get_cd,
+#ifdef MMC_SUPPORTS_TUNING
+	.execute_tuning = sandbox_mmc_execute_tuning,
+#endif
 };
 
+void sandbox_mmc_set_host_caps(struct udevice *dev, uint host_caps)
+{
+	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+
+	plat->cfg.host_caps = host_caps;
+}
+
+uint sandbox_mmc_get_cmd_count(struct udevice *dev, uint cmdidx)
+{
+	struct sandbox_emmc *card = dev_get_priv(dev);
+
+	return card->cmd_count[cmdidx % ARRAY_SIZE(card->cmd_count)];
+}
+
+static int sandbox_emmc_probe(struct udevice *dev)
+{
+	struct sandbox_emmc *card = dev_get_priv(dev);
+	const char *fname;
+	u64 offset;
+	uint user_size, boot_mult, rpmb_mult;
+	int part;
+
+	fname = dev_read_string(dev, "sandbox,filename");
+	if (!fname)
+		return -EINVAL;
+	user_size = dev_read_u32_default(dev, "sandbox,size", 32 << 20);
+	boot_mult = dev_read_u32_default(dev, "sandbox,boot-mult", 1);
+	rpmb_mult = dev_read_u32_default(dev, "sandbox,rpmb-mult", 1);
+	if (!user_size || user_size % (EMMC_ERASE_GRP_BLKS * MMC_MAX_BLOCK_LEN) ||
+	    boot_mult > 0xff || rpmb_mult > 0xff)
+		return -EINVAL;
+
+	card->part_size[EMMC_PART_USER] = user_size;
+	card->part_size[EMMC_PART_BOOT1] = boot_mult << 17;
+	card->part_size[EMMC_PART_BOOT2] = boot_mult << 17;
+	card->part_size[EMMC_PART_RPMB] = rpmb_mult << 17;
+	for (part = 0, offset = 0; part < EMMC_PART_COUNT; part++) {
+		card->part_offset[part] = offset;
+		offset += card->part_size[part];
+	}
+
+	card->fd = os_open(fname, OS_O_RDWR | OS_O_CREAT);
+	if (card->fd < 0) {
+		printf("%s: Cannot open '%s'\n", __func__, fname);
+		return -EIO;
+	}
+	/* Extend the file if needed, so that unwritten blocks read as zero */
+	if (os_lseek(card->fd, 0, OS_SEEK_END) < offset &&
+	    (os_lseek(card->fd, offset - 1, OS_SEEK_SET) < 0 ||
+	     os_write(card->fd, "", 1) != 1)) {
+		os_close(card->fd);
+		return -EIO;
+	}
+
+	card->read_latency_us = dev_read_u32_default(dev,
+					"sandbox,read-latency-us", 50);
+	card->write_latency_us = dev_read_u32_default(dev,
+					"sandbox,write-latency-us", 200);
+	card->erase_us = dev_read_u32_default(dev, "sandbox,erase-time-us",
+					      1000);
+	card->switch_us = dev_read_u32_default(dev, "sandbox,switch-time-us",
+					       100);
+	card->power_up_us = dev_read_u32_default(dev, "sandbox,power-up-us", 0);
+	card->read_rate = dev_read_u32_default(dev, "sandbox,read-rate",
+					       150000000);
+	card->write_rate = dev_read_u32_default(dev, "sandbox,write-rate",
+						40000000);
+
+	card->ext_csd[EXT_CSD_REV] = 8;		/* eMMC 5.1 */
+	card->ext_csd[EXT_CSD_CARD_TYPE] = EXT_CSD_CARD_TYPE_26 |
+		EXT_CSD_CARD_TYPE_52 | EXT_CSD_CARD_TYPE_DDR_1_8V |
+		EXT_CSD_CARD_TYPE_HS200_1_8V;
+	put_unaligned_le32(user_size / MMC_MAX_BLOCK_LEN,
+			   &card->ext_csd[EXT_CSD_SEC_CNT]);
+	card->ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE] = 1;
+	card->ext_csd[EXT_CSD_HC_WP_GRP_SIZE] = 1;
+	card->ext_csd[EXT_CSD_BOOT_MULT] = boot_mult;
+	card->ext_csd[EXT_CSD_RPMB_MULT] = rpmb_mult;
+	card->ext_csd[EXT_CSD_PARTITIONING_SUPPORT] = PART_SUPPORT;
+	card->ext_csd[EXT_CSD_PARTITION_SETTING] =
+		EXT_CSD_PARTITION_SETTING_COMPLETED;
+	card->ext_csd[EXT_CSD_GENERIC_CMD6_TIME] = 10;
+	card->ext_csd[EXT_CSD_PART_SWITCH_TIME] = 10;
+	sandbox_emmc_reset(card);
+
+	return 0;
+}
+
+static int sandbox_mmc_remove(struct udevice *dev)
+{
+	struct sandbox_emmc *card = dev_get_priv(dev);
+
+	if (dev_get_driver_data(dev) == SANDBOX_MMC_EMMC)
+		os_close(card->fd);
+
+	return 0;
+}
+
 int sandbox_mmc_probe(struct udevice *dev)
 {
 	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
+	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (dev_get_driver_data(dev) != SANDBOX_MMC_EMMC)
+		return mmc_init(&plat->mmc);
+
+	/* As with a real host, the card is initialised when it is first used */
+	upriv->mmc = &plat->mmc;
 
-	return mmc_init(&plat->mmc);
+	return sandbox_emmc_probe(dev);
 }
 
 int sandbox_mmc_bind(struct udevice *dev)
 {
 	struct sandbox_mmc_plat *plat = dev_get_platdata(dev);
 	struct mmc_config *cfg = &plat->cfg;
+	int ret;
 
 	cfg->name = dev->name;
 	cfg->host_caps = MMC_MODE_HS_52MHz | MMC_MODE_HS | MMC_MODE_8BIT;
@@ -120,6 +741,20 @@ int sandbox_mmc_bind(struct udevice *dev)
 	cfg->f_max = 52000000;
 	cfg->b_max = U32_MAX;
 
+	if (dev_get_driver_data(dev) == SANDBOX_MMC_EMMC) {
+		/* The host is described by the usual properties */
+		cfg->host_caps = 0;
+		cfg->f_min = 400000;
+		ret = mmc_of_parse(dev, cfg);
+		if (ret)
+			return ret;
+		/* As with Linux, cap-mmc-highspeed covers both 26 and 52MHz */
+		if (cfg->host_caps & MMC_CAP(MMC_HS))
+			cfg->host_caps |= MMC_MODE_HS_52MHz;
+		cfg->b_max = dev_read_u32_default(dev, "sandbox,b-max",
+						  U32_MAX);
+	}
+
 	return mmc_bind(dev, &plat->mmc, cfg);
 }
 
@@ -131,7 +766,8 @@ int sandbox_mmc_unbind(struct udevice *dev)
 }
 
 static const struct udevice_id sandbox_mmc_ids[] = {
-	{ .compatible = "sandbox,mmc" },
+	{ .compatible = "sandbox,mmc", .data = SANDBOX_MMC_SD },
+	{ .compatible = "sandbox,emmc", .data = SANDBOX_MMC_EMMC },
 	{ }
 };
 
@@ -143,5 +779,7 @@ U_BOOT_DRIVER(mmc_sandbox) = {
 	.bind		= sandbox_mmc_bind,
 	.unbind		= sandbox_mmc_unbind,
 	.probe		= sandbox_mmc_probe,
+	.remove		= sandbox_mmc_remove,
+	.priv_auto_alloc_size = sizeof(struct sandbox_emmc),
 	.platdata_auto_alloc_size = sizeof(struct sandbox_mmc_plat),
 };
@@ -11,17 +11,22 @@
 #define LOG_CATEGORY UCLASS_SPI_FLASH
 
 #include <common.h>
+#include <div64.h>
 #include <dm.h>
 #include <malloc.h>
 #include <spi.h>
+#include <spi-mem.h>
 #include <os.h>
 
 #include <spi_flash.h>
+#include <linux/log2.h>
 #include "sf_internal.h"
 
 #include <asm/getopt.h>
 #include <asm/spi.h>
 #include <asm/state.h>
+#include <asm/test.h>
+#include <asm/unaligned.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
@@ -41,6 +46,7 @@ enum sandbox_sf_state {
 	SF_READ_STATUS, /* read the flash's status register */
 	SF_READ_STATUS1, /* read the flash's status register upper 8 bits*/
 	SF_WRITE_STATUS, /* write the flash's status register */
+	SF_READ_SFDP, /* read the flash's SFDP tables */
 };
 
 #if CONFIG_IS_ENABLED(LOG)
@@ -48,7 +54,7 @@ static const char *sandbox_sf_state_name(enum sandbox_sf_state state)
 {
 	static const char * const states[] = {
 		"CMD", "ID", "ADDR", "READ", "WRITE", "ERASE", "READ_STATUS",
-		"READ_STATUS1", "WRITE_STATUS",
+		"READ_STATUS1", "WRITE_STATUS", "READ_SFDP",
 	};
 	return states[state];
 }
@@ -59,12 +65,47 @@ static const char *sandbox_sf_state_name(enum sandbox_sf_state state)
 #define STAT_WEL	(1 << 1)
 #define STAT_BP_SHIFT	2
 #define STAT_BP_MASK	(7 << STAT_BP_SHIFT)
+#define STAT_QE		(CR_QUAD_EN_SPAN << 8)
 
 /* Assume all SPI flashes have 3 byte addresses since they do atm */
 #define SF_ADDR_LEN	3
 
 #define IDCODE_LEN 3
 
+/* Layout of the SFDP area: header, one parameter header, then the BFPT */
+#define SFDP_BFPT_OFF	0x10
+#define SFDP_BFPT_LEN	9
+#define SFDP_SIZE	(SFDP_BFPT_OFF + SFDP_BFPT_LEN * 4)
+
+/*
+ * Read commands understood by the emulation. The address and any dummy
+ * cycles go over @addr_width lines and the data over @data_width lines. With
+ * @dtr, address and data are clocked on both edges. @flags gives the
+ * flash_info flags a chip needs before it accepts the command.
+ */
+struct sandbox_sf_read_cmd {
+	u8 opcode;
+	u8 addr_width;
+	u8 data_width;
+	u8 dummy;
+	bool dtr;
+	int flags;
+};
+
+static const struct sandbox_sf_read_cmd sandbox_sf_read_cmds[] = {
+	{ SPINOR_OP_READ,		1, 1, 0, false, 0 },
+	{ SPINOR_OP_READ_FAST,		1, 1, 8, false, 0 },
+	{ SPINOR_OP_RDSFDP,		1, 1, 8, false, 0 },
+	{ SPINOR_OP_READ_1_1_2,		1, 2, 8, false, SPI_NOR_DUAL_READ },
+	{ SPINOR_OP_READ_1_2_2,		2, 2, 4, false, SPI_NOR_DUAL_READ },
+	{ SPINOR_OP_READ_1_1_4,		1, 4, 8, false, SPI_NOR_QUAD_READ },
+	{ SPINOR_OP_READ_1_4_4,		4, 4, 6, false, SPI_NOR_QUAD_READ },
+	{ SPINOR_OP_READ_1_1_1_DTR,	1, 1, 8, true,
+		SPI_NOR_DUAL_READ | SPI_NOR_QUAD_READ },
+	{ SPINOR_OP_READ_1_2_2_DTR,	2, 2, 4, true, SPI_NOR_DUAL_READ },
+	{ SPINOR_OP_READ_1_4_4_DTR,	4, 4, 6, true, SPI_NOR_QUAD_READ },
+};
+
 /* Used to quickly bulk erase backing store */
 static u8 sandbox_sf_0xff[0x1000];
 
@@ -89,12 +130,29 @@ struct sandbox_spi_flash {
 	uint off;
 	/* How many address bytes we've consumed */
 	uint addr_bytes, pad_addr_bytes;
+	/* Read command being processed, if any */
+	const struct sandbox_sf_read_cmd *read;
+	/* Bus clock, and clock cycles used by the current command */
+	uint max_hz;
+	ulong cycles;
 	/* The current flash status (see STAT_XXX defines above) */
 	u16 status;
 	/* Data describing the flash we're emulating */
 	const struct flash_info *data;
 	/* The file on disk to serv up data from */
 	int fd;
+	/* Memory-mapped view of the file, for the SPI controller's window */
+	void *map;
+	size_t map_size;
+	bool no_map;
+	/* Corrupt the data returned by DTR reads */
+	bool no_dtr;
+	/* Reject the Read SFDP command, like a flash without SFDP tables */
+	bool no_sfdp;
+	/* Number of erase commands carried out */
+	uint erase_count;
+	/* SFDP tables describing the flash */
+	u8 sfdp[SFDP_SIZE];
 };
 
 struct sandbox_spi_flash_plat_data {
@@ -112,6 +170,116 @@ void sandbox_sf_set_block_protect(struct udevice *dev, int bp_mask)
 	sbsf->status |= bp_mask << STAT_BP_SHIFT;
 }
 
+void sandbox_sf_set_map(struct udevice *dev, bool enable)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	sbsf->no_map = !enable;
+}
+
+void sandbox_sf_set_dtr(struct udevice *dev, bool enable)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	sbsf->no_dtr = !enable;
+}
+
+void sandbox_sf_set_sfdp(struct udevice *dev, bool enable)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	sbsf->no_sfdp = !enable;
+}
+
+uint sandbox_sf_get_erase_count(struct udevice *dev)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	return sbsf->erase_count;
+}
+
+static const struct sandbox_sf_read_cmd *
+sandbox_sf_find_read(struct sandbox_spi_flash *sbsf, u8 opcode)
+{
+	const struct sandbox_sf_read_cmd *read;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sandbox_sf_read_cmds); i++) {
+		read = &sandbox_sf_read_cmds[i];
+		if (read->opcode != opcode)
+			continue;
+		if (read->flags && !(sbsf->data->flags & read->flags))
+			return NULL;
+		if (opcode == SPINOR_OP_RDSFDP && sbsf->no_sfdp)
+			return NULL;
+
+		return read;
+	}
+
+	return NULL;
+}
+
+/* Get the BFPT half-word describing a Fast Read command, if supported */
+static u16 sandbox_sf_bfpt_read(struct sandbox_spi_flash *sbsf, u8 opcode)
+{
+	const struct sandbox_sf_read_cmd *read;
+
+	read = sandbox_sf_find_read(sbsf, opcode);
+	if (!read)
+		return 0;
+
+	return opcode << 8 | read->dummy;
+}
+
+/*
+ * Build a JESD216 SFDP area for the flash, advertising the read commands
+ * that the emulation supports
+ */
+static void sandbox_sf_build_sfdp(struct sandbox_spi_flash *sbsf)
+{
+	const struct flash_info *data = sbsf->data;
+	u64 size = (u64)data->sector_size * data->n_sectors;
+	u32 bfpt[SFDP_BFPT_LEN];
+	u8 *hdr = sbsf->sfdp;
+	int i;
+
+	memset(bfpt, '\0', sizeof(bfpt));
+	if (data->flags & SECT_4K)
+		bfpt[0] |= 0x1 | SPINOR_OP_BE_4K << 8;
+	else
+		bfpt[0] |= 0x3 | 0xff << 8;
+	if (data->flags & SPI_NOR_DUAL_READ)
+		bfpt[0] |= BIT(16) | BIT(20);
+	if (data->flags & SPI_NOR_QUAD_READ)
+		bfpt[0] |= BIT(21) | BIT(22);
+	if (data->flags & (SPI_NOR_DUAL_READ | SPI_NOR_QUAD_READ))
+		bfpt[0] |= BIT(19);	/* DTR clocking */
+	bfpt[1] = size * 8 - 1;
+	bfpt[2] = sandbox_sf_bfpt_read(sbsf, SPINOR_OP_READ_1_4_4) |
+		sandbox_sf_bfpt_read(sbsf, SPINOR_OP_READ_1_1_4) << 16;
+	bfpt[3] = sandbox_sf_bfpt_read(sbsf, SPINOR_OP_READ_1_1_2) |
+		sandbox_sf_bfpt_read(sbsf, SPINOR_OP_READ_1_2_2) << 16;
+	if (data->flags & SECT_4K)
+		bfpt[7] = SPINOR_OP_BE_4K << 8 | 12;
+	bfpt[7] |= (SPINOR_OP_SE << 8 | ilog2(data->sector_size)) << 16;
+
+	memcpy(hdr, "SFDP", 4);
+	hdr[4] = 0;		/* minor */
+	hdr[5] = 1;		/* major */
+	hdr[6] = 0;		/* number of parameter headers - 1 */
+	hdr[7] = 0xff;
+	hdr[8] = 0x00;		/* BFPT ID, LSB */
+	hdr[9] = 0;		/* minor */
+	hdr[10] = 1;		/* major */
+	hdr[11] = SFDP_BFPT_LEN;
+	hdr[12] = SFDP_BFPT_OFF;
+	hdr[13] = 0;
+	hdr[14] = 0;
+	hdr[15] = 0xff;		/* BFPT ID, MSB */
+	for (i = 0; i < SFDP_BFPT_LEN; i++)
+		put_unaligned_le32(bfpt[i], hdr + SFDP_BFPT_OFF + i * 4);
+}
+
 /**
  * This is a very strange probe function. If it has platform data (which may
  * have come from the device tree) then this function gets the filename and
@@ -182,6 +350,8 @@ static int sandbox_sf_probe(struct udevice *dev)
 
 	sbsf->data = data;
 	sbsf->cs = cs;
+	sbsf->max_hz = slave_plat->max_hz;
+	sandbox_sf_build_sfdp(sbsf);
 
 	return 0;
 
@@ -194,6 +364,8 @@ static int sandbox_sf_remove(struct udevice *dev)
 {
 	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
 
+	if (sbsf->map)
+		os_unmap(sbsf->map, sbsf->map_size);
 	os_close(sbsf->fd);
 
 	return 0;
@@ -209,13 +381,24 @@ static void sandbox_sf_cs_activate(struct udevice *dev)
 	sbsf->off = 0;
 	sbsf->addr_bytes = 0;
 	sbsf->pad_addr_bytes = 0;
+	sbsf->read = NULL;
+	sbsf->cycles = 0;
 	sbsf->state = SF_CMD;
 	sbsf->cmd = SF_CMD;
 }
 
 static void sandbox_sf_cs_deactivate(struct udevice *dev)
 {
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
 	log_content("sandbox_sf: CS deactivated; cmd done processing!\n");
+
+	/* Account for the time the command would have taken on the bus */
+	if (sbsf->max_hz) {
+		sandbox_timer_add_offset_us(lldiv((u64)sbsf->cycles * 1000000,
+						  sbsf->max_hz));
+	}
+	sbsf->cycles = 0;
 }
 
 /*
@@ -242,17 +425,28 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 		sandbox_spi_tristate(tx, 1);
 
 	sbsf->cmd = rx[0];
+	sbsf->cycles += 8;
+	sbsf->read = sandbox_sf_find_read(sbsf, sbsf->cmd);
+	if (sbsf->read) {
+		sbsf->pad_addr_bytes = sbsf->read->dummy *
+			sbsf->read->addr_width / 8;
+		sbsf->state = SF_ADDR;
+		goto out;
+	}
+
 	switch (sbsf->cmd) {
 	case SPINOR_OP_RDID:
 		sbsf->state = SF_ID;
 		sbsf->cmd = SF_ID;
 		break;
-	case SPINOR_OP_READ_FAST:
-		sbsf->pad_addr_bytes = 1;
-	case SPINOR_OP_READ:
 	case SPINOR_OP_PP:
 		sbsf->state = SF_ADDR;
 		break;
+	case SPINOR_OP_PP_1_1_4:
+		if (!(sbsf->data->flags & SPI_NOR_QUAD_READ))
+			return -EIO;
+		sbsf->state = SF_ADDR;
+		break;
 	case SPINOR_OP_WRDI:
 		debug(" write disabled\n");
 		sbsf->status &= ~STAT_WEL;
@@ -261,6 +455,7 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 		sbsf->state = SF_READ_STATUS;
 		break;
 	case SPINOR_OP_RDSR2:
+	case SPINOR_OP_RDCR:
 		sbsf->state = SF_READ_STATUS1;
 		break;
 	case SPINOR_OP_WREN:
@@ -279,7 +474,7 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 				sbsf->data->n_sectors;
 		} else if (sbsf->cmd == SPINOR_OP_BE_4K && (flags & SECT_4K)) {
 			sbsf->erase_size = 4 << 10;
-		} else if (sbsf->cmd == SPINOR_OP_SE && !(flags & SECT_4K)) {
+		} else if (sbsf->cmd == SPINOR_OP_SE) {
 			sbsf->erase_size = 64 << 10;
 		} else {
 			debug(" cmd unknown: %#x\n", sbsf->cmd);
@@ -290,6 +485,7 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 	}
 	}
 
+out:
 	if (oldstate != sbsf->state)
 		log_content(" cmd: transition to %s state\n",
 			    sandbox_sf_state_name(sbsf->state));
@@ -364,6 +560,13 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			if (sbsf->addr_bytes++ < SF_ADDR_LEN)
 				sbsf->off = (sbsf->off << 8) | rx[pos];
 			log_content("addr:%06x\n", sbsf->off);
+			if (!sbsf->read)
+				sbsf->cycles += 8;
+			else if (sbsf->addr_bytes <= SF_ADDR_LEN &&
+				 sbsf->read->dtr)
+				sbsf->cycles += 4 / sbsf->read->addr_width;
+			else
+				sbsf->cycles += 8 / sbsf->read->addr_width;
 
 			if (tx)
 				sandbox_spi_tristate(&tx[pos], 1);
@@ -375,16 +578,21 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 				break;
 
 			/* Next state! */
+			if (sbsf->cmd == SPINOR_OP_RDSFDP) {
+				sbsf->state = SF_READ_SFDP;
+				break;
+			}
 			if (os_lseek(sbsf->fd, sbsf->off, OS_SEEK_SET) < 0) {
 				puts("sandbox_sf: os_lseek() failed");
 				return -EIO;
 			}
-			switch (sbsf->cmd) {
-			case SPINOR_OP_READ_FAST:
-			case SPINOR_OP_READ:
+			if (sbsf->read) {
 				sbsf->state = SF_READ;
 				break;
+			}
+			switch (sbsf->cmd) {
 			case SPINOR_OP_PP:
+			case SPINOR_OP_PP_1_1_4:
 				sbsf->state = SF_WRITE;
 				break;
 			default:
@@ -404,13 +612,37 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			cnt = bytes - pos;
 			log_content(" tx: read(%u)\n", cnt);
 			assert(tx);
+			sbsf->cycles += cnt * 8 / sbsf->read->data_width /
+				(sbsf->read->dtr ? 2 : 1);
+			/* IO2 and IO3 are WP# and HOLD# until QE is set */
+			if (sbsf->read->data_width == 4 &&
+			    !(sbsf->status & STAT_QE)) {
+				sandbox_spi_tristate(tx + pos, cnt);
+				pos += cnt;
+				break;
+			}
 			ret = os_read(sbsf->fd, tx + pos, cnt);
 			if (ret < 0) {
 				puts("sandbox_sf: os_read() failed\n");
 				return -EIO;
 			}
+			if (sbsf->read->dtr && sbsf->no_dtr) {
+				for (cnt = 0; cnt < ret; cnt++)
+					tx[pos + cnt] ^= cnt;
+			}
 			pos += ret;
 			break;
+		case SF_READ_SFDP:
+			cnt = bytes - pos;
+			log_content(" tx: read sfdp(%u)\n", cnt);
+			sbsf->cycles += cnt * 8;
+			sandbox_spi_tristate(tx + pos, cnt);
+			if (sbsf->off < SFDP_SIZE)
+				memcpy(tx + pos, sbsf->sfdp + sbsf->off,
+				       min_t(uint, cnt, SFDP_SIZE - sbsf->off));
+			sbsf->off += cnt;
+			pos += cnt;
+			break;
 		case SF_READ_STATUS:
 			log_content(" read status: %#x\n", sbsf->status);
 			cnt = bytes - pos;
@@ -424,8 +656,16 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			pos += cnt;
 			break;
 		case SF_WRITE_STATUS:
-			log_content(" write status: %#x (ignored)\n", rx[pos]);
-			pos = bytes;
+			/* Only the configuration register (2nd byte) is kept */
+			if (sbsf->off++ == 1) {
+				log_content(" write config: %#x\n", rx[pos]);
+				sbsf->status &= 0xff;
+				sbsf->status |= rx[pos] << 8;
+			} else {
+				log_content(" write status: %#x (ignored)\n",
+					    rx[pos]);
+			}
+			pos++;
 			break;
 		case SF_WRITE:
 			/*
@@ -485,6 +725,7 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 				log_content("sandbox_sf: Erase failed\n");
 				goto done;
 			}
+			sbsf->erase_count++;
 			goto done;
 		}
 		default:
@@ -499,6 +740,62 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 	return pos == bytes ? 0 : -EIO;
 }
 
+static int sandbox_sf_map(struct udevice *dev, const struct spi_mem_op *op,
+			  void **mapp, size_t *sizep)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+	size_t flash_size = sbsf->data->sector_size * sbsf->data->n_sectors;
+	const struct sandbox_sf_read_cmd *read;
+	loff_t file_size;
+	u64 cycles;
+	int ret;
+
+	if (sbsf->no_map)
+		return -ENOTSUPP;
+	read = sandbox_sf_find_read(sbsf, op->cmd.opcode);
+	if (!read || op->cmd.opcode == SPINOR_OP_RDSFDP)
+		return -ENOTSUPP;
+
+	/*
+	 * The read is a memcpy() from the window, so account for the time it
+	 * would have taken on the bus here, as sandbox_sf_xfer() does
+	 */
+	if (sbsf->max_hz) {
+		cycles = 8 + op->addr.nbytes * 8 / read->addr_width /
+			(read->dtr ? 2 : 1) + read->dummy;
+		cycles += (u64)op->data.nbytes * 8 / read->data_width /
+			(read->dtr ? 2 : 1);
+		sandbox_timer_add_offset_us(lldiv(cycles * 1000000,
+						  sbsf->max_hz));
+	}
+
+	/* Reads which would return garbage on the bus fail instead */
+	if ((read->data_width == 4 && !(sbsf->status & STAT_QE)) ||
+	    (read->dtr && sbsf->no_dtr))
+		return -EIO;
+
+	/* The backing file may have been replaced, so check it every time */
+	file_size = os_lseek(sbsf->fd, 0, OS_SEEK_END);
+	if (file_size < 0)
+		return -EIO;
+	if (sbsf->map && file_size != sbsf->map_size) {
+		os_unmap(sbsf->map, sbsf->map_size);
+		sbsf->map = NULL;
+	}
+	if (!sbsf->map) {
+		ret = os_map_file(sbsf->fd, &sbsf->map, &sbsf->map_size);
+		if (ret) {
+			sbsf->map = NULL;
+			return -ENOTSUPP;
+		}
+	}
+
+	*mapp = sbsf->map;
+	*sizep = min(sbsf->map_size, flash_size);
+
+	return 0;
+}
+
 int sandbox_sf_ofdata_to_platdata(struct udevice *dev)
 {
 	struct sandbox_spi_flash_plat_data *pdata = dev_get_platdata(dev);
@@ -516,6 +813,7 @@ int sandbox_sf_ofdata_to_platdata(struct udevice *dev)
 
 static const struct dm_spi_emul_ops sandbox_sf_emul_ops = {
 	.xfer          = sandbox_sf_xfer,
+	.map           = sandbox_sf_map,
 };
 
 #ifdef CONFIG_SPI_FLASH
@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <malloc.h>
 #include <linux/err.h>
 #include <linux/errno.h>
 #include <linux/log2.h>
@@ -23,6 +24,8 @@
 
 #include "sf_internal.h"
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /* Define max times to check status register before we give up. */
 
 /*
@@ -98,6 +101,15 @@ static ssize_t spi_nor_read_data(struct spi_nor *nor, loff_t from, size_t len,
 	/* convert the dummy cycles to the number of bytes */
 	op.dummy.nbytes = (nor->read_dummy * op.dummy.buswidth) / 8;
 
+	/* Copy straight out of the controller's memory window if it has one */
+	if (len <= UINT_MAX) {
+		ret = spi_mem_mmap_read(nor->spi, &op);
+		if (!ret)
+			return len;
+		if (ret != -ENOTSUPP)
+			return ret;
+	}
+
 	while (remaining) {
 		op.data.nbytes = remaining < UINT_MAX ? remaining : UINT_MAX;
 		ret = spi_mem_adjust_op_size(nor->spi, &op);
@@ -337,6 +349,7 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 		/* No small sector erase for 4-byte command set */
 		nor->erase_opcode = SPINOR_OP_SE;
 		nor->mtd.erasesize = info->sector_size;
+		nor->block_erase_opcode = 0;
 		break;
 
 	default:
@@ -346,6 +359,8 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 	nor->read_opcode = spi_nor_convert_3to4_read(nor->read_opcode);
 	nor->program_opcode = spi_nor_convert_3to4_program(nor->program_opcode);
 	nor->erase_opcode = spi_nor_convert_3to4_erase(nor->erase_opcode);
+	nor->block_erase_opcode =
+		spi_nor_convert_3to4_erase(nor->block_erase_opcode);
 }
 #endif /* !CONFIG_SPI_FLASH_BAR */
 
@@ -558,7 +573,7 @@ static int read_bar(struct spi_nor *nor, const struct flash_info *info)
 /*
  * Initiate the erasure of a single sector
  */
-static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
+static int spi_nor_erase_sector(struct spi_nor *nor, u8 opcode, u32 addr)
 {
 	u8 buf[SPI_NOR_MAX_ADDR_WIDTH];
 	int i;
@@ -575,7 +590,7 @@ static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
 		addr >>= 8;
 	}
 
-	return nor->write_reg(nor, nor->erase_opcode, buf, nor->addr_width);
+	return nor->write_reg(nor, opcode, buf, nor->addr_width);
 }
 
 /*
@@ -585,7 +600,8 @@ static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
 static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 {
 	struct spi_nor *nor = mtd_to_spi_nor(mtd);
-	u32 addr, len, rem;
+	u32 addr, len, rem, size;
+	u8 opcode;
 	int ret;
 
 	dev_dbg(nor->dev, "at 0x%llx, len %lld\n", (long long)instr->addr,
@@ -609,12 +625,22 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 #endif
 		write_enable(nor);
 
-		ret = spi_nor_erase_sector(nor, addr);
+		/* Erase whole blocks at once where the range allows it */
+		opcode = nor->erase_opcode;
+		size = mtd->erasesize;
+		if (nor->block_erase_opcode && !nor->erase &&
+		    !(addr % nor->block_erase_size) &&
+		    len >= nor->block_erase_size) {
+			opcode = nor->block_erase_opcode;
+			size = nor->block_erase_size;
+		}
+
+		ret = spi_nor_erase_sector(nor, opcode, addr);
 		if (ret)
 			goto erase_err;
 
-		addr += mtd->erasesize;
-		len -= mtd->erasesize;
+		addr += size;
+		len -= size;
 
 		ret = spi_nor_wait_till_ready(nor);
 		if (ret)
@@ -1659,6 +1685,33 @@ static const struct sfdp_bfpt_read sfdp_bfpt_reads[] = {
 	},
 };
 
+#ifdef CONFIG_SPI_FLASH_READ_BENCHMARK
+/*
+ * JESD216 only tells whether DTR clocking is supported, not which commands
+ * use it. Assume the usual op codes, with the dummy cycles of the matching
+ * STR command; the read benchmark checks each mode before it is used.
+ */
+static const struct sfdp_dtr_read {
+	u32			str_hwcaps;
+	u32			hwcaps;
+	u8			opcode;
+	enum spi_nor_protocol	proto;
+} sfdp_dtr_reads[] = {
+	{
+		SNOR_HWCAPS_READ_FAST, SNOR_HWCAPS_READ_1_1_1_DTR,
+		SPINOR_OP_READ_1_1_1_DTR, SNOR_PROTO_1_1_1_DTR,
+	},
+	{
+		SNOR_HWCAPS_READ_1_2_2, SNOR_HWCAPS_READ_1_2_2_DTR,
+		SPINOR_OP_READ_1_2_2_DTR, SNOR_PROTO_1_2_2_DTR,
+	},
+	{
+		SNOR_HWCAPS_READ_1_4_4, SNOR_HWCAPS_READ_1_4_4_DTR,
+		SPINOR_OP_READ_1_4_4_DTR, SNOR_PROTO_1_4_4_DTR,
+	},
+};
+#endif
+
 struct sfdp_bfpt_erase {
 	/*
 	 * The half-word at offset <shift> in DWORD <dwoard> encodes the
@@ -1792,6 +1845,26 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 		spi_nor_set_read_settings_from_bfpt(read, half, rd->proto);
 	}
 
+#ifdef CONFIG_SPI_FLASH_READ_BENCHMARK
+	/* DTR variants of the Fast Read commands. */
+	for (i = 0; i < ARRAY_SIZE(sfdp_dtr_reads); i++) {
+		const struct sfdp_dtr_read *rd = &sfdp_dtr_reads[i];
+		const struct spi_nor_read_command *str;
+
+		if (!(bfpt.dwords[BFPT_DWORD(1)] & BFPT_DWORD1_DTR) ||
+		    !(params->hwcaps.mask & rd->str_hwcaps))
+			continue;
+
+		str = &params->reads[spi_nor_hwcaps_read2cmd(rd->str_hwcaps)];
+		params->hwcaps.mask |= rd->hwcaps;
+		cmd = spi_nor_hwcaps_read2cmd(rd->hwcaps);
+		spi_nor_set_read_settings(&params->reads[cmd],
+					  str->num_mode_clocks,
+					  str->num_wait_states,
+					  rd->opcode, rd->proto);
+	}
+#endif
+
 	/* Sector Erase settings. */
 	for (i = 0; i < ARRAY_SIZE(sfdp_bfpt_erases); i++) {
 		const struct sfdp_bfpt_erase *er = &sfdp_bfpt_erases[i];
@@ -1820,6 +1893,24 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 		}
 	}
 
+	/* Keep the largest Erase Type for erasing runs of sectors at once. */
+	nor->block_erase_opcode = 0;
+	nor->block_erase_size = 0;
+	for (i = 0; i < ARRAY_SIZE(sfdp_bfpt_erases); i++) {
+		const struct sfdp_bfpt_erase *er = &sfdp_bfpt_erases[i];
+		u32 erasesize;
+
+		half = bfpt.dwords[er->dword] >> er->shift;
+		if (!(half & 0xff))
+			continue;
+
+		erasesize = 1U << (half & 0xff);
+		if (erasesize > max(mtd->erasesize, nor->block_erase_size)) {
+			nor->block_erase_opcode = (half >> 8) & 0xff;
+			nor->block_erase_size = erasesize;
+		}
+	}
+
 	/* Stop here if not JESD216 rev A or later. */
 	if (bfpt_header->length < BFPT_DWORD_MAX)
 		return 0;
@@ -2260,6 +2351,14 @@ static int spi_nor_select_erase(struct spi_nor *nor,
 		nor->erase_opcode = SPINOR_OP_SE;
 		mtd->erasesize = info->sector_size;
 	}
+
+	/* Still erase whole sectors when a range covers them */
+	nor->block_erase_opcode = 0;
+	nor->block_erase_size = 0;
+	if (mtd->erasesize < info->sector_size) {
+		nor->block_erase_opcode = SPINOR_OP_SE;
+		nor->block_erase_size = info->sector_size;
+	}
 	return 0;
 }
 
@@ -2377,6 +2476,151 @@ static int spi_nor_init(struct spi_nor *nor)
 	return 0;
 }
 
+#ifdef CONFIG_SPI_FLASH_READ_BENCHMARK
+/* Fast Read modes tried by the read benchmark, slowest first */
+static const struct spi_nor_read_mode {
+	u32		hwcaps;
+	const char	*name;
+} spi_nor_read_modes[] = {
+	{ SNOR_HWCAPS_READ_FAST,	"1-1-1" },
+	{ SNOR_HWCAPS_READ_1_1_1_DTR,	"1-1-1-dtr" },
+	{ SNOR_HWCAPS_READ_1_1_2,	"1-1-2" },
+	{ SNOR_HWCAPS_READ_1_2_2,	"1-2-2" },
+	{ SNOR_HWCAPS_READ_1_2_2_DTR,	"1-2-2-dtr" },
+	{ SNOR_HWCAPS_READ_1_1_4,	"1-1-4" },
+	{ SNOR_HWCAPS_READ_1_4_4,	"1-4-4" },
+	{ SNOR_HWCAPS_READ_1_4_4_DTR,	"1-4-4-dtr" },
+	{ SNOR_HWCAPS_READ_1_1_8,	"1-1-8" },
+	{ SNOR_HWCAPS_READ_1_8_8,	"1-8-8" },
+	{ SNOR_HWCAPS_READ_1_8_8_DTR,	"1-8-8-dtr" },
+};
+
+/* Switch to a read mode, setting the Quad Enable bit first if needed */
+static int spi_nor_use_read_mode(struct spi_nor *nor,
+				 const struct spi_nor_flash_parameter *params,
+				 const struct spi_nor_read_mode *mode)
+{
+	const struct spi_nor_read_command *read;
+	int ret;
+
+	if (!(params->hwcaps.mask & mode->hwcaps))
+		return -ENOTSUPP;
+	read = &params->reads[spi_nor_hwcaps_read2cmd(mode->hwcaps)];
+
+	if (spi_nor_get_protocol_width(read->proto) == 4 &&
+	    !nor->quad_enable && params->quad_enable) {
+		ret = params->quad_enable(nor);
+		if (ret)
+			return ret;
+		nor->quad_enable = params->quad_enable;
+	}
+
+	nor->read_opcode = read->opcode;
+	nor->read_proto = read->proto;
+	nor->read_dummy = read->num_mode_clocks + read->num_wait_states;
+	if (nor->flags & SNOR_F_4B_OPCODES)
+		nor->read_opcode = spi_nor_convert_3to4_read(nor->read_opcode);
+
+	return 0;
+}
+
+/**
+ * spi_nor_bench_read() - select the fastest working Fast Read mode
+ * @nor:	pointer to a 'struct spi_nor', set up with the default mode
+ * @params:	flash parameters, with all the read modes of the flash
+ *
+ * The mode chosen from the capability masks is used to take a reference
+ * copy of the start of the flash. Each other mode supported by the flash is
+ * then timed reading the same data, and the fastest one that reads it back
+ * correctly is kept. Modes the controller cannot do simply fail the read.
+ *
+ * The choice is cached in the environment, along with the flash name, and
+ * reused without benchmarking while the flash stays the same.
+ */
+static void spi_nor_bench_read(struct spi_nor *nor,
+			       const struct spi_nor_flash_parameter *params)
+{
+	size_t len = min_t(u64, CONFIG_SPI_FLASH_READ_BENCHMARK_SIZE,
+			   nor->mtd.size);
+	const struct spi_nor_read_mode *mode, *best = NULL;
+	enum spi_nor_protocol read_proto = nor->read_proto;
+	u8 read_opcode = nor->read_opcode;
+	u8 read_dummy = nor->read_dummy;
+	size_t name_len = strlen(nor->info->name);
+	ulong start, us, best_us = ULONG_MAX;
+	char var[32], val[40];
+	const char *cached;
+	u8 *ref, *buf;
+	ssize_t ret;
+	int i, run;
+
+	snprintf(var, sizeof(var), "sf_read_mode_%d_%d",
+		 nor->spi->dev->parent->seq, spi_chip_select(nor->spi->dev));
+	cached = gd->flags & GD_FLG_ENV_READY ? env_get(var) : NULL;
+	if (cached && !strncmp(cached, nor->info->name, name_len) &&
+	    cached[name_len] == ':') {
+		for (i = 0; i < ARRAY_SIZE(spi_nor_read_modes); i++) {
+			mode = &spi_nor_read_modes[i];
+			if (strcmp(cached + name_len + 1, mode->name))
+				continue;
+			if (!spi_nor_use_read_mode(nor, params, mode))
+				return;
+			break;
+		}
+	}
+
+	ref = malloc(len);
+	buf = malloc(len);
+	if (!ref || !buf)
+		goto out;
+	ret = nor->read(nor, 0, len, ref);
+	if (ret != len)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(spi_nor_read_modes); i++) {
+		mode = &spi_nor_read_modes[i];
+		if (spi_nor_use_read_mode(nor, params, mode))
+			continue;
+
+		/* Keep the best of two runs to filter out one-off delays */
+		us = ULONG_MAX;
+		for (run = 0; run < 2; run++) {
+			memset(buf, ~ref[0], len);
+			start = timer_get_us();
+			ret = nor->read(nor, 0, len, buf);
+			us = min(us, timer_get_us() - start);
+			if (ret != len || memcmp(ref, buf, len))
+				break;
+		}
+		if (run < 2) {
+			dev_dbg(nor->dev, "read mode %s failed\n", mode->name);
+			continue;
+		}
+		debug("SF: %s read %zu bytes in %lu us\n", mode->name, len, us);
+
+		/* On a tie, prefer the mode using more lines */
+		if (us <= best_us) {
+			best_us = us;
+			best = mode;
+		}
+	}
+
+out:
+	free(buf);
+	free(ref);
+
+	nor->read_opcode = read_opcode;
+	nor->read_proto = read_proto;
+	nor->read_dummy = read_dummy;
+	if (!best || spi_nor_use_read_mode(nor, params, best))
+		return;
+
+	snprintf(val, sizeof(val), "%s:%s", nor->info->name, best->name);
+	if (gd->flags & GD_FLG_ENV_READY)
+		env_set(var, val);
+}
+#endif /* CONFIG_SPI_FLASH_READ_BENCHMARK */
+
 int spi_nor_scan(struct spi_nor *nor)
 {
 	struct spi_nor_flash_parameter params;
@@ -2497,8 +2741,10 @@ int spi_nor_scan(struct spi_nor *nor)
 		/* enable 4-byte addressing if the device exceeds 16MiB */
 		nor->addr_width = 4;
 		if (JEDEC_MFR(info) == SNOR_MFR_SPANSION ||
-		    info->flags & SPI_NOR_4B_OPCODES)
+		    info->flags & SPI_NOR_4B_OPCODES) {
+			nor->flags |= SNOR_F_4B_OPCODES;
 			spi_nor_set_4byte_opcodes(nor, info);
+		}
 #else
 	/* Configure the BAR - discover bank cmds and read current bank */
 	nor->addr_width = 3;
@@ -2522,6 +2768,11 @@ int spi_nor_scan(struct spi_nor *nor)
 	if (ret)
 		return ret;
 
+#ifdef CONFIG_SPI_FLASH_READ_BENCHMARK
+	if (!(info->flags & SPI_NOR_OPI_DTR))
+		spi_nor_bench_read(nor, &params);
+#endif
+
 	nor->name = mtd->name;
 	nor->size = mtd->size;
 	nor->erase_size = mtd->erasesize;
@@ -90,6 +90,15 @@ static ssize_t spi_nor_read_data(struct spi_nor *nor, loff_t from, size_t len,
 	/* convert the dummy cycles to the number of bytes */
 	op.dummy.nbytes = (nor->read_dummy * op.dummy.buswidth) / 8;
 
+	/* Copy straight out of the controller's memory window if it has one */
+	if (len <= UINT_MAX) {
+		ret = spi_mem_mmap_read(nor->spi, &op);
+		if (!ret)
+			return len;
+		if (ret != -ENOTSUPP)
+			return ret;
+	}
+
 	while (remaining) {
 		op.data.nbytes = remaining < UINT_MAX ? remaining : UINT_MAX;
 		ret = spi_mem_adjust_op_size(nor->spi, &op);
@@ -14,6 +14,7 @@
 #include <dm.h>
 #include <malloc.h>
 #include <spi.h>
+#include <spi-mem.h>
 #include <spi_flash.h>
 #include <os.h>
 
@@ -102,6 +103,30 @@ static int sandbox_spi_xfer(struct udevice *slave, unsigned int bitlen,
 	return ret;
 }
 
+static int sandbox_spi_mmap(struct spi_slave *slave,
+			    const struct spi_mem_op *op, void **mapp,
+			    size_t *sizep)
+{
+	struct udevice *bus = slave->dev->parent;
+	struct dm_spi_emul_ops *ops;
+	struct udevice *emul;
+	int ret;
+
+	ret = sandbox_spi_get_emul(state_get_current(), bus, slave->dev,
+				   &emul);
+	if (ret)
+		return -ENOTSUPP;
+	ret = device_probe(emul);
+	if (ret)
+		return ret;
+
+	ops = spi_emul_get_ops(emul);
+	if (!ops->map)
+		return -ENOTSUPP;
+
+	return ops->map(emul, op, mapp, sizep);
+}
+
 static int sandbox_spi_set_speed(struct udevice *bus, uint speed)
 {
 	return 0;
@@ -122,8 +147,13 @@ static int sandbox_cs_info(struct udevice *bus, uint cs,
 	return 0;
 }
 
+static const struct spi_controller_mem_ops sandbox_spi_mem_ops = {
+	.mmap		= sandbox_spi_mmap,
+};
+
 static const struct dm_spi_ops sandbox_spi_ops = {
 	.xfer		= sandbox_spi_xfer,
+	.mem_ops	= &sandbox_spi_mem_ops,
 	.set_speed	= sandbox_spi_set_speed,
 	.set_mode	= sandbox_spi_set_mode,
 	.cs_info	= sandbox_cs_info,
@@ -82,6 +82,11 @@ int spi_mem_exec_op(struct spi_slave *slave,
 	return 0;
 }
 
+int spi_mem_mmap_read(struct spi_slave *slave, const struct spi_mem_op *op)
+{
+	return -ENOTSUPP;
+}
+
 int spi_mem_adjust_op_size(struct spi_slave *slave,
 			   struct spi_mem_op *op)
 {
@@ -220,7 +220,7 @@ int spi_mem_exec_op(struct spi_slave *slave, const struct spi_mem_op *op)
 	if (ret < 0)
 		return ret;
 
-	if (ops->mem_ops) {
+	if (ops->mem_ops && ops->mem_ops->exec_op) {
 #ifndef __UBOOT__
 		/*
 		 * Flush the message queue before executing our SPI memory
@@ -398,6 +398,54 @@ int spi_mem_exec_op(struct spi_slave *slave, const struct spi_mem_op *op)
 }
 EXPORT_SYMBOL_GPL(spi_mem_exec_op);
 
+/**
+ * spi_mem_mmap_read() - Execute a read operation through a memory-mapped
+ *			 window
+ * @slave: the SPI device
+ * @op: the read operation to execute
+ *
+ * Controllers that expose the SPI memory in the CPU address space (e.g. TI
+ * QSPI) can serve a read of any length with a single memcpy() from that
+ * window, which is much faster than going through exec_op() in chunks.
+ *
+ * Return: 0 in case of success, -ENOTSUPP if the controller has no window for
+ *	   @op or the requested range does not fit in it (the caller should
+ *	   then use spi_mem_exec_op()), another negative error code otherwise.
+ */
+int spi_mem_mmap_read(struct spi_slave *slave, const struct spi_mem_op *op)
+{
+	struct udevice *bus = slave->dev->parent;
+	struct dm_spi_ops *ops = spi_get_ops(bus);
+	size_t size;
+	void *map;
+	int ret;
+
+	if (!ops->mem_ops || !ops->mem_ops->mmap ||
+	    op->data.dir != SPI_MEM_DATA_IN || !op->data.nbytes)
+		return -ENOTSUPP;
+
+	if (!spi_mem_supports_op(slave, op))
+		return -ENOTSUPP;
+
+	ret = spi_claim_bus(slave);
+	if (ret < 0)
+		return ret;
+
+	ret = ops->mem_ops->mmap(slave, op, &map, &size);
+	if (!ret) {
+		if (op->addr.val + op->data.nbytes > size)
+			ret = -ENOTSUPP;
+		else
+			memcpy(op->data.buf.in, map + op->addr.val,
+			       op->data.nbytes);
+	}
+
+	spi_release_bus(slave);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(spi_mem_mmap_read);
+
 /**
  * spi_mem_adjust_op_size() - Adjust the data size of a SPI mem operation to
  *				 match controller limitations
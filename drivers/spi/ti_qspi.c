@@ -315,22 +315,41 @@ static int ti_qspi_set_mode(struct udevice *bus, uint mode)
 	return 0;
 }
 
+/*
+ * Set up the memory-mapped window for a read op. This is used both by
+ * exec_op(), which copies from the window itself, and by ->mmap(), which
+ * hands the window to the SPI memory layer.
+ */
+static int ti_qspi_setup_mmap_op(struct spi_slave *slave,
+				 const struct spi_mem_op *op)
+{
+	struct dm_spi_slave_platdata *slave_plat;
+	struct ti_qspi_priv *priv;
+
+	priv = dev_get_priv(slave->dev->parent);
+	slave_plat = dev_get_parent_platdata(slave->dev);
+
+	if (!op->addr.nbytes || op->addr.nbytes > 4)
+		return -ENOTSUPP;
+
+	ti_qspi_setup_mmap_read(priv, slave_plat->cs, op->cmd.opcode,
+				op->data.buswidth, op->addr.nbytes,
+				op->dummy.nbytes);
+
+	return 0;
+}
+
 static int ti_qspi_exec_mem_op(struct spi_slave *slave,
 			       const struct spi_mem_op *op)
 {
-	struct dm_spi_slave_platdata *slave_plat;
 	struct ti_qspi_priv *priv;
-	struct udevice *bus;
 	u32 from = 0;
-	int ret = 0;
+	int ret;
 
-	bus = slave->dev->parent;
-	priv = dev_get_priv(bus);
-	slave_plat = dev_get_parent_platdata(slave->dev);
+	priv = dev_get_priv(slave->dev->parent);
 
 	/* Only optimize read path. */
-	if (!op->data.nbytes || op->data.dir != SPI_MEM_DATA_IN ||
-	    !op->addr.nbytes || op->addr.nbytes > 4)
+	if (!op->data.nbytes || op->data.dir != SPI_MEM_DATA_IN)
 		return -ENOTSUPP;
 
 	/* Address exceeds MMIO window size, fall back to regular mode. */
@@ -338,15 +357,32 @@ static int ti_qspi_exec_mem_op(struct spi_slave *slave,
 	if (from + op->data.nbytes > priv->mmap_size)
 		return -ENOTSUPP;
 
-	ti_qspi_setup_mmap_read(priv, slave_plat->cs, op->cmd.opcode,
-				op->data.buswidth, op->addr.nbytes,
-				op->dummy.nbytes);
+	ret = ti_qspi_setup_mmap_op(slave, op);
+	if (ret)
+		return ret;
 
 	ti_qspi_copy_mmap((void *)op->data.buf.in,
 			  (void *)priv->memory_map + from, op->data.nbytes);
 
-	return ret;
+	return 0;
+}
+
+#if !defined(CONFIG_TI_EDMA3) || defined(CONFIG_DMA)
+static int ti_qspi_mmap(struct spi_slave *slave, const struct spi_mem_op *op,
+			void **mapp, size_t *sizep)
+{
+	struct ti_qspi_priv *priv = dev_get_priv(slave->dev->parent);
+	int ret;
+
+	ret = ti_qspi_setup_mmap_op(slave, op);
+	if (ret)
+		return ret;
+	*mapp = priv->memory_map;
+	*sizep = priv->mmap_size;
+
+	return 0;
 }
+#endif
 
 static int ti_qspi_claim_bus(struct udevice *dev)
 {
@@ -477,6 +513,10 @@ static int ti_qspi_ofdata_to_platdata(struct udevice *bus)
 
 static const struct spi_controller_mem_ops ti_qspi_mem_ops = {
 	.exec_op = ti_qspi_exec_mem_op,
+#if !defined(CONFIG_TI_EDMA3) || defined(CONFIG_DMA)
+	/* With legacy EDMA, reads go through exec_op() to use the DMA copy */
+	.mmap = ti_qspi_mmap,
+#endif
 };
 
 static const struct dm_spi_ops ti_qspi_ops = {
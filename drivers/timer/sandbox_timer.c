@@ -11,17 +11,22 @@
 
 #define SANDBOX_TIMER_RATE	1000000
 
-/* system timer offset in ms */
+/* system timer offset in us */
 static unsigned long sandbox_timer_offset;
 
 void sandbox_timer_add_offset(unsigned long offset)
+{
+	sandbox_timer_offset += offset * 1000;
+}
+
+void sandbox_timer_add_offset_us(unsigned long offset)
 {
 	sandbox_timer_offset += offset;
 }
 
 u64 notrace timer_early_get_count(void)
 {
-	return os_get_nsec() / 1000 + sandbox_timer_offset * 1000;
+	return os_get_nsec() / 1000 + sandbox_timer_offset;
 }
 
 unsigned long notrace timer_early_get_rate(void)
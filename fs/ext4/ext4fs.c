@@ -23,6 +23,7 @@
 #include <common.h>
 #include <ext_common.h>
 #include <ext4fs.h>
+#include <fs.h>
 #include "ext4_common.h"
 #include <div64.h>
 
@@ -238,6 +239,68 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	return ext4fs_read(buf, offset, len, len_read);
 }
 
+/* An open file, which keeps its inode */
+struct ext4_file {
+	struct fs_file parent;
+	struct ext2fs_node node;
+};
+
+int ext4fs_open_file(const char *filename, struct fs_file **filep)
+{
+	struct ext2fs_node *fdiro = NULL;
+	struct ext4_file *file;
+	int ret = -ENOENT;
+
+	if (ext4fs_root == NULL) {
+		ret = -ENODEV;
+		goto err;
+	}
+
+	if (!ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
+			      FILETYPE_REG))
+		goto out;
+
+	if (!fdiro->inode_read &&
+	    !ext4fs_read_inode(fdiro->data, fdiro->ino, &fdiro->inode)) {
+		ret = -EIO;
+		goto out;
+	}
+
+	file = calloc(1, sizeof(*file));
+	if (!file) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	file->node = *fdiro;
+	file->node.inode_read = 1;
+	file->parent.size = le32_to_cpu(fdiro->inode.size);
+	*filep = &file->parent;
+	ret = 0;
+out:
+	ext4fs_free_node(fdiro, &ext4fs_root->diropen);
+err:
+	if (ret)
+		printf("** File not found %s **\n", filename);
+
+	return ret;
+}
+
+int ext4fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		 loff_t *actread)
+{
+	struct ext4_file *ef = container_of(file, struct ext4_file, parent);
+
+	/* The filesystem may have been mounted again since the file was opened */
+	ef->node.data = ext4fs_root;
+
+	return ext4fs_read_file(&ef->node, offset, len, buf, actread);
+}
+
+void ext4fs_close_file(struct fs_file *file)
+{
+	free(container_of(file, struct ext4_file, parent));
+}
+
 int ext4fs_uuid(char *uuid_str)
 {
 	if (ext4fs_root == NULL)
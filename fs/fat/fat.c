@@ -20,6 +20,7 @@
 #include <memalign.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
 
 /*
  * Convert a string to lowercase.  Converts at most 'len' characters,
@@ -304,12 +305,15 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
  * Update the number of bytes read in *gotsize or return -1 on fatal errors.
+ * If 'lastclust' is not NULL and all the data was read, it is set to the
+ * cluster holding the last byte read.
  */
 __u8 get_contents_vfatname_block[MAX_CLUSTSIZE]
 	__aligned(ARCH_DMA_MINALIGN);
 
 static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
-			__u8 *buffer, loff_t maxsize, loff_t *gotsize)
+			__u8 *buffer, loff_t maxsize, loff_t *gotsize,
+			__u32 *lastclust)
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
@@ -360,8 +364,11 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		actsize -= pos;
 		memcpy(buffer, get_contents_vfatname_block + pos, actsize);
 		*gotsize += actsize;
-		if (!filesize)
+		if (!filesize) {
+			if (lastclust)
+				*lastclust = curclust;
 			return 0;
+		}
 		buffer += actsize;
 
 		curclust = get_fatent(mydata, curclust);
@@ -397,6 +404,8 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 			return -1;
 		}
 		*gotsize += actsize;
+		if (lastclust)
+			*lastclust = endclust;
 		return 0;
 getit:
 		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
@@ -1141,7 +1150,8 @@ int file_fat_read_at(const char *filename, loff_t pos, void *buffer,
 		goto out_free_both;
 
 	debug("reading %s at pos %llu\n", filename, pos);
-	ret = get_contents(&fsdata, itr->dent, pos, buffer, maxsize, actread);
+	ret = get_contents(&fsdata, itr->dent, pos, buffer, maxsize, actread,
+			   NULL);
 
 out_free_both:
 	free(fsdata.fatbuf);
@@ -1174,6 +1184,131 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	return ret;
 }
 
+/*
+ * An open file. Besides the directory entry, this keeps the position reached
+ * in the cluster chain, so that reading the file in order does not follow
+ * the chain from the start each time.
+ */
+typedef struct {
+	struct fs_file parent;
+	fsdata fsdata;
+	dir_entry dent;
+	__u32 clust;		/* cluster holding byte 'clust_pos' of the file */
+	loff_t clust_pos;
+} fat_file;
+
+int file_fat_open(const char *filename, struct fs_file **filep)
+{
+	fat_file *file;
+	fsdata *mydata;
+	fat_itr *itr;
+	int ret;
+
+	itr = malloc_cache_aligned(sizeof(fat_itr));
+	if (!itr)
+		return -ENOMEM;
+	file = calloc(1, sizeof(*file));
+	if (!file) {
+		ret = -ENOMEM;
+		goto out_free_itr;
+	}
+	mydata = &file->fsdata;
+
+	ret = fat_itr_root(itr, mydata);
+	if (ret)
+		goto fail_free_file;
+
+	ret = fat_itr_resolve(itr, filename, TYPE_FILE);
+	if (ret)
+		goto fail_free_both;
+
+	file->dent = *itr->dent;
+	file->clust = START(&file->dent);
+	file->parent.size = FAT2CPU32(file->dent.size);
+	*filep = &file->parent;
+	free(itr);
+	return 0;
+
+fail_free_both:
+	free(mydata->fatbuf);
+fail_free_file:
+	free(file);
+out_free_itr:
+	free(itr);
+	return ret;
+}
+
+int fat_open_file(const char *filename, struct fs_file **filep)
+{
+	int ret;
+
+	ret = file_fat_open(filename, filep);
+	if (ret)
+		printf("** Unable to read file %s **\n", filename);
+
+	return ret;
+}
+
+int fat_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	      loff_t *actread)
+{
+	fat_file *ff = (fat_file *)file;
+	fsdata *mydata = &ff->fsdata;
+	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
+	dir_entry dent = ff->dent;
+	__u32 clust, lastclust, rem;
+	loff_t last;
+	int ret;
+
+	*actread = 0;
+	if (offset >= file->size)
+		return 0;
+
+	if (offset < ff->clust_pos) {
+		ff->clust = START(&ff->dent);
+		ff->clust_pos = 0;
+	}
+
+	/* go to cluster at offset, from where the last read left off */
+	while (offset - ff->clust_pos >= bytesperclust) {
+		clust = get_fatent(mydata, ff->clust);
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			printf("Invalid FAT entry\n");
+			return -EIO;
+		}
+		ff->clust = clust;
+		ff->clust_pos += bytesperclust;
+	}
+
+	/* read the rest as if the file started at that cluster */
+	dent.start = cpu_to_le16(ff->clust & 0xffff);
+	dent.starthi = cpu_to_le16(ff->clust >> 16);
+	dent.size = cpu_to_le32(file->size - ff->clust_pos);
+
+	lastclust = 0;
+	ret = get_contents(mydata, &dent, offset - ff->clust_pos, buf, len,
+			   actread, &lastclust);
+	if (ret || !lastclust)
+		return ret;
+
+	/* the next read is likely to carry on from the last cluster read */
+	last = offset + *actread - 1;
+	div_u64_rem(last, bytesperclust, &rem);
+	ff->clust = lastclust;
+	ff->clust_pos = last - rem;
+
+	return 0;
+}
+
+void fat_close_file(struct fs_file *file)
+{
+	fat_file *ff = (fat_file *)file;
+
+	free(ff->fsdata.fatbuf);
+	free(ff);
+}
+
 typedef struct {
 	struct fs_dir_stream parent;
 	struct fs_dirent dirent;
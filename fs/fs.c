@@ -6,6 +6,7 @@
 #include <config.h>
 #include <errno.h>
 #include <common.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -25,6 +26,49 @@ static int fs_dev_part;
 static disk_partition_t fs_partition;
 static int fs_type = FS_TYPE_ANY;
 
+/*
+ * A filesystem with files open on it. The filesystem drivers only handle one
+ * filesystem at a time, so at most one mount is active, i.e. mounted in its
+ * driver. The others are mounted again when a file on them is next read,
+ * without probing the other filesystem types.
+ */
+struct fs_mount {
+	struct blk_desc *desc;
+	int part;
+	disk_partition_t partition;
+	int fstype;
+	int files;	/* number of open files, 0 if this entry is free */
+};
+
+#define FS_MOUNT_COUNT	4
+
+static struct fs_mount fs_mounts[FS_MOUNT_COUNT];
+static struct fs_mount *fs_active;
+
+/*
+ * The filesystem type found on a recently used partition, or FS_TYPE_ANY if
+ * none was found, so that fs_set_blk_dev() can go straight to the right
+ * probe. An entry holds until the media is rescanned or written, which
+ * changes the device's media_gen.
+ */
+struct fs_probe_entry {
+	struct blk_desc *desc;
+	int hwpart;
+	int part;
+	lbaint_t start;
+	uint media_gen;
+	int fstype;
+};
+
+#define FS_PROBE_CACHE_COUNT	8
+
+static struct fs_probe_entry fs_probe_cache[FS_PROBE_CACHE_COUNT];
+static int fs_probe_next;	/* entry to replace next */
+static uint fs_probe_hits;
+static uint fs_probe_misses;
+
+static struct fstype_info *fs_get_info(int fstype);
+
 static inline int fs_probe_unsupported(struct blk_desc *fs_dev_desc,
 				      disk_partition_t *fs_partition)
 {
@@ -120,6 +164,19 @@ static inline int fs_mkdir_unsupported(const char *dirname)
 	return -1;
 }
 
+static inline int fs_open_unsupported(const char *filename,
+				      struct fs_file **filep)
+{
+	return -ENODEV;
+}
+
+static inline int fs_pread_unsupported(struct fs_file *file, void *buf,
+				       loff_t offset, loff_t len,
+				       loff_t *actread)
+{
+	return -1;
+}
+
 struct fstype_info {
 	int fstype;
 	char *name;
@@ -160,8 +217,59 @@ struct fstype_info {
 	int (*unlink)(const char *filename);
 	int (*mkdir)(const char *dirname);
 	int (*ln)(const char *filename, const char *target);
+	/*
+	 * Open a file for reading with pread(). On success return 0 and the
+	 * file, with its size set, via 'filep'. On error return -errno. See
+	 * fs_open().
+	 */
+	int (*open)(const char *filename, struct fs_file **filep);
+	/* see fs_pread(), called with the file's filesystem mounted */
+	int (*pread)(struct fs_file *file, void *buf, loff_t offset,
+		     loff_t len, loff_t *actread);
+	/* free a file from open() */
+	void (*close_file)(struct fs_file *file);
 };
 
+/* generic implementation of open/pread in terms of size/read by name */
+__maybe_unused
+static int fs_open_generic(const char *filename, struct fs_file **filep)
+{
+	struct fs_file *file;
+	loff_t size;
+
+	if (fs_get_info(fs_type)->size(filename, &size) < 0) {
+		printf("** Unable to read file %s **\n", filename);
+		return -ENOENT;
+	}
+
+	file = calloc(1, sizeof(*file));
+	if (!file)
+		return -ENOMEM;
+	file->name = strdup(filename);
+	if (!file->name) {
+		free(file);
+		return -ENOMEM;
+	}
+	file->size = size;
+	*filep = file;
+
+	return 0;
+}
+
+__maybe_unused
+static int fs_pread_generic(struct fs_file *file, void *buf, loff_t offset,
+			    loff_t len, loff_t *actread)
+{
+	return fs_get_info(fs_type)->read(file->name, buf, offset, len,
+					  actread);
+}
+
+static void fs_close_file_generic(struct fs_file *file)
+{
+	free(file->name);
+	free(file);
+}
+
 static struct fstype_info fstypes[] = {
 #ifdef CONFIG_FS_FAT
 	{
@@ -188,6 +296,9 @@ static struct fstype_info fstypes[] = {
 		.readdir = fat_readdir,
 		.closedir = fat_closedir,
 		.ln = fs_ln_unsupported,
+		.open = fat_open_file,
+		.pread = fat_pread,
+		.close_file = fat_close_file,
 	},
 #endif
 #ifdef CONFIG_FS_EXT4
@@ -212,6 +323,9 @@ static struct fstype_info fstypes[] = {
 		.opendir = fs_opendir_unsupported,
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
+		.open = ext4fs_open_file,
+		.pread = ext4fs_pread,
+		.close_file = ext4fs_close_file,
 	},
 #endif
 #ifdef CONFIG_SANDBOX
@@ -231,6 +345,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.pread = fs_pread_generic,
+		.close_file = fs_close_file_generic,
 	},
 #endif
 #ifdef CONFIG_CMD_UBIFS
@@ -250,6 +367,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.pread = fs_pread_generic,
+		.close_file = fs_close_file_generic,
 	},
 #endif
 #ifdef CONFIG_FS_BTRFS
@@ -269,6 +389,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_generic,
+		.pread = fs_pread_generic,
+		.close_file = fs_close_file_generic,
 	},
 #endif
 	{
@@ -287,6 +410,9 @@ static struct fstype_info fstypes[] = {
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
 		.ln = fs_ln_unsupported,
+		.open = fs_open_unsupported,
+		.pread = fs_pread_unsupported,
+		.close_file = fs_close_file_generic,
 	},
 };
 
@@ -317,12 +443,115 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
-int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+static void fs_close_dev(void)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+
+	info->close();
+
+	fs_type = FS_TYPE_ANY;
+	fs_active = NULL;
+}
+
+static struct fs_probe_entry *fs_probe_lookup(int part)
+{
+	struct fs_probe_entry *entry;
+
+	for (entry = fs_probe_cache;
+	     entry < fs_probe_cache + FS_PROBE_CACHE_COUNT; entry++) {
+		if (entry->desc == fs_dev_desc &&
+		    entry->hwpart == fs_dev_desc->hwpart &&
+		    entry->part == part &&
+		    entry->start == fs_partition.start &&
+		    entry->media_gen == fs_dev_desc->media_gen)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void fs_probe_record(int part, int fstype)
 {
+	struct fs_probe_entry *entry = fs_probe_lookup(part);
+
+	if (!entry) {
+		entry = &fs_probe_cache[fs_probe_next];
+		fs_probe_next = (fs_probe_next + 1) % FS_PROBE_CACHE_COUNT;
+	}
+	entry->desc = fs_dev_desc;
+	entry->hwpart = fs_dev_desc->hwpart;
+	entry->part = part;
+	entry->start = fs_partition.start;
+	entry->media_gen = fs_dev_desc->media_gen;
+	entry->fstype = fstype;
+}
+
+/* Find the filesystem on fs_dev_desc / fs_partition */
+static int fs_probe(int part, int fstype)
+{
+	struct fs_probe_entry *entry = NULL;
 	struct fstype_info *info;
-	int part, i;
+	int i;
+
+	if (fs_dev_desc)
+		entry = fs_probe_lookup(part);
+	if (entry && (fstype == FS_TYPE_ANY || fstype == entry->fstype)) {
+		info = fs_get_info(entry->fstype);
+		if (!info->probe(fs_dev_desc, &fs_partition)) {
+			fs_probe_hits++;
+			fs_type = info->fstype;
+			fs_dev_part = part;
+			return 0;
+		}
+		if (entry->fstype == FS_TYPE_ANY) {
+			fs_probe_hits++;
+			return -1;
+		}
+		/* The filesystem has gone, so look again */
+		entry->desc = NULL;
+	}
+	if (fs_dev_desc && fstype == FS_TYPE_ANY)
+		fs_probe_misses++;
+
+	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
+		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
+				fstype != info->fstype)
+			continue;
+
+		if (!fs_dev_desc && !info->null_dev_desc_ok)
+			continue;
+
+		if (!info->probe(fs_dev_desc, &fs_partition)) {
+			/*
+			 * Only a search of all types says what is on the
+			 * partition, since more than one type may match
+			 */
+			if (fs_dev_desc && fstype == FS_TYPE_ANY)
+				fs_probe_record(part, info->fstype);
+			fs_type = info->fstype;
+			fs_dev_part = part;
+			return 0;
+		}
+	}
+	if (fs_dev_desc && fstype == FS_TYPE_ANY)
+		fs_probe_record(part, FS_TYPE_ANY);
+
+	return -1;
+}
+
+void fs_probe_cache_stats(uint *hitsp, uint *missesp)
+{
+	*hitsp = fs_probe_hits;
+	*missesp = fs_probe_misses;
+}
+
+int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+{
+	int part;
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
+	struct fstype_info *info;
 	static int relocated;
+	int i;
 
 	if (!relocated) {
 		for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes);
@@ -338,34 +567,25 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	}
 #endif
 
+	/* The driver can only handle one filesystem at once */
+	if (fs_active)
+		fs_close_dev();
+
 	part = blk_get_device_part_str(ifname, dev_part_str, &fs_dev_desc,
 					&fs_partition, 1);
 	if (part < 0)
 		return -1;
 
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
-				fstype != info->fstype)
-			continue;
-
-		if (!fs_dev_desc && !info->null_dev_desc_ok)
-			continue;
-
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
-	}
-
-	return -1;
+	return fs_probe(part, fstype);
 }
 
 /* set current blk device w/ blk_desc + partition # */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 {
-	struct fstype_info *info;
-	int ret, i;
+	int ret;
+
+	if (fs_active)
+		fs_close_dev();
 
 	if (part >= 1)
 		ret = part_get_info(desc, part, &fs_partition);
@@ -375,24 +595,7 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
-	}
-
-	return -1;
-}
-
-static void fs_close(void)
-{
-	struct fstype_info *info = fs_get_info(fs_type);
-
-	info->close();
-
-	fs_type = FS_TYPE_ANY;
+	return fs_probe(part, FS_TYPE_ANY);
 }
 
 int fs_uuid(char *uuid_str)
@@ -411,7 +614,7 @@ int fs_ls(const char *dirname)
 	ret = info->ls(dirname);
 
 	fs_type = FS_TYPE_ANY;
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
@@ -424,7 +627,7 @@ int fs_exists(const char *filename)
 
 	ret = info->exists(filename);
 
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
@@ -437,7 +640,7 @@ int fs_size(const char *filename, loff_t *size)
 
 	ret = info->size(filename, size);
 
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
@@ -460,7 +663,7 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	/* If we requested a specific number of bytes, check we got it */
 	if (ret == 0 && len && *actread != len)
 		debug("** %s shorter than offset + len **\n", filename);
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
@@ -480,11 +683,121 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 		printf("** Unable to write file %s **\n", filename);
 		ret = -1;
 	}
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
 
+/* Find the mount for the current filesystem, or a free one to use for it */
+static struct fs_mount *fs_mount_find(void)
+{
+	struct fs_mount *mnt, *free_mnt = NULL;
+
+	for (mnt = fs_mounts; mnt < fs_mounts + FS_MOUNT_COUNT; mnt++) {
+		if (!mnt->files) {
+			if (!free_mnt)
+				free_mnt = mnt;
+		} else if (mnt->desc == fs_dev_desc && mnt->part == fs_dev_part &&
+			   mnt->fstype == fs_type) {
+			return mnt;
+		}
+	}
+	if (free_mnt) {
+		free_mnt->desc = fs_dev_desc;
+		free_mnt->part = fs_dev_part;
+		free_mnt->partition = fs_partition;
+		free_mnt->fstype = fs_type;
+	}
+
+	return free_mnt;
+}
+
+/* Mount the filesystem holding an open file, if it is not already */
+static int fs_mount_activate(struct fs_mount *mnt)
+{
+	struct fstype_info *info = fs_get_info(mnt->fstype);
+
+	if (fs_active == mnt)
+		return 0;
+
+	fs_close_dev();
+	if (info->probe(mnt->desc, &mnt->partition))
+		return -EIO;
+	fs_dev_desc = mnt->desc;
+	fs_dev_part = mnt->part;
+	fs_partition = mnt->partition;
+	fs_type = mnt->fstype;
+	fs_active = mnt;
+
+	return 0;
+}
+
+int fs_open(const char *filename, struct fs_file **filep)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_mount *mnt;
+	struct fs_file *file;
+	int ret;
+
+	mnt = fs_mount_find();
+	if (!mnt) {
+		fs_close_dev();
+		return -EMFILE;
+	}
+
+	ret = info->open(filename, &file);
+	if (ret) {
+		fs_close_dev();
+		return ret;
+	}
+
+	/* Leave the filesystem mounted for fs_pread() */
+	file->mount = mnt;
+	mnt->files++;
+	fs_active = mnt;
+	*filep = file;
+
+	return 0;
+}
+
+int fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	     loff_t *actread)
+{
+	int ret;
+
+	*actread = 0;
+	if (offset < 0 || len < 0)
+		return -EINVAL;
+	if (offset >= file->size || !len)
+		return 0;
+
+	ret = fs_mount_activate(file->mount);
+	if (ret)
+		return ret;
+
+	len = min(len, file->size - offset);
+
+	return fs_get_info(fs_type)->pread(file, buf, offset, len, actread);
+}
+
+loff_t fs_file_size(struct fs_file *file)
+{
+	return file->size;
+}
+
+void fs_close(struct fs_file *file)
+{
+	struct fs_mount *mnt;
+
+	if (!file)
+		return;
+
+	mnt = file->mount;
+	fs_get_info(mnt->fstype)->close_file(file);
+	if (!--mnt->files && fs_active == mnt)
+		fs_close_dev();
+}
+
 struct fs_dir_stream *fs_opendir(const char *filename)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
@@ -492,7 +805,7 @@ struct fs_dir_stream *fs_opendir(const char *filename)
 	int ret;
 
 	ret = info->opendir(filename, &dirs);
-	fs_close();
+	fs_close_dev();
 	if (ret) {
 		errno = -ret;
 		return NULL;
@@ -514,7 +827,7 @@ struct fs_dirent *fs_readdir(struct fs_dir_stream *dirs)
 	info = fs_get_info(fs_type);
 
 	ret = info->readdir(dirs, &dirent);
-	fs_close();
+	fs_close_dev();
 	if (ret) {
 		errno = -ret;
 		return NULL;
@@ -534,7 +847,7 @@ void fs_closedir(struct fs_dir_stream *dirs)
 	info = fs_get_info(fs_type);
 
 	info->closedir(dirs);
-	fs_close();
+	fs_close_dev();
 }
 
 int fs_unlink(const char *filename)
@@ -546,7 +859,7 @@ int fs_unlink(const char *filename)
 	ret = info->unlink(filename);
 
 	fs_type = FS_TYPE_ANY;
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
@@ -560,7 +873,7 @@ int fs_mkdir(const char *dirname)
 	ret = info->mkdir(dirname);
 
 	fs_type = FS_TYPE_ANY;
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
@@ -576,7 +889,7 @@ int fs_ln(const char *fname, const char *target)
 		printf("** Unable to create link %s -> %s **\n", fname, target);
 		ret = -1;
 	}
-	fs_close();
+	fs_close_dev();
 
 	return ret;
 }
@@ -606,9 +919,11 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	unsigned long addr;
 	const char *addr_str;
 	const char *filename;
+	struct fs_file *file;
 	loff_t bytes;
 	loff_t pos;
 	loff_t len_read;
+	void *buf;
 	int ret;
 	unsigned long time;
 	char *ep;
@@ -651,7 +966,16 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		pos = 0;
 
 	time = get_timer(0);
-	ret = fs_read(filename, addr, pos, bytes, &len_read);
+	ret = fs_open(filename, &file);
+	if (!ret) {
+		/* A length of 0 means read the rest of the file */
+		if (!bytes && pos < fs_file_size(file))
+			bytes = fs_file_size(file) - pos;
+		buf = map_sysmem(addr, bytes);
+		ret = fs_pread(file, buf, pos, bytes, &len_read);
+		unmap_sysmem(buf);
+		fs_close(file);
+	}
 	time = get_timer(time);
 	if (ret < 0)
 		return 1;
@@ -682,23 +682,19 @@ static inline void *kmap(struct page *page)
 	return page->addr;
 }
 
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+/*
+ * decompress_dn - decompress a data node that has already been read.
+ *
+ * This is the consumer side of the read path: it does not touch the flash,
+ * so it works the same for nodes read one by one and for nodes taken out of
+ * a bulk-read buffer.
+ */
+static int decompress_dn(struct ubifs_info *c, struct inode *inode, void *addr,
+			 unsigned int block, struct ubifs_data_node *dn)
 {
-	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
 
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
-
 	ubifs_assert(le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
 	len = le32_to_cpu(dn->size);
@@ -729,6 +725,80 @@ dump:
 	return -EINVAL;
 }
 
+static int read_block(struct inode *inode, void *addr, unsigned int block,
+		      struct ubifs_data_node *dn)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	union ubifs_key key;
+	int err;
+
+	data_key_init(c, &key, inode->i_ino, block);
+	err = ubifs_tnc_lookup(c, &key, dn);
+	if (err) {
+		if (err == -ENOENT)
+			/* Not found, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		return err;
+	}
+
+	return decompress_dn(c, inode, addr, block, dn);
+}
+
+/**
+ * bulk_read - read and decompress a run of data blocks
+ * @c: UBIFS file-system description object
+ * @inode: inode the blocks belong to
+ * @addr: destination, which must have room for @max_blocks full blocks
+ * @block: first block to read
+ * @max_blocks: maximum number of blocks to fill in
+ *
+ * The data nodes that follow @block and sit back to back in one LEB are
+ * fetched into c->bu.buf with a single flash read, and are then decompressed
+ * from that buffer into @addr. Holes between the nodes are zero-filled.
+ *
+ * Return: number of blocks filled in (0 if there is nothing to bulk-read and
+ * the caller should fall back to do_readpage()), or a negative error code
+ */
+static int bulk_read(struct ubifs_info *c, struct inode *inode, void *addr,
+		     unsigned int block, unsigned int max_blocks)
+{
+	struct bu_info *bu = &c->bu;
+	unsigned int i, n, nn = 0;
+	int err, offs = 0;
+
+	bu->buf_len = c->max_bu_buf_len;
+	data_key_init(c, &bu->key, inode->i_ino, block);
+	err = ubifs_tnc_get_bu_keys(c, bu);
+	if (err)
+		return err;
+
+	/* A run of one node is no better than the normal path */
+	if (bu->cnt < 2 || key_block(c, &bu->zbranch[0].key) != block)
+		return 0;
+
+	err = ubifs_tnc_bulk_read(c, bu);
+	if (err)
+		return err;
+
+	n = min_t(unsigned int, bu->blk_cnt, max_blocks);
+	for (i = 0; i < n; i++, addr += UBIFS_BLOCK_SIZE) {
+		if (nn >= bu->cnt ||
+		    key_block(c, &bu->zbranch[nn].key) != block + i) {
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+			continue;
+		}
+
+		err = decompress_dn(c, inode, addr, block + i, bu->buf + offs);
+		if (err)
+			return err;
+
+		offs += ALIGN(bu->zbranch[nn].len, 8);
+		nn++;
+	}
+
+	return n;
+}
+
 static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		       struct page *page, int last_block_size)
 {
@@ -899,6 +969,29 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	page.index = offset / PAGE_SIZE;
 	page.inode = inode;
 	for (i = 0; i < count; i++) {
+		/*
+		 * Use bulk-read for whole pages. The last page is left to
+		 * do_readpage() as it must not be padded in the destination.
+		 */
+		if (c->bu.buf && i + 1 < count) {
+			int done = bulk_read(c, inode, page.addr,
+					     page.index << UBIFS_BLOCKS_PER_PAGE_SHIFT,
+					     (count - i - 1) * UBIFS_BLOCKS_PER_PAGE);
+
+			if (done < 0) {
+				err = done;
+				break;
+			}
+
+			done /= UBIFS_BLOCKS_PER_PAGE;
+			if (done) {
+				page.addr += done * PAGE_SIZE;
+				page.index += done;
+				i += done - 1;
+				continue;
+			}
+		}
+
 		/*
 		 * Make sure to not read beyond the requested size
 		 */
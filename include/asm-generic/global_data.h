@@ -67,6 +67,9 @@ typedef struct global_data {
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
 #endif
+#if CONFIG_IS_ENABLED(DM_ARENA)
+	struct dm_arena	*dm_arena;	/* Newest arena for bind-time data */
+#endif
 #if CONFIG_IS_ENABLED(TIMER)
 	struct udevice	*timer;		/* Timer instance for Driver Model */
 #endif
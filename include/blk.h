@@ -81,6 +81,7 @@ struct blk_desc {
 	char		product[BLK_PRD_SIZE + 1]; /* device product number */
 	char		revision[BLK_REV_SIZE + 1]; /* firmware revision */
 	enum sig_type	sig_type;	/* Partition table signature type */
+	uint		media_gen;	/* changed by blk_media_changed() */
 	union {
 		uint32_t mbr_sig;	/* MBR integer signature */
 		efi_guid_t guid_sig;	/* GPT GUID Signature */
@@ -197,6 +198,18 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
 
+/**
+ * blk_media_changed() - note that the contents of a device may have changed
+ *
+ * This is called when a device is written or its media is (re)scanned. It
+ * gives the device a new media_gen, so that anything worked out from what
+ * was on the device, such as the type of filesystem on a partition, is
+ * looked at again.
+ *
+ * @desc:	Block device descriptor
+ */
+void blk_media_changed(struct blk_desc *desc);
+
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
@@ -450,6 +463,7 @@ static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_media_changed(block_dev);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
@@ -457,6 +471,7 @@ static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_media_changed(block_dev);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
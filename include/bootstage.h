@@ -15,6 +15,8 @@
 enum bootstage_flags {
 	BOOTSTAGEF_ERROR	= 1 << 0,	/* Error record */
 	BOOTSTAGEF_ALLOC	= 1 << 1,	/* Allocate an id */
+	BOOTSTAGEF_SPAN		= 1 << 2,	/* Span with a start and length */
+	BOOTSTAGEF_OPEN		= 1 << 3,	/* Span which has not ended yet */
 };
 
 /* bootstate sub-IDs used for kernel and ramdisk ranges */
@@ -304,9 +306,57 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name);
  */
 uint32_t bootstage_accum(enum bootstage_id id);
 
+/**
+ * bootstage_span_begin() - Mark the start of a span of time
+ *
+ * Spans nest: a span begun while another is open becomes its child, so that
+ * the report can show, for example, the device probes within an initcall
+ * within board_init_r(). Each call creates a new record.
+ *
+ * @name:	Name of the span. This is copied if malloc() is fully set up,
+ *		else it must remain valid until bootstage_relocate() copies it
+ * @return span number to pass to bootstage_span_end(), or -1 if there is no
+ *	space to record it (which bootstage_span_end() ignores)
+ */
+int bootstage_span_begin(const char *name);
+
+/**
+ * bootstage_span_end() - Mark the end of a span of time
+ *
+ * Any spans inside this one which are still open are ended too.
+ *
+ * @span:	Span number returned by bootstage_span_begin()
+ * @return length of the span in microseconds, or 0 if @span is not open
+ */
+uint32_t bootstage_span_end(int span);
+
+/**
+ * bootstage_enable_spans() - Enable or disable recording of new spans
+ *
+ * Spans are enabled to start with. While they are disabled,
+ * bootstage_span_begin() returns -1 and records nothing.
+ *
+ * @enable:	true to record spans, false to ignore them
+ */
+void bootstage_enable_spans(bool enable);
+
 /* Print a report about boot time */
 void bootstage_report(void);
 
+/**
+ * bootstage_export_json() - Write bootstage records as Chrome trace JSON
+ *
+ * This produces a file which can be loaded into chrome://tracing or the
+ * Perfetto UI. Spans become complete events, marks become instant events and
+ * accumulated times are placed in the metadata. Times are in microseconds.
+ *
+ * @buf:	Buffer to write to (nul-terminated if there is space)
+ * @size:	Size of buffer in bytes (0 to just get the size needed)
+ * @return number of bytes needed, including the terminator. If this is more
+ *	than @size then the output was truncated
+ */
+int bootstage_export_json(char *buf, int size);
+
 /**
  * Add bootstage information to the device tree
  *
@@ -403,6 +453,20 @@ static inline uint32_t bootstage_accum(enum bootstage_id id)
 	return 0;
 }
 
+static inline int bootstage_span_begin(const char *name)
+{
+	return -1;
+}
+
+static inline uint32_t bootstage_span_end(int span)
+{
+	return 0;
+}
+
+static inline void bootstage_enable_spans(bool enable)
+{
+}
+
 static inline int bootstage_stash(void *base, int size)
 {
 	return 0;	/* Pretend to succeed */
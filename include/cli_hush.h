@@ -20,6 +20,25 @@ int set_local_var(const char *s, int flg_export);
 void unset_local_var(const char *name);
 char *get_local_var(const char *s);
 
+/**
+ * hush_parse_cache_enable() - Enable or disable the parse cache
+ *
+ * Disabling the cache drops the scripts held in it, so that each script is
+ * parsed every time it is run. This is mostly useful for measuring the
+ * effect of the cache. The cache is enabled by default.
+ *
+ * @enable: true to cache parsed scripts, false to parse them on every run
+ */
+void hush_parse_cache_enable(bool enable);
+
+/**
+ * hush_parse_cache_stats() - Read the parse-cache statistics
+ *
+ * @hitsp: Returns the number of scripts run without parsing them
+ * @missesp: Returns the number of scripts which had to be parsed
+ */
+void hush_parse_cache_stats(uint *hitsp, uint *missesp);
+
 #if defined(CONFIG_HUSH_INIT_VAR)
 extern int hush_init_var (void);
 #endif
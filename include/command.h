@@ -55,6 +55,20 @@ int _do_help (cmd_tbl_t *cmd_start, int cmd_items, cmd_tbl_t * cmdtp, int
 cmd_tbl_t *find_cmd(const char *cmd);
 cmd_tbl_t *find_cmd_tbl (const char *cmd, cmd_tbl_t *table, int table_len);
 
+/**
+ * find_cmd_tbl_sorted() - Find a command in a table sorted by name
+ *
+ * This is a faster version of find_cmd_tbl() for a table in strcmp() order,
+ * such as the main command table. Abbreviations are handled in the same way.
+ *
+ * @cmd:	Command to find (may be abbreviated or have a '.' suffix)
+ * @table:	Table of commands, sorted by name
+ * @table_len:	Number of commands in @table
+ * @return command found, or NULL if none or if @cmd is ambiguous
+ */
+cmd_tbl_t *find_cmd_tbl_sorted(const char *cmd, cmd_tbl_t *table,
+			       int table_len);
+
 extern int cmd_usage(const cmd_tbl_t *cmdtp);
 
 #ifdef CONFIG_AUTO_COMPLETE
@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Running independent pieces of work on the secondary CPUs
+ */
+
+#ifndef _CPU_WORK_H
+#define _CPU_WORK_H
+
+/**
+ * struct cpu_work - a piece of work which may run on any CPU
+ *
+ * The function may run on a secondary CPU at the same time as other work,
+ * so it must only touch its own data. It must not use U-Boot services such
+ * as malloc(), the console or driver model.
+ *
+ * @func:	Function to run
+ * @arg:	Argument to pass to @func
+ */
+struct cpu_work {
+	void (*func)(void *arg);
+	void *arg;
+};
+
+#if CONFIG_IS_ENABLED(CPU_WORK)
+/**
+ * cpu_work_cpus() - get the number of secondary CPUs available for work
+ *
+ * @return number of CPUs, 0 if all work runs on the boot CPU
+ */
+int cpu_work_cpus(void);
+
+/**
+ * cpu_work_run() - run some work, spread over all the CPUs
+ *
+ * The work is shared out evenly between the boot CPU and the secondary
+ * CPUs, and is not run in any particular order. This returns when all of
+ * it has finished.
+ *
+ * @work:	Work to run
+ * @count:	Number of entries in @work
+ */
+void cpu_work_run(struct cpu_work *work, int count);
+#else
+static inline int cpu_work_cpus(void)
+{
+	return 0;
+}
+
+static inline void cpu_work_run(struct cpu_work *work, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		work[i].func(work[i].arg);
+}
+#endif
+
+/**
+ * arch_cpu_work_cpus() - get the number of secondary CPUs which can run work
+ *
+ * The default returns 0.
+ *
+ * @return number of CPUs; they are numbered from 1
+ */
+int arch_cpu_work_cpus(void);
+
+/**
+ * arch_cpu_work_start() - start a function on a secondary CPU
+ *
+ * @cpu:	CPU number, from 1 to arch_cpu_work_cpus()
+ * @func:	Function to run
+ * @arg:	Argument to pass to @func
+ * @return 0 if started, -ve on error, in which case the caller runs the
+ *	function itself
+ */
+int arch_cpu_work_start(int cpu, void (*func)(void *arg), void *arg);
+
+/**
+ * arch_cpu_work_wait() - wait for a secondary CPU to finish its function
+ *
+ * On return, everything the function wrote must be visible to the caller.
+ *
+ * @cpu:	CPU number passed to arch_cpu_work_start()
+ */
+void arch_cpu_work_wait(int cpu);
+
+#endif
@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Arena allocator for bind-time driver model data
+ */
+
+#ifndef _DM_ARENA_H
+#define _DM_ARENA_H
+
+#include <malloc.h>
+
+/**
+ * struct dm_arena - A block of memory for bind-time driver model data
+ *
+ * Memory is handed out in order and is never reused. Freeing memory which
+ * is in an arena does nothing, since the whole arena is freed by
+ * dm_uninit(). The data follows this header, at DM_ARENA_ALIGN.
+ *
+ * @next: Next (older) arena, or NULL if none
+ * @size: Number of bytes of data in the arena
+ * @used: Number of bytes handed out so far
+ * @allocs: Number of allocations which came from the arena
+ * @misses: Number of allocations which did not fit and used calloc()
+ * @open: true if new allocations may come from this arena
+ */
+struct dm_arena {
+	struct dm_arena *next;
+	ulong size;
+	ulong used;
+	uint allocs;
+	uint misses;
+	bool open;
+};
+
+/* Alignment of each allocation, the same as malloc() */
+#define DM_ARENA_ALIGN		(2 * sizeof(size_t))
+
+#if CONFIG_IS_ENABLED(DM_ARENA)
+/**
+ * dm_arena_open() - Create a new arena and use it for new allocations
+ *
+ * The arena is sized from the number of nodes in the device tree and the
+ * number of driver_info records. This does nothing before relocation, since
+ * the simple malloc() used then is already a bump allocator.
+ *
+ * @return 0 if OK (or nothing to do), -ENOMEM if out of memory
+ */
+int dm_arena_open(void);
+
+/**
+ * dm_arena_close() - Stop using the newest arena for new allocations
+ *
+ * The data already allocated remains valid until dm_arena_release().
+ */
+void dm_arena_close(void);
+
+/**
+ * dm_arena_release() - Free all arenas
+ *
+ * Anything allocated from an arena must no longer be in use.
+ */
+void dm_arena_release(void);
+
+/**
+ * dm_arena_calloc() - Allocate zeroed memory for bind-time data
+ *
+ * This uses the open arena if there is one and the memory fits, otherwise
+ * calloc().
+ *
+ * @size: Number of bytes to allocate
+ * @return pointer to memory, or NULL if out of memory
+ */
+void *dm_arena_calloc(size_t size);
+
+/**
+ * dm_arena_free() - Free memory from dm_arena_calloc()
+ *
+ * @ptr: Memory to free (ignored if NULL or in an arena)
+ */
+void dm_arena_free(void *ptr);
+
+/**
+ * dm_arena_contains() - Check whether memory is in an arena
+ *
+ * @ptr: Pointer to check
+ * @return true if @ptr is inside one of the arenas
+ */
+bool dm_arena_contains(const void *ptr);
+
+/* Show the size and usage of each arena */
+void dm_dump_arena(void);
+#else
+static inline int dm_arena_open(void)
+{
+	return 0;
+}
+
+static inline void dm_arena_close(void)
+{
+}
+
+static inline void dm_arena_release(void)
+{
+}
+
+static inline void *dm_arena_calloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+static inline void dm_arena_free(void *ptr)
+{
+	free(ptr);
+}
+
+static inline bool dm_arena_contains(const void *ptr)
+{
+	return false;
+}
+
+static inline void dm_dump_arena(void)
+{
+}
+#endif
+
+#endif
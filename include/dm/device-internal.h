@@ -94,6 +94,35 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_start() - Probe a device, starting slow initialisation early
+ *
+ * This probes the device and then calls its uclass' probe_start() method, if
+ * any, to start initialisation which takes a long time, such as waiting for
+ * an MMC card to power up. It does not wait for this to finish, so other
+ * devices can be set up in the meantime. The next call to device_probe()
+ * for the device (e.g. from uclass_get_device()) waits for it, using
+ * device_probe_complete().
+ *
+ * If the device is already active this does nothing.
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if OK, -ve on error
+ */
+int device_probe_start(struct udevice *dev);
+
+/**
+ * device_probe_complete() - Finish probing a device
+ *
+ * If the device was probed with device_probe_start() and is still pending,
+ * this calls its uclass' probe_complete() method to wait for initialisation
+ * to finish. If that fails, the device is removed.
+ *
+ * @dev: Pointer to device to complete
+ * @return 0 if OK (or nothing was pending), -ve on error
+ */
+int device_probe_complete(struct udevice *dev);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
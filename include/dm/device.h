@@ -66,6 +66,12 @@ struct driver_info;
 /* DM does not enable the power domain of the device */
 #define DM_FLAG_DEFAULT_PD_EN_OFF	(1 << 11)
 
+/*
+ * Device was probed by device_probe_start() and its uclass has not yet
+ * completed the slow part of its initialisation
+ */
+#define DM_FLAG_PROBE_PENDING		(1 << 12)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
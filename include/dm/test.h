@@ -48,6 +48,8 @@ enum {
 	DM_TEST_OP_PRE_REMOVE,
 	DM_TEST_OP_INIT,
 	DM_TEST_OP_DESTROY,
+	DM_TEST_OP_PROBE_START,
+	DM_TEST_OP_PROBE_COMPLETE,
 
 	DM_TEST_OP_COUNT,
 };
@@ -142,6 +144,7 @@ struct dm_test_state {
 	struct udevice *testdev;
 	int force_fail_alloc;
 	int skip_post_probe;
+	int fail_probe_complete;
 	struct udevice *removed;
 };
 
@@ -60,6 +60,13 @@ struct udevice;
  * @pre_probe: Called before a new device is probed
  * @post_probe: Called after a new device is probed
  * @pre_remove: Called before a device is removed
+ * @probe_start: Called by device_probe_start() after a device is probed, to
+ * start any slow hardware initialisation (such as waiting for a card to
+ * power up) without waiting for it to finish. Not called by device_probe().
+ * @probe_complete: Called to wait for the initialisation started by
+ * @probe_start to finish. This happens when the device is first needed, i.e.
+ * the next time device_probe() is called for it, so that uclass_get_device()
+ * and friends return a fully initialised device.
  * @child_post_bind: Called after a child is bound to a device in this uclass
  * @child_pre_probe: Called before a child in this uclass is probed
  * @child_post_probe: Called after a child in this uclass is probed
@@ -93,6 +100,8 @@ struct uclass_driver {
 	int (*pre_probe)(struct udevice *dev);
 	int (*post_probe)(struct udevice *dev);
 	int (*pre_remove)(struct udevice *dev);
+	int (*probe_start)(struct udevice *dev);
+	int (*probe_complete)(struct udevice *dev);
 	int (*child_post_bind)(struct udevice *dev);
 	int (*child_pre_probe)(struct udevice *dev);
 	int (*child_post_probe)(struct udevice *dev);
@@ -123,6 +123,33 @@ struct dma_ops {
 	 */
 	int (*transfer)(struct udevice *dev, int direction, void *dst,
 			void *src, size_t len);
+	/**
+	 * transfer_start() - Start a DMA transfer, without waiting for it.
+	 *   Transfers must complete in the order in which they were
+	 *   started. If no more can be queued, the implementation may wait
+	 *   for the oldest one.
+	 *
+	 * @dev: The DMA device
+	 * @direction: direction of data transfer (should be one from
+	 *   enum dma_direction)
+	 * @dst: The destination pointer.
+	 * @src: The source pointer.
+	 * @len: Length of the data to be copied (number of bytes).
+	 * @cookiep: Returns a value identifying the transfer, to pass to
+	 *   transfer_wait()
+	 * @return zero on success, or -ve error code.
+	 */
+	int (*transfer_start)(struct udevice *dev, int direction, void *dst,
+			      void *src, size_t len, ulong *cookiep);
+	/**
+	 * transfer_wait() - Wait for a transfer started by transfer_start(),
+	 *   and any started before it, to complete.
+	 *
+	 * @dev: The DMA device
+	 * @cookie: Value returned by transfer_start()
+	 * @return zero on success, or -ve error code.
+	 */
+	int (*transfer_wait)(struct udevice *dev, ulong cookie);
 };
 
 #endif /* _DMA_UCLASS_H */
@@ -10,6 +10,7 @@
 #define _DMA_H_
 
 #include <linux/errno.h>
+#include <linux/string.h>
 #include <linux/types.h>
 
 /*
@@ -327,4 +328,68 @@ static inline int dma_memcpy(void *dst, void *src, size_t len)
 }
 #endif
 
+/**
+ * struct dma_copy - a copy started by dma_memcpy_start()
+ *
+ * @dev: DMA device doing the copy, or NULL if it is already complete
+ * @dst: destination pointer
+ * @len: data length being copied
+ * @cookie: driver's value identifying the transfer
+ */
+struct dma_copy {
+	struct udevice *dev;
+	void *dst;
+	size_t len;
+	ulong cookie;
+};
+
+#if CONFIG_IS_ENABLED(DMA)
+/*
+ * dma_memcpy_start - start a mem copy, without waiting for it to finish
+ *
+ * The copy is done by a DMA device which supports DMA_MEM_TO_MEM and can
+ * queue transfers. If there is none, a device which can only do a whole
+ * transfer is used, or failing that the CPU, and the copy is complete when
+ * this returns. Copies started on a device complete in the order in which
+ * they were started.
+ *
+ * Until dma_memcpy_wait() returns, the CPU must not use the destination or
+ * change the source. The destination is invalidated in the data cache, so
+ * if it is not aligned to ARCH_DMA_MINALIGN, the CPU must not write to the
+ * rest of the cache lines at either end of it until then either.
+ *
+ * @copy - returns information about the copy, for dma_memcpy_wait()
+ * @dst - destination pointer
+ * @src - souce pointer
+ * @len - data length to be copied
+ * @return - 0 if the copy was started (or done), -ve error code on failure
+ */
+int dma_memcpy_start(struct dma_copy *copy, void *dst, void *src, size_t len);
+
+/*
+ * dma_memcpy_wait - wait for a copy started by dma_memcpy_start()
+ *
+ * This also waits for any copies started on the same device before it. It
+ * does nothing if the copy is already complete, so may be called again.
+ *
+ * @copy - copy to wait for
+ * @return - 0 if ok, -ve error code if the transfer failed
+ */
+int dma_memcpy_wait(struct dma_copy *copy);
+#else
+static inline int dma_memcpy_start(struct dma_copy *copy, void *dst,
+				   void *src, size_t len)
+{
+	copy->dev = NULL;
+	memcpy(dst, src, len);
+
+	return 0;
+}
+
+static inline int dma_memcpy_wait(struct dma_copy *copy)
+{
+	return 0;
+}
+#endif
+
 #endif	/* _DMA_H_ */
@@ -151,6 +151,11 @@ int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 disk_partition_t *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		   loff_t *actread);
+struct fs_file;
+int ext4fs_open_file(const char *filename, struct fs_file **filep);
+int ext4fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		 loff_t *actread);
+void ext4fs_close_file(struct fs_file *file);
 int ext4_read_superblock(char *buffer);
 int ext4fs_uuid(char *uuid_str);
 #endif
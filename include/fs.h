@@ -37,6 +37,14 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype);
  */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
 
+/**
+ * fs_probe_cache_stats() - Read the statistics for the filesystem-type cache
+ *
+ * @hitsp: Returns the number of partitions found from the cached type
+ * @missesp: Returns the number of searches across all filesystem types
+ */
+void fs_probe_cache_stats(uint *hitsp, uint *missesp);
+
 /**
  * fs_get_type_name() - Get type of current filesystem
  *
@@ -99,6 +107,69 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite);
 
+struct fs_mount;
+
+/*
+ * An open file, returned by fs_open(). Filesystems which can read a file
+ * without looking up its path each time embed this in their own structure.
+ *
+ * Note: fs_file should be treated as opaque to the user of fs layer
+ */
+struct fs_file {
+	/* private to fs layer: */
+	struct fs_mount *mount;
+	char *name;
+	/* set by the filesystem when the file is opened: */
+	loff_t size;
+};
+
+/*
+ * fs_open - Open a file on the partition previously set by fs_set_blk_dev()
+ *
+ * The filesystem stays mounted, and the file's directory entry or inode is
+ * kept, until fs_close() is called. Each fs_pread() can then go straight to
+ * the file's data, so reading a file in small pieces is not much slower
+ * than reading it in one go. As with the other calls, fs_set_blk_dev() is
+ * needed again before the next call which takes a path.
+ *
+ * A file must not be written with fs_write() while it is open.
+ *
+ * @filename: Name of file to open
+ * @filep: Returns the open file
+ * @return 0 if ok, -ENOENT if not found, other -ve value on error
+ */
+int fs_open(const char *filename, struct fs_file **filep);
+
+/*
+ * fs_pread - Read part of a file opened by fs_open()
+ *
+ * @file: File to read from
+ * @buf: Buffer to read into
+ * @offset: The offset in file to read from
+ * @len: The number of bytes to read. Reading stops at the end of the file
+ * @actread: Returns the actual number of bytes read
+ * @return 0 if ok with valid *actread, -ve on error
+ */
+int fs_pread(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+	     loff_t *actread);
+
+/*
+ * fs_file_size - Get the size of a file opened by fs_open()
+ *
+ * @file: Open file
+ * @return size of file in bytes
+ */
+loff_t fs_file_size(struct fs_file *file);
+
+/*
+ * fs_close - Close a file opened by fs_open()
+ *
+ * The filesystem is unmounted when the last file on it is closed.
+ *
+ * @file: File to close (may be NULL)
+ */
+void fs_close(struct fs_file *file);
+
 /*
  * Directory entry types, matches the subset of DT_x in posix readdir()
  * which apply to u-boot.
@@ -23,6 +23,16 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: erase whole groups of erase_grp blocks, leaving them
+	 * reading back as zeroes. This is used in place of writing zero-filled
+	 * chunks, and to discard don't-care chunks.
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	lbaint_t	erase_grp;
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -8,6 +8,63 @@
 
 typedef int (*init_fnc_t)(void);
 
-int initcall_run_list(const init_fnc_t init_sequence[]);
+/**
+ * struct initcall - an entry in an init sequence
+ *
+ * Entries are normally created with INITCALL(). A slow piece of hardware
+ * set-up which does not need to finish straight away can be split into a
+ * function which starts it and one which waits for it to complete, using
+ * INITCALL_SPLIT() to run the first and INITCALL_WAIT() to run the second
+ * at the point where the result is first needed. Initcalls in between run
+ * while the hardware is busy.
+ *
+ * @func:	Function to call, or NULL for an INITCALL_WAIT() entry
+ * @complete:	Function which completes the work started by @func, or NULL
+ *		if @func does all the work
+ * @name:	Name of @func (or of @complete if @func is NULL), used to name
+ *		the bootstage record for this entry
+ */
+struct initcall {
+	init_fnc_t func;
+	init_fnc_t complete;
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+	const char *name;
+#endif
+};
+
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+#define INITCALL_ENTRY(_func, _complete, _name) \
+	{ .func = _func, .complete = _complete, .name = _name }
+#else
+#define INITCALL_ENTRY(_func, _complete, _name) \
+	{ .func = _func, .complete = _complete }
+#endif
+
+/* Call @_func and stop the sequence if it fails */
+#define INITCALL(_func)		INITCALL_ENTRY(_func, NULL, #_func)
+
+/*
+ * Call @_start, then run the following entries until an INITCALL_WAIT() for
+ * @_complete is reached
+ */
+#define INITCALL_SPLIT(_start, _complete) \
+	INITCALL_ENTRY(_start, _complete, #_start)
+
+/* Call @_complete, if the INITCALL_SPLIT() which started it has run */
+#define INITCALL_WAIT(_complete) INITCALL_ENTRY(NULL, _complete, #_complete)
+
+/* Marks the end of an init sequence which returns */
+#define INITCALL_END		INITCALL_ENTRY(NULL, NULL, NULL)
+
+/**
+ * initcall_run_list() - Run each function in an init sequence
+ *
+ * If CONFIG_BOOTSTAGE_INITCALL is enabled, a bootstage record is added after
+ * each entry, so that 'bootstage report' shows how long each one took.
+ *
+ * @init_sequence: Sequence to run, ending with INITCALL_END
+ * @return 0 if OK, -1 if any function failed
+ */
+int initcall_run_list(const struct initcall init_sequence[]);
 
 #endif
@@ -251,6 +251,7 @@ enum spi_nor_option_flags {
 	SNOR_F_READY_XSR_RDY	= BIT(4),
 	SNOR_F_USE_CLSR		= BIT(5),
 	SNOR_F_BROKEN_RESET	= BIT(6),
+	SNOR_F_4B_OPCODES	= BIT(7),
 };
 
 enum spi_nor_mode {
@@ -280,6 +281,9 @@ struct flash_info;
  * @page_size:		the page size of the SPI NOR
  * @addr_width:		number of address bytes
  * @erase_opcode:	the opcode for erasing a sector
+ * @block_erase_opcode:	the opcode for erasing a block of several sectors at
+ *			once, or 0 if not available
+ * @block_erase_size:	the size of the block erased by @block_erase_opcode
  * @read_opcode:	the read opcode
  * @read_dummy:		the dummy needed by the read operation
  * @program_opcode:	the program opcode
@@ -318,6 +322,8 @@ struct spi_nor {
 	u32			page_size;
 	u8			addr_width;
 	u8			erase_opcode;
+	u8			block_erase_opcode;
+	u32			block_erase_size;
 	u8			read_opcode;
 	u8			read_dummy;
 	u8			program_opcode;
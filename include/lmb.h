@@ -10,6 +10,7 @@
  * Copyright (C) 2001 Peter Bergner, IBM Corp.
  */
 
+/* Number of regions held in struct lmb_region itself, before it grows */
 #define MAX_LMB_REGIONS 8
 
 struct lmb_property {
@@ -17,20 +18,42 @@ struct lmb_property {
 	phys_size_t size;
 };
 
+/*
+ * Regions are kept sorted by base address. They do not overlap or touch,
+ * since such regions are merged when they are added. Once @initial is
+ * full, @region moves to a larger array from malloc().
+ */
 struct lmb_region {
 	unsigned long cnt;
+	unsigned long max;
 	phys_size_t size;
-	struct lmb_property region[MAX_LMB_REGIONS+1];
+	struct lmb_property *region;
+	struct lmb_property initial[MAX_LMB_REGIONS];
+};
+
+/*
+ * How lmb_alloc() and lmb_alloc_base() place an allocation in free memory:
+ *
+ * LMB_ALLOC_TOP_DOWN:	at the highest address possible
+ * LMB_ALLOC_FIRST_FIT:	at the lowest address possible
+ * LMB_ALLOC_BEST_FIT:	at the bottom of the smallest free area it fits in
+ */
+enum lmb_alloc_policy {
+	LMB_ALLOC_TOP_DOWN,
+	LMB_ALLOC_FIRST_FIT,
+	LMB_ALLOC_BEST_FIT,
 };
 
 struct lmb {
 	struct lmb_region memory;
 	struct lmb_region reserved;
+	enum lmb_alloc_policy policy;
 };
 
 extern struct lmb lmb;
 
 extern void lmb_init(struct lmb *lmb);
+extern void lmb_release(struct lmb *lmb);
 extern long lmb_add(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 extern long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 extern phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align);
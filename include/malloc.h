@@ -958,6 +958,82 @@ extern ulong mem_malloc_brk;
 
 void mem_malloc_init(ulong start, ulong size);
 
+/**
+ * malloc_fastbins_enable() - Enable or disable the malloc() fast bins
+ *
+ * Disabling the fast bins merges the chunks in them back into the heap.
+ * This is mostly useful for comparing performance.
+ *
+ * @enable: true to keep small freed chunks in fast bins for reuse
+ */
+void malloc_fastbins_enable(bool enable);
+
+/* Functions counted in struct malloc_heap_stats */
+enum malloc_op {
+	MALLOC_OP_MALLOC,
+	MALLOC_OP_CALLOC,
+	MALLOC_OP_REALLOC,
+	MALLOC_OP_MEMALIGN,
+	MALLOC_OP_FREE,
+
+	MALLOC_OP_COUNT,
+};
+
+/* Number of request-size classes in struct malloc_heap_stats */
+#define MALLOC_HIST_COUNT	16
+
+/**
+ * struct malloc_heap_stats - Statistics about use of the malloc() heap
+ *
+ * Sizes include the malloc() overhead for each chunk.
+ *
+ * @calls: Number of calls to each function, indexed by enum malloc_op
+ * @ticks: Timer ticks spent in each function, indexed by enum malloc_op
+ * @failures: Number of allocations which returned NULL
+ * @fast_hits: Number of allocations taken from a fast bin
+ * @in_use: Number of bytes allocated and not yet freed
+ * @peak: Largest value of @in_use since the statistics were reset
+ * @hist: Number of allocations of each size: entry n counts requests for up
+ *	to 16 << n bytes, except that the last entry counts all larger ones
+ * @heap_size: Number of bytes taken from the heap region with sbrk()
+ * @heap_peak: Largest value of @heap_size
+ * @top_size: Number of bytes in the free chunk at the top of the heap
+ * @free_bytes: Number of bytes in free chunks, including the top chunk
+ * @free_chunks: Number of free chunks, including the top chunk
+ * @largest_free: Size of the largest free chunk
+ */
+struct malloc_heap_stats {
+	ulong calls[MALLOC_OP_COUNT];
+	u64 ticks[MALLOC_OP_COUNT];
+	ulong failures;
+	ulong fast_hits;
+	ulong in_use;
+	ulong peak;
+	ulong hist[MALLOC_HIST_COUNT];
+	ulong heap_size;
+	ulong heap_peak;
+	ulong top_size;
+	ulong free_bytes;
+	ulong free_chunks;
+	ulong largest_free;
+};
+
+/**
+ * malloc_get_stats() - Get statistics about the malloc() heap
+ *
+ * This walks the free lists, so takes a little time with a fragmented heap.
+ *
+ * @stats: Returns the statistics
+ */
+void malloc_get_stats(struct malloc_heap_stats *stats);
+
+/**
+ * malloc_reset_stats() - Reset the malloc() call counts and peak use
+ *
+ * This allows the allocations made by a single operation to be measured.
+ */
+void malloc_reset_stats(void);
+
 #ifdef __cplusplus
 };  /* end of extern "C" */
 #endif
@@ -364,4 +364,53 @@ int os_write_file(const char *name, const void *buf, int size);
  */
 int os_read_file(const char *name, void **bufp, int *sizep);
 
+/**
+ * os_map_file() - Map a whole file into memory for reading
+ *
+ * The mapping is shared, so later writes to the file through @fd are visible
+ * in it.
+ *
+ * @fd:		File descriptor to map
+ * @bufp:	Returns a pointer to the mapped data
+ * @sizep:	Returns the size of the mapping, i.e. of the file
+ * @return 0 if OK, -ve on error (an empty file cannot be mapped)
+ */
+int os_map_file(int fd, void **bufp, size_t *sizep);
+
+/**
+ * os_unmap() - Unmap a file previously mapped with os_map_file()
+ *
+ * @buf:	Pointer returned by os_map_file()
+ * @size:	Size returned by os_map_file()
+ * @return 0 if OK, -ve on error
+ */
+int os_unmap(void *buf, size_t size);
+
+/**
+ * os_thread_start() - Run a function in a new host thread
+ *
+ * The function must not call back into U-Boot code which uses global state,
+ * since nothing there is thread-safe.
+ *
+ * @threadp:	Returns the thread, to pass to os_thread_join()
+ * @func:	Function to run
+ * @arg:	Argument to pass to @func
+ * @return 0 if OK, -ve on error
+ */
+int os_thread_start(void **threadp, void (*func)(void *arg), void *arg);
+
+/**
+ * os_thread_join() - Wait for a thread started by os_thread_start() to finish
+ *
+ * @thread:	Thread to wait for
+ */
+void os_thread_join(void *thread);
+
+/**
+ * os_cpu_count() - Get the number of CPUs on the host
+ *
+ * @return number of CPUs online, at least 1
+ */
+int os_cpu_count(void);
+
 #endif
@@ -173,6 +173,12 @@ static inline void *spi_mem_get_drvdata(struct spi_mem *mem)
  *		    limitations)
  * @supports_op: check if an operation is supported by the controller
  * @exec_op: execute a SPI memory operation
+ * @calibrate: tune the controller for @op using known @calib_data
+ * @mmap: get the memory-mapped window through which CPU loads issue the read
+ *	  operation described by @op (@op->addr.val and @op->data are
+ *	  ignored). On success *@mapp points at flash offset 0 and *@sizep is
+ *	  the window size. The window is only valid while the bus is claimed.
+ *	  Return -ENOTSUPP if @op cannot be mapped.
  *
  * This interface should be implemented by SPI controllers providing an
  * high-level interface to execute SPI memory operation, which is usually the
@@ -186,6 +192,8 @@ struct spi_controller_mem_ops {
 		       const struct spi_mem_op *op);
 	int (*calibrate)(struct spi_slave *slave, struct spi_mem_op *op,
 			 void *calib_data, size_t size);
+	int (*mmap)(struct spi_slave *slave, const struct spi_mem_op *op,
+		    void **mapp, size_t *sizep);
 };
 
 #ifndef __UBOOT__
@@ -244,6 +252,8 @@ bool spi_mem_supports_op(struct spi_slave *slave, const struct spi_mem_op *op);
 
 int spi_mem_exec_op(struct spi_slave *slave, const struct spi_mem_op *op);
 
+int spi_mem_mmap_read(struct spi_slave *slave, const struct spi_mem_op *op);
+
 #ifndef __UBOOT__
 int spi_mem_driver_register_with_owner(struct spi_mem_driver *drv,
 				       struct module *owner);
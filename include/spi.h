@@ -446,6 +446,8 @@ struct dm_spi_ops {
 	int (*cs_info)(struct udevice *bus, uint cs, struct spi_cs_info *info);
 };
 
+struct spi_mem_op;
+
 struct dm_spi_emul_ops {
 	/**
 	 * SPI transfer
@@ -473,6 +475,23 @@ struct dm_spi_emul_ops {
 	 */
 	int (*xfer)(struct udevice *slave, unsigned int bitlen,
 		    const void *dout, void *din, unsigned long flags);
+
+	/**
+	 * Get a memory-mapped view of the emulated memory (optional)
+	 *
+	 * This lets the sandbox SPI controller offer a memory-mapped read
+	 * window, like QSPI controllers do on real hardware. The window is
+	 * used for a single read, @op, so that the emulation can account for
+	 * the time it would take on the bus.
+	 *
+	 * @dev:	Emulation device
+	 * @op:		Read operation which will use the window
+	 * @mapp:	Returns a pointer to offset 0 of the memory
+	 * @sizep:	Returns the size of the window in bytes
+	 * Returns: 0 on success, -ENOTSUPP if no window is available
+	 */
+	int (*map)(struct udevice *dev, const struct spi_mem_op *op,
+		   void **mapp, size_t *sizep);
 };
 
 /**
@@ -37,6 +37,14 @@ struct unit_test {
 	int flags;
 };
 
+/*
+ * Flags for unit tests. The bits below 8 are left for suites to define, as
+ * driver model does with DM_TESTF_...
+ */
+enum {
+	UT_TESTF_MANUAL		= 1 << 8,	/* only run when named */
+};
+
 /* Declare a new unit test */
 #define UNIT_TEST(_name, _flags, _suite)				\
 	ll_entry_declare(struct unit_test, _name, _suite) = {		\
@@ -28,6 +28,7 @@ enum {
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_TIMES,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -36,6 +37,14 @@ struct trace_output_func {
 	uint32_t call_count;		/* Number of times called */
 };
 
+/* Time spent in a function, as written to the profile output file */
+struct trace_output_time {
+	uint32_t offset;		/* Function offset into code */
+	uint32_t call_count;		/* Number of timed calls */
+	uint64_t incl_us;		/* Total time including callees */
+	uint64_t excl_us;		/* Total time excluding callees */
+};
+
 /* A header at the start of the trace output buffer */
 struct trace_output_hdr {
 	enum trace_chunk_type type;	/* Record type */
@@ -79,6 +88,32 @@ struct trace_call {
 
 int trace_list_calls(void *buff, int buff_size, unsigned int *needed);
 
+/**
+ * Dump the time spent in each function into a buffer
+ *
+ * Each record in the buffer is a struct trace_output_time, giving the total
+ * time spent in a function with and without the functions it calls. Only
+ * functions which have returned since tracing started are included. This
+ * needs CONFIG_TRACE_FUNC_TIMES.
+ *
+ * @param buff		Buffer in which to place data, or NULL to count size
+ * @param buff_size	Size of buffer
+ * @param needed	Returns number of bytes used / needed
+ * @return 0 if ok, -1 on error (buffer exhausted)
+ */
+int trace_list_times(void *buff, int buff_size, unsigned int *needed);
+
+/**
+ * Select what happens when the call-record buffer is full
+ *
+ * By default recording stops when the buffer is full, so the first calls
+ * are kept. In ring mode the oldest records are overwritten instead, so
+ * that the most recent calls are kept.
+ *
+ * @param ring		1 to overwrite the oldest records, 0 to stop
+ */
+void trace_set_ring(int ring);
+
 /**
  * Turn function tracing on and off
  *
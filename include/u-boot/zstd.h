@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Zstandard decompression
+ */
+
+#ifndef _U_BOOT_ZSTD_H
+#define _U_BOOT_ZSTD_H
+
+#include <linux/types.h>
+
+/**
+ * zstd_decompress() - decompress Zstandard data in memory
+ *
+ * All the frames in the input are decompressed, one after the other.
+ *
+ * @src:	Compressed data
+ * @srcn:	Size of compressed data
+ * @dst:	Buffer for the decompressed data
+ * @dstn:	On entry, size of @dst. On exit, number of bytes written
+ * @return 0 if OK, -ENOBUFS if @dst is too small, -ENOMEM if out of
+ *	memory, -EPROTONOSUPPORT if the data is not zstd, -EPROTO if it is
+ *	corrupt
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+struct zstd_stream;
+
+/**
+ * zstd_stream_new() - set up to decompress data which arrives in pieces
+ *
+ * The stream needs a buffer as large as the window used to compress the
+ * data, which is allocated once the frame header has been read.
+ *
+ * @return new stream, or NULL if out of memory
+ */
+struct zstd_stream *zstd_stream_new(void);
+
+/**
+ * zstd_stream_decompress() - decompress the next piece of a stream
+ *
+ * Decompresses as much of @src as possible into @dst. Call this again with
+ * the rest of the input, and more input, until it returns 1 or an error. Any
+ * input not used because @dst is full must be passed in again.
+ *
+ * @zs:		Stream to use
+ * @src:	Next piece of compressed data
+ * @srcn:	On entry, size of @src. On exit, number of bytes used
+ * @dst:	Buffer for the decompressed data
+ * @dstn:	On entry, size of @dst. On exit, number of bytes written
+ * @return 1 if a frame has been completed, 0 if more input or output space
+ *	is needed, -ve on error as for zstd_decompress()
+ */
+int zstd_stream_decompress(struct zstd_stream *zs, const void *src,
+			   size_t *srcn, void *dst, size_t *dstn);
+
+/**
+ * zstd_stream_free() - free a stream
+ *
+ * @zs:		Stream to free (may be NULL)
+ */
+void zstd_stream_free(struct zstd_stream *zs);
+
+#endif
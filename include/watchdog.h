@@ -21,8 +21,8 @@ int init_func_watchdog_reset(void);
 #endif
 
 #if defined(CONFIG_WATCHDOG) || defined(CONFIG_HW_WATCHDOG)
-#define INIT_FUNC_WATCHDOG_INIT	init_func_watchdog_init,
-#define INIT_FUNC_WATCHDOG_RESET	init_func_watchdog_reset,
+#define INIT_FUNC_WATCHDOG_INIT	INITCALL(init_func_watchdog_init),
+#define INIT_FUNC_WATCHDOG_RESET	INITCALL(init_func_watchdog_reset),
 #else
 #define INIT_FUNC_WATCHDOG_INIT
 #define INIT_FUNC_WATCHDOG_RESET
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Running independent pieces of work on the secondary CPUs
+ */
+
+#include <common.h>
+#include <cpu_work.h>
+
+/* The work run by one CPU: every step'th entry, starting from first */
+struct cpu_work_queue {
+	struct cpu_work *work;
+	int count;
+	int first;
+	int step;
+};
+
+__weak int arch_cpu_work_cpus(void)
+{
+	return 0;
+}
+
+__weak int arch_cpu_work_start(int cpu, void (*func)(void *arg), void *arg)
+{
+	return -ENOSYS;
+}
+
+__weak void arch_cpu_work_wait(int cpu)
+{
+}
+
+int cpu_work_cpus(void)
+{
+	return min(arch_cpu_work_cpus(), CONFIG_CPU_WORK_CPUS);
+}
+
+static void cpu_work_queue_run(void *arg)
+{
+	struct cpu_work_queue *queue = arg;
+	int i;
+
+	for (i = queue->first; i < queue->count; i += queue->step)
+		queue->work[i].func(queue->work[i].arg);
+}
+
+void cpu_work_run(struct cpu_work *work, int count)
+{
+	struct cpu_work_queue queue[CONFIG_CPU_WORK_CPUS + 1];
+	bool started[CONFIG_CPU_WORK_CPUS + 1];
+	int cpus, cpu;
+
+	cpus = min(cpu_work_cpus(), count - 1);
+	if (cpus < 0)
+		return;
+	for (cpu = 0; cpu <= cpus; cpu++) {
+		queue[cpu].work = work;
+		queue[cpu].count = count;
+		queue[cpu].first = cpu;
+		queue[cpu].step = cpus + 1;
+	}
+
+	for (cpu = 1; cpu <= cpus; cpu++) {
+		started[cpu] = !arch_cpu_work_start(cpu, cpu_work_queue_run,
+						    &queue[cpu]);
+	}
+
+	/* Do our own share, and that of any CPU which did not start */
+	cpu_work_queue_run(&queue[0]);
+	for (cpu = 1; cpu <= cpus; cpu++) {
+		if (!started[cpu])
+			cpu_work_queue_run(&queue[cpu]);
+	}
+	for (cpu = 1; cpu <= cpus; cpu++) {
+		if (started[cpu])
+			arch_cpu_work_wait(cpu);
+	}
+}
@@ -14,6 +14,23 @@
 
 const efi_guid_t efi_block_io_guid = BLOCK_IO_GUID;
 
+/**
+ * struct efi_disk_cache - blocks read ahead for an EFI disk
+ *
+ * @buf:	buffer holding the blocks, aligned for DMA
+ * @lba:	first block in the buffer
+ * @count:	number of blocks in the buffer, 0 if none
+ * @media_gen:	media_gen of the block device when the buffer was filled
+ * @next_lba:	block after the last one read, to spot sequential reads
+ */
+struct efi_disk_cache {
+	void *buf;
+	lbaint_t lba;
+	lbaint_t count;
+	uint media_gen;
+	lbaint_t next_lba;
+};
+
 /**
  * struct efi_disk_obj - EFI disk object
  *
@@ -27,6 +44,7 @@ const efi_guid_t efi_block_io_guid = BLOCK_IO_GUID;
  * @volume:	simple file system protocol of the partition
  * @offset:	offset into disk for simple partition
  * @desc:	internal block device descriptor
+ * @cache:	blocks read ahead
  */
 struct efi_disk_obj {
 	struct efi_object header;
@@ -39,6 +57,7 @@ struct efi_disk_obj {
 	struct efi_simple_file_system_protocol *volume;
 	lbaint_t offset;
 	struct blk_desc *desc;
+	struct efi_disk_cache cache;
 };
 
 static efi_status_t EFIAPI efi_disk_reset(struct efi_block_io *this,
@@ -53,6 +72,88 @@ enum efi_disk_direction {
 	EFI_DISK_WRITE,
 };
 
+/**
+ * efi_disk_read() - read blocks, using the read-ahead buffer
+ *
+ * Reads which carry on from the previous one fill the buffer with
+ * CONFIG_EFI_DISK_READAHEAD_SIZE bytes. Blocks which are in the buffer are
+ * copied from there, as long as nothing has been written to the device
+ * since it was filled. Large reads into a buffer aligned for DMA go
+ * straight to the device. Otherwise the read goes through the buffer, so
+ * that the block driver does not have to bounce it.
+ *
+ * @diskobj:	disk to read from
+ * @lba:	first block to read, from the start of the device
+ * @blocks:	number of blocks to read
+ * @buffer:	buffer to read into
+ * Return:	number of blocks read
+ */
+static lbaint_t efi_disk_read(struct efi_disk_obj *diskobj, lbaint_t lba,
+			      lbaint_t blocks, void *buffer)
+{
+	struct efi_disk_cache *cache = &diskobj->cache;
+	struct blk_desc *desc = diskobj->desc;
+	lbaint_t ra_blocks = CONFIG_EFI_DISK_READAHEAD_SIZE / desc->blksz;
+	lbaint_t done = 0;
+	bool sequential, accessed = false;
+
+	if (ra_blocks && !cache->buf)
+		cache->buf = memalign(ARCH_DMA_MINALIGN,
+				      ra_blocks * desc->blksz);
+	if (!cache->buf) {
+		done = blk_dread(desc, lba, blocks, buffer);
+		efi_timer_check();
+		return done;
+	}
+
+	if (cache->media_gen != desc->media_gen)
+		cache->count = 0;
+	sequential = lba == cache->next_lba ||
+		     (cache->count && lba == cache->lba + cache->count);
+	cache->next_lba = lba + blocks;
+
+	while (done < blocks) {
+		lbaint_t left = blocks - done;
+		void *dst = buffer + done * desc->blksz;
+		lbaint_t n;
+
+		if (lba >= cache->lba && lba < cache->lba + cache->count) {
+			n = min(left, cache->lba + cache->count - lba);
+			memcpy(dst, cache->buf + (lba - cache->lba) *
+			       desc->blksz, n * desc->blksz);
+		} else if (left >= ra_blocks &&
+			   IS_ALIGNED((ulong)dst, ARCH_DMA_MINALIGN)) {
+			done += blk_dread(desc, lba, left, dst);
+			accessed = true;
+			break;
+		} else {
+			n = min(left, ra_blocks);
+			/* Read ahead only if it stays on the device */
+			if (sequential && lba + ra_blocks <= desc->lba)
+				n = ra_blocks;
+			cache->count = 0;
+			accessed = true;
+			if (blk_dread(desc, lba, n, cache->buf) != n)
+				break;
+			cache->lba = lba;
+			cache->count = n;
+			cache->media_gen = desc->media_gen;
+			continue;
+		}
+		lba += n;
+		done += n;
+	}
+
+	/*
+	 * We don't do interrupts, so check for timers cooperatively. Reads
+	 * from the buffer are too quick to need it.
+	 */
+	if (accessed)
+		efi_timer_check();
+
+	return done;
+}
+
 static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
 			u32 media_id, u64 lba, unsigned long buffer_size,
 			void *buffer, enum efi_disk_direction direction)
@@ -76,13 +177,14 @@ static efi_status_t efi_disk_rw_blocks(struct efi_block_io *this,
 	if (buffer_size & (blksz - 1))
 		return EFI_DEVICE_ERROR;
 
-	if (direction == EFI_DISK_READ)
-		n = blk_dread(desc, lba, blocks, buffer);
-	else
+	if (direction == EFI_DISK_READ) {
+		n = efi_disk_read(diskobj, lba, blocks, buffer);
+	} else {
 		n = blk_dwrite(desc, lba, blocks, buffer);
 
-	/* We don't do interrupts, so check for timers cooperatively */
-	efi_timer_check();
+		/* We don't do interrupts, so check for timers cooperatively */
+		efi_timer_check();
+	}
 
 	debug("EFI: %s:%d n=%lx blocks=%x\n", __func__, __LINE__, n, blocks);
 
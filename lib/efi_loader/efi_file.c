@@ -29,6 +29,9 @@ struct file_handle {
 	loff_t offset;       /* current file position/cursor */
 	int isdir;
 
+	/* for reading a file, opened on the first read: */
+	struct fs_file *file;
+
 	/* for reading a directory: */
 	struct fs_dir_stream *dirs;
 	struct fs_dirent *dent;
@@ -52,6 +55,52 @@ static int set_blk_dev(struct file_handle *fh)
 	return fs_set_blk_dev_with_part(fh->fs->desc, fh->fs->part);
 }
 
+/**
+ * open_file() - open the file for reading, if not already open
+ *
+ * This keeps the filesystem mounted and the file looked up, so that reading
+ * a file in small pieces does not probe the filesystem and walk the path for
+ * each piece.
+ *
+ * @fh:		file handle
+ * Return:	0 if OK, -ve on error
+ */
+static int open_file(struct file_handle *fh)
+{
+	if (fh->file)
+		return 0;
+	if (set_blk_dev(fh))
+		return -ENODEV;
+
+	return fs_open(fh->path, &fh->file);
+}
+
+/**
+ * file_size() - get the size of a file
+ *
+ * @fh:		file handle
+ * @size:	returns the size of the file, 0 for a directory
+ * Return:	0 if OK, -ve on error
+ */
+static int file_size(struct file_handle *fh, loff_t *size)
+{
+	if (!fh->isdir && !open_file(fh)) {
+		*size = fs_file_size(fh->file);
+		return 0;
+	}
+	if (set_blk_dev(fh))
+		return -ENODEV;
+
+	return fs_size(fh->path, size);
+}
+
+/* Close the file after writing it, so the next read sees the changes */
+static void close_file(struct file_handle *fh)
+{
+	fs_close(fh->file);
+	fh->file = NULL;
+}
+
 /**
  * is_dir() - check if file handle points to directory
  *
@@ -263,6 +312,7 @@ out:
 
 static efi_status_t file_close(struct file_handle *fh)
 {
+	close_file(fh);
 	fs_closedir(fh->dirs);
 	free(fh);
 	return EFI_SUCCESS;
@@ -282,6 +332,7 @@ static efi_status_t EFIAPI efi_file_delete(struct efi_file_handle *file)
 
 	EFI_ENTRY("%p", file);
 
+	close_file(fh);
 	if (set_blk_dev(fh)) {
 		ret = EFI_DEVICE_ERROR;
 		goto error;
@@ -300,8 +351,8 @@ static efi_status_t file_read(struct file_handle *fh, u64 *buffer_size,
 {
 	loff_t actread;
 
-	if (fs_read(fh->path, map_to_sysmem(buffer), fh->offset,
-		    *buffer_size, &actread))
+	if (open_file(fh) ||
+	    fs_pread(fh->file, buffer, fh->offset, *buffer_size, &actread))
 		return EFI_DEVICE_ERROR;
 
 	*buffer_size = actread;
@@ -319,6 +370,8 @@ static efi_status_t dir_read(struct file_handle *fh, u64 *buffer_size,
 
 	if (!fh->dirs) {
 		assert(fh->offset == 0);
+		if (set_blk_dev(fh))
+			return EFI_DEVICE_ERROR;
 		fh->dirs = fs_opendir(fh->path);
 		if (!fh->dirs)
 			return EFI_DEVICE_ERROR;
@@ -396,11 +449,6 @@ static efi_status_t EFIAPI efi_file_read(struct efi_file_handle *file,
 		goto error;
 	}
 
-	if (set_blk_dev(fh)) {
-		ret = EFI_DEVICE_ERROR;
-		goto error;
-	}
-
 	bs = *buffer_size;
 	if (fh->isdir)
 		ret = dir_read(fh, &bs, buffer);
@@ -425,6 +473,7 @@ static efi_status_t EFIAPI efi_file_write(struct efi_file_handle *file,
 
 	EFI_ENTRY("%p, %p, %p", file, buffer_size, buffer);
 
+	close_file(fh);
 	if (set_blk_dev(fh)) {
 		ret = EFI_DEVICE_ERROR;
 		goto error;
@@ -499,19 +548,14 @@ static efi_status_t EFIAPI efi_file_setpos(struct efi_file_handle *file,
 	}
 
 	if (pos == ~0ULL) {
-		loff_t file_size;
-
-		if (set_blk_dev(fh)) {
-			ret = EFI_DEVICE_ERROR;
-			goto error;
-		}
+		loff_t size;
 
-		if (fs_size(fh->path, &file_size)) {
+		if (file_size(fh, &size)) {
 			ret = EFI_DEVICE_ERROR;
 			goto error;
 		}
 
-		pos = file_size;
+		pos = size;
 	}
 
 	fh->offset = pos;
@@ -534,7 +578,7 @@ static efi_status_t EFIAPI efi_file_getinfo(struct efi_file_handle *file,
 		struct efi_file_info *info = buffer;
 		char *filename = basename(fh);
 		unsigned int required_size;
-		loff_t file_size;
+		loff_t size;
 
 		/* check buffer size: */
 		required_size = sizeof(*info) + 2 * (strlen(filename) + 1);
@@ -544,12 +588,7 @@ static efi_status_t EFIAPI efi_file_getinfo(struct efi_file_handle *file,
 			goto error;
 		}
 
-		if (set_blk_dev(fh)) {
-			ret = EFI_DEVICE_ERROR;
-			goto error;
-		}
-
-		if (fs_size(fh->path, &file_size)) {
+		if (file_size(fh, &size)) {
 			ret = EFI_DEVICE_ERROR;
 			goto error;
 		}
@@ -557,8 +596,8 @@ static efi_status_t EFIAPI efi_file_getinfo(struct efi_file_handle *file,
 		memset(info, 0, required_size);
 
 		info->size = required_size;
-		info->file_size = file_size;
-		info->physical_size = file_size;
+		info->file_size = size;
+		info->physical_size = size;
 
 		if (fh->isdir)
 			info->attribute |= EFI_FILE_DIRECTORY;
@@ -10,24 +10,33 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <watchdog.h>
-#include <linux/list_sort.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
 efi_uintn_t efi_memory_map_key;
 
+/**
+ * struct efi_mem_list - memory map entry
+ *
+ * @node:		node in the efi_mem tree, ordered by address
+ * @desc:		memory descriptor
+ * @max_free_pages:	largest number of free pages described by this
+ *			entry or any entry below it in the tree
+ */
 struct efi_mem_list {
-	struct list_head link;
+	struct rb_node node;
 	struct efi_mem_desc desc;
+	u64 max_free_pages;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
-
-/* This list contains all memory map items */
-LIST_HEAD(efi_mem);
+/*
+ * This tree contains all memory map items. They never overlap, and
+ * adjacent items of the same type and attributes are merged.
+ */
+static struct rb_root efi_mem = RB_ROOT;
+static int efi_mem_count;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -46,163 +55,221 @@ struct efi_pool_allocation {
 	char data[] __aligned(ARCH_DMA_MINALIGN);
 };
 
-/*
- * Sorts the memory list from highest address to lowest address
- *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
- */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
+static uint64_t desc_get_end(struct efi_mem_desc *desc)
 {
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
+	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
+}
 
-	if (mema->desc.physical_start == memb->desc.physical_start)
+static u64 efi_mem_free_pages(struct efi_mem_list *mem)
+{
+	if (mem->desc.type != EFI_CONVENTIONAL_MEMORY)
 		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
+
+	return mem->desc.num_pages;
 }
 
-static uint64_t desc_get_end(struct efi_mem_desc *desc)
+static u64 efi_mem_compute_max(struct efi_mem_list *mem)
 {
-	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
+	u64 max_pages = efi_mem_free_pages(mem);
+	struct efi_mem_list *child;
+
+	if (mem->node.rb_left) {
+		child = rb_entry(mem->node.rb_left, struct efi_mem_list, node);
+		max_pages = max(max_pages, child->max_free_pages);
+	}
+	if (mem->node.rb_right) {
+		child = rb_entry(mem->node.rb_right, struct efi_mem_list, node);
+		max_pages = max(max_pages, child->max_free_pages);
+	}
+
+	return max_pages;
 }
 
-static void efi_mem_sort(void)
+RB_DECLARE_CALLBACKS(static, efi_mem_augment, struct efi_mem_list, node, u64,
+		     max_free_pages, efi_mem_compute_max)
+
+static struct efi_mem_list *efi_mem_next(struct efi_mem_list *mem)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
-
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
-
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
+	return rb_entry_safe(rb_next(&mem->node), struct efi_mem_list, node);
+}
 
-			cur = &lmem->desc;
+static struct efi_mem_list *efi_mem_prev(struct efi_mem_list *mem)
+{
+	return rb_entry_safe(rb_prev(&mem->node), struct efi_mem_list, node);
+}
 
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
+/**
+ * efi_mem_find() - find a memory map entry by address
+ *
+ * @addr:	address to look for
+ * Return:	the entry containing @addr, else the first entry above it, or
+ *		NULL if there is none
+ */
+static struct efi_mem_list *efi_mem_find(u64 addr)
+{
+	struct rb_node *node = efi_mem.rb_node;
+	struct efi_mem_list *found = NULL;
 
-				merge_again = true;
-				break;
-			}
+	while (node) {
+		struct efi_mem_list *mem;
 
-			prevmem = lmem;
+		mem = rb_entry(node, struct efi_mem_list, node);
+		if (addr < desc_get_end(&mem->desc)) {
+			found = mem;
+			if (addr >= mem->desc.physical_start)
+				break;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
 		}
 	}
+
+	return found;
 }
 
-/** efi_mem_carve_out - unmap memory region
+static void efi_mem_insert(struct efi_mem_list *newmem)
+{
+	struct rb_node **link = &efi_mem.rb_node, *parent = NULL;
+	u64 start = newmem->desc.physical_start;
+
+	newmem->max_free_pages = efi_mem_free_pages(newmem);
+	while (*link) {
+		struct efi_mem_list *mem;
+
+		parent = *link;
+		mem = rb_entry(parent, struct efi_mem_list, node);
+		if (mem->max_free_pages < newmem->max_free_pages)
+			mem->max_free_pages = newmem->max_free_pages;
+		if (start < mem->desc.physical_start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	rb_link_node(&newmem->node, parent, link);
+	rb_insert_augmented(&newmem->node, &efi_mem, &efi_mem_augment);
+	efi_mem_count++;
+}
+
+static void efi_mem_remove(struct efi_mem_list *mem)
+{
+	rb_erase_augmented(&mem->node, &efi_mem, &efi_mem_augment);
+	free(mem);
+	efi_mem_count--;
+}
+
+/* Call this after changing the size or type of an entry */
+static void efi_mem_update(struct efi_mem_list *mem)
+{
+	efi_mem_augment_propagate(&mem->node, NULL);
+}
+
+/**
+ * efi_mem_is_free() - check that a region is all free RAM
  *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return Value:	the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
+ * @start:	start of the region
+ * @end:	end of the region
+ * Return:	true if every page of the region is free RAM
+ */
+static bool efi_mem_is_free(u64 start, u64 end)
+{
+	struct efi_mem_list *mem;
+	u64 addr = start;
+
+	for (mem = efi_mem_find(start); addr < end; mem = efi_mem_next(mem)) {
+		if (!mem || mem->desc.physical_start > addr ||
+		    mem->desc.type != EFI_CONVENTIONAL_MEMORY)
+			return false;
+		addr = desc_get_end(&mem->desc);
+	}
+
+	return true;
+}
+
+/**
+ * efi_mem_carve_out() - unmap memory region
  *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
+ * @start:	start of the region
+ * @end:	end of the region
  *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
+ * Removes the region from the memory map, shrinking or splitting the
+ * entries which overlap it.
  */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
+static void efi_mem_carve_out(u64 start, u64 end)
 {
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
+	struct efi_mem_list *mem = efi_mem_find(start);
+
+	while (mem && mem->desc.physical_start < end) {
+		struct efi_mem_list *next = efi_mem_next(mem);
+		struct efi_mem_desc *desc = &mem->desc;
+		u64 map_start = desc->physical_start;
+		u64 map_end = desc_get_end(desc);
+
+		if (map_start < start) {
+			if (map_end > end) {
+				/* Split off [ end ... map_end ] */
+				struct efi_mem_list *newmem;
+
+				newmem = calloc(1, sizeof(*newmem));
+				newmem->desc = *desc;
+				newmem->desc.physical_start = end;
+				newmem->desc.virtual_start += end - map_start;
+				newmem->desc.num_pages = (map_end - end) >>
+							 EFI_PAGE_SHIFT;
+				efi_mem_insert(newmem);
+			}
+			/* Shrink the map to [ map_start ... start ] */
+			desc->num_pages = (start - map_start) >> EFI_PAGE_SHIFT;
+			efi_mem_update(mem);
+		} else if (map_end > end) {
+			/*
+			 * Move the start of the map to the end of the region.
+			 * The order of the tree does not change, as nothing
+			 * else lies in between.
+			 */
+			desc->physical_start = end;
+			desc->virtual_start += end - map_start;
+			desc->num_pages = (map_end - end) >> EFI_PAGE_SHIFT;
+			efi_mem_update(mem);
 		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
+			/* Full overlap, just remove map */
+			efi_mem_remove(mem);
 		}
-
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
+		mem = next;
 	}
+}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
-
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
-
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
+static bool efi_mem_can_merge(struct efi_mem_list *lower,
+			      struct efi_mem_list *upper)
+{
+	return desc_get_end(&lower->desc) == upper->desc.physical_start &&
+	       lower->desc.type == upper->desc.type &&
+	       lower->desc.attribute == upper->desc.attribute;
+}
 
-	return EFI_CARVE_LOOP_AGAIN;
+/* Merge an entry with the ones either side of it, if possible */
+static void efi_mem_merge(struct efi_mem_list *mem)
+{
+	struct efi_mem_list *prev = efi_mem_prev(mem);
+	struct efi_mem_list *next = efi_mem_next(mem);
+
+	if (prev && efi_mem_can_merge(prev, mem)) {
+		prev->desc.num_pages += mem->desc.num_pages;
+		efi_mem_update(prev);
+		efi_mem_remove(mem);
+		mem = prev;
+	}
+	if (next && efi_mem_can_merge(mem, next)) {
+		mem->desc.num_pages += next->desc.num_pages;
+		efi_mem_update(mem);
+		efi_mem_remove(next);
+	}
 }
 
 uint64_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 			    bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
-	uint64_t carved_pages = 0;
+	struct efi_mem_list *newmem;
+	uint64_t end = start + (pages << EFI_PAGE_SHIFT);
 
 	debug("%s: 0x%llx 0x%llx %d %s\n", __func__,
 	      start, pages, memory_type, overlap_only_ram ? "yes" : "no");
@@ -213,124 +280,94 @@ uint64_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 	if (!pages)
 		return start;
 
+	/*
+	 * The payload wanted to have RAM overlaps, but the region is not all
+	 * free RAM. Error out.
+	 */
+	if (overlap_only_ram && !efi_mem_is_free(start, end))
+		return 0;
+
 	++efi_memory_map_key;
-	newlist = calloc(1, sizeof(*newlist));
-	newlist->desc.type = memory_type;
-	newlist->desc.physical_start = start;
-	newlist->desc.virtual_start = start;
-	newlist->desc.num_pages = pages;
+	newmem = calloc(1, sizeof(*newmem));
+	newmem->desc.type = memory_type;
+	newmem->desc.physical_start = start;
+	newmem->desc.virtual_start = start;
+	newmem->desc.num_pages = pages;
 
 	switch (memory_type) {
 	case EFI_RUNTIME_SERVICES_CODE:
 	case EFI_RUNTIME_SERVICES_DATA:
-		newlist->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
 		break;
 	case EFI_MMAP_IO:
-		newlist->desc.attribute = EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_RUNTIME;
 		break;
 	default:
-		newlist->desc.attribute = EFI_MEMORY_WB;
+		newmem->desc.attribute = EFI_MEMORY_WB;
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				return 0;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
+	/* Make room for our new map and add it */
+	efi_mem_carve_out(start, end);
+	efi_mem_insert(newmem);
+	efi_mem_merge(newmem);
 
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
-		}
-	} while (carve_again);
+	return start;
+}
 
-	if (overlap_only_ram && (carved_pages != pages)) {
-		/*
-		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
-		 */
+/**
+ * efi_mem_find_free() - find the highest free memory in a subtree
+ *
+ * Subtrees without a large enough free entry are skipped, so this takes
+ * time in proportion to the depth of the tree.
+ *
+ * @node:	root of the subtree
+ * @len:	number of bytes needed, a whole number of pages
+ * @max_addr:	address the memory must end at or below, page aligned
+ * Return:	start address of the memory, or 0 if there is none
+ */
+static uint64_t efi_mem_find_free(struct rb_node *node, uint64_t len,
+				  uint64_t max_addr)
+{
+	struct efi_mem_list *mem;
+	struct efi_mem_desc *desc;
+	uint64_t ret;
+
+	if (!node)
+		return 0;
+	mem = rb_entry(node, struct efi_mem_list, node);
+	desc = &mem->desc;
+	if (mem->max_free_pages < len >> EFI_PAGE_SHIFT)
 		return 0;
+
+	/* Try higher addresses first */
+	if (desc->physical_start < max_addr) {
+		ret = efi_mem_find_free(node->rb_right, len, max_addr);
+		if (ret)
+			return ret;
 	}
 
-	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
+	/* We only take memory from free RAM */
+	if (desc->type == EFI_CONVENTIONAL_MEMORY) {
+		uint64_t curmax = min(max_addr, desc_get_end(desc));
 
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+		/* Return the highest address in this map within bounds */
+		if (curmax >= desc->physical_start + len)
+			return curmax - len;
+	}
 
-	return start;
+	return efi_mem_find_free(node->rb_left, len, max_addr);
 }
 
 static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
 {
-	struct list_head *lhandle;
-
 	/*
 	 * Prealign input max address, so we simplify our matching
 	 * logic below and can just reuse it as return pointer.
 	 */
 	max_addr &= ~EFI_PAGE_MASK;
 
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
-		struct efi_mem_desc *desc = &lmem->desc;
-		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
-		uint64_t desc_end = desc->physical_start + desc_len;
-		uint64_t curmax = min(max_addr, desc_end);
-		uint64_t ret = curmax - len;
-
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
-		/* Out of bounds for max_addr */
-		if ((ret + len) > max_addr)
-			continue;
-
-		/* Out of bounds for upper map limit */
-		if ((ret + len) > desc_end)
-			continue;
-
-		/* Out of bounds for lower map limit */
-		if (ret < desc->physical_start)
-			continue;
-
-		/* Return the highest address in this map within bounds */
-		return ret;
-	}
-
-	return 0;
+	return efi_mem_find_free(efi_mem.rb_node, len, max_addr);
 }
 
 /*
@@ -421,7 +458,6 @@ efi_status_t efi_free_pages(uint64_t memory, efi_uintn_t pages)
 	uint64_t r = 0;
 
 	r = efi_add_memory_map(memory, pages, EFI_CONVENTIONAL_MEMORY, false);
-	/* Merging of adjacent free regions is missing */
 
 	if (r == memory)
 		return EFI_SUCCESS;
@@ -504,8 +540,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
+	struct rb_node *node;
 	efi_uintn_t provided_map_size;
 
 	if (!memory_map_size)
@@ -513,10 +548,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
-	map_size = map_entries * sizeof(struct efi_mem_desc);
+	map_size = efi_mem_count * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
 
@@ -532,15 +564,12 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (descriptor_version)
 		*descriptor_version = EFI_MEMORY_DESCRIPTOR_VERSION;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
+	/* Copy the tree into the array, in ascending order */
+	for (node = rb_first(&efi_mem); node; node = rb_next(node)) {
 		struct efi_mem_list *lmem;
 
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
-		*memory_map = lmem->desc;
-		memory_map--;
+		lmem = rb_entry(node, struct efi_mem_list, node);
+		*memory_map++ = lmem->desc;
 	}
 
 	if (map_key)
@@ -0,0 +1,565 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_block_perf
+ *
+ * This test measures how fast the block IO protocol of a partition can be
+ * read with the patterns a boot loader such as GRUB uses.
+ * A disk image with a single partition is created in memory. Each block is
+ * stamped with its number.
+ * ConnectController is used to setup the partition.
+ * The partition is read for a fixed time with each pattern, the blocks read
+ * are checked and the throughput is reported.
+ * A block is overwritten and read back, to check that no stale data is
+ * returned after a write.
+ */
+
+#include <efi_selftest.h>
+
+/* Binary logarithm of the block size */
+#define LB_BLOCK_SIZE 9
+#define BLOCK_SIZE (1 << LB_BLOCK_SIZE)
+
+/* Size of the disk image */
+#define DISK_SIZE (8 << 20)
+#define DISK_BLOCKS (DISK_SIZE >> LB_BLOCK_SIZE)
+
+/* First block of the partition */
+#define PART_START 1
+
+/* Time each pattern is read for, in ms */
+#define PATTERN_MS 500
+
+/* Bytes read between checks of the timer */
+#define BATCH_SIZE (256 << 10)
+
+/* Largest read made by any pattern */
+#define MAX_READ (1 << 20)
+
+static struct efi_boot_services *boottime;
+
+static const efi_guid_t block_io_protocol_guid = BLOCK_IO_GUID;
+static const efi_guid_t guid_device_path = DEVICE_PATH_GUID;
+static efi_guid_t guid_vendor =
+	EFI_GUID(0x2d3e1ec2, 0x9f61, 0x4c0f,
+		 0x8b, 0x3a, 0x51, 0x7d, 0xe2, 0x0a, 0x64, 0xc9);
+
+static struct efi_device_path *dp;
+
+/* Disk image */
+static u8 *image;
+
+/* Buffer for reads, with room to misalign it */
+static u8 *buf;
+
+/* Timer used to end each pattern */
+static struct efi_event *timer;
+
+/* A way of reading the partition */
+struct read_pattern {
+	const char *name;
+	u32 size;	/* bytes per read */
+	u32 offset;	/* offset of the buffer from an aligned address */
+	bool random;	/* read from random positions, else sequentially */
+};
+
+static const struct read_pattern patterns[] = {
+	{ "512 B sequential", 512, 0, false },
+	{ "4 KiB sequential", 4096, 0, false },
+	{ "4 KiB sequential, unaligned", 4096, 8, false },
+	{ "4 KiB random", 4096, 0, true },
+	{ "64 KiB sequential", 64 << 10, 0, false },
+	{ "64 KiB sequential, unaligned", 64 << 10, 8, false },
+	{ "1 MiB sequential", MAX_READ, 0, false },
+};
+
+/*
+ * Reset service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * @return	status code
+ */
+static efi_status_t EFIAPI reset(
+			struct efi_block_io *this,
+			char extended_verification)
+{
+	return EFI_SUCCESS;
+}
+
+/*
+ * Read service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * @media_id	media id
+ * @lba		start of the read in logical blocks
+ * @buffer_size	number of bytes to read
+ * @buffer	target buffer
+ * @return	status code
+ */
+static efi_status_t EFIAPI read_blocks(
+			struct efi_block_io *this, u32 media_id, u64 lba,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	if ((lba << LB_BLOCK_SIZE) + buffer_size > DISK_SIZE)
+		return EFI_INVALID_PARAMETER;
+
+	boottime->copy_mem(buffer, image + (lba << LB_BLOCK_SIZE),
+			   buffer_size);
+
+	return EFI_SUCCESS;
+}
+
+/*
+ * Write service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * @media_id	media id
+ * @lba		start of the write in logical blocks
+ * @buffer_size	number of bytes to read
+ * @buffer	source buffer
+ * @return	status code
+ */
+static efi_status_t EFIAPI write_blocks(
+			struct efi_block_io *this, u32 media_id, u64 lba,
+			efi_uintn_t buffer_size, void *buffer)
+{
+	if ((lba << LB_BLOCK_SIZE) + buffer_size > DISK_SIZE)
+		return EFI_INVALID_PARAMETER;
+
+	boottime->copy_mem(image + (lba << LB_BLOCK_SIZE), buffer,
+			   buffer_size);
+
+	return EFI_SUCCESS;
+}
+
+/*
+ * Flush service of the block IO protocol.
+ *
+ * @this	block IO protocol
+ * @return	status code
+ */
+static efi_status_t EFIAPI flush_blocks(struct efi_block_io *this)
+{
+	return EFI_SUCCESS;
+}
+
+static struct efi_block_io_media media;
+
+static struct efi_block_io block_io = {
+	.media = &media,
+	.reset = reset,
+	.read_blocks = read_blocks,
+	.write_blocks = write_blocks,
+	.flush_blocks = flush_blocks,
+};
+
+/* Handle for the block IO device */
+static efi_handle_t disk_handle;
+
+/*
+ * Stamp a block with a number, at its start and end.
+ *
+ * @block	block to stamp
+ * @stamp	number to stamp it with
+ */
+static void stamp_block(u8 *block, u32 stamp)
+{
+	boottime->copy_mem(block, &stamp, sizeof(stamp));
+	boottime->copy_mem(block + BLOCK_SIZE - sizeof(stamp), &stamp,
+			   sizeof(stamp));
+}
+
+/*
+ * Check the stamp of a block.
+ *
+ * @block	block to check
+ * @stamp	number it should be stamped with
+ * @return	0 if the stamp is correct
+ */
+static int check_block(const u8 *block, u32 stamp)
+{
+	return efi_st_memcmp(block, &stamp, sizeof(stamp)) ||
+	       efi_st_memcmp(block + BLOCK_SIZE - sizeof(stamp), &stamp,
+			     sizeof(stamp));
+}
+
+/*
+ * Create the disk image. It holds a DOS partition table with one partition,
+ * which fills the rest of the disk. Each block of the partition is stamped
+ * with its number on the disk.
+ *
+ * @return	status code
+ */
+static efi_status_t create_image(void)
+{
+	u32 start = PART_START, count = DISK_BLOCKS - PART_START;
+	efi_status_t ret;
+	u8 *entry;
+	u32 lba;
+
+	ret = boottime->allocate_pool(EFI_LOADER_DATA, DISK_SIZE,
+				      (void **)&image);
+	if (ret != EFI_SUCCESS)
+		return ret;
+	boottime->set_mem(image, DISK_SIZE, 0);
+
+	/* Partition entry: type FAT32 (LBA), start and size */
+	entry = image + 0x1be;
+	entry[4] = 0x0c;
+	boottime->copy_mem(entry + 8, &start, sizeof(start));
+	boottime->copy_mem(entry + 12, &count, sizeof(count));
+	image[0x1fe] = 0x55;
+	image[0x1ff] = 0xaa;
+
+	for (lba = PART_START; lba < DISK_BLOCKS; lba++)
+		stamp_block(image + (lba << LB_BLOCK_SIZE), lba);
+
+	return EFI_SUCCESS;
+}
+
+/*
+ * Setup unit test.
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * @return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_status_t ret;
+	struct efi_device_path_vendor vendor_node;
+	struct efi_device_path end_node;
+
+	boottime = systable->boottime;
+
+	if (create_image() != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->allocate_pool(EFI_LOADER_DATA,
+				      MAX_READ + 2 * ARCH_DMA_MINALIGN,
+				      (void **)&buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->create_event(EVT_TIMER, TPL_CALLBACK, NULL, NULL,
+				     &timer);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not create event\n");
+		return EFI_ST_FAILURE;
+	}
+
+	block_io.media->block_size = BLOCK_SIZE;
+	block_io.media->last_block = DISK_BLOCKS - 1;
+
+	ret = boottime->install_protocol_interface(
+				&disk_handle, &block_io_protocol_guid,
+				EFI_NATIVE_INTERFACE, &block_io);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to install block I/O protocol\n");
+		return EFI_ST_FAILURE;
+	}
+
+	ret = boottime->allocate_pool(EFI_LOADER_DATA,
+				      sizeof(struct efi_device_path_vendor) +
+				      sizeof(struct efi_device_path),
+				      (void **)&dp);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return EFI_ST_FAILURE;
+	}
+	vendor_node.dp.type = DEVICE_PATH_TYPE_HARDWARE_DEVICE;
+	vendor_node.dp.sub_type = DEVICE_PATH_SUB_TYPE_VENDOR;
+	vendor_node.dp.length = sizeof(struct efi_device_path_vendor);
+
+	boottime->copy_mem(&vendor_node.guid, &guid_vendor,
+			   sizeof(efi_guid_t));
+	boottime->copy_mem(dp, &vendor_node,
+			   sizeof(struct efi_device_path_vendor));
+	end_node.type = DEVICE_PATH_TYPE_END;
+	end_node.sub_type = DEVICE_PATH_SUB_TYPE_END;
+	end_node.length = sizeof(struct efi_device_path);
+
+	boottime->copy_mem((char *)dp + sizeof(struct efi_device_path_vendor),
+			   &end_node, sizeof(struct efi_device_path));
+	ret = boottime->install_protocol_interface(&disk_handle,
+						   &guid_device_path,
+						   EFI_NATIVE_INTERFACE,
+						   dp);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("InstallProtocolInterface failed\n");
+		return EFI_ST_FAILURE;
+	}
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * Tear down unit test.
+ *
+ * @return:	EFI_ST_SUCCESS for success
+ */
+static int teardown(void)
+{
+	efi_status_t r = EFI_ST_SUCCESS;
+
+	if (disk_handle) {
+		r = boottime->uninstall_protocol_interface(disk_handle,
+							   &guid_device_path,
+							   dp);
+		if (r != EFI_SUCCESS) {
+			efi_st_error("Uninstall device path failed\n");
+			return EFI_ST_FAILURE;
+		}
+		r = boottime->uninstall_protocol_interface(
+				disk_handle, &block_io_protocol_guid,
+				&block_io);
+		if (r != EFI_SUCCESS) {
+			efi_st_todo(
+				"Failed to uninstall block I/O protocol\n");
+			return EFI_ST_SUCCESS;
+		}
+	}
+
+	if (timer) {
+		r = boottime->close_event(timer);
+		if (r != EFI_SUCCESS) {
+			efi_st_error("Could not close event\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	if (buf) {
+		r = boottime->free_pool(buf);
+		if (r != EFI_SUCCESS) {
+			efi_st_error("Failed to free buffer\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	if (image) {
+		r = boottime->free_pool(image);
+		if (r != EFI_SUCCESS) {
+			efi_st_error("Failed to free image\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	return r;
+}
+
+/*
+ * Get length of device path without end tag.
+ *
+ * @dp		device path
+ * @return	length of device path in bytes
+ */
+static efi_uintn_t dp_size(struct efi_device_path *dp)
+{
+	struct efi_device_path *pos = dp;
+
+	while (pos->type != DEVICE_PATH_TYPE_END)
+		pos = (struct efi_device_path *)((char *)pos + pos->length);
+	return (char *)pos - (char *)dp;
+}
+
+/*
+ * Find the block IO protocol of the partition on the disk.
+ *
+ * @part_io	block IO protocol of the partition
+ * @return	EFI_ST_SUCCESS for success
+ */
+static int find_partition(struct efi_block_io **part_io)
+{
+	efi_status_t ret;
+	efi_uintn_t no_handles, i, len;
+	efi_handle_t *handles;
+	efi_handle_t handle_partition = NULL;
+	struct efi_device_path *dp_partition;
+
+	ret = boottime->locate_handle_buffer(
+				BY_PROTOCOL, &guid_device_path, NULL,
+				&no_handles, &handles);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to locate handles\n");
+		return EFI_ST_FAILURE;
+	}
+	len = dp_size(dp);
+	for (i = 0; i < no_handles; ++i) {
+		ret = boottime->open_protocol(handles[i], &guid_device_path,
+					      (void **)&dp_partition,
+					      NULL, NULL,
+					      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("Failed to open device path protocol\n");
+			return EFI_ST_FAILURE;
+		}
+		if (len >= dp_size(dp_partition))
+			continue;
+		if (efi_st_memcmp(dp, dp_partition, len))
+			continue;
+		handle_partition = handles[i];
+		break;
+	}
+	ret = boottime->free_pool(handles);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to free pool memory\n");
+		return EFI_ST_FAILURE;
+	}
+	if (!handle_partition) {
+		efi_st_error("Partition handle not found\n");
+		return EFI_ST_FAILURE;
+	}
+
+	ret = boottime->open_protocol(handle_partition,
+				      &block_io_protocol_guid,
+				      (void **)part_io, NULL, NULL,
+				      EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to open block I/O protocol\n");
+		return EFI_ST_FAILURE;
+	}
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * Read the partition with a pattern until the timer fires, check what is
+ * read and report the throughput.
+ *
+ * @part_io	block IO protocol of the partition
+ * @pattern	how to read the partition
+ * @return	EFI_ST_SUCCESS for success
+ */
+static int run_pattern(struct efi_block_io *part_io,
+		       const struct read_pattern *pattern)
+{
+	u32 blocks = pattern->size >> LB_BLOCK_SIZE;
+	u32 part_blocks = part_io->media->last_block + 1;
+	u8 *dst = (u8 *)ALIGN((uintptr_t)buf, ARCH_DMA_MINALIGN) +
+		  pattern->offset;
+	u32 batch = BATCH_SIZE / pattern->size ? : 1;
+	u32 seed = 1, lba = 0, i, n;
+	u64 bytes = 0;
+	efi_status_t ret;
+
+	ret = boottime->set_timer(timer, EFI_TIMER_RELATIVE,
+				  PATTERN_MS * 10000);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not set timer\n");
+		return EFI_ST_FAILURE;
+	}
+	/* Only check the timer between batches, it is slow on some boards */
+	while (boottime->check_event(timer) == EFI_NOT_READY) {
+		for (n = 0; n < batch; n++) {
+			if (pattern->random) {
+				seed = seed * 1103515245 + 12345;
+				lba = (seed >> 8) % (part_blocks - blocks);
+			} else if (lba + blocks > part_blocks) {
+				lba = 0;
+			}
+			ret = part_io->read_blocks(part_io,
+						   part_io->media->media_id,
+						   lba, pattern->size, dst);
+			if (ret != EFI_SUCCESS) {
+				efi_st_error("Failed to read blocks\n");
+				return EFI_ST_FAILURE;
+			}
+			for (i = 0; i < blocks; i++) {
+				if (check_block(dst + (i << LB_BLOCK_SIZE),
+						PART_START + lba + i)) {
+					efi_st_error("Wrong data in block %u\n",
+						     lba + i);
+					return EFI_ST_FAILURE;
+				}
+			}
+			lba += blocks;
+		}
+		bytes += batch * pattern->size;
+	}
+	/* KiB per ms, converted to MiB per second */
+	efi_st_printf("%s: %u MB/s\n", pattern->name,
+		      (unsigned int)(bytes >> 10) / PATTERN_MS * 1000 >> 10);
+
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * Read a block, overwrite it through the partition and read it again, to
+ * check that the new data is returned.
+ *
+ * @part_io	block IO protocol of the partition
+ * @return	EFI_ST_SUCCESS for success
+ */
+static int check_write(struct efi_block_io *part_io)
+{
+	u8 *dst = (u8 *)ALIGN((uintptr_t)buf, ARCH_DMA_MINALIGN);
+	u32 lba = 10;
+	efi_status_t ret;
+
+	ret = part_io->read_blocks(part_io, part_io->media->media_id, lba,
+				   BLOCK_SIZE, dst);
+	if (ret != EFI_SUCCESS || check_block(dst, PART_START + lba)) {
+		efi_st_error("Failed to read block\n");
+		return EFI_ST_FAILURE;
+	}
+	stamp_block(dst, 0xdeadbeef);
+	ret = part_io->write_blocks(part_io, part_io->media->media_id, lba,
+				    BLOCK_SIZE, dst);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to write block\n");
+		return EFI_ST_FAILURE;
+	}
+	boottime->set_mem(dst, BLOCK_SIZE, 0);
+	ret = part_io->read_blocks(part_io, part_io->media->media_id, lba,
+				   BLOCK_SIZE, dst);
+	if (ret != EFI_SUCCESS || check_block(dst, 0xdeadbeef)) {
+		efi_st_error("Stale data read after write\n");
+		return EFI_ST_FAILURE;
+	}
+	stamp_block(dst, PART_START + lba);
+	ret = part_io->write_blocks(part_io, part_io->media->media_id, lba,
+				    BLOCK_SIZE, dst);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to write block\n");
+		return EFI_ST_FAILURE;
+	}
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * Execute unit test.
+ *
+ * @return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	struct efi_block_io *part_io;
+	efi_status_t ret;
+	int i;
+
+	/* Connect controller to virtual disk */
+	ret = boottime->connect_controller(disk_handle, NULL, NULL, 1);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to connect controller\n");
+		return EFI_ST_FAILURE;
+	}
+	if (find_partition(&part_io) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	if (check_write(part_io) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+	for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+		if (run_pattern(part_io, &patterns[i]) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
+	if (check_write(part_io) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(blkperf) = {
+	.name = "block device performance",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = teardown,
+	.on_request = true,
+};
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_memory_stress
+ *
+ * This unit test makes a mixture of AllocatePages, AllocatePool, FreePages
+ * and FreePool calls for a fixed time, as a boot loader loading many files
+ * does. Each allocation is marked, and the marks are checked when it is
+ * freed. The number of calls per second is reported.
+ *
+ * Once everything is freed the memory map must be the same as at the start.
+ */
+
+#include <efi_selftest.h>
+
+/* Number of allocations live at once, at most */
+#define STRESS_SLOTS 1024
+
+/* Time the test runs for, in ms */
+#define STRESS_MS 500
+
+/* Calls made between checks of the timer */
+#define STRESS_BATCH 256
+
+/* Room for the memory map to grow while it is being read */
+#define MAP_SLACK 16
+
+struct stress_slot {
+	u8 *buf;
+	efi_uintn_t size;
+	bool pool;
+};
+
+static struct efi_boot_services *boottime;
+static struct stress_slot *slots;
+static struct efi_event *timer;
+static struct efi_mem_desc *map_before, *map_after;
+static efi_uintn_t map_alloc_size;
+
+/**
+ * setup() - setup unit test
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_uintn_t map_key, desc_size;
+	u32 desc_version;
+	efi_status_t ret;
+
+	boottime = systable->boottime;
+
+	ret = boottime->allocate_pool(EFI_LOADER_DATA,
+				      STRESS_SLOTS * sizeof(*slots),
+				      (void **)&slots);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return EFI_ST_FAILURE;
+	}
+	boottime->set_mem(slots, STRESS_SLOTS * sizeof(*slots), 0);
+
+	ret = boottime->create_event(EVT_TIMER, TPL_CALLBACK, NULL, NULL,
+				     &timer);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not create event\n");
+		return EFI_ST_FAILURE;
+	}
+
+	map_alloc_size = 0;
+	ret = boottime->get_memory_map(&map_alloc_size, NULL, &map_key,
+				       &desc_size, &desc_version);
+	if (ret != EFI_BUFFER_TOO_SMALL) {
+		efi_st_error("GetMemoryMap did not return EFI_BUFFER_TOO_SMALL\n");
+		return EFI_ST_FAILURE;
+	}
+	map_alloc_size += MAP_SLACK * sizeof(struct efi_mem_desc);
+	ret = boottime->allocate_pool(EFI_LOADER_DATA, map_alloc_size,
+				      (void **)&map_before);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->allocate_pool(EFI_LOADER_DATA, map_alloc_size,
+				      (void **)&map_after);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Out of memory\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * teardown() - tear down unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int teardown(void)
+{
+	int ret = EFI_ST_SUCCESS;
+
+	if (timer && boottime->close_event(timer) != EFI_SUCCESS) {
+		efi_st_error("Could not close event\n");
+		ret = EFI_ST_FAILURE;
+	}
+	if (map_after && boottime->free_pool(map_after) != EFI_SUCCESS) {
+		efi_st_error("Failed to free memory map\n");
+		ret = EFI_ST_FAILURE;
+	}
+	if (map_before && boottime->free_pool(map_before) != EFI_SUCCESS) {
+		efi_st_error("Failed to free memory map\n");
+		ret = EFI_ST_FAILURE;
+	}
+	if (slots && boottime->free_pool(slots) != EFI_SUCCESS) {
+		efi_st_error("Failed to free slots\n");
+		ret = EFI_ST_FAILURE;
+	}
+
+	return ret;
+}
+
+/**
+ * get_map() - read the memory map
+ *
+ * @map:	buffer for the memory map
+ * @map_size:	returns the size of the memory map
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int get_map(struct efi_mem_desc *map, efi_uintn_t *map_size)
+{
+	efi_uintn_t map_key, desc_size;
+	u32 desc_version;
+	efi_status_t ret;
+
+	*map_size = map_alloc_size;
+	ret = boottime->get_memory_map(map_size, map, &map_key, &desc_size,
+				       &desc_version);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("GetMemoryMap failed\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * free_slot() - check the marks on an allocation and free it
+ *
+ * @slot:	slot number
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int free_slot(int slot)
+{
+	struct stress_slot *s = &slots[slot];
+	efi_status_t ret;
+
+	if (s->buf[0] != (u8)slot || s->buf[s->size - 1] != (u8)slot) {
+		efi_st_error("Allocation %d was overwritten\n", slot);
+		return EFI_ST_FAILURE;
+	}
+	if (s->pool)
+		ret = boottime->free_pool(s->buf);
+	else
+		ret = boottime->free_pages((uintptr_t)s->buf,
+					   s->size >> EFI_PAGE_SHIFT);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to free allocation %d\n", slot);
+		return EFI_ST_FAILURE;
+	}
+	s->buf = NULL;
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * alloc_slot() - make an allocation and mark it
+ *
+ * Most allocations are small pool allocations, some are a few pages.
+ *
+ * @slot:	slot number
+ * @seed:	random number used to choose the size
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int alloc_slot(int slot, u32 seed)
+{
+	struct stress_slot *s = &slots[slot];
+	efi_status_t ret;
+
+	s->pool = (seed >> 24) % 4;
+	if (s->pool) {
+		s->size = 16 + (seed >> 8) % 4096;
+		ret = boottime->allocate_pool(EFI_LOADER_DATA, s->size,
+					      (void **)&s->buf);
+	} else {
+		u64 addr;
+
+		s->size = (1 + (seed >> 8) % 8) << EFI_PAGE_SHIFT;
+		ret = boottime->allocate_pages(EFI_ALLOCATE_ANY_PAGES,
+					       EFI_LOADER_DATA,
+					       s->size >> EFI_PAGE_SHIFT,
+					       &addr);
+		s->buf = (u8 *)(uintptr_t)addr;
+	}
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Failed to allocate %u bytes\n",
+			     (unsigned int)s->size);
+		return EFI_ST_FAILURE;
+	}
+	s->buf[0] = slot;
+	s->buf[s->size - 1] = slot;
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * execute() - execute unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	efi_uintn_t size_before, size_after, entries = 0, map_size;
+	u32 seed = 1, calls = 0;
+	efi_status_t ret;
+	int i, slot;
+
+	if (get_map(map_before, &size_before) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	ret = boottime->set_timer(timer, EFI_TIMER_RELATIVE, STRESS_MS * 10000);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not set timer\n");
+		return EFI_ST_FAILURE;
+	}
+	while (boottime->check_event(timer) == EFI_NOT_READY) {
+		for (i = 0; i < STRESS_BATCH; i++) {
+			seed = seed * 1103515245 + 12345;
+			slot = (seed >> 8) % STRESS_SLOTS;
+			if (slots[slot].buf)
+				ret = free_slot(slot);
+			else
+				ret = alloc_slot(slot, seed);
+			if (ret != EFI_ST_SUCCESS)
+				return EFI_ST_FAILURE;
+		}
+		calls += STRESS_BATCH;
+
+		/* Keep track of how much the memory map is split up */
+		map_size = 0;
+		boottime->get_memory_map(&map_size, NULL, NULL, NULL, NULL);
+		if (map_size / sizeof(struct efi_mem_desc) > entries)
+			entries = map_size / sizeof(struct efi_mem_desc);
+	}
+	for (slot = 0; slot < STRESS_SLOTS; slot++) {
+		if (slots[slot].buf && free_slot(slot) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
+	efi_st_printf("%u calls per second, up to %u memory map entries\n",
+		      calls / STRESS_MS * 1000, (unsigned int)entries);
+
+	if (get_map(map_after, &size_after) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+	if (size_before != size_after ||
+	    efi_st_memcmp(map_before, map_after, size_after)) {
+		efi_st_error("Memory map not restored after freeing\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(memstress) = {
+	.name = "memory allocation stress",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = teardown,
+};
@@ -46,26 +46,183 @@
 
 static void default_log(const char *ignored, char *response) {}
 
+/**
+ * struct sparse_buffer - blocks waiting to be written to storage
+ *
+ * Small RAW and FILL chunks are collected here so that they can be written
+ * with a single large write.
+ *
+ * @buf:	buffer holding the blocks
+ * @size:	size of @buf in blocks
+ * @count:	number of blocks held in @buf
+ * @blk:	block at which @buf is to be written
+ */
+struct sparse_buffer {
+	char *buf;
+	lbaint_t size;
+	lbaint_t count;
+	lbaint_t blk;
+};
+
+static int sparse_write(struct sparse_storage *info, struct sparse_buffer *sb,
+			lbaint_t blkcnt, const void *data, char *response)
+{
+	lbaint_t blks;
+
+	blks = info->write(info, sb->blk, blkcnt, data);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n",
+		       __func__, "Write failed, block #", sb->blk, blks);
+		info->mssg("flash write failure", response);
+		return -1;
+	}
+	sb->blk += blks;
+
+	return 0;
+}
+
+/* Write out any blocks collected in the buffer */
+static int sparse_flush(struct sparse_storage *info, struct sparse_buffer *sb,
+			char *response)
+{
+	lbaint_t count = sb->count;
+
+	if (!count)
+		return 0;
+	sb->count = 0;
+
+	return sparse_write(info, sb, count, sb->buf, response);
+}
+
+static int sparse_raw(struct sparse_storage *info, struct sparse_buffer *sb,
+		      lbaint_t blkcnt, const void *data, char *response)
+{
+	/* Large chunks are written directly from the image */
+	if (blkcnt >= sb->size) {
+		if (sparse_flush(info, sb, response))
+			return -1;
+		return sparse_write(info, sb, blkcnt, data, response);
+	}
+
+	if (sb->count + blkcnt > sb->size && sparse_flush(info, sb, response))
+		return -1;
+	memcpy(sb->buf + sb->count * info->blksz, data, blkcnt * info->blksz);
+	sb->count += blkcnt;
+
+	return 0;
+}
+
+static void sparse_fill_buf(struct sparse_storage *info, void *buf,
+			    lbaint_t blkcnt, uint32_t fill_val)
+{
+	uint32_t *ptr = buf;
+	ulong i;
+
+	for (i = 0; i < blkcnt * info->blksz / sizeof(fill_val); i++)
+		ptr[i] = fill_val;
+}
+
+static int sparse_fill(struct sparse_storage *info, struct sparse_buffer *sb,
+		       lbaint_t blkcnt, uint32_t fill_val, char *response)
+{
+	lbaint_t todo;
+
+	/* Fill the whole buffer once for long runs of the same value */
+	if (!sb->count && blkcnt >= sb->size) {
+		sparse_fill_buf(info, sb->buf, sb->size, fill_val);
+		while (blkcnt >= sb->size) {
+			if (sparse_write(info, sb, sb->size, sb->buf, response))
+				return -1;
+			blkcnt -= sb->size;
+		}
+	}
+
+	while (blkcnt) {
+		todo = min(blkcnt, sb->size - sb->count);
+		sparse_fill_buf(info, sb->buf + sb->count * info->blksz, todo,
+				fill_val);
+		sb->count += todo;
+		blkcnt -= todo;
+		if (sb->count == sb->size && sparse_flush(info, sb, response))
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * sparse_erase() - Erase the whole erase groups within a range of blocks
+ *
+ * The range starts after the blocks held in the buffer. Any blocks before the
+ * first erase group are filled with zeroes first, so that the buffer can be
+ * written out ahead of the erase.
+ *
+ * @info:	storage to erase
+ * @sb:		write buffer
+ * @blkcnt:	number of blocks in the range
+ * @zero:	true to fill blocks before the first erase group with zeroes,
+ *		false to reserve them
+ * @donep:	returns the number of blocks of the range which were handled
+ *		(filled, reserved or erased)
+ * @response:	fastboot response buffer
+ * @return 0 if OK, -1 on error
+ */
+static int sparse_erase(struct sparse_storage *info, struct sparse_buffer *sb,
+			lbaint_t blkcnt, bool zero, lbaint_t *donep,
+			char *response)
+{
+	lbaint_t head, count, blks;
+	u32 rem;
+
+	*donep = 0;
+	if (!info->erase || !info->erase_grp)
+		return 0;
+	div_u64_rem(sb->blk + sb->count, info->erase_grp, &rem);
+	head = rem ? info->erase_grp - rem : 0;
+	if (head >= blkcnt)
+		return 0;
+	div_u64_rem(blkcnt - head, info->erase_grp, &rem);
+	count = blkcnt - head - rem;
+	if (!count)
+		return 0;
+
+	if (zero && sparse_fill(info, sb, head, 0, response))
+		return -1;
+	if (sparse_flush(info, sb, response))
+		return -1;
+	if (!zero)
+		sb->blk += info->reserve(info, sb->blk, head);
+	*donep = head;
+
+	blks = info->erase(info, sb->blk, count);
+	if (blks != count) {
+		/* Leave it to the caller to write the blocks instead */
+		printf("%s: Erase failed, block #" LBAFU "\n", __func__,
+		       sb->blk);
+		return 0;
+	}
+	sb->blk += count;
+	*donep += count;
+
+	return 0;
+}
+
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
-	lbaint_t blk;
 	lbaint_t blkcnt;
 	lbaint_t blks;
 	uint32_t bytes_written = 0;
 	unsigned int chunk;
 	unsigned int offset;
 	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	struct sparse_buffer sb;
+	int ret = -1;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -104,10 +261,19 @@ int write_sparse_image(struct sparse_storage *info,
 		return -1;
 	}
 
+	sb.size = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	sb.count = 0;
+	sb.blk = info->start;
+	sb.buf = memalign(ARCH_DMA_MINALIGN,
+			  ROUNDUP(info->blksz * sb.size, ARCH_DMA_MINALIGN));
+	if (!sb.buf) {
+		info->mssg("Malloc failed for sparse write buffer", response);
+		return -1;
+	}
+
 	puts("Flashing Sparse Image\n");
 
 	/* Start processing chunks */
-	blk = info->start;
 	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
 		/* Read and skip over chunk header */
 		chunk_header = (chunk_header_t *)data;
@@ -137,28 +303,21 @@ int write_sparse_image(struct sparse_storage *info,
 			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
 				info->mssg("Bogus chunk size for chunk type Raw",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			if (blk + blkcnt > info->start + info->size) {
+			if (sb.blk + sb.count + blkcnt >
+			    info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				info->mssg("flash write failure", response);
-				return -1;
-			}
-			blk += blks;
+			if (sparse_raw(info, &sb, blkcnt, data, response))
+				goto out;
 			bytes_written += blkcnt * info->blksz;
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -168,64 +327,42 @@ int write_sparse_image(struct sparse_storage *info,
 			if (chunk_header->total_sz !=
 			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
 				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
+				goto out;
 			}
 
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
+			if (sb.blk + sb.count + blkcnt >
+			    info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
+			/* Erase rather than write zeroes where possible */
+			blks = 0;
+			if (!fill_val && sparse_erase(info, &sb, blkcnt, true,
+						      &blks, response))
+				goto out;
+			if (sparse_fill(info, &sb, blkcnt - blks, fill_val,
+					response))
+				goto out;
 			bytes_written += blkcnt * info->blksz;
 			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
+			if (sparse_flush(info, &sb, response))
+				goto out;
+			/* Discard what is there, if that is cheap */
+			if (sparse_erase(info, &sb, blkcnt, false, &blks,
+					 response))
+				goto out;
+			sb.blk += info->reserve(info, sb.blk, blkcnt - blks);
 			total_blocks += chunk_header->chunk_sz;
 			break;
 
@@ -234,7 +371,7 @@ int write_sparse_image(struct sparse_storage *info,
 			    sparse_header->chunk_hdr_sz) {
 				info->mssg("Bogus chunk size for chunk type Dont Care",
 					   response);
-				return -1;
+				goto out;
 			}
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -244,9 +381,11 @@ int write_sparse_image(struct sparse_storage *info,
 			printf("%s: Unknown chunk type: %x\n", __func__,
 			       chunk_header->chunk_type);
 			info->mssg("Unknown chunk type", response);
-			return -1;
+			goto out;
 		}
 	}
+	if (sparse_flush(info, &sb, response))
+		goto out;
 
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks, sparse_header->total_blks);
@@ -254,8 +393,12 @@ int write_sparse_image(struct sparse_storage *info,
 
 	if (total_blocks != sparse_header->total_blks) {
 		info->mssg("sparse image write failure", response);
-		return -1;
+		goto out;
 	}
+	ret = 0;
 
-	return 0;
+out:
+	free(sb.buf);
+
+	return ret;
 }
@@ -4,36 +4,96 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <initcall.h>
 #include <efi.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
-int initcall_run_list(const init_fnc_t init_sequence[])
+enum {
+	/* Maximum number of split initcalls waiting to be completed */
+	INITCALL_MAX_PENDING	= 4,
+};
+
+/* Start a bootstage span to show how long the initcall takes */
+static int initcall_span(const struct initcall *ic)
 {
-	const init_fnc_t *init_fnc_ptr;
+#ifdef CONFIG_BOOTSTAGE_INITCALL
+	return bootstage_span_begin(ic->name);
+#else
+	return -1;
+#endif
+}
 
-	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
-		unsigned long reloc_ofs = 0;
-		int ret;
+static int initcall_call(const struct initcall init_sequence[],
+			 init_fnc_t func)
+{
+	unsigned long reloc_ofs = 0;
+	int ret;
 
-		if (gd->flags & GD_FLG_RELOC)
-			reloc_ofs = gd->reloc_off;
+	if (gd->flags & GD_FLG_RELOC)
+		reloc_ofs = gd->reloc_off;
 #ifdef CONFIG_EFI_APP
-		reloc_ofs = (unsigned long)image_base;
+	reloc_ofs = (unsigned long)image_base;
 #endif
-		debug("initcall: %p", (char *)*init_fnc_ptr - reloc_ofs);
-		if (gd->flags & GD_FLG_RELOC)
-			debug(" (relocated to %p)\n", (char *)*init_fnc_ptr);
-		else
-			debug("\n");
-		ret = (*init_fnc_ptr)();
-		if (ret) {
-			printf("initcall sequence %p failed at call %p (err=%d)\n",
-			       init_sequence,
-			       (char *)*init_fnc_ptr - reloc_ofs, ret);
-			return -1;
+	debug("initcall: %p", (char *)func - reloc_ofs);
+	if (gd->flags & GD_FLG_RELOC)
+		debug(" (relocated to %p)\n", (char *)func);
+	else
+		debug("\n");
+	ret = func();
+	if (ret) {
+		printf("initcall sequence %p failed at call %p (err=%d)\n",
+		       init_sequence, (char *)func - reloc_ofs, ret);
+		return -1;
+	}
+
+	return 0;
+}
+
+int initcall_run_list(const struct initcall init_sequence[])
+{
+	init_fnc_t pending[INITCALL_MAX_PENDING];
+	const struct initcall *ic;
+	int num_pending = 0;
+	int span, i;
+
+	for (ic = init_sequence; ic->func || ic->complete; ic++) {
+		if (ic->func) {
+			span = initcall_span(ic);
+			if (initcall_call(init_sequence, ic->func))
+				return -1;
+			if (ic->complete) {
+				if (num_pending == INITCALL_MAX_PENDING) {
+					/* No room, so complete it right away */
+					if (initcall_call(init_sequence,
+							  ic->complete))
+						return -1;
+				} else {
+					pending[num_pending++] = ic->complete;
+				}
+			}
+		} else {
+			/* Only complete work which was actually started */
+			for (i = 0; i < num_pending; i++) {
+				if (pending[i] == ic->complete)
+					break;
+			}
+			if (i == num_pending)
+				continue;
+			pending[i] = pending[--num_pending];
+			span = initcall_span(ic);
+			if (initcall_call(init_sequence, ic->complete))
+				return -1;
 		}
+		bootstage_span_end(span);
 	}
+
+	/* Don't leave anything half-done if the sequence returns */
+	for (i = 0; i < num_pending; i++) {
+		if (initcall_call(init_sequence, pending[i]))
+			return -1;
+	}
+
 	return 0;
 }
@@ -8,6 +8,7 @@
 
 #include <common.h>
 #include <lmb.h>
+#include <malloc.h>
 
 #define LMB_ALLOC_ANYWHERE	0
 
@@ -40,135 +41,127 @@ void lmb_dump_all(struct lmb *lmb)
 #endif /* DEBUG */
 }
 
-static long lmb_addrs_overlap(phys_addr_t base1,
-		phys_size_t size1, phys_addr_t base2, phys_size_t size2)
+static phys_addr_t lmb_end(struct lmb_property *prop)
 {
-	return ((base1 < (base2+size2)) && (base2 < (base1+size1)));
+	return prop->base + prop->size;
 }
 
-static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
-		phys_addr_t base2, phys_size_t size2)
+/*
+ * Find the first region which ends at or after addr, so that it contains
+ * addr, touches it or lies above it. Returns rgn->cnt if there is none.
+ */
+static unsigned long lmb_find_region(struct lmb_region *rgn, phys_addr_t addr)
 {
-	if (base2 == base1 + size1)
-		return 1;
-	else if (base1 == base2 + size2)
-		return -1;
+	unsigned long lo = 0, hi = rgn->cnt;
 
-	return 0;
+	while (lo < hi) {
+		unsigned long mid = lo + (hi - lo) / 2;
+
+		if (lmb_end(&rgn->region[mid]) < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
 }
 
-static long lmb_regions_adjacent(struct lmb_region *rgn,
-		unsigned long r1, unsigned long r2)
+/* Make room for a region at index i, growing the array if needed */
+static long lmb_insert_region(struct lmb_region *rgn, unsigned long i,
+			      phys_addr_t base, phys_size_t size)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	if (rgn->cnt == rgn->max) {
+		unsigned long max = rgn->max * 2;
+		struct lmb_property *region;
+
+		region = malloc(max * sizeof(*region));
+		if (!region)
+			return -1;
+		memcpy(region, rgn->region, rgn->cnt * sizeof(*region));
+		if (rgn->region != rgn->initial)
+			free(rgn->region);
+		rgn->region = region;
+		rgn->max = max;
+	}
+
+	memmove(&rgn->region[i + 1], &rgn->region[i],
+		(rgn->cnt - i) * sizeof(*rgn->region));
+	rgn->region[i].base = base;
+	rgn->region[i].size = size;
+	rgn->cnt++;
 
-	return lmb_addrs_adjacent(base1, size1, base2, size2);
+	return 0;
 }
 
-static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
+/* Remove count regions starting at index r */
+static void lmb_remove_regions(struct lmb_region *rgn, unsigned long r,
+			       unsigned long count)
 {
-	unsigned long i;
-
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-	}
-	rgn->cnt--;
+	memmove(&rgn->region[r], &rgn->region[r + count],
+		(rgn->cnt - r - count) * sizeof(*rgn->region));
+	rgn->cnt -= count;
 }
 
-/* Assumption: base addr of region 1 < base addr of region 2 */
-static void lmb_coalesce_regions(struct lmb_region *rgn,
-		unsigned long r1, unsigned long r2)
+static void lmb_init_region(struct lmb_region *rgn)
 {
-	rgn->region[r1].size += rgn->region[r2].size;
-	lmb_remove_region(rgn, r2);
+	rgn->region = rgn->initial;
+	rgn->max = MAX_LMB_REGIONS;
+	rgn->cnt = 0;
+	rgn->size = 0;
 }
 
 void lmb_init(struct lmb *lmb)
 {
-	/* Create a dummy zero size LMB which will get coalesced away later.
-	 * This simplifies the lmb_add() code below...
-	 */
-	lmb->memory.region[0].base = 0;
-	lmb->memory.region[0].size = 0;
-	lmb->memory.cnt = 1;
-	lmb->memory.size = 0;
-
-	/* Ditto. */
-	lmb->reserved.region[0].base = 0;
-	lmb->reserved.region[0].size = 0;
-	lmb->reserved.cnt = 1;
-	lmb->reserved.size = 0;
+	lmb_init_region(&lmb->memory);
+	lmb_init_region(&lmb->reserved);
+	lmb->policy = LMB_ALLOC_TOP_DOWN;
 }
 
-/* This routine called with relocation disabled. */
-static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t size)
+static void lmb_release_region(struct lmb_region *rgn)
 {
-	unsigned long coalesced = 0;
-	long adjacent, i;
+	if (rgn->region != rgn->initial)
+		free(rgn->region);
+	rgn->region = rgn->initial;
+	rgn->max = MAX_LMB_REGIONS;
+}
 
-	if ((rgn->cnt == 1) && (rgn->region[0].size == 0)) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		return 0;
-	}
+/* Free the memory used by an lmb whose regions grew beyond the first few */
+void lmb_release(struct lmb *lmb)
+{
+	lmb_release_region(&lmb->memory);
+	lmb_release_region(&lmb->reserved);
+}
 
-	/* First try and coalesce this LMB with another. */
-	for (i=0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
+/*
+ * Add a region, merging it with any regions it overlaps or touches.
+ * Returns the number of regions it was merged with, or -1 on error.
+ */
+static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base,
+			   phys_size_t size)
+{
+	phys_addr_t end = base + size;
+	unsigned long first, last;
 
-		if ((rgnbase == base) && (rgnsize == size))
-			/* Already have this region, so we're done */
-			return 0;
+	if (!size)
+		return 0;
 
-		adjacent = lmb_addrs_adjacent(base,size,rgnbase,rgnsize);
-		if ( adjacent > 0 ) {
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		}
-		else if ( adjacent < 0 ) {
-			rgn->region[i].size += size;
-			coalesced++;
+	first = lmb_find_region(rgn, base);
+	for (last = first; last < rgn->cnt; last++) {
+		if (rgn->region[last].base > end)
 			break;
-		}
 	}
 
-	if ((i < rgn->cnt-1) && lmb_regions_adjacent(rgn, i, i+1) ) {
-		lmb_coalesce_regions(rgn, i, i+1);
-		coalesced++;
-	}
+	if (first == last)
+		return lmb_insert_region(rgn, first, base, size);
 
-	if (coalesced)
-		return coalesced;
-	if (rgn->cnt >= MAX_LMB_REGIONS)
-		return -1;
+	/* Merge with regions first to last - 1 */
+	base = min(base, rgn->region[first].base);
+	end = max(end, lmb_end(&rgn->region[last - 1]));
+	rgn->region[first].base = base;
+	rgn->region[first].size = end - base;
+	lmb_remove_regions(rgn, first + 1, last - first - 1);
 
-	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i+1].base = rgn->region[i].base;
-			rgn->region[i+1].size = rgn->region[i].size;
-		} else {
-			rgn->region[i+1].base = base;
-			rgn->region[i+1].size = size;
-			break;
-		}
-	}
-
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-	}
-
-	rgn->cnt++;
-
-	return 0;
+	return last - first;
 }
 
 /* This routine may be called with relocation disabled. */
@@ -184,26 +177,24 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	struct lmb_region *rgn = &(lmb->reserved);
 	phys_addr_t rgnbegin, rgnend;
 	phys_addr_t end = base + size;
-	int i;
-
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
+	unsigned long i;
 
 	/* Find the region where (base, size) belongs to */
-	for (i=0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+	i = lmb_find_region(rgn, base);
+	if (i < rgn->cnt && lmb_end(&rgn->region[i]) == base && size)
+		i++;
+	if (i == rgn->cnt)
+		return -1;
+	rgnbegin = rgn->region[i].base;
+	rgnend = lmb_end(&rgn->region[i]);
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (rgnbegin > base || end > rgnend)
 		return -1;
 
 	/* Check to see if we are removing entire region */
 	if ((rgnbegin == base) && (rgnend == end)) {
-		lmb_remove_region(rgn, i);
+		lmb_remove_regions(rgn, i, 1);
 		return 0;
 	}
 
@@ -225,7 +216,7 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	 * beginging of the hole and add the region after hole.
 	 */
 	rgn->region[i].size = base - rgn->region[i].base;
-	return lmb_add_region(rgn, end, rgnend - end);
+	return lmb_insert_region(rgn, i + 1, end, rgnend - end);
 }
 
 long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
@@ -235,20 +226,21 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	return lmb_add_region(_rgn, base, size);
 }
 
+/* Returns the index of the highest region overlapping (base, size), or -1 */
 static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
 				phys_size_t size)
 {
 	unsigned long i;
 
-	for (i=0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if ( lmb_addrs_overlap(base,size,rgnbase,rgnsize) ) {
-			break;
-		}
+	/* Find the last region starting below the end of (base, size) */
+	i = lmb_find_region(rgn, base + size);
+	if (i == rgn->cnt || rgn->region[i].base >= base + size) {
+		if (!i)
+			return -1;
+		i--;
 	}
 
-	return (i < rgn->cnt) ? i : -1;
+	return lmb_end(&rgn->region[i]) > base ? i : -1;
 }
 
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
@@ -279,7 +271,8 @@ static phys_addr_t lmb_align_up(phys_addr_t addr, ulong size)
 	return (addr + (size - 1)) & ~(size - 1);
 }
 
-phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phys_addr_t max_addr)
+static phys_addr_t lmb_alloc_top_down(struct lmb *lmb, phys_size_t size,
+				      ulong align, phys_addr_t max_addr)
 {
 	long i, j;
 	phys_addr_t base = 0;
@@ -304,14 +297,9 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 
 		while (base && lmbbase <= base) {
 			j = lmb_overlaps_region(&lmb->reserved, base, size);
-			if (j < 0) {
+			if (j < 0)
 				/* This area isn't reserved, take it */
-				if (lmb_add_region(&lmb->reserved, base,
-							lmb_align_up(size,
-								align)) < 0)
-					return 0;
 				return base;
-			}
 			res_base = lmb->reserved.region[j].base;
 			if (res_base < size)
 				break;
@@ -321,17 +309,75 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 	return 0;
 }
 
-int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
+/*
+ * Walk the free areas from the bottom of memory up, for first-fit and
+ * best-fit allocation. Each free area lies between reserved regions within
+ * one memory region, and is cut off at max_addr.
+ */
+static phys_addr_t lmb_alloc_bottom_up(struct lmb *lmb, phys_size_t size,
+				       ulong align, phys_addr_t max_addr)
 {
-	int i;
-
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return 1;
+	struct lmb_region *res = &lmb->reserved;
+	phys_addr_t best = 0;
+	phys_size_t best_size = 0;
+	unsigned long i, j;
+
+	for (i = 0; i < lmb->memory.cnt; i++) {
+		phys_addr_t start = lmb->memory.region[i].base;
+		phys_addr_t mem_end = lmb_end(&lmb->memory.region[i]);
+
+		if (max_addr != LMB_ALLOC_ANYWHERE && mem_end > max_addr)
+			mem_end = max_addr;
+
+		/* Skip reserved regions which end before this memory */
+		j = lmb_find_region(res, start);
+		while (start < mem_end) {
+			phys_addr_t end = mem_end, base;
+
+			if (j < res->cnt && res->region[j].base <= start) {
+				start = lmb_end(&res->region[j++]);
+				continue;
+			}
+			if (j < res->cnt && res->region[j].base < end)
+				end = res->region[j].base;
+
+			/* Address 0 means failure, so never hand it out */
+			base = lmb_align_up(start ? start : align ? : 1, align);
+			if (base >= start && base < end && end - base >= size) {
+				if (lmb->policy == LMB_ALLOC_FIRST_FIT)
+					return base;
+				if (!best || end - start < best_size) {
+					best = base;
+					best_size = end - start;
+				}
+			}
+			start = end;
+		}
 	}
-	return 0;
+
+	return best;
+}
+
+phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phys_addr_t max_addr)
+{
+	phys_addr_t base;
+
+	if (lmb->policy == LMB_ALLOC_TOP_DOWN)
+		base = lmb_alloc_top_down(lmb, size, align, max_addr);
+	else
+		base = lmb_alloc_bottom_up(lmb, size, align, max_addr);
+	if (!base)
+		return 0;
+
+	if (lmb_add_region(&lmb->reserved, base, lmb_align_up(size, align)) < 0)
+		return 0;
+
+	return base;
+}
+
+int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
+{
+	return lmb_overlaps_region(&lmb->reserved, addr, 1) >= 0;
 }
 
 __weak void board_lmb_reserve(struct lmb *lmb)
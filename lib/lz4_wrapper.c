@@ -5,6 +5,8 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <cpu_work.h>
+#include <malloc.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 
@@ -62,6 +64,126 @@ struct lz4_block_header {
 	/* + u32 block_checksum iff has_block_checksum is set */
 } __packed;
 
+/* Decompress one block, setting *sizep to the number of bytes written */
+static int lz4_block(const struct lz4_block_header *b, const void *in,
+		     void *out, size_t avail, size_t *sizep)
+{
+	int ret;
+
+	if (b->not_compressed) {
+		size_t size = min((size_t)b->size, avail);
+
+		memcpy(out, in, size);
+		*sizep = size;
+		if (size < b->size)
+			return -ENOBUFS;	/* output overrun */
+		return 0;
+	}
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic(in, out, b->size, avail, endOnInputSize,
+				     full, 0, noDict, out, NULL, 0);
+	if (ret < 0) {
+		*sizep = 0;
+		return -EPROTO;		/* decompression error */
+	}
+	*sizep = ret;
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(CPU_WORK)
+struct lz4_job {
+	struct lz4_block_header b;
+	const void *in;
+	void *out;
+	size_t avail;
+	size_t size;
+	int ret;
+};
+
+static void lz4_job_run(void *arg)
+{
+	struct lz4_job *job = arg;
+
+	job->ret = lz4_block(&job->b, job->in, job->out, job->avail,
+			     &job->size);
+}
+
+/*
+ * Decompress the blocks of a frame on all CPUs. Block sizes are not stored,
+ * so this relies on every block but the last filling the maximum block size,
+ * as the lz4 tool does. Each block is then decompressed to its own place.
+ * @dst_size bytes are available at @dst and the number written is returned in
+ * @dstn. Returns -EAGAIN if that does not work out, or the frame is not worth
+ * splitting up, so that the caller decompresses it in the usual way, which
+ * also reports any error.
+ */
+static int ulz4fn_parallel(const void *src, size_t srcn, const void *in,
+			   int has_block_checksum, size_t block_size,
+			   void *dst, size_t dst_size, size_t *dstn)
+{
+	const void *pos = in;
+	struct cpu_work *work;
+	struct lz4_job *jobs;
+	int count = 0, short_block = -1, i, ret = 0;
+
+	/* Find the blocks */
+	while (1) {
+		struct lz4_block_header b;
+
+		if (pos - src + sizeof(b) > srcn)
+			return -EAGAIN;
+		b.raw = le32_to_cpu(*(u32 *)pos);
+		pos += sizeof(b);
+		if (!b.size)
+			break;
+		if (pos - src + b.size > srcn)
+			return -EAGAIN;
+		/* The size of a stored block shows if it is short */
+		if (b.not_compressed && b.size != block_size)
+			short_block = count;
+		pos += b.size;
+		if (has_block_checksum)
+			pos += sizeof(u32);
+		count++;
+	}
+	if (count < 2 || (count - 1) * block_size >= dst_size ||
+	    (short_block != -1 && short_block != count - 1))
+		return -EAGAIN;
+
+	jobs = malloc(count * (sizeof(*jobs) + sizeof(*work)));
+	if (!jobs)
+		return -EAGAIN;
+	work = (struct cpu_work *)(jobs + count);
+
+	for (pos = in, i = 0; i < count; i++) {
+		struct lz4_job *job = &jobs[i];
+
+		job->b.raw = le32_to_cpu(*(u32 *)pos);
+		job->in = pos + sizeof(job->b);
+		job->out = dst + i * block_size;
+		job->avail = min(block_size, dst_size - i * block_size);
+		work[i].func = lz4_job_run;
+		work[i].arg = job;
+		pos = job->in + job->b.size;
+		if (has_block_checksum)
+			pos += sizeof(u32);
+	}
+	cpu_work_run(work, count);
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].ret || (i < count - 1 && jobs[i].size != block_size))
+			ret = -EAGAIN;
+	}
+	if (!ret)
+		*dstn = (count - 1) * block_size + jobs[count - 1].size;
+	free(jobs);
+
+	return ret;
+}
+#endif
+
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 {
 	const void *end = dst + *dstn;
@@ -69,6 +191,9 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	void *out = dst;
 	int has_block_checksum;
 	int ret;
+#if CONFIG_IS_ENABLED(CPU_WORK)
+	size_t dst_size = *dstn;
+#endif
 	*dstn = 0;
 
 	{ /* With in-place decompression the header may become invalid later. */
@@ -92,8 +217,27 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 		in += sizeof(u8);
 	}
 
+#if CONFIG_IS_ENABLED(CPU_WORK)
+	/*
+	 * Blocks can only be decompressed out of order if not in-place. The
+	 * distances are compared, as @srcn and @dst_size may be 'unlimited'.
+	 */
+	if (cpu_work_cpus() &&
+	    ((dst >= src && dst - src >= srcn) ||
+	     (src >= dst && src - dst >= dst_size))) {
+		const struct lz4_frame_header *h = src;
+		/* 64KB, 256KB, 1MB or 4MB; smaller values are not used */
+		size_t block_size = 1 << (2 * h->max_block_size + 8);
+
+		if (!ulz4fn_parallel(src, srcn, in, has_block_checksum,
+				     block_size, dst, dst_size, dstn))
+			return 0;
+	}
+#endif
+
 	while (1) {
 		struct lz4_block_header b;
+		size_t size;
 
 		b.raw = le32_to_cpu(*(u32 *)in);
 		in += sizeof(struct lz4_block_header);
@@ -108,25 +252,10 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 			break;
 		}
 
-		if (b.not_compressed) {
-			size_t size = min((ptrdiff_t)b.size, end - out);
-			memcpy(out, in, size);
-			out += size;
-			if (size < b.size) {
-				ret = -ENOBUFS;	/* output overrun */
-				break;
-			}
-		} else {
-			/* constant folding essential, do not touch params! */
-			ret = LZ4_decompress_generic(in, out, b.size,
-					end - out, endOnInputSize,
-					full, 0, noDict, out, NULL, 0);
-			if (ret < 0) {
-				ret = -EPROTO;	/* decompression error */
-				break;
-			}
-			out += ret;
-		}
+		ret = lz4_block(&b, in, out, end - out, &size);
+		out += size;
+		if (ret)
+			break;
 
 		in += b.size;
 		if (has_block_checksum)
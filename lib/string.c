@@ -20,6 +20,7 @@
 #include <linux/string.h>
 #include <linux/ctype.h>
 #include <malloc.h>
+#include <asm/byteorder.h>
 
 
 /**
@@ -469,26 +470,31 @@ char *strswab(const char *s)
  */
 void * memset(void * s,int c,size_t count)
 {
-	unsigned long *sl = (unsigned long *) s;
-	char *s8;
+	char *s8 = s;
 
 #if !CONFIG_IS_ENABLED(TINY_MEMSET)
+	unsigned long *sl;
 	unsigned long cl = 0;
 	int i;
 
-	/* do it one word at a time (32 bits or 64 bits) while possible */
-	if ( ((ulong)s & (sizeof(*sl) - 1)) == 0) {
+	/* do it one word at a time (32 bits or 64 bits) once aligned */
+	if (count >= sizeof(*sl)) {
+		while ((ulong)s8 & (sizeof(*sl) - 1)) {
+			*s8++ = c;
+			count--;
+		}
 		for (i = 0; i < sizeof(*sl); i++) {
 			cl <<= 8;
 			cl |= c & 0xff;
 		}
+		sl = (unsigned long *)s8;
 		while (count >= sizeof(*sl)) {
 			*sl++ = cl;
 			count -= sizeof(*sl);
 		}
+		s8 = (char *)sl;
 	}
 #endif	/* fill 8 bits at a time */
-	s8 = (char *)sl;
 	while (count--)
 		*s8++ = c;
 
@@ -496,6 +502,58 @@ void * memset(void * s,int c,size_t count)
 }
 #endif
 
+#if !CONFIG_IS_ENABLED(TINY_MEMCPY) && \
+	(!defined(__HAVE_ARCH_MEMCPY) || !defined(__HAVE_ARCH_MEMMOVE))
+/*
+ * Helpers for copying whole words to an aligned destination. When the source
+ * is not aligned the same way, each destination word is made from the two
+ * aligned source words which hold its bytes, so that every load and store is
+ * a full, aligned word. Only aligned words which hold at least one byte of the
+ * source are read.
+ *
+ * MERGE() gives the word starting @off bytes into @lo, the first of two
+ * adjacent aligned words @lo and @hi. @off must be 1 to sizeof(long) - 1.
+ */
+#define WORD_BYTES	sizeof(unsigned long)
+
+#ifdef __BIG_ENDIAN
+#define MERGE(lo, hi, off) \
+	(((lo) << (off) * 8) | ((hi) >> (WORD_BYTES - (off)) * 8))
+#else
+#define MERGE(lo, hi, off) \
+	(((lo) >> (off) * 8) | ((hi) << (WORD_BYTES - (off)) * 8))
+#endif
+#endif
+
+#if !CONFIG_IS_ENABLED(TINY_MEMCPY) && !defined(__HAVE_ARCH_MEMCPY)
+/* Copy @words words upwards from @s8 to @dl */
+static void copy_words_fwd(unsigned long *dl, const char *s8, size_t words)
+{
+	uint off = (ulong)s8 & (WORD_BYTES - 1);
+	const unsigned long *sl = (const unsigned long *)(s8 - off);
+	unsigned long lo, hi;
+
+	if (!off) {
+		for (; words >= 4; words -= 4, dl += 4, sl += 4) {
+			dl[0] = sl[0];
+			dl[1] = sl[1];
+			dl[2] = sl[2];
+			dl[3] = sl[3];
+		}
+		while (words--)
+			*dl++ = *sl++;
+		return;
+	}
+
+	lo = *sl++;
+	while (words--) {
+		hi = *sl++;
+		*dl++ = MERGE(lo, hi, off);
+		lo = hi;
+	}
+}
+#endif
+
 #ifndef __HAVE_ARCH_MEMCPY
 /**
  * memcpy - Copy one area of memory to another
@@ -508,22 +566,42 @@ void * memset(void * s,int c,size_t count)
  */
 void * memcpy(void *dest, const void *src, size_t count)
 {
-	unsigned long *dl = (unsigned long *)dest, *sl = (unsigned long *)src;
-	char *d8, *s8;
+	char *d8 = dest;
+	const char *s8 = src;
 
 	if (src == dest)
 		return dest;
 
+#if !CONFIG_IS_ENABLED(TINY_MEMCPY)
+	/* align the destination, then copy a word at a time */
+	if (count >= 2 * WORD_BYTES) {
+		size_t words;
+
+		while ((ulong)d8 & (WORD_BYTES - 1)) {
+			*d8++ = *s8++;
+			count--;
+		}
+		words = count / WORD_BYTES;
+		copy_words_fwd((unsigned long *)d8, s8, words);
+		d8 += words * WORD_BYTES;
+		s8 += words * WORD_BYTES;
+		count -= words * WORD_BYTES;
+	}
+#else
 	/* while all data is aligned (common case), copy a word at a time */
-	if ( (((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+	if ( (((ulong)dest | (ulong)src) & (sizeof(long) - 1)) == 0) {
+		unsigned long *dl = dest;
+		const unsigned long *sl = src;
+
 		while (count >= sizeof(*dl)) {
 			*dl++ = *sl++;
 			count -= sizeof(*dl);
 		}
+		d8 = (char *)dl;
+		s8 = (const char *)sl;
 	}
-	/* copy the reset one byte at a time */
-	d8 = (char *)dl;
-	s8 = (char *)sl;
+#endif
+	/* copy the rest one byte at a time */
 	while (count--)
 		*d8++ = *s8++;
 
@@ -532,6 +610,29 @@ void * memcpy(void *dest, const void *src, size_t count)
 #endif
 
 #ifndef __HAVE_ARCH_MEMMOVE
+#if !CONFIG_IS_ENABLED(TINY_MEMCPY)
+/* Copy @words words downwards, ending just below @s8 and @dl */
+static void copy_words_bwd(unsigned long *dl, const char *s8, size_t words)
+{
+	uint off = (ulong)s8 & (WORD_BYTES - 1);
+	const unsigned long *sl = (const unsigned long *)(s8 - off);
+	unsigned long lo, hi;
+
+	if (!off) {
+		while (words--)
+			*--dl = *--sl;
+		return;
+	}
+
+	hi = *sl;
+	while (words--) {
+		lo = *--sl;
+		*--dl = MERGE(lo, hi, off);
+		hi = lo;
+	}
+}
+#endif
+
 /**
  * memmove - Copy one area of memory to another
  * @dest: Where to copy to
@@ -542,16 +643,34 @@ void * memcpy(void *dest, const void *src, size_t count)
  */
 void * memmove(void * dest,const void *src,size_t count)
 {
-	char *tmp, *s;
+	char *d8;
+	const char *s8;
 
 	if (dest <= src) {
 		memcpy(dest, src, count);
-	} else {
-		tmp = (char *) dest + count;
-		s = (char *) src + count;
-		while (count--)
-			*--tmp = *--s;
+		return dest;
+	}
+
+	/* copy downwards, so the source is read before it is overwritten */
+	d8 = (char *)dest + count;
+	s8 = (const char *)src + count;
+#if !CONFIG_IS_ENABLED(TINY_MEMCPY)
+	if (count >= 2 * WORD_BYTES) {
+		size_t words;
+
+		while ((ulong)d8 & (WORD_BYTES - 1)) {
+			*--d8 = *--s8;
+			count--;
 		}
+		words = count / WORD_BYTES;
+		copy_words_bwd((unsigned long *)d8, s8, words);
+		d8 -= words * WORD_BYTES;
+		s8 -= words * WORD_BYTES;
+		count -= words * WORD_BYTES;
+	}
+#endif
+	while (count--)
+		*--d8 = *--s8;
 
 	return dest;
 }
@@ -14,6 +14,32 @@ DECLARE_GLOBAL_DATA_PTR;
 static char trace_enabled __attribute__((section(".data")));
 static char trace_inited __attribute__((section(".data")));
 
+#ifdef CONFIG_TRACE_FUNC_TIMES
+enum {
+	/* Number of functions whose time we can record (must be 2^n) */
+	TRACE_FUNC_TIME_BITS	= 13,
+	TRACE_FUNC_TIME_COUNT	= 1 << TRACE_FUNC_TIME_BITS,
+
+	/* Call depth to which we can time functions */
+	TRACE_STACK_DEPTH	= 64,
+};
+
+/* Time spent in a function, kept in a hash table in the trace buffer */
+struct trace_func_time {
+	uint32_t func;		/* Function number + 1, or 0 if unused */
+	uint32_t call_count;	/* Number of timed calls */
+	uint64_t incl_us;	/* Time in the function, including callees */
+	uint64_t excl_us;	/* Time in the function itself */
+};
+
+/* A function which is being timed */
+struct trace_frame {
+	uint32_t func;		/* Function number */
+	uint32_t start_us;	/* Time when the function was entered */
+	uint32_t child_us;	/* Time spent in callees so far */
+};
+#endif
+
 /* The header block at the start of the trace memory area */
 struct trace_hdr {
 	int func_count;		/* Total number of function call sites */
@@ -27,15 +53,29 @@ struct trace_hdr {
 	 */
 	uintptr_t *call_accum;
 
+#ifdef CONFIG_TRACE_FUNC_TIMES
+	/* Time spent in each function, a hash table by function number */
+	struct trace_func_time *func_time;
+	ulong untimed_count;	/* Calls not timed as the table was full */
+#endif
+
 	/* Function trace list */
 	struct trace_call *ftrace;	/* The function call records */
 	ulong ftrace_size;	/* Num. of ftrace records we have space for */
 	ulong ftrace_count;	/* Num. of ftrace records written */
 	ulong ftrace_too_deep_count;	/* Functions that were too deep */
+	ulong ftrace_next;	/* Next ftrace record to write */
+	bool ftrace_ring;	/* Overwrite the oldest records when full */
+	bool ftrace_wrapped;	/* ftrace_next has wrapped round to 0 */
 
 	int depth;
 	int depth_limit;
 	int max_depth;
+
+#ifdef CONFIG_TRACE_FUNC_TIMES
+	/* Functions currently being timed, indexed by depth */
+	struct trace_frame stack[TRACE_STACK_DEPTH];
+#endif
 };
 
 static struct trace_hdr *hdr;	/* Pointer to start of trace buffer */
@@ -56,28 +96,46 @@ static inline uintptr_t __attribute__((no_instrument_function))
 	return offset / FUNC_SITE_SIZE;
 }
 
+/* Get the next record to write, or NULL if the buffer is full */
+static struct trace_call *__attribute__((no_instrument_function))
+		next_ftrace(void)
+{
+	struct trace_call *rec;
+
+	if (hdr->ftrace_next >= hdr->ftrace_size)
+		return NULL;
+	rec = &hdr->ftrace[hdr->ftrace_next++];
+	if (hdr->ftrace_ring && hdr->ftrace_next == hdr->ftrace_size) {
+		hdr->ftrace_next = 0;
+		hdr->ftrace_wrapped = true;
+	}
+
+	return rec;
+}
+
 static void __attribute__((no_instrument_function)) add_ftrace(void *func_ptr,
-				void *caller, ulong flags)
+				void *caller, ulong flags, ulong now)
 {
+	struct trace_call *rec;
+
 	if (hdr->depth > hdr->depth_limit) {
 		hdr->ftrace_too_deep_count++;
 		return;
 	}
-	if (hdr->ftrace_count < hdr->ftrace_size) {
-		struct trace_call *rec = &hdr->ftrace[hdr->ftrace_count];
-
+	rec = next_ftrace();
+	if (rec) {
 		rec->func = func_ptr_to_num(func_ptr);
 		rec->caller = func_ptr_to_num(caller);
-		rec->flags = flags | (timer_get_us() & FUNCF_TIMESTAMP_MASK);
+		rec->flags = flags | (now & FUNCF_TIMESTAMP_MASK);
 	}
 	hdr->ftrace_count++;
 }
 
 static void __attribute__((no_instrument_function)) add_textbase(void)
 {
-	if (hdr->ftrace_count < hdr->ftrace_size) {
-		struct trace_call *rec = &hdr->ftrace[hdr->ftrace_count];
+	struct trace_call *rec = next_ftrace();
 
+	if (rec) {
 		rec->func = CONFIG_SYS_TEXT_BASE;
 		rec->caller = 0;
 		rec->flags = FUNCF_TEXTBASE;
@@ -85,6 +143,82 @@ static void __attribute__((no_instrument_function)) add_textbase(void)
 	hdr->ftrace_count++;
 }
 
+#ifdef CONFIG_TRACE_FUNC_TIMES
+/* Find the time record for a function, adding it if needed */
+static struct trace_func_time *__attribute__((no_instrument_function))
+		find_func_time(uint32_t func)
+{
+	struct trace_func_time *ft;
+	uint32_t i, pos;
+
+	pos = (func * 2654435761U) >> (32 - TRACE_FUNC_TIME_BITS);
+	for (i = 0; i < TRACE_FUNC_TIME_COUNT; i++) {
+		ft = &hdr->func_time[(pos + i) & (TRACE_FUNC_TIME_COUNT - 1)];
+		if (ft->func == func + 1)
+			return ft;
+		if (!ft->func) {
+			ft->func = func + 1;
+			return ft;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Add the time spent in a function which is returning. This is called after
+ * hdr->depth is decremented, so it indexes the function's own frame.
+ */
+static void __attribute__((no_instrument_function)) add_func_time(
+		uint32_t func, ulong now)
+{
+	struct trace_func_time *ft;
+	struct trace_frame *frame;
+	uint32_t elapsed;
+
+	if (hdr->depth < 0 || hdr->depth >= TRACE_STACK_DEPTH)
+		return;
+	frame = &hdr->stack[hdr->depth];
+	if (frame->func != func)
+		return;		/* entered before tracing was enabled */
+	elapsed = (uint32_t)now - frame->start_us;
+	ft = find_func_time(func);
+	if (ft) {
+		ft->call_count++;
+		ft->incl_us += elapsed;
+		ft->excl_us += elapsed - frame->child_us;
+	} else {
+		hdr->untimed_count++;
+	}
+	if (hdr->depth)
+		frame[-1].child_us += elapsed;
+}
+
+/* Start timing a function which is being entered */
+static void __attribute__((no_instrument_function)) start_func_time(
+		uint32_t func, ulong now)
+{
+	struct trace_frame *frame;
+
+	if (hdr->depth < 0 || hdr->depth >= TRACE_STACK_DEPTH)
+		return;
+	frame = &hdr->stack[hdr->depth];
+	frame->func = func;
+	frame->start_us = now;
+	frame->child_us = 0;
+}
+#else
+static inline void __attribute__((no_instrument_function)) add_func_time(
+		uint32_t func, ulong now)
+{
+}
+
+static inline void __attribute__((no_instrument_function)) start_func_time(
+		uint32_t func, ulong now)
+{
+}
+#endif
+
 /**
  * This is called on every function entry
  *
@@ -98,9 +232,10 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_enter(
 		void *func_ptr, void *caller)
 {
 	if (trace_enabled) {
+		ulong now = timer_get_us();
 		int func;
 
-		add_ftrace(func_ptr, caller, FUNCF_ENTRY);
+		add_ftrace(func_ptr, caller, FUNCF_ENTRY, now);
 		func = func_ptr_to_num(func_ptr);
 		if (func < hdr->func_count) {
 			hdr->call_accum[func]++;
@@ -108,6 +243,7 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_enter(
 		} else {
 			hdr->untracked_count++;
 		}
+		start_func_time(func, now);
 		hdr->depth++;
 		if (hdr->depth > hdr->depth_limit)
 			hdr->max_depth = hdr->depth;
@@ -117,7 +253,7 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_enter(
 /**
  * This is called on every function exit
  *
- * We do nothing here.
+ * We add the time spent in the function to its total.
  *
  * @param func_ptr	Pointer to function being entered
  * @param caller	Pointer to function which called this function
@@ -126,8 +262,12 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_exit(
 		void *func_ptr, void *caller)
 {
 	if (trace_enabled) {
-		add_ftrace(func_ptr, caller, FUNCF_EXIT);
+		ulong now = timer_get_us();
+
+		/* use the same depth as on entry, so both records are kept */
 		hdr->depth--;
+		add_ftrace(func_ptr, caller, FUNCF_EXIT, now);
+		add_func_time(func_ptr_to_num(func_ptr), now);
 	}
 }
 
@@ -187,12 +327,59 @@ int trace_list_functions(void *buff, int buff_size, unsigned int *needed)
 	return 0;
 }
 
+#ifdef CONFIG_TRACE_FUNC_TIMES
+int trace_list_times(void *buff, int buff_size, unsigned int *needed)
+{
+	struct trace_output_hdr *output_hdr = NULL;
+	void *end, *ptr = buff;
+	int i, upto;
+
+	end = buff ? buff + buff_size : NULL;
+
+	/* Place some header information */
+	if (ptr + sizeof(struct trace_output_hdr) < end)
+		output_hdr = ptr;
+	ptr += sizeof(struct trace_output_hdr);
+
+	/* Add information about each function which was timed */
+	for (i = upto = 0; i < TRACE_FUNC_TIME_COUNT; i++) {
+		struct trace_func_time *ft = &hdr->func_time[i];
+
+		if (!ft->func)
+			continue;
+
+		if (ptr + sizeof(struct trace_output_time) < end) {
+			struct trace_output_time *out = ptr;
+
+			out->offset = (ft->func - 1) * FUNC_SITE_SIZE;
+			out->call_count = ft->call_count;
+			out->incl_us = ft->incl_us;
+			out->excl_us = ft->excl_us;
+			upto++;
+		}
+		ptr += sizeof(struct trace_output_time);
+	}
+
+	/* Update the header */
+	if (output_hdr) {
+		output_hdr->rec_count = upto;
+		output_hdr->type = TRACE_CHUNK_TIMES;
+	}
+
+	/* Work out how must of the buffer we used */
+	*needed = ptr - buff;
+	if (ptr > end)
+		return -1;
+	return 0;
+}
+#endif
+
 int trace_list_calls(void *buff, int buff_size, unsigned *needed)
 {
 	struct trace_output_hdr *output_hdr = NULL;
 	void *end, *ptr = buff;
 	int rec, upto;
-	int count;
+	int count, first;
 
 	end = buff ? buff + buff_size : NULL;
 
@@ -201,15 +388,20 @@ int trace_list_calls(void *buff, int buff_size, unsigned *needed)
 		output_hdr = ptr;
 	ptr += sizeof(struct trace_output_hdr);
 
-	/* Add information about each call */
-	count = hdr->ftrace_count;
-	if (count > hdr->ftrace_size)
+	/* Add information about each call, oldest first */
+	if (hdr->ftrace_wrapped) {
 		count = hdr->ftrace_size;
+		first = hdr->ftrace_next;
+	} else {
+		count = min(hdr->ftrace_next, hdr->ftrace_size);
+		first = 0;
+	}
 	for (rec = upto = 0; rec < count; rec++) {
 		if (ptr + sizeof(struct trace_call) < end) {
-			struct trace_call *call = &hdr->ftrace[rec];
+			struct trace_call *call;
 			struct trace_call *out = ptr;
 
+			call = &hdr->ftrace[(first + rec) % hdr->ftrace_size];
 			out->func = call->func * FUNC_SITE_SIZE;
 			out->caller = call->caller * FUNC_SITE_SIZE;
 			out->flags = call->flags;
@@ -254,14 +446,20 @@ void trace_print_stats(void)
 	print_grouped_ull(count, 10);
 	puts(" traced function calls");
 	if (hdr->ftrace_count > hdr->ftrace_size) {
-		printf(" (%lu dropped due to overflow)",
-		       hdr->ftrace_count - hdr->ftrace_size);
+		printf(" (%lu %s)", hdr->ftrace_count - hdr->ftrace_size,
+		       hdr->ftrace_wrapped ? "older calls overwritten" :
+		       "dropped due to overflow");
 	}
 	puts("\n");
 	printf("%15d maximum observed call depth\n", hdr->max_depth);
 	printf("%15d call depth limit\n", hdr->depth_limit);
 	print_grouped_ull(hdr->ftrace_too_deep_count, 10);
 	puts(" calls not traced due to depth\n");
+#ifdef CONFIG_TRACE_FUNC_TIMES
+	print_grouped_ull(hdr->untimed_count, 10);
+	puts(" calls not timed due to function count\n");
+#endif
+	printf("%15s when full\n", hdr->ftrace_ring ? "overwrite" : "stop");
 }
 
 void __attribute__((no_instrument_function)) trace_set_enabled(int enabled)
@@ -269,6 +467,47 @@ void __attribute__((no_instrument_function)) trace_set_enabled(int enabled)
 	trace_enabled = enabled != 0;
 }
 
+void trace_set_ring(int ring)
+{
+	if (!trace_inited || !hdr->ftrace_size)
+		return;
+	/* If we already stopped at the end, start overwriting the oldest */
+	if (ring && hdr->ftrace_next >= hdr->ftrace_size) {
+		hdr->ftrace_next = 0;
+		hdr->ftrace_wrapped = true;
+	}
+	hdr->ftrace_ring = ring != 0;
+}
+
+/* Get the space needed for the header and tables, before the call records */
+static size_t __attribute__((no_instrument_function)) trace_needed(
+		ulong func_count)
+{
+	size_t needed = sizeof(*hdr) + func_count * sizeof(uintptr_t);
+
+#ifdef CONFIG_TRACE_FUNC_TIMES
+	needed += TRACE_FUNC_TIME_COUNT * sizeof(struct trace_func_time);
+#endif
+
+	return needed;
+}
+
+/* Set up the pointers to the tables which follow the header */
+static void __attribute__((no_instrument_function)) setup_tables(
+		size_t needed, size_t buff_size)
+{
+	hdr->call_accum = (uintptr_t *)(hdr + 1);
+#ifdef CONFIG_TRACE_FUNC_TIMES
+	hdr->func_time = (struct trace_func_time *)
+		(hdr->call_accum + hdr->func_count);
+#endif
+
+	/* Use any remaining space for the timed function trace */
+	hdr->ftrace = (struct trace_call *)((char *)hdr + needed);
+	hdr->ftrace_size = (buff_size - needed) / sizeof(*hdr->ftrace);
+	add_textbase();
+}
+
 /**
  * Init the tracing system ready for used, and enable it
  *
@@ -294,7 +533,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 		trace_enabled = 0;
 		hdr = map_sysmem(CONFIG_TRACE_EARLY_ADDR,
 				 CONFIG_TRACE_EARLY_SIZE);
-		end = (char *)&hdr->ftrace[hdr->ftrace_count];
+		end = (char *)&hdr->ftrace[hdr->ftrace_next];
 		used = end - (char *)hdr;
 		printf("trace: copying %08lx bytes of early data from %x to %08lx\n",
 		       used, CONFIG_TRACE_EARLY_ADDR,
@@ -306,7 +545,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 #endif
 	}
 	hdr = (struct trace_hdr *)buff;
-	needed = sizeof(*hdr) + func_count * sizeof(uintptr_t);
+	needed = trace_needed(func_count);
 	if (needed > buff_size) {
 		printf("trace: buffer size %zd bytes: at least %zd needed\n",
 		       buff_size, needed);
@@ -316,12 +555,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 	if (was_disabled)
 		memset(hdr, '\0', needed);
 	hdr->func_count = func_count;
-	hdr->call_accum = (uintptr_t *)(hdr + 1);
-
-	/* Use any remaining space for the timed function trace */
-	hdr->ftrace = (struct trace_call *)(buff + needed);
-	hdr->ftrace_size = (buff_size - needed) / sizeof(*hdr->ftrace);
-	add_textbase();
+	setup_tables(needed, buff_size);
 
 	puts("trace: enabled\n");
 	hdr->depth_limit = 15;
@@ -342,7 +576,7 @@ int __attribute__((no_instrument_function)) trace_early_init(void)
 		return 0;
 
 	hdr = map_sysmem(CONFIG_TRACE_EARLY_ADDR, CONFIG_TRACE_EARLY_SIZE);
-	needed = sizeof(*hdr) + func_count * sizeof(uintptr_t);
+	needed = trace_needed(func_count);
 	if (needed > buff_size) {
 		printf("trace: buffer size is %zd bytes, at least %zd needed\n",
 		       buff_size, needed);
@@ -350,13 +584,8 @@ int __attribute__((no_instrument_function)) trace_early_init(void)
 	}
 
 	memset(hdr, '\0', needed);
-	hdr->call_accum = (uintptr_t *)(hdr + 1);
 	hdr->func_count = func_count;
-
-	/* Use any remaining space for the timed function trace */
-	hdr->ftrace = (struct trace_call *)((char *)hdr + needed);
-	hdr->ftrace_size = (buff_size - needed) / sizeof(*hdr->ftrace);
-	add_textbase();
+	setup_tables(needed, buff_size);
 	hdr->depth_limit = 200;
 	printf("trace: early enable at %08x\n", CONFIG_TRACE_EARLY_ADDR);
 
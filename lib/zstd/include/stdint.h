@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/* Stub so that the zstd sources build without changes, see README.txt */
+#ifndef _ZSTD_STDINT_H
+#define _ZSTD_STDINT_H
+
+#include <linux/types.h>
+
+typedef long intptr_t;
+
+#endif
@@ -0,0 +1,8 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/* Stub so that the zstd sources build without changes, see README.txt */
+#ifndef _ZSTD_STDLIB_H
+#define _ZSTD_STDLIB_H
+
+#include <malloc.h>
+
+#endif
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * U-Boot interface to the Zstandard decompressor
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <u-boot/zstd.h>
+#include "zstd.h"
+#include "zstd_errors.h"
+
+struct zstd_stream {
+	ZSTD_DStream *ds;
+};
+
+static int zstd_to_errno(size_t ret)
+{
+	switch (ZSTD_getErrorCode(ret)) {
+	case ZSTD_error_dstSize_tooSmall:
+		return -ENOBUFS;
+	case ZSTD_error_memory_allocation:
+		return -ENOMEM;
+	case ZSTD_error_prefix_unknown:
+	case ZSTD_error_version_unsupported:
+	case ZSTD_error_frameParameter_unsupported:
+		return -EPROTONOSUPPORT;
+	default:
+		debug("zstd: %s\n", ZSTD_getErrorName(ret));
+		return -EPROTO;
+	}
+}
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	ZSTD_DCtx *dctx;
+	size_t ret;
+
+	dctx = ZSTD_createDCtx();
+	if (!dctx)
+		return -ENOMEM;
+	ret = ZSTD_decompressDCtx(dctx, dst, *dstn, src, srcn);
+	ZSTD_freeDCtx(dctx);
+	if (ZSTD_isError(ret))
+		return zstd_to_errno(ret);
+	*dstn = ret;
+
+	return 0;
+}
+
+struct zstd_stream *zstd_stream_new(void)
+{
+	struct zstd_stream *zs;
+
+	zs = malloc(sizeof(*zs));
+	if (!zs)
+		return NULL;
+	zs->ds = ZSTD_createDStream();
+	if (!zs->ds) {
+		free(zs);
+		return NULL;
+	}
+
+	return zs;
+}
+
+int zstd_stream_decompress(struct zstd_stream *zs, const void *src,
+			   size_t *srcn, void *dst, size_t *dstn)
+{
+	ZSTD_inBuffer in = { src, *srcn, 0 };
+	ZSTD_outBuffer out = { dst, *dstn, 0 };
+	size_t ret;
+
+	ret = ZSTD_decompressStream(zs->ds, &out, &in);
+	*srcn = in.pos;
+	*dstn = out.pos;
+	if (ZSTD_isError(ret))
+		return zstd_to_errno(ret);
+
+	return !ret;
+}
+
+void zstd_stream_free(struct zstd_stream *zs)
+{
+	if (!zs)
+		return;
+	ZSTD_freeDStream(zs->ds);
+	free(zs);
+}
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests and benchmarks for the command-line interface
+ */
+
+#include <common.h>
+#include <cli_hush.h>
+#include <command.h>
+#include <div64.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Declare a new cli test */
+#define CLI_TEST(_name, _flags)	UNIT_TEST(_name, _flags, cli_test)
+
+#ifdef CONFIG_HUSH_PARSE_CACHE
+/* Script which leaves a "for" loop early, so the loop must be tidied up */
+static const char cli_test_loop[] =
+	"setenv cli_out; "
+	"for i in a b c; do "
+		"setenv cli_out ${cli_out}${i}; "
+		"if test ${i} = b; then exit; fi; "
+	"done";
+
+/* Check that a script gives the same result when run from the cache */
+static int cli_test_parse_cache(struct unit_test_state *uts)
+{
+	uint hits, misses, old_hits, old_misses;
+
+	hush_parse_cache_enable(true);
+	ut_assertok(env_set("cli_script", cli_test_loop));
+	hush_parse_cache_stats(&old_hits, &old_misses);
+
+	ut_assertok(run_command("run cli_script", 0));
+	ut_asserteq_str("ab", env_get("cli_out"));
+	hush_parse_cache_stats(&hits, &misses);
+	ut_asserteq(old_misses + 1, misses);
+
+	ut_assertok(run_command("run cli_script", 0));
+	ut_asserteq_str("ab", env_get("cli_out"));
+	hush_parse_cache_stats(&hits, &misses);
+	ut_asserteq(old_hits + 1, hits);
+	ut_asserteq(old_misses + 1, misses);
+
+	/* changing the script must not run the old one */
+	ut_assertok(env_set("cli_script", "setenv cli_out changed"));
+	ut_assertok(run_command("run cli_script", 0));
+	ut_asserteq_str("changed", env_get("cli_out"));
+
+	env_set("cli_script", NULL);
+	env_set("cli_out", NULL);
+
+	return 0;
+}
+CLI_TEST(cli_test_parse_cache, 0);
+
+/* Run the distro boot scripts with nothing to boot, returning the time */
+static ulong cli_test_distro_us(int count)
+{
+	ulong start;
+	int i;
+
+	start = timer_get_us();
+	gd->flags |= GD_FLG_SILENT;
+	for (i = 0; i < count; i++) {
+		run_command("run distro_bootcmd", 0);
+		run_command("run scan_dev_for_boot_part", 0);
+		run_command("run scan_dev_for_boot", 0);
+	}
+	gd->flags &= ~GD_FLG_SILENT;
+
+	return timer_get_us() - start;
+}
+
+/*
+ * Compare running the distro boot scripts with and without the cache. The
+ * times are only reported, since they depend on the host. Check the cache
+ * statistics instead: once each script has been parsed, every later run
+ * should come from the cache.
+ */
+static int cli_test_parse_cache_run(struct unit_test_state *uts)
+{
+	const int count = 200;
+	uint hits, misses, old_hits, old_misses;
+	ulong uncached_us, cached_us;
+
+	ut_assertok(env_set("devtype", "host"));
+	ut_assertok(env_set("devnum", "0"));
+	ut_assertok(env_set("distro_bootpart", "1"));
+
+	/* Without the cache, nothing is counted */
+	hush_parse_cache_enable(false);
+	hush_parse_cache_stats(&old_hits, &old_misses);
+	uncached_us = cli_test_distro_us(count);
+	hush_parse_cache_stats(&hits, &misses);
+	ut_asserteq(old_hits, hits);
+	ut_asserteq(old_misses, misses);
+
+	/* The first run fills the cache and the rest only hit it */
+	hush_parse_cache_enable(true);
+	cli_test_distro_us(1);
+	hush_parse_cache_stats(&old_hits, &old_misses);
+	cached_us = cli_test_distro_us(count);
+	hush_parse_cache_stats(&hits, &misses);
+	ut_asserteq(old_misses, misses);
+	ut_assert(hits - old_hits >= count * 3);
+
+	printf("%d runs: uncached %lu us, cached %lu us (%lu%%), %u hits\n",
+	       count, uncached_us, cached_us,
+	       (ulong)lldiv((u64)cached_us * 100, max(uncached_us, 1UL)),
+	       hits - old_hits);
+
+	return 0;
+}
+
+static int cli_test_parse_cache_rate(struct unit_test_state *uts)
+{
+	int ret;
+
+	if (!env_get("distro_bootcmd")) {
+		printf("Skipping: no distro_bootcmd\n");
+		return 0;
+	}
+	ret = cli_test_parse_cache_run(uts);
+
+	/* Don't leave the boot device set for later tests */
+	env_set("devtype", NULL);
+	env_set("devnum", NULL);
+	env_set("devplist", NULL);
+	env_set("distro_bootpart", NULL);
+
+	return ret;
+}
+CLI_TEST(cli_test_parse_cache_rate, 0);
+#endif
+
+/* Check find_cmd() against a linear search, for every abbreviation */
+static int cli_test_cmd_lookup(struct unit_test_state *uts)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	char name[40];
+	cmd_tbl_t *cmdtp;
+	int len;
+
+	/* the linker should put the commands in order of name */
+	for (cmdtp = start + 1; cmdtp < start + count; cmdtp++)
+		ut_assert(strcmp(cmdtp[-1].name, cmdtp->name) < 0);
+
+	for (cmdtp = start; cmdtp < start + count; cmdtp++) {
+		ut_asserteq_ptr(cmdtp, find_cmd(cmdtp->name));
+		strlcpy(name, cmdtp->name, sizeof(name) - 2);
+		for (len = strlen(name); len >= 0; len--) {
+			name[len] = '\0';
+			ut_asserteq_ptr(find_cmd_tbl(name, start, count),
+					find_cmd(name));
+			strcat(name, ".b");
+			ut_asserteq_ptr(find_cmd_tbl(name, start, count),
+					find_cmd(name));
+			name[len] = '\0';
+		}
+	}
+	ut_assertnull(find_cmd("no-such-command"));
+	ut_assertnull(find_cmd(NULL));
+
+	return 0;
+}
+CLI_TEST(cli_test_cmd_lookup, 0);
+
+/*
+ * Compare looking up every command with find_cmd() and a linear search. The
+ * times depend on the host, so they are only reported. cli_test_cmd_lookup
+ * checks that both give the same results.
+ */
+static int cli_test_cmd_lookup_rate(struct unit_test_state *uts)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	const int rounds = 200;
+	ulong linear_us, sorted_us, start_us;
+	cmd_tbl_t *cmdtp;
+	int i;
+
+	start_us = timer_get_us();
+	for (i = 0; i < rounds; i++) {
+		for (cmdtp = start; cmdtp < start + count; cmdtp++)
+			find_cmd_tbl(cmdtp->name, start, count);
+	}
+	linear_us = timer_get_us() - start_us;
+
+	start_us = timer_get_us();
+	for (i = 0; i < rounds; i++) {
+		for (cmdtp = start; cmdtp < start + count; cmdtp++)
+			find_cmd(cmdtp->name);
+	}
+	sorted_us = timer_get_us() - start_us;
+
+	printf("%d lookups of %d commands: linear %lu us, find_cmd() %lu us\n",
+	       rounds * count, count, linear_us, sorted_us);
+
+	return 0;
+}
+CLI_TEST(cli_test_cmd_lookup_rate, 0);
+
+int do_ut_cli(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, cli_test);
+	const int n_ents = ll_entry_count(struct unit_test, cli_test);
+
+	return cmd_ut_category("cli", tests, n_ents, argc, argv);
+}
@@ -16,13 +16,21 @@ int cmd_ut_category(const char *name, struct unit_test *tests, int n_ents,
 {
 	struct unit_test_state uts = { .fail_count = 0 };
 	struct unit_test *test;
+	int n_manual = 0;
 
+	/* Tests which take a long time, such as benchmarks, must be named */
+	for (test = tests; test < tests + n_ents; test++) {
+		if (test->flags & UT_TESTF_MANUAL)
+			n_manual++;
+	}
 	if (argc == 1)
-		printf("Running %d %s tests\n", n_ents, name);
+		printf("Running %d %s tests\n", n_ents - n_manual, name);
 
 	for (test = tests; test < tests + n_ents; test++) {
 		if (argc > 1 && strcmp(argv[1], test->name))
 			continue;
+		if (argc == 1 && (test->flags & UT_TESTF_MANUAL))
+			continue;
 		printf("Test: %s\n", test->name);
 
 		uts.start = mallinfo();
@@ -53,10 +61,17 @@ static cmd_tbl_t cmd_ut_sub[] = {
 	U_BOOT_CMD_MKENT(unicode, CONFIG_SYS_MAXARGS, 1, do_ut_unicode, "", ""),
 #endif
 #ifdef CONFIG_SANDBOX
+	U_BOOT_CMD_MKENT(cli, CONFIG_SYS_MAXARGS, 1, do_ut_cli, "", ""),
 	U_BOOT_CMD_MKENT(compression, CONFIG_SYS_MAXARGS, 1, do_ut_compression,
 			 "", ""),
+	U_BOOT_CMD_MKENT(fs, CONFIG_SYS_MAXARGS, 1, do_ut_fs, "", ""),
 	U_BOOT_CMD_MKENT(bloblist, CONFIG_SYS_MAXARGS, 1, do_ut_bloblist,
 			 "", ""),
+	U_BOOT_CMD_MKENT(malloc, CONFIG_SYS_MAXARGS, 1, do_ut_malloc, "", ""),
+	U_BOOT_CMD_MKENT(mem, CONFIG_SYS_MAXARGS, 1, do_ut_mem, "", ""),
+#ifdef CONFIG_MMC_SANDBOX
+	U_BOOT_CMD_MKENT(mmc, CONFIG_SYS_MAXARGS, 1, do_ut_mmc, "", ""),
+#endif
 #endif
 };
 
@@ -100,7 +115,14 @@ static char ut_help_text[] =
 	"all - execute all enabled tests\n"
 #ifdef CONFIG_SANDBOX
 	"ut bloblist - Test bloblist implementation\n"
+	"ut cli - Test and benchmark the command line\n"
 	"ut compression - Test compressors and bootm decompression\n"
+	"ut fs - Test the fs layer with FAT and ext4 images\n"
+	"ut malloc - Test and benchmark the malloc() heap\n"
+	"ut mem - Test and benchmark memcpy(), memmove() and memset()\n"
+#ifdef CONFIG_MMC_SANDBOX
+	"ut mmc - Measure MMC throughput with the sandbox eMMC emulator\n"
+#endif
 #endif
 #ifdef CONFIG_UT_DM
 	"ut dm [test-name]\n"
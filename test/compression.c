@@ -8,7 +8,9 @@
 #include <command.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <os.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -18,6 +20,7 @@
 #include <lzma/LzmaTools.h>
 
 #include <linux/lzo.h>
+#include <u-boot/zstd.h>
 #include <test/compression.h>
 #include <test/suites.h>
 #include <test/ut.h>
@@ -117,6 +120,23 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 /tmp/plain.txt -o /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -292,6 +312,40 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size,  strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	size_t output_size = out_max;
+	int ret;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -436,6 +490,190 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
+/* Feed the stream a byte at a time, with one byte of output space */
+static int compression_test_zstd_stream(struct unit_test_state *uts)
+{
+	struct zstd_stream *zs;
+	char out[sizeof(plain)], bad[256];
+	size_t in_pos = 0, out_pos = 0, in_len, out_len;
+	int ret = 0;
+
+	zs = zstd_stream_new();
+	ut_assertnonnull(zs);
+	while (ret != 1) {
+		ut_assert(in_pos < zstd_compressed_size);
+		in_len = 1;
+		out_len = min(sizeof(out) - out_pos, (size_t)1);
+		ret = zstd_stream_decompress(zs, zstd_compressed + in_pos,
+					     &in_len, out + out_pos, &out_len);
+		ut_assert(ret >= 0);
+		in_pos += in_len;
+		out_pos += out_len;
+	}
+	zstd_stream_free(zs);
+	ut_asserteq(zstd_compressed_size, in_pos);
+	ut_asserteq(strlen(plain), out_pos);
+	ut_assertok(memcmp(plain, out, out_pos));
+
+	/* A corrupt checksum is reported */
+	ut_assert(zstd_compressed_size <= sizeof(bad));
+	memcpy(bad, zstd_compressed, zstd_compressed_size);
+	bad[zstd_compressed_size - 1] ^= 1;
+	zs = zstd_stream_new();
+	ut_assertnonnull(zs);
+	in_len = zstd_compressed_size;
+	out_len = sizeof(out);
+	ut_asserteq(-EPROTO, zstd_stream_decompress(zs, bad, &in_len,
+						   out, &out_len));
+	zstd_stream_free(zs);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_stream, 0);
+
+#if CONFIG_IS_ENABLED(CPU_WORK)
+enum {
+	LZ4_BLOCK_SIZE	= 64 << 10,	/* block maximum size ID 4 */
+	LZ4_BLOCKS	= 16,
+	LZ4_LAST_SIZE	= 1000,		/* size of the final, short block */
+	LZ4_FRAME_MAX	= LZ4_BLOCKS * (LZ4_BLOCK_SIZE + 4) + 16,
+	LZ4_OUT_SIZE	= LZ4_BLOCKS * LZ4_BLOCK_SIZE,
+};
+
+static u8 *lz4_put_le32(u8 *p, u32 val)
+{
+	put_unaligned_le32(val, p);
+
+	return p + 4;
+}
+
+/* Add a block which decompresses to len copies of val */
+static u8 *lz4_put_run_block(u8 *p, u8 val, int len)
+{
+	int ml = len - 1 - 5;	/* one literal, a match, five literals */
+	u8 *start = p + 4;
+	int extra;
+
+	p = start;
+	*p++ = 1 << 4 | min(ml - 4, 15);
+	*p++ = val;
+	*p++ = 1;	/* match offset 1 */
+	*p++ = 0;
+	for (extra = ml - 4 - 15; extra >= 0; extra -= 255)
+		*p++ = min(extra, 255);
+	*p++ = 5 << 4;
+	memset(p, val, 5);
+	p += 5;
+	lz4_put_le32(start - 4, p - start);
+
+	return p;
+}
+
+/*
+ * Make a frame with blocks which are alternately stored and compressed, and
+ * the output it should decompress to. All blocks are full except the last,
+ * and, if short_block is not -1, that one.
+ */
+static int lz4_make_frame(u8 *frame, u8 *out, int short_block)
+{
+	u8 *p = frame, *q = out;
+	int i, len, j;
+
+	p = lz4_put_le32(p, 0x184d2204);
+	*p++ = 0x60;	/* version 1, independent blocks */
+	*p++ = 0x40;	/* 64KB blocks */
+	*p++ = 0;	/* header checksum, not checked */
+	for (i = 0; i < LZ4_BLOCKS; i++) {
+		len = LZ4_BLOCK_SIZE;
+		if (i == LZ4_BLOCKS - 1 || i == short_block)
+			len = LZ4_LAST_SIZE;
+		if (i & 1) {
+			p = lz4_put_run_block(p, i, len);
+			memset(q, i, len);
+		} else {
+			p = lz4_put_le32(p, len | 1U << 31);
+			for (j = 0; j < len; j++)
+				p[j] = q[j] = i * 3 + j * 7;
+			p += len;
+		}
+		q += len;
+	}
+	p = lz4_put_le32(p, 0);
+
+	return p - frame;
+}
+
+/* Decompress a multi-block frame on one and on several CPUs */
+static int compression_test_lz4_blocks(struct unit_test_state *uts)
+{
+	static const int cpus[] = { 0, 1, 3 };
+	/* No short block, a short stored block and a short compressed block */
+	static const int shorts[] = { -1, 4, 5 };
+	u8 *frame, *expect, *out;
+	size_t frame_size, expect_size, out_size;
+	int short_block, i, j;
+	ulong start;
+
+	frame = malloc(LZ4_FRAME_MAX);
+	expect = malloc(LZ4_OUT_SIZE);
+	out = malloc(LZ4_OUT_SIZE);
+	ut_assertnonnull(frame);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(out);
+
+	/* A short block in the middle means the blocks must be done in turn */
+	for (j = 0; j < ARRAY_SIZE(shorts); j++) {
+		short_block = shorts[j];
+		frame_size = lz4_make_frame(frame, expect, short_block);
+		expect_size = (LZ4_BLOCKS - 1) * LZ4_BLOCK_SIZE + LZ4_LAST_SIZE;
+		if (short_block != -1)
+			expect_size -= LZ4_BLOCK_SIZE - LZ4_LAST_SIZE;
+		for (i = 0; i < ARRAY_SIZE(cpus); i++) {
+			sandbox_set_cpu_work_cpus(cpus[i]);
+			memset(out, 'A', LZ4_OUT_SIZE);
+			out_size = LZ4_OUT_SIZE;
+			start = timer_get_us();
+			ut_assertok(ulz4fn(frame, frame_size, out, &out_size));
+			printf("\t%d block%s, %d secondary CPUs: %lu us\n",
+			       LZ4_BLOCKS, short_block == -1 ? "s" :
+			       "s, one short", cpus[i], timer_get_us() - start);
+			ut_asserteq(expect_size, out_size);
+			ut_assertok(memcmp(expect, out, expect_size));
+
+			/* Too little space for the output */
+			out_size = expect_size - 1;
+			ut_assert(ulz4fn(frame, frame_size, out, &out_size) < 0);
+
+			/* The source size need not be known */
+			memset(out, 'A', LZ4_OUT_SIZE);
+			out_size = LZ4_OUT_SIZE;
+			ut_assertok(ulz4fn(frame, ~0UL, out, &out_size));
+			ut_asserteq(expect_size, out_size);
+			ut_assertok(memcmp(expect, out, expect_size));
+		}
+	}
+
+	/* Nothing is written if the header is cut short */
+	out_size = LZ4_OUT_SIZE;
+	ut_asserteq(-EINVAL, ulz4fn(frame, 4, out, &out_size));
+	ut_asserteq(0, out_size);
+	sandbox_set_cpu_work_cpus(-1);
+	free(out);
+	free(expect);
+	free(frame);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_lz4_blocks, 0);
+#endif
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -526,12 +764,254 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/*
+ * Benchmark of the decompressors
+ *
+ * Each decompressor is timed on the sorts of payload it is used for when
+ * booting, at sizes from 4KB up, giving the speed and the compression ratio.
+ * With CONFIG_SYS_MALLOC_STATS it also gives the most heap each decompressor
+ * uses; without it the heap column is left out.
+ *
+ * The payloads and their compressed forms are made with the host tools by
+ * test/py (see test_perf_decomp_bench()), so they are the same on each run.
+ * They are read from a directory, with names like kernel.4096 for a payload
+ * and kernel.4096.gz once compressed. Any which are missing are skipped.
+ *
+ * This takes a while, so it only runs when named:
+ *	ut compression compression_test_bench_norun
+ *
+ * Environment variables control the benchmark:
+ *	compression_bench_dir	directory holding the files
+ *				(default compression_bench)
+ *	compression_bench_max	largest size in hex (default 1MB)
+ *	compression_bench_format	'csv' for output which is easy to parse
+ */
+enum {
+	BENCH_MIN_SIZE		= 4 << 10,
+	BENCH_DEF_MAX_SIZE	= 1 << 20,
+	BENCH_BYTES		= 1 << 20,	/* output per measurement */
+};
+
+static const char *const bench_payloads[] = {
+	"kernel",	/* like an uncompressed ARM kernel */
+	"fdt",		/* a device tree with many devices */
+	"cpio",		/* an initramfs with scripts and programs */
+	"random",	/* data which does not compress */
+};
+
+static const struct {
+	const char *name;
+	const char *ext;	/* file extension used by the host tool */
+	mutate_func uncompress;
+} bench_codecs[] = {
+	{ "gzip", "gz", uncompress_using_gzip },
+	{ "bzip2", "bz2", uncompress_using_bzip2 },
+	{ "lzma", "lzma", uncompress_using_lzma },
+	{ "lzo", "lzo", uncompress_using_lzo },
+	{ "lz4", "lz4", uncompress_using_lz4 },
+	{ "zstd", "zst", uncompress_using_zstd },
+};
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+/* Start counting the heap used, returning the amount in use now */
+static ulong bench_heap_start(void)
+{
+	struct malloc_heap_stats stats;
+
+	malloc_reset_stats();
+	malloc_get_stats(&stats);
+
+	return stats.in_use;
+}
+
+/* Get the most heap used since bench_heap_start() */
+static ulong bench_heap_peak(ulong start)
+{
+	struct malloc_heap_stats stats;
+
+	malloc_get_stats(&stats);
+
+	return stats.peak - start;
+}
+#endif
+
+/* Print a size in KB or MB */
+static void bench_print_size(ulong size)
+{
+	if (size >= 1 << 20 && !(size & ((1 << 20) - 1)))
+		printf("%4luM", size >> 20);
+	else
+		printf("%4luK", size >> 10);
+}
+
+/* Check that a payload decompresses and time the decompressor */
+static int bench_codec_run(struct unit_test_state *uts, int c, int p,
+			   void *comp, int comp_size, u8 *payload, ulong size,
+			   u8 *out, bool csv)
+{
+	mutate_func uncompress = bench_codecs[c].uncompress;
+	ulong out_size, count, i, start, us, ratio;
+	ulong heap = 0;
+
+	/* Check the output, and the heap used */
+	memset(out, '\0', size);
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+	heap = bench_heap_start();
+#endif
+	ut_assertok(uncompress(uts, comp, comp_size, out, size, &out_size));
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+	heap = bench_heap_peak(heap);
+#endif
+	ut_asserteq(size, out_size);
+	ut_assertok(memcmp(payload, out, size));
+
+	count = max(BENCH_BYTES / size, 1UL);
+	start = timer_get_us();
+	for (i = 0; i < count; i++)
+		uncompress(uts, comp, comp_size, out, size, NULL);
+	us = max(timer_get_us() - start, 1UL);
+
+	if (csv) {
+		printf("%s,%lu,%s,%d,%lu,%lu,%lu", bench_payloads[p], size,
+		       bench_codecs[c].name, comp_size, count, us,
+		       size * count / us);
+		if (CONFIG_IS_ENABLED(SYS_MALLOC_STATS))
+			printf(",%lu", heap);
+		printf("\n");
+		return 0;
+	}
+	ratio = (u64)comp_size * 1000 / size;
+	printf("%-7s ", bench_payloads[p]);
+	bench_print_size(size);
+	printf(" %-6s %10d %3lu.%lu%% %4lu MB/s", bench_codecs[c].name,
+	       comp_size, ratio / 10, ratio % 10, size * count / us);
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_STATS))
+		printf(" %6luK", heap >> 10);
+	printf("\n");
+
+	return 0;
+}
+
+/* Read the compressed file for a payload and benchmark it, if it exists */
+static int bench_codec(struct unit_test_state *uts, int c, int p,
+		       const char *dir, u8 *payload, ulong size, u8 *out,
+		       bool csv)
+{
+	char fname[256];
+	loff_t fsize;
+	int comp_size;
+	void *comp;
+	int ret;
+
+	snprintf(fname, sizeof(fname), "%s/%s.%lu.%s", dir, bench_payloads[p],
+		 size, bench_codecs[c].ext);
+	if (os_get_filesize(fname, &fsize)) {
+		if (!csv)
+			printf("%s: skipped, no file\n", fname);
+		return 0;
+	}
+	ut_assertok(os_read_file(fname, &comp, &comp_size));
+	ret = bench_codec_run(uts, c, p, comp, comp_size, payload, size, out,
+			      csv);
+	os_free(comp);
+
+	return ret;
+}
+
+/* Benchmark each decompressor on a payload */
+static int bench_payload(struct unit_test_state *uts, int p, const char *dir,
+			 u8 *payload, int len, ulong size, u8 *out, bool csv)
+{
+	int c;
+
+	ut_asserteq(size, len);
+	for (c = 0; c < ARRAY_SIZE(bench_codecs); c++)
+		ut_assertok(bench_codec(uts, c, p, dir, payload, size, out,
+					csv));
+
+	return 0;
+}
+
+/* Benchmark each payload size in turn, counting the payloads found */
+static int bench_payloads_run(struct unit_test_state *uts, const char *dir,
+			      ulong max_size, u8 *out, bool csv, int *foundp)
+{
+	char fname[256];
+	void *payload;
+	loff_t fsize;
+	ulong size;
+	int len;
+	int ret;
+	int p;
+
+	for (p = 0; p < ARRAY_SIZE(bench_payloads); p++) {
+		for (size = BENCH_MIN_SIZE; size <= max_size; size <<= 2) {
+			snprintf(fname, sizeof(fname), "%s/%s.%lu", dir,
+				 bench_payloads[p], size);
+			if (os_get_filesize(fname, &fsize))
+				break;
+			ut_assertok(os_read_file(fname, &payload, &len));
+			ret = bench_payload(uts, p, dir, payload, len, size,
+					    out, csv);
+			os_free(payload);
+			if (ret)
+				return ret;
+			(*foundp)++;
+		}
+	}
+
+	return 0;
+}
+
+static int compression_test_bench_norun(struct unit_test_state *uts)
+{
+	const char *dir = env_get("compression_bench_dir");
+	const char *format = env_get("compression_bench_format");
+	bool csv = format && !strcmp(format, "csv");
+	const char *heap = "";
+	ulong max_size;
+	int found = 0;
+	int ret;
+	u8 *out;
+
+	if (!dir)
+		dir = "compression_bench";
+	max_size = env_get_hex("compression_bench_max", BENCH_DEF_MAX_SIZE);
+
+	/* Keep the buffers out of the heap, so only the decoder is counted */
+	out = os_malloc(max_size);
+	ut_assertnonnull(out);
+
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_STATS))
+		heap = csv ? ",heap" : "    Heap";
+	if (csv)
+		printf("payload,size,codec,compressed,count,us,mb_s%s\n", heap);
+	else
+		printf("%-7s %5s %-6s %10s %6s %9s%s\n", "Payload", "Size",
+		       "Codec", "Compressed", "Ratio", "Speed", heap);
+	ret = bench_payloads_run(uts, dir, max_size, out, csv, &found);
+	os_free(out);
+	if (ret)
+		return ret;
+	if (!found)
+		printf("%s: skipped, no payloads\n", dir);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_bench_norun, UT_TESTF_MANUAL);
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <dm/arena.h>
 #include <dm/device-internal.h>
 #include <dm/root.h>
 #include <dm/util.h>
@@ -471,6 +472,59 @@ static int dm_test_remove(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_remove, DM_TESTF_SCAN_PDATA | DM_TESTF_PROBE_TEST);
 
+/* Test that a device can be started early and completed when it is used */
+static int dm_test_probe_start(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *dev, *dev1;
+
+	ut_assertok(uclass_find_device(UCLASS_TEST, 0, &dev));
+	ut_assert(!device_active(dev));
+
+	/* A normal probe does not use the start/complete methods */
+	ut_assertok(device_probe(dev));
+	ut_asserteq(0, dm_testdrv_op_count[DM_TEST_OP_PROBE_START]);
+	ut_asserteq(0, dm_testdrv_op_count[DM_TEST_OP_PROBE_COMPLETE]);
+
+	/* Nothing is started for a device which is already active */
+	ut_assertok(device_probe_start(dev));
+	ut_asserteq(0, dm_testdrv_op_count[DM_TEST_OP_PROBE_START]);
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+
+	ut_assertok(device_probe_start(dev));
+	ut_assert(device_active(dev));
+	ut_assert(dev->flags & DM_FLAG_PROBE_PENDING);
+	ut_asserteq(1, dm_testdrv_op_count[DM_TEST_OP_PROBE_START]);
+	ut_asserteq(0, dm_testdrv_op_count[DM_TEST_OP_PROBE_COMPLETE]);
+
+	/* Getting the device completes it, once */
+	ut_assertok(uclass_get_device(UCLASS_TEST, 0, &dev1));
+	ut_asserteq_ptr(dev, dev1);
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(1, dm_testdrv_op_count[DM_TEST_OP_PROBE_COMPLETE]);
+	ut_assertok(uclass_get_device(UCLASS_TEST, 0, &dev1));
+	ut_asserteq(1, dm_testdrv_op_count[DM_TEST_OP_PROBE_COMPLETE]);
+
+	/* Removing a pending device drops the pending state */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_probe_start(dev));
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_assertok(device_probe(dev));
+	ut_asserteq(1, dm_testdrv_op_count[DM_TEST_OP_PROBE_COMPLETE]);
+
+	/* If completion fails, the device is removed */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_probe_start(dev));
+	dms->fail_probe_complete = 1;
+	ut_asserteq(-EIO, uclass_get_device(UCLASS_TEST, 0, &dev1));
+	ut_assert(!device_active(dev));
+	dms->fail_probe_complete = 0;
+
+	return 0;
+}
+DM_TEST(dm_test_probe_start, DM_TESTF_SCAN_PDATA);
+
 /* Remove and recreate everything, check for memory leaks */
 static int dm_test_leak(struct unit_test_state *uts)
 {
@@ -901,3 +955,41 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+#if CONFIG_IS_ENABLED(DM_ARENA)
+/* Test that bind-time data comes from the arena only while it is open */
+static int dm_test_arena(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct dm_arena *old_arena = gd->dm_arena;
+	struct udevice *dev, *dev2;
+	struct uclass *uc;
+
+	/* Create the uclass first, since it outlives the arena */
+	ut_assertok(uclass_get(UCLASS_TEST, &uc));
+	gd->dm_arena = NULL;
+	ut_assertok(dm_arena_open());
+	ut_assertnonnull(gd->dm_arena);
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_manual,
+					&dev));
+	ut_assert(dm_arena_contains(dev));
+	ut_assert(gd->dm_arena->allocs > 0);
+	ut_assert(gd->dm_arena->used > 0);
+
+	/* Once closed, allocations come from malloc() again */
+	dm_arena_close();
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_manual,
+					&dev2));
+	ut_assert(!dm_arena_contains(dev2));
+
+	/* Unbinding must not try to free memory in the arena */
+	ut_assertok(device_unbind(dev));
+	ut_assertok(device_unbind(dev2));
+	dm_arena_release();
+	ut_assertnull(gd->dm_arena);
+	gd->dm_arena = old_arena;
+
+	return 0;
+}
+DM_TEST(dm_test_arena, 0);
+#endif
@@ -35,6 +35,50 @@ static int dm_test_dma_m2m(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_dma_m2m, DM_TESTF_SCAN_FDT);
 
+static int dm_test_dma_m2m_async(struct unit_test_state *uts)
+{
+	struct dma_copy copy[6];
+	u8 src_buf[512];
+	u8 dst_buf[6][512];
+	size_t len = 512;
+	int i;
+
+	memset(dst_buf, 0, sizeof(dst_buf));
+	for (i = 0; i < len; i++)
+		src_buf[i] = i;
+
+	/* The sandbox driver copies nothing until it is waited for */
+	ut_assertok(dma_memcpy_start(&copy[0], dst_buf[0], src_buf, len));
+	ut_assertnonnull(copy[0].dev);
+	ut_asserteq(0, dst_buf[0][1]);
+
+	/* This reads the first copy's destination, so relies on ordering */
+	ut_assertok(dma_memcpy_start(&copy[1], dst_buf[1], dst_buf[0], len));
+	ut_assertok(dma_memcpy_wait(&copy[1]));
+	ut_assertok(memcmp(src_buf, dst_buf[1], len));
+	ut_assertok(memcmp(src_buf, dst_buf[0], len));
+	ut_assertok(dma_memcpy_wait(&copy[0]));
+
+	/* Fill the driver's queue; the oldest copy completes to make room */
+	memset(dst_buf, 0, sizeof(dst_buf));
+	for (i = 1; i < 6; i++)
+		ut_assertok(dma_memcpy_start(&copy[i], dst_buf[i], src_buf,
+					     len));
+	ut_assertok(memcmp(src_buf, dst_buf[1], len));
+	ut_asserteq(0, dst_buf[2][1]);
+	ut_assertok(dma_memcpy_wait(&copy[4]));
+	ut_assertok(memcmp(src_buf, dst_buf[4], len));
+	ut_asserteq(0, dst_buf[5][1]);
+	ut_assertok(dma_memcpy_wait(&copy[5]));
+	ut_assertok(memcmp(src_buf, dst_buf[5], len));
+
+	/* Waiting again does nothing */
+	ut_assertok(dma_memcpy_wait(&copy[5]));
+
+	return 0;
+}
+DM_TEST(dm_test_dma_m2m_async, DM_TESTF_SCAN_FDT);
+
 static int dm_test_dma(struct unit_test_state *uts)
 {
 	struct udevice *dev;
@@ -5,8 +5,16 @@
 
 #include <common.h>
 #include <dm.h>
+#include <hexdump.h>
+#include <mapmem.h>
 #include <mmc.h>
+#include <os.h>
+#include <sparse_format.h>
+#include <asm/test.h>
+#include <asm/unaligned.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
+#include <dm/uclass-internal.h>
 #include <test/ut.h>
 
 /*
@@ -41,3 +49,305 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check reads, writes and erases on the file-backed eMMC emulator */
+static int dm_test_mmc_emmc(struct unit_test_state *uts)
+{
+	const int count = 0x900;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	uint reads;
+	u8 *src, *dst;
+	int i;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc3", &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertnonnull(mmc);
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(MMC_HS_200, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+	ut_assert(sandbox_mmc_get_cmd_count(dev,
+					    MMC_CMD_SEND_TUNING_BLOCK_HS200));
+	ut_asserteq(16 << 20, mmc->capacity_user);
+	ut_asserteq(128 << 10, mmc->capacity_boot);
+	ut_asserteq(128 << 10, mmc->capacity_rpmb);
+	ut_asserteq(1024, mmc->erase_grp_size);
+	ut_assert(mmc->erase_zero);
+
+	desc = mmc_get_blk_desc(mmc);
+	ut_asserteq(512, desc->blksz);
+	ut_asserteq((16 << 20) / 512, desc->lba);
+
+	src = malloc(count * 512);
+	dst = malloc(count * 512);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	for (i = 0; i < count * 512; i++)
+		src[i] = i * 3 + (i >> 9);
+
+	/* Transfers longer than b_max are split into several commands */
+	ut_asserteq(count, blk_dwrite(desc, 0x1000, count, src));
+	reads = sandbox_mmc_get_cmd_count(dev, MMC_CMD_READ_MULTIPLE_BLOCK);
+	ut_asserteq(count, blk_dread(desc, 0x1000, count, dst));
+	ut_asserteq_mem(src, dst, count * 512);
+	ut_asserteq(reads + 2,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_READ_MULTIPLE_BLOCK));
+
+	reads = sandbox_mmc_get_cmd_count(dev, MMC_CMD_READ_SINGLE_BLOCK);
+	ut_asserteq(1, blk_dread(desc, 0x1001, 1, dst));
+	ut_asserteq_mem(src + 512, dst, 512);
+	ut_asserteq(reads + 1,
+		    sandbox_mmc_get_cmd_count(dev, MMC_CMD_READ_SINGLE_BLOCK));
+
+	/* Erasing one erase group leaves zeroes and does not touch the rest */
+	ut_asserteq(1024, blk_derase(desc, 0x1400, 1024));
+	ut_asserteq(count, blk_dread(desc, 0x1000, count, dst));
+	ut_asserteq_mem(src, dst, 0x400 * 512);
+	for (i = 0x400 * 512; i < 0x800 * 512; i++)
+		ut_asserteq(0, dst[i]);
+	ut_asserteq_mem(src + 0x800 * 512, dst + 0x800 * 512,
+			(count - 0x800) * 512);
+
+	/* Access past the end of the user area fails */
+	ut_asserteq(0, blk_dread(desc, desc->lba - 1, 2, dst));
+
+	free(src);
+	free(dst);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_emmc, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check switching between the hardware partitions of the eMMC emulator */
+static int dm_test_mmc_emmc_part(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char buf[512], user[512];
+	int fd;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc3", &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertok(mmc_init(mmc));
+	desc = mmc_get_blk_desc(mmc);
+
+	memset(user, 'u', sizeof(user));
+	ut_asserteq(1, blk_dwrite(desc, 0, 1, user));
+
+	/* Each boot partition has its own data, stored after the user area */
+	ut_assertok(blk_dselect_hwpart(desc, 1));
+	ut_asserteq(1, desc->hwpart);
+	ut_asserteq((128 << 10) / 512, desc->lba);
+	memset(buf, '1', sizeof(buf));
+	ut_asserteq(1, blk_dwrite(desc, 0, 1, buf));
+
+	ut_assertok(blk_dselect_hwpart(desc, 2));
+	memset(buf, '2', sizeof(buf));
+	ut_asserteq(1, blk_dwrite(desc, 1, 1, buf));
+	ut_asserteq(1, blk_dread(desc, 1, 1, buf));
+	ut_asserteq('2', buf[0]);
+
+	ut_assertok(blk_dselect_hwpart(desc, 1));
+	ut_asserteq(1, blk_dread(desc, 0, 1, buf));
+	ut_asserteq('1', buf[511]);
+
+	fd = os_open("emmc.bin", OS_O_RDONLY);
+	ut_assert(fd >= 0);
+	ut_asserteq(16 << 20, os_lseek(fd, 16 << 20, OS_SEEK_SET));
+	ut_asserteq(1, os_read(fd, buf, 1));
+	ut_asserteq('1', buf[0]);
+	ut_asserteq((16 << 20) + (128 << 10) + 512,
+		    os_lseek(fd, (16 << 20) + (128 << 10) + 512, OS_SEEK_SET));
+	ut_asserteq(1, os_read(fd, buf, 1));
+	ut_asserteq('2', buf[0]);
+	os_close(fd);
+
+	/* RPMB can be selected, but plain reads are refused */
+	ut_assertok(blk_dselect_hwpart(desc, 3));
+	ut_asserteq(0, blk_dread(desc, 0, 1, buf));
+
+	/* There are no general-purpose partitions */
+	ut_assert(blk_dselect_hwpart(desc, 4));
+
+	ut_assertok(blk_dselect_hwpart(desc, 0));
+	ut_asserteq((16 << 20) / 512, desc->lba);
+	ut_asserteq(1, blk_dread(desc, 0, 1, buf));
+	ut_asserteq_mem(user, buf, sizeof(buf));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_emmc_part, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_CMD_MMC_SWRITE
+/* Add a chunk to a sparse image, returning a pointer to its data */
+static void *add_sparse_chunk(void **posp, sparse_header_t *hdr, uint type,
+			      uint blocks, uint data_size)
+{
+	chunk_header_t *chunk = *posp;
+
+	chunk->chunk_type = cpu_to_le16(type);
+	chunk->reserved1 = 0;
+	chunk->chunk_sz = cpu_to_le32(blocks);
+	chunk->total_sz = cpu_to_le32(sizeof(*chunk) + data_size);
+	*posp += sizeof(*chunk) + data_size;
+	hdr->total_blks = cpu_to_le32(le32_to_cpu(hdr->total_blks) + blocks);
+	hdr->total_chunks = cpu_to_le32(le32_to_cpu(hdr->total_chunks) + 1);
+
+	return chunk + 1;
+}
+
+/* Check writing a sparse image with 'mmc swrite' */
+static int dm_test_mmc_swrite(struct unit_test_state *uts)
+{
+	const int blksz = 4096, start = 0x2000, sectors = 392 * 8;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	sparse_header_t *hdr;
+	u8 *raw1, *raw2, *raw3, *dst;
+	u32 *fill;
+	struct mmc *mmc;
+	uint erases;
+	void *pos;
+	int i;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc3", &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertok(mmc_init(mmc));
+	desc = mmc_get_blk_desc(mmc);
+
+	/* Start with data everywhere, so that zeroes must be written */
+	dst = malloc((sectors + 1) * 512);
+	ut_assertnonnull(dst);
+	memset(dst, '\xa5', (sectors + 1) * 512);
+	ut_asserteq(sectors + 1, blk_dwrite(desc, start, sectors + 1, dst));
+
+	hdr = map_sysmem(0x100000, 0x10000);
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->magic = cpu_to_le32(SPARSE_HEADER_MAGIC);
+	hdr->major_version = cpu_to_le16(1);
+	hdr->file_hdr_sz = cpu_to_le16(sizeof(*hdr));
+	hdr->chunk_hdr_sz = cpu_to_le16(sizeof(chunk_header_t));
+	hdr->blk_sz = cpu_to_le32(blksz);
+	pos = hdr + 1;
+
+	/* Small chunks, which are collected and written together */
+	raw1 = add_sparse_chunk(&pos, hdr, CHUNK_TYPE_RAW, 3, 3 * blksz);
+	for (i = 0; i < 3 * blksz; i++)
+		raw1[i] = i * 3 + (i >> 9);
+	fill = add_sparse_chunk(&pos, hdr, CHUNK_TYPE_FILL, 2, 4);
+	*fill = cpu_to_le32(0xdeadbeef);
+	raw2 = add_sparse_chunk(&pos, hdr, CHUNK_TYPE_RAW, 1, blksz);
+	memset(raw2, 'r', blksz);
+
+	/* 1MiB of zeroes, covering one whole erase group */
+	fill = add_sparse_chunk(&pos, hdr, CHUNK_TYPE_FILL, 256, 4);
+	*fill = 0;
+
+	/* 512KiB which may be left as it is, or erased */
+	add_sparse_chunk(&pos, hdr, CHUNK_TYPE_DONT_CARE, 128, 0);
+	raw3 = add_sparse_chunk(&pos, hdr, CHUNK_TYPE_RAW, 2, 2 * blksz);
+	memset(raw3, 'e', 2 * blksz);
+
+	erases = sandbox_mmc_get_cmd_count(dev, MMC_CMD_ERASE);
+	ut_assertok(run_command("mmc dev 3", 0));
+	ut_assertok(run_command("mmc swrite 100000 2000", 0));
+	ut_assert(sandbox_mmc_get_cmd_count(dev, MMC_CMD_ERASE) > erases);
+
+	ut_asserteq(sectors, blk_dread(desc, start, sectors, dst));
+	ut_asserteq_mem(raw1, dst, 3 * blksz);
+	for (i = 0; i < 2 * blksz; i += 4)
+		ut_asserteq(0xdeadbeef, get_unaligned_le32(dst + 3 * blksz + i));
+	ut_asserteq_mem(raw2, dst + 5 * blksz, blksz);
+	for (i = 6 * blksz; i < 262 * blksz; i++)
+		ut_asserteq(0, dst[i]);
+	ut_asserteq_mem(raw3, dst + 390 * blksz, 2 * blksz);
+
+	/* The next block is not touched */
+	ut_asserteq(1, blk_dread(desc, start + sectors, 1, dst));
+	ut_asserteq(0xa5, dst[0]);
+
+	free(dst);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_swrite, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+/* Check that an eMMC can power up while other devices are set up */
+static int dm_test_mmc_probe_start(struct unit_test_state *uts)
+{
+	ulong start, sync_us, deferred_us;
+	struct udevice *dev, *dev1;
+	struct mmc *mmc;
+
+	/* A normal probe leaves the card alone until it is used */
+	ut_assertok(uclass_find_device_by_name(UCLASS_MMC, "mmc3", &dev));
+	ut_assertok(device_probe(dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assert(!mmc->init_in_progress);
+	ut_asserteq(0, sandbox_mmc_get_cmd_count(dev, MMC_CMD_SEND_OP_COND));
+	start = timer_get_us();
+	ut_assertok(mmc_init(mmc));
+	sync_us = timer_get_us() - start;
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	mmc->has_init = 0;
+
+	/* Start it early this time */
+	ut_assertok(device_probe_start(dev));
+	ut_assert(dev->flags & DM_FLAG_PROBE_PENDING);
+	ut_assert(mmc->init_in_progress);
+	ut_assert(!mmc->has_init);
+	ut_assert(sandbox_mmc_get_cmd_count(dev, MMC_CMD_SEND_OP_COND));
+	ut_asserteq(0, sandbox_mmc_get_cmd_count(dev, MMC_CMD_ALL_SEND_CID));
+
+	/* Do something else while the card powers up (20ms) */
+	mdelay(25);
+
+	/* Getting the device finishes init, without waiting for power-up */
+	start = timer_get_us();
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc3", &dev1));
+	deferred_us = timer_get_us() - start;
+	ut_asserteq_ptr(dev, dev1);
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(mmc->has_init);
+	ut_asserteq(1, sandbox_mmc_get_cmd_count(dev, MMC_CMD_ALL_SEND_CID));
+	ut_asserteq(MMC_HS_200, mmc->selected_mode);
+	ut_assert(deferred_us + 15000 < sync_us);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_probe_start, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that mmc_initialize() leaves the eMMC to power up in the background */
+static int dm_test_mmc_initialize(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct mmc *mmc;
+
+	/* Go through the same steps as initr_mmc() does at boot */
+	mmc_reset_initialize();
+	ut_assertok(mmc_initialize(NULL));
+
+	ut_assertok(uclass_find_device_by_name(UCLASS_MMC, "mmc3", &dev));
+	ut_assert(dev->flags & DM_FLAG_ACTIVATED);
+	ut_assert(dev->flags & DM_FLAG_PROBE_PENDING);
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assert(mmc->init_in_progress);
+	ut_assert(!mmc->has_init);
+	ut_assert(sandbox_mmc_get_cmd_count(dev, MMC_CMD_SEND_OP_COND));
+	ut_asserteq(0, sandbox_mmc_get_cmd_count(dev, MMC_CMD_ALL_SEND_CID));
+
+	/* Listing the devices must not wait for it either */
+	print_mmc_devices(',');
+	ut_assert(dev->flags & DM_FLAG_PROBE_PENDING);
+	ut_assert(!mmc->has_init);
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc3", &dev));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_assert(mmc->has_init);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_initialize, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
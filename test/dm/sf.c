@@ -12,6 +12,7 @@
 #include <spi_flash.h>
 #include <asm/state.h>
 #include <asm/test.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <dm/util.h>
 #include <test/ut.h>
@@ -64,6 +65,138 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_spi_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/*
+ * Check that reads through the memory-mapped window match reads over SPI, and
+ * report how long each takes
+ */
+static int dm_test_spi_flash_mmap(struct unit_test_state *uts)
+{
+	struct udevice *dev, *emul;
+	int full_size = 0x200000;
+	ulong start, mmap_us, spi_us;
+	u8 *src, *dst;
+	int i;
+
+	src = map_sysmem(0x20000, full_size);
+	for (i = 0; i < full_size; i++)
+		src[i] = i * 7 + (i >> 12);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_EMUL, &emul));
+
+	dst = map_sysmem(0x20000 + full_size, full_size);
+	memset(dst, '\0', full_size);
+	start = timer_get_us();
+	ut_assertok(spi_flash_read_dm(dev, 0, full_size, dst));
+	mmap_us = timer_get_us() - start;
+	ut_assertok(memcmp(src, dst, full_size));
+
+	/* Unaligned start and length */
+	memset(dst, '\0', full_size);
+	ut_assertok(spi_flash_read_dm(dev, 0x123, 0x4567, dst));
+	ut_assertok(memcmp(src + 0x123, dst, 0x4567));
+
+	/* Now force every read to go over the SPI bus */
+	sandbox_sf_set_map(emul, false);
+	memset(dst, '\0', full_size);
+	start = timer_get_us();
+	ut_assertok(spi_flash_read_dm(dev, 0, full_size, dst));
+	spi_us = timer_get_us() - start;
+	ut_assertok(memcmp(src, dst, full_size));
+	sandbox_sf_set_map(emul, true);
+
+	printf("Read %#x bytes: memory-mapped %lu us, SPI %lu us\n",
+	       full_size, mmap_us, spi_us);
+
+	/*
+	 * Since we are about to destroy all devices, we must tell sandbox
+	 * to forget the emulation device
+	 */
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_mmap, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that the read benchmark picks a working mode and caches it */
+static int dm_test_spi_flash_read_mode(struct unit_test_state *uts)
+{
+	struct sandbox_state *state = state_get_current();
+	const char *var = "sf_read_mode_0_2";
+	struct udevice *bus, *dev, *emul;
+	struct spi_flash *flash;
+	int full_size = 0x200000;
+	int size = 0x10000;
+	u8 *src, *dst;
+	int i;
+
+	src = map_sysmem(0x20000, full_size);
+	for (i = 0; i < full_size; i++)
+		src[i] = i * 3 + (i >> 8);
+	ut_assertok(os_write_file("spi-quad.bin", src, full_size));
+
+	/*
+	 * Quad DTR needs the fewest clock cycles. The emulation charges each
+	 * read through the memory-mapped window for its time on the bus.
+	 */
+	env_set(var, NULL);
+	ut_assertok(spi_flash_probe_bus_cs(0, 2, 0, 0, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SNOR_PROTO_1_4_4_DTR, flash->read_proto);
+	ut_asserteq_str("w25q16cl:1-4-4-dtr", env_get(var));
+
+	dst = map_sysmem(0x20000 + full_size, size);
+	ut_assertok(spi_flash_read_dm(dev, 0x1234, size, dst));
+	ut_assertok(memcmp(src + 0x1234, dst, size));
+
+	/* Reads over SPI give the same choice */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(uclass_get_device_by_seq(UCLASS_SPI, 0, &bus));
+	ut_assertok(spi_find_chip_select(bus, 2, &dev));
+	ut_assertok(sandbox_spi_get_emul(state, bus, dev, &emul));
+	ut_assertok(device_probe(emul));
+	sandbox_sf_set_map(emul, false);
+	env_set(var, NULL);
+	ut_assertok(spi_flash_probe_bus_cs(0, 2, 0, 0, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SNOR_PROTO_1_4_4_DTR, flash->read_proto);
+	ut_assertok(spi_flash_read_dm(dev, 0x1234, size, dst));
+	ut_assertok(memcmp(src + 0x1234, dst, size));
+
+	/* If DTR reads are unreliable, a quad STR mode must be used */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	sandbox_sf_set_dtr(emul, false);
+	env_set(var, NULL);
+	ut_assertok(spi_flash_probe_bus_cs(0, 2, 0, 0, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(4, spi_nor_get_protocol_data_nbits(flash->read_proto));
+	ut_assert(!spi_nor_protocol_is_dtr(flash->read_proto));
+	ut_assertok(spi_flash_read_dm(dev, 0x1234, size, dst));
+	ut_assertok(memcmp(src + 0x1234, dst, size));
+
+	/* A cached mode is used as is */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	env_set(var, "w25q16cl:1-2-2");
+	ut_assertok(spi_flash_probe_bus_cs(0, 2, 0, 0, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SNOR_PROTO_1_2_2, flash->read_proto);
+	ut_assertok(spi_flash_read_dm(dev, 0x1234, size, dst));
+	ut_assertok(memcmp(src + 0x1234, dst, size));
+
+	/* ...but not if it was for another flash */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	env_set(var, "m25p16:1-2-2");
+	ut_assertok(spi_flash_probe_bus_cs(0, 2, 0, 0, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(4, spi_nor_get_protocol_data_nbits(flash->read_proto));
+
+	env_set(var, NULL);
+	sandbox_sf_unbind_emul(state, 0, 2);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_read_mode, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* Functional test that sandbox SPI flash works correctly */
 static int dm_test_spi_flash_func(struct unit_test_state *uts)
 {
@@ -91,3 +224,120 @@ static int dm_test_spi_flash_func(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash_func, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that 'sf update' writes only what changed, using its manifest */
+static int dm_test_spi_flash_update(struct unit_test_state *uts)
+{
+	struct sandbox_state *state = state_get_current();
+	int full_size = 0x200000;
+	int size = 0x100000;
+	char cmd[80];
+	u8 *src, *dst;
+	int fd, i;
+
+	src = map_sysmem(0x20000, full_size);
+	for (i = 0; i < full_size; i++)
+		src[i] = i * 5 + (i >> 12);
+	ut_assertok(os_write_file("spi-quad.bin", src, full_size));
+	ut_assertok(run_command("sf probe 0:2", 0));
+
+	/* Change a 64KiB block and a few scattered sectors */
+	memset(src + 0x10000, '\xaa', 0x10000);
+	for (i = 0x3000; i < size; i += 0x21000)
+		src[i] ^= 0xff;
+	snprintf(cmd, sizeof(cmd), "sf update %x 0 %x", 0x20000, size);
+	ut_assertok(run_command(cmd, 0));
+	dst = map_sysmem(0x20000 + full_size, full_size);
+	ut_assertok(run_command("sf read 220000 0 100000", 0));
+	ut_assertok(memcmp(src, dst, size));
+
+	/*
+	 * Corrupt a sector behind the driver's back. The manifest says it is
+	 * unchanged, so it should not be read and should not be fixed.
+	 */
+	fd = os_open("spi-quad.bin", OS_O_RDWR);
+	ut_assert(fd >= 0);
+	ut_asserteq(0x5000, os_lseek(fd, 0x5000, OS_SEEK_SET));
+	ut_asserteq(4, os_write(fd, "junk", 4));
+	os_close(fd);
+	src[0x80010] ^= 0xff;
+	ut_assertok(run_command(cmd, 0));
+	ut_assertok(run_command("sf read 220000 0 100000", 0));
+	ut_asserteq_mem("junk", dst + 0x5000, 4);
+	ut_assertok(memcmp(src + 0x6000, dst + 0x6000, size - 0x6000));
+
+	/* 'sf write' discards the manifest, so everything is compared again */
+	ut_assertok(run_command("sf write 120000 180000 1000", 0));
+	ut_assertok(run_command(cmd, 0));
+	ut_assertok(run_command("sf read 220000 0 100000", 0));
+	ut_assertok(memcmp(src, dst, size));
+
+	/* A partial last sector keeps the rest of the sector intact */
+	memset(src + size, '\x55', 0x800);
+	snprintf(cmd, sizeof(cmd), "sf update %x 0 %x", 0x20000, size + 0x800);
+	ut_assertok(run_command(cmd, 0));
+	ut_assertok(run_command("sf read 220000 0 101000", 0));
+	ut_assertok(memcmp(src, dst, size + 0x1000));
+
+	env_set("sf_read_mode_0_2", NULL);
+	sandbox_sf_unbind_emul(state, 0, 2);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_update, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that runs of sectors are erased a block at a time */
+static int dm_test_spi_flash_erase(struct unit_test_state *uts)
+{
+	struct sandbox_state *state = state_get_current();
+	struct udevice *bus, *dev, *emul;
+	int full_size = 0x200000;
+	u8 *src, *dst;
+	uint count;
+	int i;
+
+	src = map_sysmem(0x20000, full_size);
+	for (i = 0; i < full_size; i++)
+		src[i] = i * 7 + (i >> 12);
+	ut_assertok(os_write_file("spi-quad.bin", src, full_size));
+
+	/*
+	 * The SFDP tables only give 64KiB erases unless 4KiB sectors are
+	 * enabled, so use the flash_info entry, which has both
+	 */
+	ut_assertok(uclass_get_device_by_seq(UCLASS_SPI, 0, &bus));
+	ut_assertok(spi_find_chip_select(bus, 2, &dev));
+	ut_assertok(sandbox_spi_get_emul(state, bus, dev, &emul));
+	ut_assertok(device_probe(emul));
+	sandbox_sf_set_sfdp(emul, false);
+	ut_assertok(run_command("sf probe 0:2", 0));
+
+	/* Two whole 64KiB blocks need one command each */
+	count = sandbox_sf_get_erase_count(emul);
+	ut_assertok(run_command("sf erase 0 20000", 0));
+	ut_asserteq(2, sandbox_sf_get_erase_count(emul) - count);
+
+	/* 15 sectors up to a block boundary, a block, then one more sector */
+	count = sandbox_sf_get_erase_count(emul);
+	ut_assertok(run_command("sf erase 31000 20000", 0));
+	ut_asserteq(17, sandbox_sf_get_erase_count(emul) - count);
+
+	/*
+	 * Update two changed blocks and one changed sector. Each run of
+	 * sectors is erased as above, and the new manifest needs one more.
+	 */
+	memset(src + 0x80000, '\x5a', 0x20000);
+	src[0xa3000] ^= 0xff;
+	count = sandbox_sf_get_erase_count(emul);
+	ut_assertok(run_command("sf update a0000 80000 30000", 0));
+	ut_asserteq(4, sandbox_sf_get_erase_count(emul) - count);
+	dst = map_sysmem(0x20000 + full_size, 0x30000);
+	ut_assertok(run_command("sf read 220000 80000 30000", 0));
+	ut_assertok(memcmp(src + 0x80000, dst, 0x30000));
+
+	env_set("sf_read_mode_0_2", NULL);
+	sandbox_sf_unbind_emul(state, 0, 2);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_erase, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
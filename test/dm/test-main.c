@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <command.h>
 #include <console.h>
 #include <dm.h>
@@ -148,6 +149,11 @@ static int dm_test_main(const char *test_name)
 	if (!test_name)
 		printf("Running %d driver model tests\n", n_ents);
 
+	/*
+	 * Probing test devices does not belong in the boot-time report, and
+	 * recording it would allocate memory while tests check for leaks
+	 */
+	bootstage_enable_spans(false);
 	run_count = 0;
 #ifdef CONFIG_OF_LIVE
 	uts->of_root = gd->of_root;
@@ -182,6 +188,7 @@ static int dm_test_main(const char *test_name)
 		}
 		run_count += runs;
 	}
+	bootstage_enable_spans(true);
 
 	if (test_name && !run_count)
 		printf("Test '%s' not found\n", test_name);
@@ -97,6 +97,24 @@ static int test_pre_remove(struct udevice *dev)
 	return 0;
 }
 
+static int test_probe_start(struct udevice *dev)
+{
+	dm_testdrv_op_count[DM_TEST_OP_PROBE_START]++;
+	ut_assert(device_active(dev));
+
+	return 0;
+}
+
+static int test_probe_complete(struct udevice *dev)
+{
+	struct dm_test_state *dms = uts->priv;
+
+	dm_testdrv_op_count[DM_TEST_OP_PROBE_COMPLETE]++;
+	ut_assert(device_active(dev));
+
+	return dms->fail_probe_complete ? -EIO : 0;
+}
+
 static int test_init(struct uclass *uc)
 {
 	dm_testdrv_op_count[DM_TEST_OP_INIT]++;
@@ -120,6 +138,8 @@ UCLASS_DRIVER(test) = {
 	.pre_probe	= test_pre_probe,
 	.post_probe	= test_post_probe,
 	.pre_remove	= test_pre_remove,
+	.probe_start	= test_probe_start,
+	.probe_complete	= test_probe_complete,
 	.init		= test_init,
 	.destroy	= test_destroy,
 	.priv_auto_alloc_size	= sizeof(struct dm_test_uclass_priv),
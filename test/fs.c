@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the fs layer, using filesystem images on a host device
+ *
+ * The images are created by test/py (see test_ut.py). Each holds a fragmented
+ * file whose bytes follow fs_test_byte(), so that any part of it can be
+ * checked after reading it.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <fs.h>
+#include <malloc.h>
+#include <os.h>
+#include <sandboxblockdev.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new fs test */
+#define FS_TEST(_name, _flags)	UNIT_TEST(_name, _flags, fs_test)
+
+#define FS_TEST_FILE	"/pread.bin"
+
+enum {
+	FS_TEST_SIZE	= 300007,	/* size of FS_TEST_FILE */
+	FS_TEST_CHUNK	= 1000,		/* bytes in each sequential read */
+	FS_TEST_READS	= 500,		/* number of random reads */
+	FS_TEST_MAX_LEN	= 5000,		/* maximum length of a random read */
+};
+
+static const char *const fs_test_images[] = {
+	"fs_pread.fat.img",
+	"fs_pread.ext4.img",
+};
+
+static u8 fs_test_byte(loff_t pos)
+{
+	return (pos * 7) ^ (pos >> 8) ^ (pos >> 16);
+}
+
+/* Check that @len bytes in @buf match the file contents at @pos */
+static int fs_test_check(struct unit_test_state *uts, const u8 *buf,
+			 loff_t pos, loff_t len)
+{
+	loff_t i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] != fs_test_byte(pos + i)) {
+			printf("%s: mismatch at %lld\n", __func__, pos + i);
+			ut_assert(false);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Bind host device 0 to an image and open the test file on it. This returns
+ * -ENOENT if the image is not there, e.g. if the host tools to create it are
+ * missing.
+ */
+static int fs_test_open(struct unit_test_state *uts, const char *image,
+			struct fs_file **filep)
+{
+	loff_t size;
+
+	if (os_get_filesize(image, &size)) {
+		printf("%s: skipped, no image\n", image);
+		return -ENOENT;
+	}
+	ut_assertok(host_dev_bind(0, (char *)image));
+	ut_assertok(fs_set_blk_dev("host", "0:0", FS_TYPE_ANY));
+	ut_assertok(fs_open(FS_TEST_FILE, filep));
+	ut_asserteq(FS_TEST_SIZE, fs_file_size(*filep));
+
+	return 0;
+}
+
+/* Read the file from start to end, in chunks which are not block-aligned */
+static int fs_test_pread_seq_one(struct unit_test_state *uts,
+				 const char *image)
+{
+	struct fs_file *file;
+	loff_t pos, actread;
+	u8 *buf;
+	int ret;
+
+	ret = fs_test_open(uts, image, &file);
+	if (ret == -ENOENT)
+		return 0;
+	ut_assertok(ret);
+	buf = malloc(FS_TEST_CHUNK);
+	ut_assertnonnull(buf);
+
+	for (pos = 0; pos < FS_TEST_SIZE; pos += actread) {
+		ut_assertok(fs_pread(file, buf, pos, FS_TEST_CHUNK, &actread));
+		ut_asserteq(min((loff_t)FS_TEST_CHUNK, FS_TEST_SIZE - pos),
+			    actread);
+		ut_assertok(fs_test_check(uts, buf, pos, actread));
+	}
+
+	/* Nothing is read at the end of the file */
+	ut_assertok(fs_pread(file, buf, pos, FS_TEST_CHUNK, &actread));
+	ut_asserteq(0, actread);
+
+	free(buf);
+	fs_close(file);
+	ut_assertok(host_dev_bind(0, NULL));
+
+	return 0;
+}
+
+static int fs_test_pread_seq(struct unit_test_state *uts)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fs_test_images); i++)
+		ut_assertok(fs_test_pread_seq_one(uts, fs_test_images[i]));
+
+	return 0;
+}
+FS_TEST(fs_test_pread_seq, 0);
+
+/* Read from random places, going both forwards and backwards in the file */
+static int fs_test_pread_random_one(struct unit_test_state *uts,
+				    const char *image)
+{
+	struct fs_file *file;
+	loff_t pos, len, actread;
+	uint seed = 1;
+	u8 *buf;
+	int ret, i;
+
+	ret = fs_test_open(uts, image, &file);
+	if (ret == -ENOENT)
+		return 0;
+	ut_assertok(ret);
+	buf = malloc(FS_TEST_MAX_LEN);
+	ut_assertnonnull(buf);
+
+	for (i = 0; i < FS_TEST_READS; i++) {
+		seed = seed * 1103515245 + 12345;
+		pos = (seed >> 8) % FS_TEST_SIZE;
+		seed = seed * 1103515245 + 12345;
+		len = (seed >> 8) % FS_TEST_MAX_LEN + 1;
+
+		ut_assertok(fs_pread(file, buf, pos, len, &actread));
+		ut_asserteq(min(len, FS_TEST_SIZE - pos), actread);
+		ut_assertok(fs_test_check(uts, buf, pos, actread));
+	}
+
+	free(buf);
+	fs_close(file);
+	ut_assertok(host_dev_bind(0, NULL));
+
+	return 0;
+}
+
+static int fs_test_pread_random(struct unit_test_state *uts)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fs_test_images); i++)
+		ut_assertok(fs_test_pread_random_one(uts, fs_test_images[i]));
+
+	return 0;
+}
+FS_TEST(fs_test_pread_random, 0);
+
+/*
+ * Select host device 0 and check which filesystem is found, and whether that
+ * came from the cache
+ */
+static int fs_test_probe(struct unit_test_state *uts, const char *name,
+			 bool hit)
+{
+	uint hits, misses, new_hits, new_misses;
+	loff_t size;
+
+	fs_probe_cache_stats(&hits, &misses);
+	ut_assertok(fs_set_blk_dev("host", "0:0", FS_TYPE_ANY));
+	ut_asserteq_str(name, fs_get_type_name());
+	ut_assertok(fs_size(FS_TEST_FILE, &size));
+	ut_asserteq(FS_TEST_SIZE, size);
+
+	fs_probe_cache_stats(&new_hits, &new_misses);
+	ut_asserteq(hits + hit, new_hits);
+	ut_asserteq(misses + !hit, new_misses);
+
+	return 0;
+}
+
+/* Check that the filesystem type is remembered until the media changes */
+static int fs_test_probe_cache(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	loff_t size;
+	u8 *buf;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fs_test_images); i++) {
+		if (os_get_filesize(fs_test_images[i], &size)) {
+			printf("%s: skipped, no image\n", fs_test_images[i]);
+			return 0;
+		}
+	}
+
+	/* The first look at the image searches, after that the type is used */
+	ut_assertok(host_dev_bind(0, (char *)fs_test_images[0]));
+	ut_assertok(fs_test_probe(uts, "fat", false));
+	ut_assertok(fs_test_probe(uts, "fat", true));
+	ut_assertok(fs_test_probe(uts, "fat", true));
+
+	/* Binding another image gives a new device, perhaps at the same place */
+	ut_assertok(host_dev_bind(0, (char *)fs_test_images[1]));
+	ut_assertok(fs_test_probe(uts, "ext4", false));
+	ut_assertok(fs_test_probe(uts, "ext4", true));
+
+	/* A write may have changed the filesystem, so search again */
+	desc = blk_get_devnum_by_type(IF_TYPE_HOST, 0);
+	ut_assertnonnull(desc);
+	buf = malloc(desc->blksz);
+	ut_assertnonnull(buf);
+	ut_asserteq(1, blk_dread(desc, 0, 1, buf));
+	ut_asserteq(1, blk_dwrite(desc, 0, 1, buf));
+	free(buf);
+	ut_assertok(fs_test_probe(uts, "ext4", false));
+	ut_assertok(fs_test_probe(uts, "ext4", true));
+
+	ut_assertok(host_dev_bind(0, NULL));
+
+	return 0;
+}
+FS_TEST(fs_test_probe_cache, 0);
+
+int do_ut_fs(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, fs_test);
+	const int n_ents = ll_entry_count(struct unit_test, fs_test);
+
+	return cmd_ut_category("fs", tests, n_ents, argc, argv);
+}
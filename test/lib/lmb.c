@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the logical memory block (lmb) allocator
+ */
+
+#include <common.h>
+#include <lmb.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define RAM_BASE	0x40000000
+#define RAM_SIZE	0x10000000
+#define RAM_END		(RAM_BASE + RAM_SIZE)
+
+/* Check that reserved region 'i' covers base to base + size */
+static int check_reserved(struct unit_test_state *uts, struct lmb *lmb,
+			  int i, phys_addr_t base, phys_size_t size)
+{
+	ut_assert(i < lmb->reserved.cnt);
+	ut_asserteq(base, lmb->reserved.region[i].base);
+	ut_asserteq(size, lmb->reserved.region[i].size);
+
+	return 0;
+}
+
+static int lib_test_lmb_reserve(struct unit_test_state *uts)
+{
+	struct lmb lmb;
+
+	lmb_init(&lmb);
+	ut_asserteq(0, lmb_add(&lmb, RAM_BASE, RAM_SIZE));
+	ut_asserteq(1, lmb.memory.cnt);
+
+	/* Regions are kept in order */
+	ut_asserteq(0, lmb_reserve(&lmb, RAM_BASE + 0x4000, 0x1000));
+	ut_asserteq(0, lmb_reserve(&lmb, RAM_BASE + 0x1000, 0x1000));
+	ut_asserteq(2, lmb.reserved.cnt);
+	ut_assertok(check_reserved(uts, &lmb, 0, RAM_BASE + 0x1000, 0x1000));
+	ut_assertok(check_reserved(uts, &lmb, 1, RAM_BASE + 0x4000, 0x1000));
+
+	/* A region touching another is merged with it */
+	ut_asserteq(1, lmb_reserve(&lmb, RAM_BASE + 0x2000, 0x1000));
+	ut_asserteq(2, lmb.reserved.cnt);
+	ut_assertok(check_reserved(uts, &lmb, 0, RAM_BASE + 0x1000, 0x2000));
+
+	/* A region filling the gap joins both */
+	ut_asserteq(2, lmb_reserve(&lmb, RAM_BASE + 0x2800, 0x1800));
+	ut_asserteq(1, lmb.reserved.cnt);
+	ut_assertok(check_reserved(uts, &lmb, 0, RAM_BASE + 0x1000, 0x4000));
+
+	ut_asserteq(0, lmb_is_reserved(&lmb, RAM_BASE + 0xfff));
+	ut_asserteq(1, lmb_is_reserved(&lmb, RAM_BASE + 0x1000));
+	ut_asserteq(1, lmb_is_reserved(&lmb, RAM_BASE + 0x4fff));
+	ut_asserteq(0, lmb_is_reserved(&lmb, RAM_BASE + 0x5000));
+
+	/* Freeing the middle splits the region */
+	ut_asserteq(0, lmb_free(&lmb, RAM_BASE + 0x2000, 0x1000));
+	ut_asserteq(2, lmb.reserved.cnt);
+	ut_assertok(check_reserved(uts, &lmb, 0, RAM_BASE + 0x1000, 0x1000));
+	ut_assertok(check_reserved(uts, &lmb, 1, RAM_BASE + 0x3000, 0x2000));
+	ut_asserteq(0, lmb_is_reserved(&lmb, RAM_BASE + 0x2000));
+
+	/* Only whole reserved ranges can be freed */
+	ut_asserteq(-1, lmb_free(&lmb, RAM_BASE + 0x1800, 0x1000));
+	ut_asserteq(-1, lmb_free(&lmb, RAM_BASE + 0x8000, 0x1000));
+
+	ut_asserteq(0, lmb_free(&lmb, RAM_BASE + 0x3000, 0x1000));
+	ut_asserteq(0, lmb_free(&lmb, RAM_BASE + 0x4000, 0x1000));
+	ut_asserteq(0, lmb_free(&lmb, RAM_BASE + 0x1000, 0x1000));
+	ut_asserteq(0, lmb.reserved.cnt);
+	lmb_release(&lmb);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_reserve, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* More regions than fit in the initial array */
+static int lib_test_lmb_many(struct unit_test_state *uts)
+{
+	const int count = MAX_LMB_REGIONS * 5;
+	struct lmb lmb;
+	int i;
+
+	lmb_init(&lmb);
+	ut_asserteq(0, lmb_add(&lmb, RAM_BASE, RAM_SIZE));
+
+	/* Reserve every other page, working downwards */
+	for (i = count - 1; i >= 0; i--)
+		ut_asserteq(0, lmb_reserve(&lmb, RAM_BASE + i * 0x2000, 0x1000));
+	ut_asserteq(count, lmb.reserved.cnt);
+	for (i = 0; i < count; i++) {
+		ut_assertok(check_reserved(uts, &lmb, i, RAM_BASE + i * 0x2000,
+					   0x1000));
+	}
+
+	/* The allocation is too big for the gaps so goes above them all */
+	lmb.policy = LMB_ALLOC_FIRST_FIT;
+	ut_asserteq(RAM_BASE + count * 0x2000 - 0x1000,
+		    lmb_alloc(&lmb, 0x1001, 0x1000));
+
+	/* Fill in the gaps, which joins everything into one region */
+	for (i = 0; i < count; i++) {
+		ut_assert(lmb_reserve(&lmb, RAM_BASE + i * 0x2000 + 0x1000,
+				      0x1000) > 0);
+	}
+	ut_asserteq(1, lmb.reserved.cnt);
+	ut_assertok(check_reserved(uts, &lmb, 0, RAM_BASE,
+				   count * 0x2000 + 0x1000));
+	lmb_release(&lmb);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_many, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/*
+ * Set up memory with a free hole of 8KiB, then one of 4KiB, then everything
+ * above RAM_BASE + 0x20000 free
+ */
+static void setup_holes(struct lmb *lmb, enum lmb_alloc_policy policy)
+{
+	lmb_init(lmb);
+	lmb->policy = policy;
+	lmb_add(lmb, RAM_BASE, RAM_SIZE);
+	lmb_reserve(lmb, RAM_BASE, 0x1000);
+	lmb_reserve(lmb, RAM_BASE + 0x3000, 0xd000);
+	lmb_reserve(lmb, RAM_BASE + 0x11000, 0xf000);
+}
+
+static int lib_test_lmb_top_down(struct unit_test_state *uts)
+{
+	struct lmb lmb;
+
+	setup_holes(&lmb, LMB_ALLOC_TOP_DOWN);
+	ut_asserteq(RAM_END - 0x1000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_END - 0x2000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x10000,
+		    lmb_alloc_base(&lmb, 0x1000, 0x1000, RAM_BASE + 0x12000));
+	ut_asserteq(0, __lmb_alloc_base(&lmb, 0x4000, 0x1000,
+					RAM_BASE + 0x12000));
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_top_down, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static int lib_test_lmb_first_fit(struct unit_test_state *uts)
+{
+	struct lmb lmb;
+
+	setup_holes(&lmb, LMB_ALLOC_FIRST_FIT);
+	ut_asserteq(RAM_BASE + 0x20000, lmb_alloc(&lmb, 0x3000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x1000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x2000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x10000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x23000, lmb_alloc(&lmb, 0x1000, 0x1000));
+
+	/* Alignment and the upper limit are honoured */
+	ut_asserteq(RAM_BASE + 0x100000, lmb_alloc(&lmb, 0x100, 0x100000));
+	ut_asserteq(0, __lmb_alloc_base(&lmb, 0x1000, 0x1000,
+					RAM_BASE + 0x24000));
+	ut_asserteq(RAM_BASE + 0x24000,
+		    lmb_alloc_base(&lmb, 0x1000, 0x1000, RAM_BASE + 0x25000));
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_first_fit, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+static int lib_test_lmb_best_fit(struct unit_test_state *uts)
+{
+	struct lmb lmb;
+
+	setup_holes(&lmb, LMB_ALLOC_BEST_FIT);
+	ut_asserteq(RAM_BASE + 0x10000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x1000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x2000, lmb_alloc(&lmb, 0x1000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x20000, lmb_alloc(&lmb, 0x1000, 0x1000));
+
+	/* Freeing makes the hole usable again */
+	ut_asserteq(0, lmb_free(&lmb, RAM_BASE + 0x10000, 0x1000));
+	ut_asserteq(RAM_BASE + 0x10000, lmb_alloc(&lmb, 0x800, 0x800));
+	ut_asserteq(RAM_BASE + 0x10800, lmb_alloc(&lmb, 0x800, 0x800));
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_best_fit, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests and a stress benchmark for the malloc() heap
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new malloc test */
+#define MALLOC_TEST(_name, _flags)	UNIT_TEST(_name, _flags, malloc_test)
+
+enum {
+	STRESS_SLOTS	= 1024,		/* allocations live at once, at most */
+	STRESS_OPS	= 200000,	/* number of malloc() and free() calls */
+};
+
+static u8 *stress_ptr[STRESS_SLOTS];
+static size_t stress_size[STRESS_SLOTS];
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+/* Check that the statistics follow an allocation and free */
+static int malloc_test_stats(struct unit_test_state *uts)
+{
+	struct malloc_heap_stats before, st;
+	void *ptr;
+
+	malloc_get_stats(&before);
+	ptr = malloc(100);
+	ut_assertnonnull(ptr);
+	malloc_get_stats(&st);
+	ut_asserteq(before.calls[MALLOC_OP_MALLOC] + 1,
+		    st.calls[MALLOC_OP_MALLOC]);
+	ut_asserteq(before.hist[3] + 1, st.hist[3]);	/* 65-128 bytes */
+	ut_assert(st.in_use >= before.in_use + 100);
+	ut_assert(st.peak >= st.in_use);
+
+	free(ptr);
+	malloc_get_stats(&st);
+	ut_asserteq(before.calls[MALLOC_OP_FREE] + 1, st.calls[MALLOC_OP_FREE]);
+	ut_asserteq(before.in_use, st.in_use);
+	ut_assert(st.largest_free <= st.free_bytes);
+
+	malloc_reset_stats();
+	malloc_get_stats(&st);
+	ut_asserteq(0, st.calls[MALLOC_OP_MALLOC]);
+	ut_asserteq(before.in_use, st.in_use);
+	ut_asserteq(st.in_use, st.peak);
+
+	return 0;
+}
+MALLOC_TEST(malloc_test_stats, 0);
+#endif
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+/* Check that small chunks are reused, and not lost when merged back in */
+static int malloc_test_fastbins(struct unit_test_state *uts)
+{
+	struct mallinfo start = mallinfo();
+	void *ptr, *ptr2, *guard;
+	int used;
+
+	malloc_fastbins_enable(true);
+	ptr = malloc(40);
+	ut_assertnonnull(ptr);
+	/* Keep the chunk away from the top of the heap */
+	guard = malloc(40);
+	ut_assertnonnull(guard);
+	used = mallinfo().uordblks;
+	free(ptr);
+
+	/* The chunk is in a fast bin, which counts as free */
+	ut_assert(mallinfo().uordblks < used);
+	ptr2 = malloc(40);
+	ut_asserteq_ptr(ptr, ptr2);
+
+	free(ptr2);
+	malloc_fastbins_enable(false);
+	free(guard);
+	ut_asserteq(start.uordblks, mallinfo().uordblks);
+	malloc_fastbins_enable(true);
+
+	return 0;
+}
+MALLOC_TEST(malloc_test_fastbins, 0);
+#endif
+
+/*
+ * Make a mixture of allocations, mostly small ones such as driver model and
+ * the environment make, with some buffers of a few KB. Each is marked with
+ * its slot number, which is checked when it is freed.
+ */
+static int malloc_stress(struct unit_test_state *uts, ulong *usp)
+{
+	uint seed = 1;
+	ulong start;
+	int i, slot;
+
+	start = timer_get_us();
+	for (i = 0; i < STRESS_OPS; i++) {
+		seed = seed * 1103515245 + 12345;
+		slot = (seed >> 8) % STRESS_SLOTS;
+		if (stress_ptr[slot]) {
+			size_t size = stress_size[slot];
+
+			ut_asserteq((u8)slot, stress_ptr[slot][0]);
+			ut_asserteq((u8)slot, stress_ptr[slot][size - 1]);
+			free(stress_ptr[slot]);
+			stress_ptr[slot] = NULL;
+			continue;
+		}
+		if ((seed >> 24) % 16)
+			stress_size[slot] = 8 + (seed >> 12) % 120;
+		else
+			stress_size[slot] = 512 + (seed >> 12) % 8192;
+		stress_ptr[slot] = malloc(stress_size[slot]);
+		ut_assertnonnull(stress_ptr[slot]);
+		stress_ptr[slot][0] = slot;
+		stress_ptr[slot][stress_size[slot] - 1] = slot;
+	}
+	for (slot = 0; slot < STRESS_SLOTS; slot++) {
+		free(stress_ptr[slot]);
+		stress_ptr[slot] = NULL;
+	}
+	*usp = timer_get_us() - start;
+
+	return 0;
+}
+
+/* Time the stress test, with and without fast bins if available */
+static int malloc_test_stress(struct unit_test_state *uts)
+{
+	struct mallinfo start = mallinfo();
+	ulong us;
+
+	ut_assertok(malloc_stress(uts, &us));
+	printf("%d operations: %lu us\n", STRESS_OPS, us);
+	ut_asserteq(start.uordblks, mallinfo().uordblks);
+#if CONFIG_IS_ENABLED(SYS_MALLOC_FASTBINS)
+	malloc_fastbins_enable(false);
+	ut_assertok(malloc_stress(uts, &us));
+	malloc_fastbins_enable(true);
+	printf("%d operations without fast bins: %lu us\n", STRESS_OPS, us);
+	ut_asserteq(start.uordblks, mallinfo().uordblks);
+#endif
+
+	return 0;
+}
+MALLOC_TEST(malloc_test_stress, 0);
+
+int do_ut_malloc(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, malloc_test);
+	const int n_ents = ll_entry_count(struct unit_test, malloc_test);
+
+	return cmd_ut_category("malloc", tests, n_ents, argc, argv);
+}
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests and a benchmark for memcpy(), memmove() and memset()
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new mem test */
+#define MEM_TEST(_name, _flags)	UNIT_TEST(_name, _flags, mem_test)
+
+enum {
+	CHECK_MAX_LEN	= 80,		/* lengths 0 to this are checked */
+	CHECK_MAX_OFS	= 16,		/* as are offsets 0 to this - 1 */
+	CHECK_BUF	= CHECK_MAX_LEN + 2 * CHECK_MAX_OFS,
+	GUARD		= 0xee,
+
+	BENCH_MAX_LEN	= 64 << 10,
+	BENCH_BYTES	= 16 << 20,	/* bytes copied for each measurement */
+};
+
+static u8 src_buf[CHECK_BUF], dst_buf[CHECK_BUF], ref_buf[CHECK_BUF];
+
+static void fill_pattern(u8 *buf, int len, int seed)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (i * 7 + seed) ^ (i >> 8);
+}
+
+/* Check memcpy() for each length and source and destination alignment */
+static int mem_test_memcpy(struct unit_test_state *uts)
+{
+	int len, sofs, dofs, i;
+	void *ret;
+
+	fill_pattern(src_buf, CHECK_BUF, 1);
+	for (len = 0; len <= CHECK_MAX_LEN; len++) {
+		for (sofs = 0; sofs < CHECK_MAX_OFS; sofs++) {
+			for (dofs = 0; dofs < CHECK_MAX_OFS; dofs++) {
+				memset(dst_buf, GUARD, CHECK_BUF);
+				memset(ref_buf, GUARD, CHECK_BUF);
+				for (i = 0; i < len; i++)
+					ref_buf[dofs + i] = src_buf[sofs + i];
+				ret = memcpy(dst_buf + dofs, src_buf + sofs,
+					     len);
+				ut_asserteq_ptr(dst_buf + dofs, ret);
+				ut_assertok(memcmp(ref_buf, dst_buf, CHECK_BUF));
+			}
+		}
+	}
+
+	return 0;
+}
+MEM_TEST(mem_test_memcpy, 0);
+
+/* Check memmove() in both directions with every amount of overlap */
+static int mem_test_memmove(struct unit_test_state *uts)
+{
+	int len, sofs, dofs, i;
+	void *ret;
+
+	for (len = 0; len <= CHECK_MAX_LEN; len++) {
+		for (sofs = 0; sofs < 2 * CHECK_MAX_OFS; sofs++) {
+			for (dofs = 0; dofs < 2 * CHECK_MAX_OFS; dofs++) {
+				fill_pattern(dst_buf, CHECK_BUF, len);
+				for (i = 0; i < CHECK_BUF; i++)
+					ref_buf[i] = dst_buf[i];
+				for (i = 0; i < len; i++)
+					src_buf[i] = dst_buf[sofs + i];
+				for (i = 0; i < len; i++)
+					ref_buf[dofs + i] = src_buf[i];
+
+				ret = memmove(dst_buf + dofs, dst_buf + sofs,
+					      len);
+				ut_asserteq_ptr(dst_buf + dofs, ret);
+				ut_assertok(memcmp(ref_buf, dst_buf, CHECK_BUF));
+			}
+		}
+	}
+
+	return 0;
+}
+MEM_TEST(mem_test_memmove, 0);
+
+/*
+ * Check long overlapping memmove() calls, where the source and destination
+ * are misaligned relative to each other, so the word-merging loops run for
+ * many words in each direction
+ */
+static int mem_test_memmove_overlap(struct unit_test_state *uts)
+{
+	static const int lens[] = { 255, 1000, 4099 };
+	static const int shifts[] = { 1, 3, 5, 7, 9, 13 };
+	const int size = 4099 + 2 * 16;	/* longest, plus room either side */
+	int l, sh, dir, sofs, dofs, len, i;
+	u8 *buf, *ref;
+	void *ret;
+
+	buf = malloc(size);
+	ref = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(ref);
+
+	for (l = 0; l < ARRAY_SIZE(lens); l++) {
+		len = lens[l];
+		for (sh = 0; sh < ARRAY_SIZE(shifts); sh++) {
+			/* dir 0 moves the data up in memory, dir 1 down */
+			for (dir = 0; dir < 2; dir++) {
+				sofs = 16 + (dir ? shifts[sh] : 0);
+				dofs = 16 + (dir ? 0 : shifts[sh]);
+				fill_pattern(buf, size, len + sh);
+				for (i = 0; i < size; i++)
+					ref[i] = buf[i];
+				for (i = 0; i < len; i++)
+					ref[dofs + i] = buf[sofs + i];
+
+				ret = memmove(buf + dofs, buf + sofs, len);
+				ut_asserteq_ptr(buf + dofs, ret);
+				ut_assertok(memcmp(ref, buf, size));
+			}
+		}
+	}
+	free(ref);
+	free(buf);
+
+	return 0;
+}
+MEM_TEST(mem_test_memmove_overlap, 0);
+
+/* Check memset() for each length and alignment */
+static int mem_test_memset(struct unit_test_state *uts)
+{
+	int len, ofs, i;
+	void *ret;
+
+	for (len = 0; len <= CHECK_MAX_LEN; len++) {
+		for (ofs = 0; ofs < CHECK_MAX_OFS; ofs++) {
+			for (i = 0; i < CHECK_BUF; i++) {
+				dst_buf[i] = GUARD;
+				ref_buf[i] = ofs <= i && i < ofs + len ?
+					0xa5 : GUARD;
+			}
+			ret = memset(dst_buf + ofs, 0x1a5, len);
+			ut_asserteq_ptr(dst_buf + ofs, ret);
+			ut_assertok(memcmp(ref_buf, dst_buf, CHECK_BUF));
+		}
+	}
+
+	return 0;
+}
+MEM_TEST(mem_test_memset, 0);
+
+/* Work out the copy rate in MB/s, from the bytes copied and the time taken */
+static ulong mem_rate(ulong bytes, ulong us)
+{
+	return us ? bytes / us : 0;
+}
+
+/*
+ * Time memcpy(), memmove() and memset() for a range of sizes, with the
+ * source and destination aligned, aligned the same way but not on a word
+ * boundary, and misaligned with respect to each other. The same number of
+ * bytes is copied for each size.
+ */
+static int mem_test_bench(struct unit_test_state *uts)
+{
+	static const struct {
+		const char *name;
+		int sofs;
+		int dofs;
+	} align[] = {
+		{ "aligned", 0, 0 },
+		{ "both+1", 1, 1 },
+		{ "src+1", 1, 0 },
+		{ "dst+3", 0, 3 },
+	};
+	ulong len, count, i, start, cpy, move, set;
+	u8 *src, *dst;
+	int a;
+
+	src = malloc(BENCH_MAX_LEN + 16);
+	dst = malloc(BENCH_MAX_LEN + 16);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	fill_pattern(src, BENCH_MAX_LEN + 16, 0);
+
+	printf("%-8s %6s %10s %10s %10s\n", "Align", "Size", "memcpy",
+	       "memmove", "memset");
+	for (a = 0; a < ARRAY_SIZE(align); a++) {
+		u8 *s = src + align[a].sofs, *d = dst + align[a].dofs;
+
+		for (len = 16; len <= BENCH_MAX_LEN; len <<= 4) {
+			count = BENCH_BYTES / len;
+
+			start = timer_get_us();
+			for (i = 0; i < count; i++)
+				memcpy(d, s, len);
+			cpy = timer_get_us() - start;
+			ut_assertok(memcmp(s, d, len));
+
+			/*
+			 * Overlapping, so this copies downwards, and by an odd
+			 * amount, so the source and destination are misaligned
+			 */
+			start = timer_get_us();
+			for (i = 0; i < count; i++)
+				memmove(d + 3, d, len);
+			move = timer_get_us() - start;
+
+			start = timer_get_us();
+			for (i = 0; i < count; i++)
+				memset(d, i, len);
+			set = timer_get_us() - start;
+
+			printf("%-8s %6lu %5lu MB/s %5lu MB/s %5lu MB/s\n",
+			       align[a].name, len,
+			       mem_rate(BENCH_BYTES, cpy),
+			       mem_rate(BENCH_BYTES, move),
+			       mem_rate(BENCH_BYTES, set));
+		}
+	}
+	free(dst);
+	free(src);
+
+	return 0;
+}
+MEM_TEST(mem_test_bench, 0);
+
+int do_ut_mem(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, mem_test);
+	const int n_ents = ll_entry_count(struct unit_test, mem_test);
+
+	return cmd_ut_category("mem", tests, n_ents, argc, argv);
+}
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Throughput tests for MMC, using the sandbox eMMC emulator
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <div64.h>
+#include <dm.h>
+#include <mmc.h>
+#include <asm/test.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new mmc test */
+#define MMC_TEST(_name, _flags)	UNIT_TEST(_name, _flags, mmc_test)
+
+enum {
+	TEST_START	= 0x2000,	/* first block to use */
+	TEST_SIZE	= 4 << 20,	/* bytes to transfer in each test */
+};
+
+#define MMC_TEST_HS	(MMC_MODE_HS | MMC_MODE_HS_52MHz)
+
+/* Bus modes to compare, from slowest to fastest */
+static const struct mmc_test_mode {
+	const char *name;
+	enum bus_mode mode;
+	uint host_caps;
+} mmc_test_modes[] = {
+	{ "legacy x1", MMC_LEGACY, MMC_MODE_1BIT },
+	{ "HS52 x4", MMC_HS_52, MMC_TEST_HS | MMC_MODE_4BIT },
+	{ "HS52 x8", MMC_HS_52, MMC_TEST_HS | MMC_MODE_8BIT },
+	{ "DDR52 x8", MMC_DDR_52,
+		MMC_TEST_HS | MMC_MODE_8BIT | MMC_MODE_DDR_52MHz },
+	{ "HS200 x8", MMC_HS_200, MMC_TEST_HS | MMC_MODE_8BIT |
+		MMC_MODE_DDR_52MHz | MMC_MODE_HS200 },
+};
+
+static int mmc_test_get(struct unit_test_state *uts, struct udevice **devp,
+			struct mmc **mmcp)
+{
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc3", devp));
+	*mmcp = mmc_get_mmc_dev(*devp);
+	ut_assertnonnull(*mmcp);
+	ut_assertok(mmc_init(*mmcp));
+
+	return 0;
+}
+
+/* Re-initialise the card with the given host capabilities */
+static int mmc_test_set_caps(struct unit_test_state *uts, struct udevice *dev,
+			     struct mmc *mmc, uint host_caps)
+{
+	sandbox_mmc_set_host_caps(dev, host_caps);
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+
+	return 0;
+}
+
+/* Return the rate in KiB/s of moving @bytes in @us microseconds */
+static ulong mmc_test_rate(ulong bytes, ulong us)
+{
+	return lldiv((u64)bytes * 1000000 / 1024, max(us, 1UL));
+}
+
+/* Compare read and write throughput in each bus mode */
+static int mmc_test_modes_rate(struct unit_test_state *uts)
+{
+	const int blocks = TEST_SIZE / 512;
+	ulong start, read_rate, write_rate, last_rate = 0;
+	const struct mmc_test_mode *tm;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	uint host_caps;
+	void *buf;
+
+	ut_assertok(mmc_test_get(uts, &dev, &mmc));
+	host_caps = mmc->cfg->host_caps;
+	desc = mmc_get_blk_desc(mmc);
+	buf = malloc(TEST_SIZE);
+	ut_assertnonnull(buf);
+	memset(buf, 0xa5, TEST_SIZE);
+
+	for (tm = mmc_test_modes; tm < mmc_test_modes +
+	     ARRAY_SIZE(mmc_test_modes); tm++) {
+		ut_assertok(mmc_test_set_caps(uts, dev, mmc, tm->host_caps));
+		ut_asserteq(tm->mode, mmc->selected_mode);
+
+		start = timer_get_us();
+		ut_asserteq(blocks, blk_dwrite(desc, TEST_START, blocks, buf));
+		write_rate = mmc_test_rate(TEST_SIZE, timer_get_us() - start);
+
+		start = timer_get_us();
+		ut_asserteq(blocks, blk_dread(desc, TEST_START, blocks, buf));
+		read_rate = mmc_test_rate(TEST_SIZE, timer_get_us() - start);
+
+		printf("%-10s %3d MHz: read %7lu KiB/s, write %7lu KiB/s\n",
+		       tm->name, mmc->clock / 1000000, read_rate, write_rate);
+
+		/* Each mode should read faster than the one before */
+		ut_assert(read_rate > last_rate);
+		last_rate = read_rate;
+	}
+	free(buf);
+	ut_assertok(mmc_test_set_caps(uts, dev, mmc, host_caps));
+
+	return 0;
+}
+MMC_TEST(mmc_test_modes_rate, 0);
+
+/* Show how the per-command overhead affects reads of different sizes */
+static int mmc_test_size_rate(struct unit_test_state *uts)
+{
+	static const int sizes[] = { 1, 8, 64, 512, 4096 };
+	ulong start, rate, last_rate = 0;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	lbaint_t blk;
+	void *buf;
+	int i;
+
+	ut_assertok(mmc_test_get(uts, &dev, &mmc));
+	desc = mmc_get_blk_desc(mmc);
+	buf = malloc(TEST_SIZE);
+	ut_assertnonnull(buf);
+
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		start = timer_get_us();
+		for (blk = 0; blk < TEST_SIZE / 512; blk += sizes[i]) {
+			ut_asserteq(sizes[i], blk_dread(desc, TEST_START + blk,
+							sizes[i],
+							buf + blk * 512));
+		}
+		rate = mmc_test_rate(TEST_SIZE, timer_get_us() - start);
+		printf("%4d blocks per read: %7lu KiB/s\n", sizes[i], rate);
+		ut_assert(rate > last_rate);
+		last_rate = rate;
+	}
+	free(buf);
+
+	return 0;
+}
+MMC_TEST(mmc_test_size_rate, 0);
+
+int do_ut_mmc(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, mmc_test);
+	const int n_ents = ll_entry_count(struct unit_test, mmc_test);
+
+	return cmd_ut_category("mmc", tests, n_ents, argc, argv);
+}
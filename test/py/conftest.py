@@ -77,6 +77,13 @@ def pytest_addoption(parser):
     parser.addoption('--gdbserver', default=None,
         help='Run sandbox under gdbserver. The argument is the channel '+
         'over which gdbserver should communicate, e.g. localhost:1234')
+    parser.addoption('--perf-baseline', default=None,
+        help='JSON file with baseline timings for the performance tests '+
+        '(default $U_BOOT_PERF_BASELINE)')
+    parser.addoption('--perf-tolerance', default=0.5, type=float,
+        help='Allowed increase over the baseline timings (0.5 = 50%%)')
+    parser.addoption('--perf-update', default=False, action='store_true',
+        help='Write performance timings to the baseline file')
 
 def pytest_configure(config):
     """pytest hook: Perform custom initialization at startup time.
@@ -210,6 +217,8 @@ def generate_ut_subtest(metafunc, fixture_name):
     Determines the set of unit tests built into a U-Boot binary by parsing the
     list of symbols generated by the build process. Provides this information
     to test functions by parameterizing their ut_subtest fixture parameter.
+    Tests whose names end in _norun, such as benchmarks, are left out; they
+    are marked UT_TESTF_MANUAL and only run when named.
 
     Args:
         metafunc: The pytest test function.
@@ -230,7 +239,7 @@ def generate_ut_subtest(metafunc, fixture_name):
     vals = []
     for l in lines:
         m = re_ut_test_list.search(l)
-        if not m:
+        if not m or m.group(2).endswith('_norun'):
             continue
         vals.append(m.group(1) + ' ' + m.group(2))
 
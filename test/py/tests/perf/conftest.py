@@ -0,0 +1,470 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Boot-time performance test specific setup
+
+import json
+import os
+import os.path
+import pytest
+import random
+import struct
+from subprocess import call, check_call, CalledProcessError
+from perf_helpers import *
+
+# Size of each of the large files in the filesystem images
+PERF_FILE_SIZE = 8 << 20
+
+# Number and size of the small files used to fragment the large file
+PERF_SMALL_FILES = 256
+PERF_SMALL_SIZE = 16 << 10
+
+supported_fs_perf = ['fat', 'ext4']
+
+def pytest_generate_tests(metafunc):
+    """Parametrize the filesystem fixture with each supported filesystem.
+
+    Args:
+        metafunc: Pytest test function.
+
+    Returns:
+        Nothing.
+    """
+    if 'perf_fs' in metafunc.fixturenames:
+        metafunc.parametrize('perf_fs', supported_fs_perf, indirect=True,
+            scope='module')
+
+class PerfResults(object):
+    """Timings collected by the performance tests.
+
+    The baseline file holds a dictionary for each board type, mapping the
+    name of each measurement to its time in microseconds. A measurement
+    which is not in the baseline is recorded but not checked.
+
+    Timings depend on the host machine, so there is no default baseline:
+    the timings are only checked if one is given with --perf-baseline or
+    the U_BOOT_PERF_BASELINE environment variable.
+    """
+
+    def __init__(self, config, u_boot_config):
+        self.board_type = u_boot_config.board_type
+        self.fname = (config.getoption('perf_baseline') or
+                      os.environ.get('U_BOOT_PERF_BASELINE'))
+        self.tolerance = config.getoption('perf_tolerance')
+        self.update = config.getoption('perf_update')
+        self.out_fname = u_boot_config.result_dir + '/perf-results.json'
+        self.results = {}
+        self.baseline = {}
+        if self.fname and os.path.exists(self.fname):
+            with open(self.fname) as fd:
+                self.baseline = json.load(fd)
+
+    def check(self, name, usecs):
+        """Record a timing and check it against the baseline.
+
+        Args:
+            name: Name of the measurement, e.g. 'fs.fat.contig'.
+            usecs: Time taken in microseconds.
+
+        Returns:
+            Nothing. An assertion fails if the time is too long.
+        """
+        self.results[name] = usecs
+        base = self.baseline.get(self.board_type, {}).get(name)
+        if self.update or base is None:
+            return
+        limit = int(base * (1 + self.tolerance)) + PERF_SLACK_US
+        assert usecs <= limit, ('%s took %d us, baseline %d us (limit %d us)'
+                                % (name, usecs, base, limit))
+
+    def finish(self):
+        """Write out the results, and the new baseline if requested."""
+        data = {self.board_type: self.results}
+        with open(self.out_fname, 'w') as fd:
+            json.dump(data, fd, indent=4, separators=(',', ': '),
+                      sort_keys=True)
+        if self.update and self.fname and self.results:
+            self.baseline.setdefault(self.board_type, {}).update(self.results)
+            with open(self.fname, 'w') as fd:
+                json.dump(self.baseline, fd, indent=4, separators=(',', ': '),
+                          sort_keys=True)
+                fd.write('\n')
+
+# NOTE: yield_fixture was deprecated since pytest-3.0
+@pytest.yield_fixture(scope='session')
+def perf(request, u_boot_config):
+    """Set up the timing results for the session.
+
+    Args:
+        request: Pytest request object.
+        u_boot_config: U-Boot configuration.
+
+    Return:
+        A PerfResults object, used to record and check each timing.
+    """
+    results = PerfResults(request.config, u_boot_config)
+    yield results
+    results.finish()
+
+#
+# Helper functions
+#
+def mk_files(dirname):
+    """Create the files to put in the filesystem image.
+
+    Args:
+        dirname: Directory to create the files in.
+
+    Return:
+        Nothing.
+    """
+    check_call('mkdir -p %s' % dirname, shell=True)
+    check_call('dd if=/dev/urandom of=%s/big bs=1M count=%d'
+        % (dirname, PERF_FILE_SIZE >> 20), shell=True)
+    check_call('dd if=/dev/urandom of=%s/small bs=1K count=%d'
+        % (dirname, PERF_SMALL_SIZE >> 10), shell=True)
+
+def mtools(cmd, fs_img, args):
+    """Run an mtools command on a FAT image.
+
+    Args:
+        cmd: mtools command, e.g. 'mcopy'.
+        fs_img: Filename of the image.
+        args: Arguments for the command.
+
+    Return:
+        Nothing.
+    """
+    check_call('MTOOLS_SKIP_CHECK=1 %s -i %s %s' % (cmd, fs_img, args),
+        shell=True)
+
+def mk_fat(fs_img, dirname):
+    """Create a FAT image with a contiguous and a fragmented file.
+
+    The fragmented file is written after deleting every other small file,
+    so it fills the gaps they leave.
+
+    Args:
+        fs_img: Filename of the image to create.
+        dirname: Directory holding the files from mk_files().
+
+    Return:
+        Nothing.
+    """
+    check_call('mkfs.vfat -C %s %d' % (fs_img, 64 << 10), shell=True)
+    mtools('mcopy', fs_img, '%s/big ::/contig.bin' % dirname)
+    for i in range(PERF_SMALL_FILES):
+        mtools('mcopy', fs_img, '%s/small ::/s%d' % (dirname, i))
+    mtools('mdel', fs_img, ' '.join(['::/s%d' % i
+        for i in range(0, PERF_SMALL_FILES, 2)]))
+    mtools('mcopy', fs_img, '%s/big ::/frag.bin' % dirname)
+
+def mk_ext4(fs_img, dirname):
+    """Create an ext4 image with a contiguous and a fragmented file.
+
+    This works in the same way as mk_fat(), using debugfs.
+
+    Args:
+        fs_img: Filename of the image to create.
+        dirname: Directory holding the files from mk_files().
+
+    Return:
+        Nothing.
+    """
+    check_call('dd if=/dev/zero of=%s bs=1M count=64' % fs_img, shell=True)
+    check_call('mkfs.ext4 -q -b 4096 -O ^metadata_csum %s' % fs_img,
+        shell=True)
+    cmds = dirname + '/debugfs.cmds'
+    with open(cmds, 'w') as fd:
+        fd.write('write %s/big contig.bin\n' % dirname)
+        for i in range(PERF_SMALL_FILES):
+            fd.write('write %s/small s%d\n' % (dirname, i))
+        for i in range(0, PERF_SMALL_FILES, 2):
+            fd.write('rm s%d\n' % i)
+        fd.write('write %s/big frag.bin\n' % dirname)
+    check_call('debugfs -w -f %s %s' % (cmds, fs_img), shell=True)
+
+#
+# Fixture for filesystem performance tests
+#
+# NOTE: yield_fixture was deprecated since pytest-3.0
+@pytest.yield_fixture()
+def perf_fs(request, u_boot_config):
+    """Set up a filesystem image with a contiguous and a fragmented file.
+
+    Args:
+        request: Pytest request object.
+        u_boot_config: U-Boot configuration.
+
+    Return:
+        A fixture for filesystem performance tests, i.e. a triplet of
+        filesystem type, image filename and the filename of the host copy
+        of the large file.
+    """
+    fs_type = request.param
+    tools = {'fat': ['mkfs.vfat', 'mcopy', 'mdel'],
+             'ext4': ['mkfs.ext4', 'debugfs']}[fs_type]
+    for tool in tools:
+        if not tool_is_in_path(tool):
+            pytest.skip('tool "%s" not in $PATH' % tool)
+    if not u_boot_config.buildconfig.get('config_cmd_%s' % fs_type, None):
+        pytest.skip('.config feature "CMD_%s" not enabled' % fs_type.upper())
+
+    dirname = u_boot_config.persistent_data_dir + '/perf'
+    fs_img = '%s/perf.%s.img' % (u_boot_config.persistent_data_dir, fs_type)
+    try:
+        mk_files(dirname)
+        call('rm -f %s' % fs_img, shell=True)
+        if fs_type == 'fat':
+            mk_fat(fs_img, dirname)
+        else:
+            mk_ext4(fs_img, dirname)
+    except CalledProcessError:
+        call('rm -f %s' % fs_img, shell=True)
+        pytest.skip('Setup failed for filesystem: ' + fs_type)
+        return
+    else:
+        yield [fs_type, fs_img, dirname + '/big']
+    finally:
+        call('rm -rf %s' % dirname, shell=True)
+        call('rm -f %s' % fs_img, shell=True)
+
+#
+# Fixture for the decompressor benchmark in 'ut compression'
+#
+# Largest payload, and the directory holding the payloads, within the
+# persistent data directory
+DECOMP_BENCH_MAX = 1 << 20
+DECOMP_BENCH_DIR = 'compression_bench'
+
+# Host tool and arguments for each file extension read by the benchmark. Each
+# tool is used at its default level.
+decomp_bench_tools = {
+    'gz': ['gzip', '-n', '-c'],
+    'bz2': ['bzip2', '-c'],
+    'lzma': ['lzma', '-c'],
+    'lzo': ['lzop', '-c'],
+    'lz4': ['lz4', '-q', '-c'],
+    'zst': ['zstd', '-q', '-c'],
+}
+
+def bench_text(rng, size):
+    """Make lines of text, as in messages or scripts."""
+    words = ['the', 'device', 'failed', 'to', 'probe', 'clock', 'reset',
+             'driver', 'memory', 'error', '%s: ', 'invalid', 'address',
+             'interrupt', 'mode', 'not', 'supported', 'dma', 'timeout',
+             '0x%08lx', 'register', 'power', 'bus', 'init', 'for', '%d',
+             'echo', 'mount', '-t', '/dev/mmcblk0p1', '/sys', 'if', 'then',
+             'fi', '[', ']', '-e', 'exit', '1']
+    out = bytearray()
+    while len(out) < size:
+        out += rng.choice(words).encode()
+        out += b'\n' if rng.random() < 0.125 else b' '
+    return bytes(out[:size])
+
+def bench_code(rng, size):
+    """Make something like ARM code: functions with literal pools."""
+    ops = [0xe5900000, 0xe5800000, 0xe2800000, 0xe2400000,
+           0xe3a00000, 0xe1a00000, 0xe3500000, 0xe0000000]
+    reg = lambda: rng.randrange(4) if rng.random() < 0.75 else rng.randrange(16)
+    words = []
+    while len(words) * 4 < size:
+        words.append(0xe92d4010 | rng.randrange(256) << 4)
+        for i in range(rng.randrange(4, 64)):
+            if rng.random() < 0.125:
+                # bl or conditional branch, mostly close by
+                op = 0xeb000000 if rng.random() < 0.5 else 0x1a000000
+                words.append(op | rng.randrange(0x400))
+            else:
+                words.append(rng.choice(ops) | reg() << 16 | reg() << 12 |
+                             rng.randrange(16) << 2)
+        words.append(0xe8bd8010 | rng.randrange(256) << 4)
+        # Addresses of data used by the function
+        for i in range(rng.randrange(4)):
+            words.append(0xc0800000 | rng.randrange(0x100000) << 2)
+    return struct.pack('<%dI' % len(words), *words)[:size]
+
+def bench_kernel(size):
+    """Make something like an uncompressed ARM kernel.
+
+    This is code, with strings and zeroed data in between. A zImage holds a
+    compressed kernel, so it is no different from random data as far as
+    another compressor is concerned.
+    """
+    rng = random.Random(1)
+    out = bytearray()
+    while len(out) < size:
+        kind = rng.randrange(8)
+        length = rng.randrange(256, 0x10000, 4)
+        if kind == 0:
+            out += bench_text(rng, length)
+        elif kind == 1:
+            out += b'\0' * min(length, 1024)
+        else:
+            out += bench_code(rng, length)
+    return bytes(out[:size])
+
+def bench_fdt(size):
+    """Make a flat device tree with many devices, as for an SoC.
+
+    It is padded out to the size, as with 'dtc -p'.
+    """
+    rng = random.Random(2)
+    compats = ['arm,pl011', 'snps,dw-apb-gpio', 'ti,omap4-i2c',
+               'fsl,imx6q-usdhc', 'arm,pl330', 'snps,dw-wdt']
+    names = ['serial', 'gpio', 'i2c', 'mmc', 'dma-controller', 'watchdog']
+    dt_struct = bytearray()
+    strings = bytearray()
+    offsets = {}
+
+    def pad(data):
+        data += b'\0' * (-len(data) & 3)
+
+    def begin_node(name):
+        dt_struct.extend(struct.pack('>I', 1) + name.encode() + b'\0')
+        pad(dt_struct)
+
+    def prop(name, value):
+        if name not in offsets:
+            offsets[name] = len(strings)
+            strings.extend(name.encode() + b'\0')
+        dt_struct.extend(struct.pack('>III', 3, len(value), offsets[name]))
+        dt_struct.extend(value)
+        pad(dt_struct)
+
+    def end_node():
+        dt_struct.extend(struct.pack('>I', 2))
+
+    begin_node('')
+    prop('compatible', b'vendor,board\0')
+    prop('#address-cells', struct.pack('>I', 1))
+    prop('#size-cells', struct.pack('>I', 1))
+    begin_node('soc')
+    prop('compatible', b'simple-bus\0')
+    prop('ranges', b'')
+    i = 0
+    # Leave room for the header, the end of the tree and the strings
+    while 56 + len(dt_struct) + len(strings) + 512 < size:
+        r = rng.randrange(len(compats))
+        addr = 0x10000000 + i * 0x1000
+        begin_node('%s@%x' % (names[r], addr))
+        prop('compatible', compats[r].encode() + b'\0')
+        prop('reg', struct.pack('>II', addr, 0x1000))
+        prop('interrupts', struct.pack('>III', 0, 32 + i % 224, 4))
+        prop('clocks', struct.pack('>II', 1, rng.randrange(200)))
+        prop('pinctrl-names', b'default\0')
+        prop('status', b'okay\0' if rng.random() < 0.5 else b'disabled\0')
+        end_node()
+        i += 1
+    end_node()
+    end_node()
+    dt_struct.extend(struct.pack('>I', 9))
+
+    off_struct = 56
+    off_strings = off_struct + len(dt_struct)
+    header = struct.pack('>10I', 0xd00dfeed, size, off_struct, off_strings,
+                         40, 17, 16, 0, len(strings), len(dt_struct))
+    out = header + b'\0' * 16 + dt_struct + strings
+    return bytes(out + b'\0' * (size - len(out)))
+
+def bench_cpio(size):
+    """Make a newc cpio archive, as for an initramfs, with scripts and
+    programs."""
+    rng = random.Random(3)
+    end = size - 128        # room for the trailer
+    out = bytearray()
+
+    def entry(name, mode, data):
+        out.extend(b'070701' + (b'%08x' * 13) % (len(out), mode, 0, 0, 1, 0,
+                   len(data), 0, 0, 0, 0, len(name) + 1, 0))
+        out.extend(name.encode() + b'\0')
+        out.extend(b'\0' * (-len(out) & 3))
+        out.extend(data)
+        out.extend(b'\0' * (-len(out) & 3))
+
+    i = 0
+    while True:
+        if rng.random() < 0.125:
+            if len(out) + 150 > end:
+                break
+            entry('dir%d' % i, 0o40755, b'')
+        else:
+            script = rng.random() < 0.5
+            length = rng.randrange(0x2000 if script else 0x10000)
+            length = min(length, end - len(out) - 150)
+            if length <= 0:
+                break
+            data = bench_text(rng, length) if script else \
+                bench_code(rng, length)
+            entry('dir%d/file%d' % (i // 8 * 8, i), 0o100755, data)
+        i += 1
+    entry('TRAILER!!!', 0, b'')
+    return bytes(out + b'\0' * (size - len(out)))
+
+def bench_random(size):
+    """Make data which does not compress."""
+    rng = random.Random(4)
+    return struct.pack('<%dI' % (size // 4),
+                       *[rng.getrandbits(32) for i in range(size // 4)])
+
+bench_payloads = {
+    'kernel': bench_kernel,
+    'fdt': bench_fdt,
+    'cpio': bench_cpio,
+    'random': bench_random,
+}
+
+def mk_decomp_bench(dirname):
+    """Create the payloads for the benchmark and compress them.
+
+    Each payload is written at each size, with a file for each host tool
+    which is present. The names are as expected by test/compression.c, e.g.
+    kernel.4096 and kernel.4096.gz.
+
+    Args:
+        dirname: Directory to create the files in.
+
+    Return:
+        Nothing.
+    """
+    check_call('mkdir -p %s' % dirname, shell=True)
+    for name, make in sorted(bench_payloads.items()):
+        size = 4 << 10
+        while size <= DECOMP_BENCH_MAX:
+            fname = '%s/%s.%d' % (dirname, name, size)
+            with open(fname, 'wb') as fd:
+                fd.write(make(size))
+            for ext, cmd in sorted(decomp_bench_tools.items()):
+                if not tool_is_in_path(cmd[0]):
+                    continue
+                with open(fname, 'rb') as inf:
+                    with open('%s.%s' % (fname, ext), 'wb') as outf:
+                        check_call(cmd, stdin=inf, stdout=outf)
+            size <<= 2
+
+@pytest.fixture(scope='session')
+def perf_decomp_bench(request, u_boot_config):
+    """Set up the files for the decompressor benchmark.
+
+    The benchmark takes a while, so it only runs if selected by name, e.g.
+    with '-k decomp_bench', or if U_BOOT_PERF_BENCH is set in the
+    environment. The files are made once and kept in the persistent data
+    directory.
+
+    Args:
+        request: Pytest request object.
+        u_boot_config: U-Boot configuration.
+
+    Return:
+        A pair of the directory holding the files and the largest payload
+        size.
+    """
+    if ('decomp_bench' not in request.config.getoption('keyword') and
+            not os.environ.get('U_BOOT_PERF_BENCH')):
+        pytest.skip('select with -k decomp_bench or set U_BOOT_PERF_BENCH')
+    dirname = '%s/%s' % (u_boot_config.persistent_data_dir, DECOMP_BENCH_DIR)
+    stamp = dirname + '/done'
+    if not os.path.exists(stamp):
+        call('rm -rf %s' % dirname, shell=True)
+        mk_decomp_bench(dirname)
+        open(stamp, 'w').close()
+    return dirname, DECOMP_BENCH_MAX
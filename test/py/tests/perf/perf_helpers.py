@@ -0,0 +1,70 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Helpers for the performance tests
+
+import os
+import re
+
+# Time allowed on top of the tolerance for each measurement, since short
+# timings vary a lot from run to run
+PERF_SLACK_US = 1000
+
+def time_command(u_boot_console, cmd):
+    """Run a command on the U-Boot console and return how long it took.
+
+    This uses the 'time' command, so the resolution is one millisecond.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        cmd: Command to run.
+
+    Returns:
+        A tuple (the time taken in microseconds, the command's output).
+    """
+    output = u_boot_console.run_command('time %s' % cmd)
+    m = re.search(r'time:(?: (\d+) minutes,)? (\d+)\.(\d+) seconds', output)
+    assert m, 'No time reported for "%s"' % cmd
+    assert u_boot_console.run_command('echo $?').endswith('0'), \
+        'Command "%s" failed' % cmd
+    minutes = int(m.group(1) or 0)
+    usecs = (minutes * 60 + int(m.group(2))) * 1000000
+    usecs += int(m.group(3)) * 1000
+
+    return usecs, output[:m.start()]
+
+def time_loop(u_boot_console, cmd, count):
+    """Run a command a number of times and return the average time taken.
+
+    The command is run in a hush 'for' loop so that the time spent sending
+    the command to U-Boot is not included.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        cmd: Command to run. This must not contain single quotes.
+        count: Number of times to run it.
+
+    Returns:
+        The average time taken in microseconds.
+    """
+    loop = ' '.join(str(i) for i in range(count))
+    u_boot_console.run_command("setenv perf_loop 'for i in %s; do %s; done'" %
+                               (loop, cmd))
+    usecs, output = time_command(u_boot_console, 'run perf_loop')
+    u_boot_console.run_command('setenv perf_loop')
+
+    return usecs // count
+
+def tool_is_in_path(tool):
+    """Check whether a given command is available on host.
+
+    Args:
+        tool: Command name.
+
+    Return:
+        True if available, False if not.
+    """
+    for path in os.environ["PATH"].split(os.pathsep):
+        fn = os.path.join(path, tool)
+        if os.path.isfile(fn) and os.access(fn, os.X_OK):
+            return True
+    return False
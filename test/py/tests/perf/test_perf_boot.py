@@ -0,0 +1,41 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# U-Boot boot-time performance test
+
+"""
+Record how long sandbox takes to boot, using the bootstage data exported as
+Chrome trace-event JSON. This covers driver model scanning before and after
+relocation.
+"""
+
+import json
+import pytest
+
+# Spans whose duration is recorded, if present
+BOOT_SPANS = ['board_init_r', 'initf_dm', 'initr_dm', 'initr_mmc']
+
+# Accumulated times which are recorded, if present
+BOOT_ACCUM = ['dm_f', 'dm_r', 'of_live']
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_bootstage')
+def test_perf_boot(u_boot_console, perf):
+    """Record the time taken by the main parts of the boot"""
+    cons = u_boot_console
+    # Start afresh so that only the boot itself is recorded
+    cons.restart_uboot()
+    output = cons.run_command('bootstage export')
+    data, end = json.JSONDecoder().raw_decode(output[output.index('{'):])
+    events = data['traceEvents']
+    spans = dict((ev['name'], ev['dur']) for ev in events if ev['ph'] == 'X')
+    marks = dict((ev['name'], ev['ts']) for ev in events if ev['ph'] == 'i')
+    accum = data.get('otherData', {})
+
+    assert 'main_loop' in marks
+    perf.check('boot.main_loop', marks['main_loop'])
+    for name in BOOT_SPANS:
+        if name in spans:
+            perf.check('boot.%s' % name, spans[name])
+    for name in BOOT_ACCUM:
+        if name in accum:
+            perf.check('boot.%s' % name, accum[name])
@@ -0,0 +1,147 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# U-Boot command performance tests
+
+"""
+Record how long some common boot-time commands take: decompression,
+environment import and export, and running a hush script.
+"""
+
+import os
+import pytest
+import u_boot_utils
+import zlib
+from perf_helpers import *
+
+# Amount of data to compress, taken from the start of the U-Boot binary
+DECOMP_SIZE = 2 << 20
+
+# Number of times to run each command
+DECOMP_LOOPS = 10
+ENV_LOOPS = 100
+HUSH_LOOPS = 100
+
+# Number of variables to import into the environment
+ENV_VARS = 200
+
+# Host tool, U-Boot command and Kconfig option for each compression algorithm,
+# and whether the command takes the size of the compressed data
+decomp_algos = {
+    'gzip': ['gzip', 'unzip', 'cmd_unzip', False],
+    'lz4': ['lz4', 'unlz4', 'cmd_unlz4', True],
+    'lzma': ['lzma', 'lzmadec', 'cmd_lzmadec', False],
+    'zstd': ['zstd', 'unzstd', 'cmd_unzstd', True],
+}
+
+# Time allowed for the decompressor benchmark in 'ut compression', in ms
+DECOMP_BENCH_TIMEOUT = 120000
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_crc32')
+@pytest.mark.parametrize('algo', sorted(decomp_algos.keys()))
+def test_perf_decomp(u_boot_console, perf, algo):
+    """Record the time taken to decompress part of the U-Boot binary"""
+    cons = u_boot_console
+    tool, cmd, option, src_size = decomp_algos[algo]
+    if not cons.config.buildconfig.get('config_%s' % option):
+        pytest.skip('.config feature "%s" not enabled' % option.upper())
+    if not tool_is_in_path(tool):
+        pytest.skip('tool "%s" not in $PATH' % tool)
+
+    raw = cons.config.result_dir + '/perf-decomp.bin'
+    comp = '%s.%s' % (raw, algo)
+    with open(cons.config.build_dir + '/u-boot', 'rb') as fd:
+        data = fd.read(DECOMP_SIZE)
+    with open(raw, 'wb') as fd:
+        fd.write(data)
+    crc = '%08x' % (zlib.crc32(data) & 0xffffffff)
+    u_boot_utils.run_and_log(cons, ['sh', '-c', '%s -c %s >%s' %
+                                    (tool, raw, comp)])
+
+    src = u_boot_utils.find_ram_base(cons) + 0x1000000
+    dst = src + 0x1000000
+    cons.run_command('host load hostfs - %x %s' % (src, comp))
+    if src_size:
+        cmd += ' %x %x' % (src, os.path.getsize(comp))
+    else:
+        cmd += ' %x' % src
+    decomp = '%s %x %x' % (cmd, dst, len(data))
+    output = cons.run_command_list([decomp, 'crc32 %x %x' % (dst, len(data))])
+    assert crc in output[1]
+
+    usecs = time_loop(cons, decomp, DECOMP_LOOPS)
+    perf.check('decomp.%s' % algo, usecs)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_ut')
+def test_perf_decomp_bench(u_boot_console, perf, perf_decomp_bench):
+    """Record the decompressor benchmark from 'ut compression'
+
+    This covers every decompressor with a host tool to make its input, with
+    several types and sizes of payload. The time recorded is for one
+    decompression.
+    """
+    cons = u_boot_console
+    dirname, max_size = perf_decomp_bench
+    cons.run_command('setenv compression_bench_dir %s' % dirname)
+    cons.run_command('setenv compression_bench_max %x' % max_size)
+    cons.run_command('setenv compression_bench_format csv')
+    with cons.temporary_timeout(DECOMP_BENCH_TIMEOUT):
+        output = cons.run_command(
+            'ut compression compression_test_bench_norun')
+    cons.run_command('setenv compression_bench_format')
+    cons.run_command('setenv compression_bench_max')
+    cons.run_command('setenv compression_bench_dir')
+    assert output.endswith('Failures: 0')
+
+    rows = 0
+    for line in output.splitlines():
+        # payload,size,codec,compressed,count,us,mb_s[,heap]
+        fields = line.strip().split(',')
+        if len(fields) < 7 or not fields[1].isdigit():
+            continue
+        payload, size, codec, _, count, usecs = fields[:6]
+        perf.check('decomp.bench.%s.%s.%s' % (codec, payload, size),
+                   int(usecs) // int(count))
+        rows += 1
+    assert rows, 'No benchmark results'
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_exportenv')
+@pytest.mark.buildconfigspec('cmd_importenv')
+def test_perf_env(u_boot_console, perf):
+    """Record the time taken to import and export the environment"""
+    cons = u_boot_console
+    addr = u_boot_utils.find_ram_base(cons) + 0x1000000
+    env_file = cons.config.result_dir + '/perf-env.txt'
+    with open(env_file, 'w') as fd:
+        for i in range(ENV_VARS):
+            fd.write('perf_env_%d=value of variable %d\n' % (i, i))
+
+    cons.run_command('host load hostfs - %x %s' % (addr, env_file))
+    usecs = time_loop(cons, 'env import -t %x ${filesize}' % addr, ENV_LOOPS)
+    perf.check('env.import', usecs)
+    assert cons.run_command('echo $perf_env_1') == 'value of variable 1'
+
+    usecs = time_loop(cons, 'env export -t %x' % addr, ENV_LOOPS)
+    perf.check('env.export', usecs)
+
+    cons.run_command("setenv perf_loop 'for i in %s; do setenv perf_env_$i; "
+                     "done'" % ' '.join(str(i) for i in range(ENV_VARS)))
+    cons.run_command('run perf_loop; setenv perf_loop')
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('hush_parser')
+@pytest.mark.buildconfigspec('cmd_itest')
+def test_perf_hush(u_boot_console, perf):
+    """Record the time taken to run a small script"""
+    cons = u_boot_console
+    items = ' '.join(str(i) for i in range(100))
+    cons.run_command("setenv perf_script 'for j in %s; do "
+                     "if itest $j == 50; then setenv perf_mid $j; "
+                     "else setenv perf_last $j; fi; done'" % items)
+
+    usecs = time_loop(cons, 'run perf_script', HUSH_LOOPS)
+    perf.check('hush.script', usecs)
+    assert cons.run_command('echo $perf_mid $perf_last') == '50 99'
+    cons.run_command('setenv perf_script; setenv perf_mid; setenv perf_last')
@@ -0,0 +1,66 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# U-Boot FIT signature verification performance test
+
+"""
+Record how long it takes to verify a FIT with signed images. This uses the
+same image source and device tree as the verified-boot test, so it only works
+on sandbox.
+"""
+
+import os
+import pytest
+import u_boot_utils as util
+from perf_helpers import *
+
+# Size of the kernel image in the FIT
+FIT_KERNEL_SIZE = 4 << 20
+
+# Number of times the FIT is verified
+FIT_LOOPS = 10
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('fit_signature')
+@pytest.mark.buildconfigspec('cmd_imi')
+@pytest.mark.requiredtool('dtc')
+@pytest.mark.requiredtool('openssl')
+def test_perf_fit_verify(u_boot_console, perf):
+    """Record the time taken to check the signatures of a FIT"""
+    cons = u_boot_console
+    tmpdir = cons.config.result_dir + '/'
+    datadir = cons.config.source_dir + '/test/py/tests/vboot/'
+    fit = tmpdir + 'perf.fit'
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    dtc_args = '-I dts -O dtb -i %s' % tmpdir
+    dtb = tmpdir + 'sandbox-u-boot.dtb'
+
+    for name in ['sandbox-kernel', 'sandbox-u-boot']:
+        util.run_and_log(cons, 'dtc %s %s%s.dts -O dtb -o %s%s.dtb' %
+                         (dtc_args, datadir, name, tmpdir, name))
+    util.run_and_log(cons, 'openssl genpkey -algorithm RSA -out %sdev.key '
+                     '-pkeyopt rsa_keygen_bits:2048 '
+                     '-pkeyopt rsa_keygen_pubexp:65537' % tmpdir)
+    util.run_and_log(cons, 'openssl req -batch -new -x509 -key %sdev.key '
+                     '-out %sdev.crt' % (tmpdir, tmpdir))
+    with open(tmpdir + 'test-kernel.bin', 'wb') as fd:
+        fd.write(os.urandom(FIT_KERNEL_SIZE))
+    util.run_and_log(cons, [mkimage, '-D', dtc_args, '-f',
+                            datadir + 'sign-images-sha256.its', fit])
+    util.run_and_log(cons, [mkimage, '-F', '-k', tmpdir, '-K', dtb, '-r',
+                            fit])
+
+    # Use a device tree holding the public key
+    old_dtb = cons.config.dtb
+    try:
+        cons.config.dtb = dtb
+        cons.restart_uboot()
+        addr = util.find_ram_base(cons) + 0x100000
+        cons.run_command('host load hostfs - %x %s' % (addr, fit))
+        output = cons.run_command('iminfo %x' % addr)
+        assert 'dev+' in output
+
+        usecs = time_loop(cons, 'iminfo %x' % addr, FIT_LOOPS)
+        perf.check('fit.verify', usecs)
+    finally:
+        cons.config.dtb = old_dtb
+        cons.restart_uboot()
@@ -0,0 +1,39 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# U-Boot filesystem performance test
+
+"""
+Record how long it takes to load a large file from FAT and ext4, both when
+the file is contiguous and when it is badly fragmented.
+"""
+
+import pytest
+import u_boot_utils
+import zlib
+from perf_helpers import *
+
+# Number of times each file is loaded
+FS_LOOPS = 10
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_perf_fs_load(u_boot_console, perf, perf_fs):
+    """Record the time taken to load contiguous and fragmented files"""
+    cons = u_boot_console
+    fs_type, fs_img, big_file = perf_fs
+    addr = u_boot_utils.find_ram_base(cons) + 0x1000000
+    with open(big_file, 'rb') as fd:
+        crc = '%08x' % (zlib.crc32(fd.read()) & 0xffffffff)
+
+    cons.run_command('host bind 0 %s' % fs_img)
+    for name in ['contig', 'frag']:
+        # Check the file is read correctly before timing it
+        output = cons.run_command_list([
+            'load host 0:0 %x %s.bin' % (addr, name),
+            'crc32 %x $filesize' % addr])
+        assert crc in output[1]
+
+        usecs = time_loop(cons, 'load host 0:0 %x %s.bin' % (addr, name),
+                          FS_LOOPS)
+        perf.check('fs.%s.%s' % (fs_type, name), usecs)
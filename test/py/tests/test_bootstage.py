@@ -0,0 +1,69 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+"""
+Test the bootstage report, the nesting of bootstage spans and the export of
+bootstage data as Chrome trace-event JSON.
+"""
+
+import json
+import pytest
+import u_boot_utils
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+def test_bootstage_report(u_boot_console):
+    """Test that the report shows marks, accumulated times and spans"""
+    output = u_boot_console.run_command('bootstage report')
+    assert 'Timer summary in microseconds' in output
+    assert 'reset' in output
+    assert 'Accumulated time:' in output
+    if u_boot_console.config.buildconfig.get('config_bootstage_initcall'):
+        assert 'Spans:' in output
+        assert 'initr_dm' in output
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+def test_bootstage_export(u_boot_console):
+    """Test that the exported JSON is valid and spans nest correctly"""
+    output = u_boot_console.run_command('bootstage export')
+    data = json.loads(output[output.index('{'):])
+    events = data['traceEvents']
+    assert events
+    spans = [ev for ev in events if ev['ph'] == 'X']
+    for span in spans:
+        assert span['dur'] >= 0
+
+    names = [ev['name'] for ev in events]
+    assert 'reset' in names
+    if not u_boot_console.config.buildconfig.get('config_bootstage_initcall'):
+        return
+
+    # Each initcall in board_init_r() runs within the board_init_r span
+    outer = [ev for ev in spans if ev['name'] == 'board_init_r'][0]
+    inner = [ev for ev in spans if ev['name'] == 'initr_dm'][0]
+    assert inner['ts'] >= outer['ts']
+    assert inner['ts'] + inner['dur'] <= outer['ts'] + outer['dur']
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+@pytest.mark.buildconfigspec('bootstage_stash')
+def test_bootstage_stash(u_boot_console):
+    """Test that stashed records can be read back"""
+    addr = u_boot_utils.find_ram_base(u_boot_console) + 0x100000
+    size = 0x10000
+    output = u_boot_console.run_command('bootstage report')
+    before = int(output.split('(')[1].split()[0])
+
+    u_boot_console.run_command('bootstage stash %x %x' % (addr, size))
+    u_boot_console.run_command('bootstage unstash %x %x' % (addr, size))
+    output = u_boot_console.run_command('bootstage report')
+    after = int(output.split('(')[1].split()[0])
+    assert after == before * 2
+
+@pytest.mark.buildconfigspec('cmd_bootstage')
+def test_bootstage_export_mem(u_boot_console):
+    """Test writing the JSON to memory"""
+    addr = u_boot_utils.find_ram_base(u_boot_console) + 0x100000
+    u_boot_console.run_command('bootstage export %x 1' % addr)
+    output = u_boot_console.run_command('echo $?')
+    assert output.endswith('1')
+    u_boot_console.run_command('bootstage export %x 100000' % addr)
+    output = u_boot_console.run_command('printenv filesize')
+    assert int(output.split('=')[1], 16) > 0
@@ -1,8 +1,17 @@
 # SPDX-License-Identifier: GPL-2.0
 # Copyright (c) 2016, NVIDIA CORPORATION. All rights reserved.
 
+import os
 import os.path
 import pytest
+from subprocess import check_call, CalledProcessError
+
+# Size of the file read by 'ut fs'. It is fragmented by writing it after
+# a number of 2KiB files, every other one of which is deleted. The ext4
+# image is filled with them, since otherwise the file goes after them.
+FS_PREAD_SIZE = 300007
+FS_PREAD_SMALL_FAT = 64
+FS_PREAD_SMALL_EXT4 = 1024
 
 @pytest.mark.buildconfigspec('ut_dm')
 def test_ut_dm_init(u_boot_console):
@@ -21,6 +30,60 @@ def test_ut_dm_init(u_boot_console):
         with open(fn, 'wb') as fh:
             fh.write(data)
 
+def mk_pread_fat(fs_img, big, small):
+    """Create a FAT image holding a fragmented copy of the file 'big'."""
+    mtools = 'MTOOLS_SKIP_CHECK=1 %s -i ' + fs_img + ' %s'
+    check_call('mkfs.vfat -C -s 1 %s 2048' % fs_img, shell=True)
+    for i in range(FS_PREAD_SMALL_FAT):
+        check_call(mtools % ('mcopy', '%s ::/s%d' % (small, i)), shell=True)
+    check_call(mtools % ('mdel', ' '.join(['::/s%d' % i
+        for i in range(0, FS_PREAD_SMALL_FAT, 2)])), shell=True)
+    check_call(mtools % ('mcopy', '%s ::/pread.bin' % big), shell=True)
+
+def mk_pread_ext4(fs_img, big, small):
+    """Create an ext4 image holding a fragmented copy of the file 'big'."""
+    check_call('dd if=/dev/zero of=%s bs=1M count=2' % fs_img, shell=True)
+    check_call('mkfs.ext4 -q -b 1024 -N %d -O ^metadata_csum %s' %
+        (FS_PREAD_SMALL_EXT4, fs_img), shell=True)
+    cmds = fs_img + '.cmds'
+    with open(cmds, 'w') as fd:
+        for i in range(FS_PREAD_SMALL_EXT4):
+            fd.write('write %s s%d\n' % (small, i))
+        for i in range(0, FS_PREAD_SMALL_EXT4, 2):
+            fd.write('rm s%d\n' % i)
+        fd.write('write %s pread.bin\n' % big)
+    check_call('debugfs -w -f %s %s' % (cmds, fs_img), shell=True)
+    os.remove(cmds)
+
+@pytest.mark.buildconfigspec('cmd_ut')
+def test_ut_fs_init(u_boot_console):
+    """Create the filesystem images for the ut fs tests.
+
+    The bytes of the file follow fs_test_byte() in test/fs.c. If the tools
+    to create an image are missing, the tests skip that image.
+    """
+
+    dirname = u_boot_console.config.result_dir
+    big = dirname + '/pread.bin'
+    small = dirname + '/pread.small'
+    with open(big, 'wb') as fh:
+        fh.write(bytearray(((i * 7) ^ (i >> 8) ^ (i >> 16)) & 0xff
+                           for i in range(FS_PREAD_SIZE)))
+    with open(small, 'wb') as fh:
+        # debugfs leaves out blocks of zeroes, so fill these with 0xff
+        fh.write(bytearray(b'\xff' * 2048))
+
+    for fs_type, mk_fs in [('fat', mk_pread_fat), ('ext4', mk_pread_ext4)]:
+        fn = '%s/fs_pread.%s.img' % (u_boot_console.config.source_dir,
+                                     fs_type)
+        if os.path.exists(fn):
+            continue
+        try:
+            mk_fs(fn, big, small)
+        except (CalledProcessError, OSError):
+            if os.path.exists(fn):
+                os.remove(fn)
+
 def test_ut(u_boot_console, ut_subtest):
     """Execute a "ut" subtest."""
 
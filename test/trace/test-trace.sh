@@ -23,10 +23,20 @@ trace resume
 hash sha256 0 10000
 trace pause
 trace stats
+trace wrap on
+trace stats
+trace times 0 100000
+trace calls 200000 e00000
+host save hostfs - 200000 ${trace} \${profoffset}
 reset
 END
 }
 
+run_proftool() {
+	./${OUTPUT_DIR}/tools/proftool -m ${OUTPUT_DIR}/System.map \
+		-p ${trace} $1
+}
+
 check_results() {
 	echo "Check results"
 
@@ -35,30 +45,74 @@ check_results() {
 		fail "sha256 error"
 	fi
 
-	# 4 sets of results (output of 'trace stats')
-	if [ $(grep -c "traced function calls" ${tmp}) -ne 4 ]; then
+	# 5 sets of results (output of 'trace stats')
+	if [ $(grep -c "traced function calls" ${tmp}) -ne 5 ]; then
 		fail "trace output error"
 	fi
 
 	# Check trace counts. We expect to see an increase in the number of
 	# traced function calls between each 'trace stats' command, except
-	# between calls 2 and 3, where tracing is paused.
+	# between calls 2 and 3, and 4 and 5, where tracing is paused.
 	# This code gets the sign of the difference between each number and
 	# its predecessor.
 	counts="$(tr -d ',\r' <${tmp} | awk \
 		'/traced function calls/ { diff = $1 - upto; upto = $1; \
 		printf "%d ", diff < 0 ? -1 : (diff > 0 ? 1 : 0)}')"
 
-	if [ "${counts}" != "1 1 0 1 " ]; then
+	if [ "${counts}" != "1 1 0 1 0 " ]; then
 		fail "trace collection error: ${counts}"
 	fi
+
+	# The last 'trace stats' should show that wrapping is enabled
+	if [ $(grep -c "overwrite when full" ${tmp}) -ne 1 ]; then
+		fail "trace wrap error"
+	fi
+
+	if ! grep -q "Function times dumped to" ${tmp}; then
+		fail "trace times error"
+	fi
+
+	if ! grep -q "Call list dumped to" ${tmp}; then
+		fail "trace calls error"
+	fi
+}
+
+check_proftool() {
+	echo "Check proftool output"
+
+	# The profile should include the sha256 functions we ran above
+	if ! run_proftool dump-profile | grep -q "sha256_update$"; then
+		fail "proftool profile error"
+	fi
+
+	# Each flamegraph line is a stack of ';'-separated functions and a
+	# time in microseconds
+	run_proftool dump-flamegraph >${tmp}
+	if ! grep -q "sha256_update" ${tmp} ||
+	   grep -qv '^[^ ]* [0-9][0-9]*$' ${tmp}; then
+		fail "proftool flamegraph error"
+	fi
+
+	# The chrome output must be valid JSON with a list of complete events
+	if ! run_proftool dump-chrome | python3 -c '
+import json, sys
+events = json.load(sys.stdin)["traceEvents"]
+assert events
+for ev in events:
+	assert ev["ph"] == "X" and ev["name"] and ev["dur"] >= 0
+	assert isinstance(ev["ts"], int)
+'; then
+		fail "proftool chrome error"
+	fi
 }
 
 echo "Simple trace test / sanity check using sandbox"
 echo
 tmp="$(tempfile)"
+trace="$(tempfile)"
 build_uboot "${TRACE_OPT}"
 run_trace >${tmp}
 check_results ${tmp}
-rm ${tmp}
+check_proftool
+rm ${tmp} ${trace}
 echo "Test passed"
@@ -21,6 +21,8 @@
 #include <trace.h>
 
 #define MAX_LINE_LEN 500
+#define MAX_CALL_DEPTH 256	/* Deepest call stack we can walk */
+#define FOLD_HASH_SIZE 4096	/* Buckets for merging folded stacks */
 
 enum {
 	FUNCF_TRACE	= 1 << 0,	/* Include this function in trace */
@@ -31,6 +33,9 @@ struct func_info {
 	const char *name;
 	unsigned long code_size;
 	unsigned long call_count;
+	unsigned long timed_calls;	/* Number of calls with times below */
+	unsigned long long incl_us;	/* Time spent including callees */
+	unsigned long long excl_us;	/* Time spent in this function alone */
 	unsigned flags;
 	/* the section this function is in */
 	struct objsection_info *objsection;
@@ -55,6 +60,7 @@ struct func_info *func_list;
 int func_count;
 struct trace_call *call_list;
 int call_count;
+int have_times;		/* Function times were read from the profile */
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 unsigned long text_offset;		/* text address of first function */
 
@@ -85,6 +91,9 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-profile\t\tDump time spent in each function\n"
+		"   dump-flamegraph\tDump folded stacks for flamegraph.pl\n"
+		"   dump-chrome\t\tDump Chrome trace-event JSON\n"
 		"\n"
 		"Options:\n"
 		"   -m <map>\tSpecify Systen.map file\n"
@@ -226,6 +235,52 @@ static int read_calls(FILE *fin, int count)
 	return 0;
 }
 
+static int read_funcs(FILE *fin, int count)
+{
+	struct trace_output_func rec;
+	struct func_info *func;
+	int i, missing = 0;
+
+	notice("function count: %d\n", count);
+	for (i = 0; i < count; i++) {
+		if (read_data(fin, &rec, sizeof(rec)))
+			return 1;
+		func = find_func_by_offset(rec.offset);
+		if (func)
+			func->call_count = rec.call_count;
+		else
+			missing++;
+	}
+	if (missing)
+		warn("%d counted functions not found in map file\n", missing);
+	return 0;
+}
+
+static int read_times(FILE *fin, int count)
+{
+	struct trace_output_time rec;
+	struct func_info *func;
+	int i, missing = 0;
+
+	notice("timed function count: %d\n", count);
+	for (i = 0; i < count; i++) {
+		if (read_data(fin, &rec, sizeof(rec)))
+			return 1;
+		func = find_func_by_offset(rec.offset);
+		if (!func) {
+			missing++;
+			continue;
+		}
+		func->timed_calls = rec.call_count;
+		func->incl_us = rec.incl_us;
+		func->excl_us = rec.excl_us;
+	}
+	if (missing)
+		warn("%d timed functions not found in map file\n", missing);
+	have_times = 1;
+	return 0;
+}
+
 static int read_profile(FILE *fin, int *not_found)
 {
 	struct trace_output_hdr hdr;
@@ -242,13 +297,24 @@ static int read_profile(FILE *fin, int *not_found)
 
 		switch (hdr.type) {
 		case TRACE_CHUNK_FUNCS:
-			/* Ignored at present */
+			if (read_funcs(fin, hdr.rec_count))
+				return 1;
 			break;
 
 		case TRACE_CHUNK_CALLS:
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_TIMES:
+			if (read_times(fin, hdr.rec_count))
+				return 1;
+			break;
+
+		default:
+			error("Unknown chunk type %d at pos %ld\n", hdr.type,
+			      ftell(fin));
+			return 1;
 		}
 	}
 	return 0;
@@ -532,6 +598,295 @@ static int make_ftrace(void)
 	return 0;
 }
 
+/* A function call which has not yet returned, while walking the call list */
+struct call_frame {
+	struct func_info *func;
+	unsigned long long start_us;	/* Time when the function was entered */
+	unsigned long long child_us;	/* Time spent in callees so far */
+};
+
+/**
+ * Function called by walk_calls() for each function which returns
+ *
+ * @ctx:	Context pointer passed to walk_calls()
+ * @stack:	Stack of calls, with the returning function at the top
+ * @depth:	Number of entries in @stack
+ * @dur_us:	Time spent in the function, including callees
+ * @excl_us:	Time spent in the function itself
+ */
+typedef void (*walk_func)(void *ctx, struct call_frame *stack, int depth,
+			  unsigned long long dur_us,
+			  unsigned long long excl_us);
+
+/*
+ * Walk through the call list, matching each function exit with its entry.
+ * Exits with no entry (e.g. for functions called before tracing started, or
+ * whose entry was overwritten in ring mode) are ignored, as are entries with
+ * no exit.
+ */
+static int walk_calls(walk_func func, void *ctx)
+{
+	struct call_frame stack[MAX_CALL_DEPTH];
+	int missing_count = 0, unmatched_count = 0;
+	unsigned long long now = 0;
+	struct trace_call *call;
+	ulong last = 0;
+	int depth = 0;
+	int i, d;
+
+	for (i = 0, call = call_list; i < call_count; i++, call++) {
+		ulong time = call->flags & FUNCF_TIMESTAMP_MASK;
+		struct call_frame *frame;
+		unsigned long long dur;
+		struct func_info *fn;
+
+		if (TRACE_CALL_TYPE(call) != FUNCF_ENTRY &&
+		    TRACE_CALL_TYPE(call) != FUNCF_EXIT)
+			continue;
+
+		/* The timestamp wraps, so keep our own 64-bit time */
+		now += (time - last) & FUNCF_TIMESTAMP_MASK;
+		last = time;
+		fn = find_func_by_offset(call->func);
+		if (!fn) {
+			missing_count++;
+			continue;
+		}
+
+		if (TRACE_CALL_TYPE(call) == FUNCF_ENTRY) {
+			if (depth == MAX_CALL_DEPTH) {
+				error("Call depth exceeds %d\n", MAX_CALL_DEPTH);
+				return -1;
+			}
+			frame = &stack[depth++];
+			frame->func = fn;
+			frame->start_us = now;
+			frame->child_us = 0;
+			continue;
+		}
+
+		/* Drop any callees whose exit was not recorded */
+		for (d = depth - 1; d >= 0 && stack[d].func != fn; d--)
+			;
+		if (d < 0) {
+			unmatched_count++;
+			continue;
+		}
+		frame = &stack[d];
+		dur = now - frame->start_us;
+		func(ctx, stack, d + 1, dur,
+		     dur > frame->child_us ? dur - frame->child_us : 0);
+		if (d)
+			frame[-1].child_us += dur;
+		depth = d;
+	}
+	info("walk: %d functions not found, %d exits without entry\n",
+	     missing_count, unmatched_count);
+
+	return 0;
+}
+
+static void add_profile_time(void *ctx, struct call_frame *stack, int depth,
+			     unsigned long long dur_us,
+			     unsigned long long excl_us)
+{
+	struct func_info *func = stack[depth - 1].func;
+
+	func->timed_calls++;
+	func->incl_us += dur_us;
+	func->excl_us += excl_us;
+}
+
+static int h_cmp_excl_us(const void *v1, const void *v2)
+{
+	const struct func_info *f1 = *(struct func_info **)v1;
+	const struct func_info *f2 = *(struct func_info **)v2;
+
+	if (f1->excl_us != f2->excl_us)
+		return f1->excl_us < f2->excl_us ? 1 : -1;
+	return strcmp(f1->name, f2->name);
+}
+
+/*
+ * Show the time spent in each function, most expensive first. The times come
+ * from U-Boot's 'trace times' data if present, else from the call list.
+ */
+static int make_profile(void)
+{
+	struct func_info **list, *func, *end;
+	unsigned long long total_us = 0;
+	int count, i;
+
+	if (!have_times && walk_calls(add_profile_time, NULL))
+		return -1;
+
+	list = calloc(func_count, sizeof(*list));
+	if (!list) {
+		error("Cannot allocate profile list\n");
+		return -1;
+	}
+	count = 0;
+	for (func = func_list, end = func + func_count; func < end; func++) {
+		if (func->timed_calls && (func->flags & FUNCF_TRACE)) {
+			list[count++] = func;
+			total_us += func->excl_us;
+		}
+	}
+	qsort(list, count, sizeof(*list), h_cmp_excl_us);
+
+	printf("%10s %12s %12s %6s  %s\n", "calls", "incl_us", "excl_us",
+	       "excl%", "function");
+	for (i = 0; i < count; i++) {
+		func = list[i];
+		printf("%10lu %12llu %12llu %6.2f  %s\n", func->timed_calls,
+		       func->incl_us, func->excl_us,
+		       total_us ? func->excl_us * 100.0 / total_us : 0.0,
+		       func->name);
+	}
+	free(list);
+
+	return 0;
+}
+
+/* A folded stack and the time spent with that stack, for a flame graph */
+struct fold_info {
+	struct fold_info *next;		/* Next in hash chain */
+	char *stack;			/* Function names separated by ; */
+	unsigned long long us;		/* Total exclusive time */
+};
+
+struct fold_table {
+	struct fold_info *bucket[FOLD_HASH_SIZE];
+	int count;
+};
+
+static void add_folded(void *ctx, struct call_frame *stack, int depth,
+		       unsigned long long dur_us, unsigned long long excl_us)
+{
+	struct fold_table *table = ctx;
+	char buf[MAX_CALL_DEPTH * 64];
+	struct fold_info *fold;
+	unsigned int hash;
+	char *p, *end;
+	int i;
+
+	/* Excluded functions are left out, so their caller gets the time */
+	p = buf;
+	end = buf + sizeof(buf);
+	*p = '\0';
+	for (i = 0; i < depth; i++) {
+		struct func_info *func = stack[i].func;
+
+		if (!(func->flags & FUNCF_TRACE))
+			continue;
+		p += snprintf(p, end - p, "%s%s", p == buf ? "" : ";",
+			      func->name);
+		if (p >= end) {
+			warn("Folded stack too long\n");
+			return;
+		}
+	}
+	if (p == buf || !excl_us)
+		return;
+
+	for (hash = 0, p = buf; *p; p++)
+		hash = hash * 31 + *p;
+	hash %= FOLD_HASH_SIZE;
+	for (fold = table->bucket[hash]; fold; fold = fold->next) {
+		if (!strcmp(fold->stack, buf))
+			break;
+	}
+	if (!fold) {
+		fold = calloc(1, sizeof(*fold));
+		assert(fold);
+		fold->stack = strdup(buf);
+		assert(fold->stack);
+		fold->next = table->bucket[hash];
+		table->bucket[hash] = fold;
+		table->count++;
+	}
+	fold->us += excl_us;
+}
+
+static int h_cmp_fold(const void *v1, const void *v2)
+{
+	const struct fold_info *f1 = *(struct fold_info **)v1;
+	const struct fold_info *f2 = *(struct fold_info **)v2;
+
+	return strcmp(f1->stack, f2->stack);
+}
+
+/*
+ * Write out the call list as 'folded' stacks, one per line, each followed by
+ * the time in microseconds spent in the last function with that stack. This
+ * is the input format of Brendan Gregg's flamegraph.pl
+ */
+static int make_flamegraph(void)
+{
+	struct fold_info **list, *fold;
+	struct fold_table *table;
+	int i, count;
+
+	table = calloc(1, sizeof(*table));
+	if (!table) {
+		error("Cannot allocate fold table\n");
+		return -1;
+	}
+	if (walk_calls(add_folded, table))
+		return -1;
+
+	list = calloc(table->count, sizeof(*list));
+	assert(!table->count || list);
+	for (i = count = 0; i < FOLD_HASH_SIZE; i++) {
+		for (fold = table->bucket[i]; fold; fold = fold->next)
+			list[count++] = fold;
+	}
+	qsort(list, count, sizeof(*list), h_cmp_fold);
+	for (i = 0; i < count; i++) {
+		printf("%s %llu\n", list[i]->stack, list[i]->us);
+		free(list[i]->stack);
+		free(list[i]);
+	}
+	info("flamegraph: %d stacks\n", count);
+	free(list);
+	free(table);
+
+	return 0;
+}
+
+static void add_chrome_event(void *ctx, struct call_frame *stack, int depth,
+			     unsigned long long dur_us,
+			     unsigned long long excl_us)
+{
+	struct call_frame *frame = &stack[depth - 1];
+	int *countp = ctx;
+
+	if (!(frame->func->flags & FUNCF_TRACE))
+		return;
+	printf("%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,"
+	       "\"pid\":1,\"tid\":1}", *countp ? "," : "", frame->func->name,
+	       frame->start_us, dur_us);
+	(*countp)++;
+}
+
+/*
+ * Write out the call list in the Chrome trace-event format, which can be
+ * loaded into chrome://tracing or Perfetto. Each function call becomes a
+ * 'complete' event with a start time and duration in microseconds.
+ */
+static int make_chrome(void)
+{
+	int count = 0;
+
+	printf("{\"traceEvents\":[");
+	if (walk_calls(add_chrome_event, &count))
+		return -1;
+	printf("\n],\"displayTimeUnit\":\"ms\"}\n");
+	info("chrome: %d events\n", count);
+
+	return 0;
+}
+
 static int prof_tool(int argc, char * const argv[],
 		     const char *prof_fname, const char *map_fname,
 		     const char *trace_config_fname)
@@ -552,6 +907,12 @@ static int prof_tool(int argc, char * const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-profile"))
+			err = make_profile();
+		else if (0 == strcmp(cmd, "dump-flamegraph"))
+			err = make_flamegraph();
+		else if (0 == strcmp(cmd, "dump-chrome"))
+			err = make_chrome();
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}